@@ -3,6 +3,7 @@
 #include <SDL2/SDL_image.h>
 #include <GL/glew.h>
 #include "cglm/cglm.h"
+#include "glstate.h"
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
@@ -121,12 +122,12 @@ int main()
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
+    GLState_bindVertexArray(VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    GLState_bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     // position attribute
@@ -140,11 +141,11 @@ int main()
     glEnableVertexAttribArray(2);
 
     // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's bound vertex buffer object so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, 0);
 
     // You can unbind the VAO afterwards so other VAO calls won't accidentally modify this VAO, but this rarely happens. Modifying other
     // VAOs requires a call to glBindVertexArray anyways so we generally don't unbind VAOs (nor VBOs) when it's not directly necessary.
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
 
     SDL_Surface *surface = IMG_Load("./resources/wall.jpg");
     if (!surface)
@@ -155,7 +156,7 @@ int main()
     unsigned int textures[2];
     glGenTextures(2, textures);
 
-    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    GLState_bindTexture(0, GL_TEXTURE_2D, textures[0]);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -176,7 +177,7 @@ int main()
         SDL_Log("Error loading image: %s", IMG_GetError());
     }
 
-    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    GLState_bindTexture(0, GL_TEXTURE_2D, textures[1]);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -190,7 +191,7 @@ int main()
     glGenerateMipmap(GL_TEXTURE_2D);
     SDL_FreeSurface(surface);
 
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
     glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
     glUniform1i(glGetUniformLocation(shaderProgram, "texture2"), 1);
 
@@ -221,13 +222,11 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        GLState_bindTexture(0, GL_TEXTURE_2D, textures[0]);
+        GLState_bindTexture(1, GL_TEXTURE_2D, textures[1]);
 
-        glUseProgram(shaderProgram);
-        glBindVertexArray(VAO);                              // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+        GLState_useProgram(shaderProgram);
+        GLState_bindVertexArray(VAO);                        // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0); // set the count to 6 since we're drawing 6 vertices now (2 triangles); not 3!
         // glBindVertexArray(0); // no need to unbind it every time
 
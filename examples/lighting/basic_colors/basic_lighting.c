@@ -2,6 +2,7 @@
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include "cglm/cglm.h"
+#include "glstate.h"
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
@@ -182,8 +183,8 @@ int main()
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindVertexArray(VAO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
@@ -192,17 +193,17 @@ int main()
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), 3 * sizeof(float));
     glEnableVertexAttribArray(1);
 
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
 
     unsigned int lightVAO;
     glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
+    GLState_bindVertexArray(lightVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
 
     // Preparation for the shaders
     mat4 projection;
@@ -210,7 +211,7 @@ int main()
     glm_perspective(glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f, projection);
 
     /* Sets UP the shader for the objects in the scene */
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
 
     // Lighting Uniforms
     unsigned int objColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
@@ -233,7 +234,7 @@ int main()
     // ------------------------------------------------------------
 
     // Sets UP the shader for the light in the scene
-    glUseProgram(lightShaderProgram);
+    GLState_useProgram(lightShaderProgram);
 
     projectionLoc = glGetUniformLocation(shaderProgram, "projection");
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)projection);
@@ -269,7 +270,7 @@ int main()
 
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+                    GLState_polygonMode(GL_LINE);
                 }
             }
             break;
@@ -277,7 +278,7 @@ int main()
             {
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                    GLState_polygonMode(GL_FILL);
                 }
             }
             break;
@@ -295,21 +296,21 @@ int main()
 
         glClearBufferfv(GL_COLOR, 0, (vec4){0.2f, 0.3f, 0.3f, 1.0f});
 
-        glUseProgram(shaderProgram);
+        GLState_useProgram(shaderProgram);
 
         unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
         glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)view);
 
-        glBindVertexArray(VAO);                               // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+        GLState_bindVertexArray(VAO);                         // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         glDrawArrays(GL_TRIANGLES, 0, 36); // set the count to 6 since we're drawing 6 vertices now (2 triangles); not 3!
 
         // draw our first triangle
-        glUseProgram(lightShaderProgram);
+        GLState_useProgram(lightShaderProgram);
 
         viewLoc = glGetUniformLocation(shaderProgram, "view");
         glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)view);
 
-        glBindVertexArray(lightVAO);                          // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+        GLState_bindVertexArray(lightVAO);                    // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         glDrawArrays(GL_TRIANGLES, 0, 36); // set the count to 6 since we're drawing 6 vertices now (2 triangles); not 3!
         // glBindVertexArray(0); // no need to unbind it every time
 
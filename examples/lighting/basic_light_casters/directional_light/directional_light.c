@@ -4,10 +4,45 @@
 #include <GL/glew.h>
 
 #include "cglm/cglm.h"
+#include "bvh.h"
+#include "cascade.h"
+#include "frustum.h"
+#include "glstate.h"
+#include "job.h"
+#include "mesharena.h"
+#include "multidraw.h"
+#include "probes.h"
+#include "quadtree.h"
+#include "ringbuffer.h"
+#include "scene.h"
+#include "shader.h"
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
 
+#define CUBE_COUNT 10
+#define CUBE_RADIUS 0.87f // unit cube under any rotation
+
+// static pillars standing on a ground slab around the spinning cubes
+#define PILLAR_SIDE 16
+#define PILLAR_SPACING 4.0f
+#define PILLAR_HEIGHT 3.0f
+#define GROUND_Y -4.5f
+#define MAX_OBJECTS (CUBE_COUNT + PILLAR_SIDE * PILLAR_SIDE)
+
+#define NEAR_PLANE 0.1f
+#define FAR_PLANE 100.0f
+#define SHADOW_SIZE 2048
+#define SHADOW_UNIT 2 // after the material's diffuse and specular maps
+#define PROBE_UNIT 3
+
+// ambient probes a pillar spacing apart, offset so none sits inside a pillar
+#define PROBES_X 17
+#define PROBES_Y 3
+#define PROBES_Z 17
+#define PROBE_SAMPLES 256
+#define PROBE_BOUNCES 2
+
 bool isRunning = false;
 static SDL_Window *window;
 static SDL_GLContext *context;
@@ -21,11 +56,44 @@ typedef struct Light
 {
     vec3 direction;
 
-    vec3 ambient;
+    vec3 ambient; // the sky the ambient probes are baked under
     vec3 diffuse;
     vec3 specular;
 } Light;
 
+typedef struct ObjectBatch
+{
+    MeshArena *arena;
+    const Mesh *mesh;
+    MultiDraw *draws;
+    RingBuffer *models;
+} ObjectBatch;
+
+// Draws the listed objects as one multi-draw, their model matrices streamed
+// through the ring; extra, when set, is one more model drawn last.
+static int drawObjects(ObjectBatch *batch, mat4 *models, const int *indices, int count, mat4 extra)
+{
+    int total = count + (extra ? 1 : 0);
+    if (total == 0)
+        return 0;
+
+    MultiDrawData modelData = {batch->models->buffer, 0, 3, 4, sizeof(mat4)};
+    mat4 *data = RingBuffer_alloc(batch->models, total * sizeof(mat4), sizeof(vec4), &modelData.offset);
+    if (!data)
+        return 0;
+
+    for (int v = 0; v < count; v++)
+        glm_mat4_copy(models[indices[v]], data[MultiDraw_add(batch->draws, batch->mesh, 1)]);
+
+    if (extra)
+        glm_mat4_copy(extra, data[MultiDraw_add(batch->draws, batch->mesh, 1)]);
+
+    RingBuffer_flush(batch->models);
+    MultiDraw_submit(batch->draws, batch->arena, GL_TRIANGLES, &modelData);
+
+    return total;
+}
+
 int init()
 {
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS | SDL_INIT_GAMECONTROLLER) != 0)
@@ -70,7 +138,9 @@ int main()
         return 1;
     }
 
-    void *vertexShaderSource = SDL_LoadFile("./shaders/common.vert", NULL);
+    Job_init(0);
+
+    void *vertexShaderSource = SDL_LoadFile("./shaders/instanced.vert", NULL);
     void *fragmentShaderSource = SDL_LoadFile("./shaders/objects.frag", NULL);
 
     unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -164,7 +234,7 @@ int main()
         -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f};
 
     // world space positions of our cubes
-    vec3 cubePositions[10] = {
+    vec3 cubePositions[CUBE_COUNT] = {
         {0.0f, 0.0f, 0.0f},
         {3.0f, 5.0f, -15.0f},
         {-3.5f, -2.2f, -2.5f},
@@ -176,24 +246,92 @@ int main()
         {3.5f, 0.2f, -1.5f},
         {-3.3f, 1.0f, -1.5f}};
 
-    unsigned int VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    // cubes only spin in place and pillars never move, so no bounds ever change
+    vec3 objectMins[MAX_OBJECTS], objectMaxs[MAX_OBJECTS];
+
+    // every object is a scene node of the same index, the ground comes last;
+    // only the spinning cubes are ever touched after this
+    Scene scene;
+    Scene_init(&scene, MAX_OBJECTS + 1);
+
+    versor noRotation;
+    glm_quat_identity(noRotation);
+    for (int i = 0; i < CUBE_COUNT; i++)
+    {
+        glm_vec3_subs(cubePositions[i], CUBE_RADIUS, objectMins[i]);
+        glm_vec3_adds(cubePositions[i], CUBE_RADIUS, objectMaxs[i]);
+        Scene_add(&scene, -1, cubePositions[i], noRotation, (vec3){1.0f, 1.0f, 1.0f});
+    }
+
+    int objectCount = CUBE_COUNT;
+    for (int z = 0; z < PILLAR_SIDE; z++)
+    {
+        for (int x = 0; x < PILLAR_SIDE; x++)
+        {
+            vec3 position = {(x - PILLAR_SIDE / 2 + 0.5f) * PILLAR_SPACING, GROUND_Y + PILLAR_HEIGHT * 0.5f, (z - PILLAR_SIDE / 2 + 0.5f) * PILLAR_SPACING};
+
+            // keep clear of the spinning cubes
+            bool blocked = false;
+            for (int i = 0; i < CUBE_COUNT; i++)
+                blocked |= fabsf(position[0] - cubePositions[i][0]) < 2.0f && fabsf(position[2] - cubePositions[i][2]) < 2.0f;
+
+            if (blocked)
+                continue;
+
+            vec3 extent = {0.5f, PILLAR_HEIGHT * 0.5f, 0.5f};
+            glm_vec3_sub(position, extent, objectMins[objectCount]);
+            glm_vec3_add(position, extent, objectMaxs[objectCount]);
+
+            Scene_add(&scene, -1, position, noRotation, (vec3){1.0f, PILLAR_HEIGHT, 1.0f});
+            objectCount++;
+        }
+    }
+
+    Quadtree objectTree;
+    Quadtree_build(&objectTree, objectMins, objectMaxs, objectCount, 4);
+
+    // receives shadows only, nothing is below it
+    int groundNode = Scene_add(&scene, -1, (vec3){0.0f, GROUND_Y - 0.1f, 0.0f}, noRotation,
+                               (vec3){PILLAR_SIDE * PILLAR_SPACING + 20.0f, 0.2f, PILLAR_SIDE * PILLAR_SPACING + 20.0f});
+
+    Scene_update(&scene);
+    mat4 *objectModels = scene.worlds;
+    vec4 *groundModel = scene.worlds[groundNode];
+
+    // the static geometry as world space triangles, for baking; the spinning cubes are left out
+    int staticCount = objectCount - CUBE_COUNT + 1;
+    vec3 *sceneTriangles = SDL_malloc(staticCount * 36 * sizeof(vec3));
+    for (int o = 0; o < staticCount; o++)
+    {
+        float(*model)[4] = o + CUBE_COUNT < objectCount ? objectModels[o + CUBE_COUNT] : groundModel;
+        for (int v = 0; v < 36; v++)
+            glm_mat4_mulv3(model, &vertices[v * 8], 1.0f, sceneTriangles[o * 36 + v]);
+    }
+
+    Bvh sceneBvh;
+    Bvh_build(&sceneBvh, sceneTriangles, staticCount * 12);
+    SDL_free(sceneTriangles);
+
+    // position, normal, texture coords
+    MeshFormat format = {8 * sizeof(float), 3, {{3, 0}, {3, 3 * sizeof(float)}, {2, 6 * sizeof(float)}}};
+
+    MeshArena meshes;
+    MeshArena_init(&meshes, &format, 1024, 1024);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    Mesh cube;
+    MeshArena_add(&meshes, vertices, 36, NULL, 0, &cube);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
+    // each object is one draw of a batch, its model matrix the draw's instance attribute;
+    // a frame has a batch per cascade and one for the camera
+    int drawsPerFrame = (SHADOW_CASCADES + 1) * (MAX_OBJECTS + 1);
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    MultiDraw objectDraws;
+    MultiDraw_init(&objectDraws, drawsPerFrame);
 
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    RingBuffer frameModels;
+    RingBuffer_init(&frameModels, GL_ARRAY_BUFFER, drawsPerFrame * sizeof(mat4));
 
-    glBindVertexArray(0);
+    ObjectBatch batch = {&meshes, &cube, &objectDraws, &frameModels};
 
     SDL_Surface *surface = IMG_Load("./resources/container.png");
     if (!surface)
@@ -204,7 +342,7 @@ int main()
     unsigned int textures[2];
     glGenTextures(2, textures);
 
-    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    GLState_bindTexture(0, GL_TEXTURE_2D, textures[0]);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -225,7 +363,7 @@ int main()
         SDL_Log("Error loading image: %s", IMG_GetError());
     }
 
-    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    GLState_bindTexture(0, GL_TEXTURE_2D, textures[1]);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -239,7 +377,7 @@ int main()
     glGenerateMipmap(GL_TEXTURE_2D);
     SDL_FreeSurface(surface);
 
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
     glUniform1i(glGetUniformLocation(shaderProgram, "material.diffuse"), 0);
     glUniform1i(glGetUniformLocation(shaderProgram, "material.specular"), 1);
 
@@ -258,20 +396,19 @@ int main()
 
     mat4 projection;
     glm_mat4_identity(projection);
-    glm_perspective(glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f, projection);
+    glm_perspective(glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, NEAR_PLANE, FAR_PLANE, projection);
 
     mat4 view;
     glm_mat4_identity(view);
     glm_lookat(viewPos, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 1.0f, 0.0f}, view);
 
     /* Sets UP the shader for the objects in the scene */
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
 
     // Lighting Uniforms
     unsigned int matShininessLoc = glGetUniformLocation(shaderProgram, "material.shininess");
 
     unsigned int lightDirLoc = glGetUniformLocation(shaderProgram, "light.direction");
-    unsigned int lightAmbientLoc = glGetUniformLocation(shaderProgram, "light.ambient");
     unsigned int lightDiffuseLoc = glGetUniformLocation(shaderProgram, "light.diffuse");
     unsigned int lightSpecularLoc = glGetUniformLocation(shaderProgram, "light.specular");
 
@@ -280,7 +417,6 @@ int main()
     glUniform1f(matShininessLoc, material.shininess);
 
     glUniform3fv(lightDirLoc, 1, light.direction);
-    glUniform3fv(lightAmbientLoc, 1, light.ambient);
     glUniform3fv(lightDiffuseLoc, 1, light.diffuse);
     glUniform3fv(lightSpecularLoc, 1, light.specular);
 
@@ -294,10 +430,50 @@ int main()
     unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)view);
 
-    unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
     // ------------------------------------------------------------
 
-    glEnable(GL_DEPTH_TEST);
+    // Sets up the shadow maps and the depth only program that fills them
+    ShadowCascades cascades;
+    Cascade_init(&cascades, SHADOW_SIZE, glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, NEAR_PLANE, FAR_PLANE, 0.75f);
+
+    GLuint shadowProgram = CreateProgram("./shaders/shadow.vert", "./shaders/shadow.frag");
+    GLint lightViewProjectionLoc = glGetUniformLocation(shadowProgram, "lightViewProjection");
+
+    // ------------------------------------------------------------
+
+    // Bakes the ambient: the light's ambient is the sky, the sun bounces off the scene
+    float probeExtent = (PROBES_X - 1) * PILLAR_SPACING * 0.5f;
+    ProbeGrid probes;
+    Probe_init(&probes, (vec3){-probeExtent, GROUND_Y + 0.5f, -probeExtent}, (vec3){probeExtent, GROUND_Y + PILLAR_HEIGHT + 1.0f, probeExtent}, PROBES_X, PROBES_Y, PROBES_Z);
+
+    ProbeBakeSettings bakeSettings = {
+        .albedo = 0.5f,
+        .samples = PROBE_SAMPLES,
+        .bounces = PROBE_BOUNCES,
+        .seed = 1};
+    glm_vec3_copy(light.ambient, bakeSettings.skyColor);
+    glm_vec3_copy(light.direction, bakeSettings.sunDirection);
+    glm_vec3_copy(light.diffuse, bakeSettings.sunColor);
+
+    Probe_bake(&probes, &sceneBvh, &bakeSettings);
+    SDL_Log("probes: %d baked with %d paths each, %.2f Mrays in %.1f ms on %d workers",
+            probes.stats.probes, PROBE_SAMPLES, probes.stats.rays / 1e6, probes.stats.bakeMs, Job_workerCount());
+
+    // ------------------------------------------------------------
+
+    mat4 viewProjection;
+    glm_mat4_mul(projection, view, viewProjection);
+
+    Frustum frustum;
+    Frustum_extract(&frustum, viewProjection);
+
+    int visibleObjects[MAX_OBJECTS];
+    CullStats cullStats;
+    int frameCount = 0;
+
+    // setup above bound objects behind the cache's back
+    GLState_invalidate();
+    GLState_enable(GL_DEPTH_TEST);
 
     while (isRunning)
     {
@@ -321,7 +497,7 @@ int main()
 
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+                    GLState_polygonMode(GL_LINE);
                 }
             }
             break;
@@ -329,42 +505,91 @@ int main()
             {
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                    GLState_polygonMode(GL_FILL);
                 }
             }
             break;
             }
         }
 
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // the cubes spin, the pillars and ground were placed once up front
+        for (int i = 0; i < CUBE_COUNT; i++)
+        {
+            float angle = 20.0f * i + 20.0f;
+            versor spin;
+            glm_quatv(spin, glm_rad(angle + (SDL_GetTicks64() / 100.0f) * (i + 1)), (vec3){1.0f, 0.3f, 0.5f});
+            Scene_setRotation(&scene, i, spin);
+        }
+        Scene_update(&scene);
 
-        glUseProgram(shaderProgram);
+        MultiDraw_beginFrame(&objectDraws);
+        RingBuffer_beginFrame(&frameModels);
 
-        glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        // shadow pass, only the cascades due this frame
+        Cascade_update(&cascades, view, light.direction);
+        GLState_useProgram(shadowProgram);
 
-        for (unsigned int i = 0; i < 10; i++)
+        for (int c = 0; c < SHADOW_CASCADES; c++)
         {
-            // calculate the model matrix for each object and pass it to shader before drawing
-            mat4 model;
-            glm_mat4_identity(model);
+            if (!cascades.due[c])
+                continue;
 
-            glm_translate(model, cubePositions[i]);
+            Cascade_begin(&cascades, c);
+            glUniformMatrix4fv(lightViewProjectionLoc, 1, GL_FALSE, (float *)cascades.viewProjections[c]);
 
-            float angle = 20.0f * i + 20.0f;
+            int casterCount = Quadtree_cull(&objectTree, &cascades.frustums[c], visibleObjects, &cullStats);
+            int drawn = drawObjects(&batch, objectModels, visibleObjects, casterCount, NULL);
+
+            Cascade_end(&cascades, c, drawn, cullStats.tested);
+        }
+
+        Cascade_finish(&cascades, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+        // camera pass
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            glm_rotate(model, glm_rad(angle + (SDL_GetTicks64() / 100.0f) * (i + 1)), (vec3){1.0f, 0.3f, 0.5f});
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
+        GLState_useProgram(shaderProgram);
+        GLState_bindTexture(0, GL_TEXTURE_2D, textures[0]);
+        GLState_bindTexture(1, GL_TEXTURE_2D, textures[1]);
+        Cascade_bind(&cascades, shaderProgram, SHADOW_UNIT);
+        Probe_bind(&probes, shaderProgram, PROBE_UNIT);
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        int visibleCount = Quadtree_cull(&objectTree, &frustum, visibleObjects, &cullStats);
+        drawObjects(&batch, objectModels, visibleObjects, visibleCount, groundModel);
+
+        MultiDraw_endFrame(&objectDraws);
+        RingBuffer_endFrame(&frameModels);
+
+        if (++frameCount % 120 == 0)
+        {
+            SDL_Log("culling: %d tested, %d of %d objects visible, drawn as one %s batch",
+                    cullStats.tested, cullStats.visible, objectCount, MultiDraw_pathName(MultiDraw_getPath()));
+
+            SceneStats sceneStats = Scene_stats(&scene);
+            SDL_Log("scene: %d nodes, %d changed, %d world matrices rebuilt", sceneStats.nodes, sceneStats.dirty, sceneStats.rebuilt);
+
+            for (int c = 0; c < SHADOW_CASCADES; c++)
+            {
+                CascadeStats *stats = &cascades.stats[c];
+                SDL_Log("cascade %d (%5.1f - %5.1f): %3d casters, %3d tests, %d frames old, cpu %.3f ms, gpu %.3f ms",
+                        c, cascades.splits[c], cascades.splits[c + 1], stats->draws, stats->tested, stats->age, stats->cpuMs, stats->gpuMs);
+            }
         }
 
         SDL_GL_SwapWindow(window);
     }
 
+    Probe_free(&probes);
+    Bvh_free(&sceneBvh);
+    Cascade_free(&cascades);
+    glDeleteProgram(shadowProgram);
+    RingBuffer_free(&frameModels);
+    MultiDraw_free(&objectDraws);
+    MeshArena_free(&meshes);
+    Quadtree_free(&objectTree);
+    Scene_free(&scene);
+    Job_shutdown();
+
     return 0;
 }
\ No newline at end of file
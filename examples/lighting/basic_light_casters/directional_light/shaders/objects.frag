@@ -9,7 +9,6 @@ struct Material {
 struct Light {
     vec3 direction;
 
-    vec3 ambient;
     vec3 diffuse;
     vec3 specular;
 };
@@ -17,6 +16,18 @@ struct Light {
 uniform Material material;
 uniform Light light;
 uniform vec3 viewPos;
+uniform mat4 view;
+
+// filled by Cascade_bind, see src/cascade.h
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 cascadeMatrices[4];
+uniform float cascadeSplits[4]; // far view depth of each cascade
+
+// filled by Probe_bind, see src/probes.h
+uniform sampler3D probeGrid;
+uniform vec3 probeMin;
+uniform vec3 probeMax;
+uniform ivec3 probeCounts;
 
 in vec3 Normal;
 in vec3 FragPos;
@@ -24,14 +35,63 @@ in vec2 TexCoords;
 
 out vec4 FragColor;
 
+// 1 lit, 0 shadowed; 3x3 taps of the hardware-filtered comparison
+float shadow() {
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+
+    int cascade = 3;
+    for (int i = 0; i < 3; i++) {
+        if (depth < cascadeSplits[i]) {
+            cascade = i;
+            break;
+        }
+    }
+
+    // orthographic, w is 1
+    vec3 coords = (cascadeMatrices[cascade] * vec4(FragPos, 1.0)).xyz * 0.5 + 0.5;
+    if (coords.z > 1.0)
+        return 1.0;
+
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texel, cascade, coords.z - 0.0005));
+        }
+    }
+
+    return lit / 9.0;
+}
+
+// diffuse irradiance over pi, from the L2 harmonics of the surrounding probes
+vec3 probeAmbient(vec3 position, vec3 n) {
+    // texel centres of slab 0; slab i is the same lookup i grid depths further on
+    vec3 cell = clamp((position - probeMin) / (probeMax - probeMin), 0.0, 1.0) * vec3(probeCounts - 1) + 0.5;
+    vec3 size = vec3(probeCounts.xy, probeCounts.z * 7);
+
+    vec4 t[7];
+    for (int i = 0; i < 7; i++)
+        t[i] = texture(probeGrid, (cell + vec3(0.0, 0.0, i * probeCounts.z)) / size);
+
+    return t[0].xyz * 0.282095
+        + vec3(t[0].w, t[1].xy) * 0.488603 * n.y
+        + vec3(t[1].zw, t[2].x) * 0.488603 * n.z
+        + t[2].yzw * 0.488603 * n.x
+        + t[3].xyz * 1.092548 * n.x * n.y
+        + vec3(t[3].w, t[4].xy) * 1.092548 * n.y * n.z
+        + vec3(t[4].zw, t[5].x) * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + t[5].yzw * 1.092548 * n.x * n.z
+        + t[6].xyz * 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
 void main() {
     vec3 lightDir = normalize(-light.direction);
 
-    // ambient
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
+    // ambient, baked
+    vec3 norm = normalize(Normal);
+    vec3 ambient = max(probeAmbient(FragPos, norm), 0.0) * vec3(texture(material.diffuse, TexCoords));
 
     // diffuse
-    vec3 norm = normalize(Normal);
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
 
@@ -42,6 +102,6 @@ void main() {
     vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
 
     // result (phong)
-    vec3 result = ambient + diffuse + specular;
+    vec3 result = ambient + shadow() * (diffuse + specular);
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
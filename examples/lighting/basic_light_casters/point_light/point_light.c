@@ -3,10 +3,49 @@
 #include <SDL2/SDL_image.h>
 #include <GL/glew.h>
 #include "cglm/cglm.h"
+#include "cluster.h"
+#include "cull.h"
+#include "gbuffer.h"
+#include "glstate.h"
+#include "gputimer.h"
+#include "job.h"
+#include "pointshadow.h"
+#include "renderqueue.h"
+#include "ringbuffer.h"
+#include "shader.h"
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
 
+// a floor of static cubes under the ten spinning ones, drawn instanced
+#define CUBE_COUNT 10
+#define FIELD_SIDE 100
+#define FIELD_SPACING 2.0f
+#define INSTANCE_COUNT (CUBE_COUNT + FIELD_SIDE * FIELD_SIDE)
+#define CUBE_RADIUS 0.87f // unit cube under any rotation
+
+// small coloured lights hovering over the floor, plus the one the arrows move;
+// the first LAMP_COUNT of them stay put and cast shadows, as does the main light
+#define FIELD_LIGHTS 1024
+#define LAMP_COUNT 32
+#define SHADOW_SIZE 256
+#define SHADOW_FACE_BUDGET 24
+#define NEAR_PLANE 0.1f
+#define FAR_PLANE 100.0f
+
+// texture units past the material's diffuse and specular maps
+#define CLUSTER_UNIT 2
+#define GBUFFER_UNIT 5
+#define SHADOW_UNIT 8
+
+// what each frame is timed by on the GPU
+enum
+{
+    GPU_MARK_START,
+    GPU_MARK_GEOMETRY, // deferred only, the G-buffer is filled
+    GPU_MARK_LIT       // objects lit, before the light marker
+};
+
 bool isRunning = false;
 static SDL_Window *window;
 static SDL_GLContext *context;
@@ -16,18 +55,73 @@ typedef struct Material
     float shininess;
 } Material;
 
-typedef struct Light
+// what the queued draws need once their program is bound
+typedef struct SceneUniforms
+{
+    GLint lightModelLoc;
+    ClusterLight *light;
+    Clusters *clusters;
+    PointShadows *shadows;
+
+    // G key switches between shading in objects.frag and in a lighting pass
+    bool deferred;
+    GBuffer *gbuffer;
+    GpuTimer *timer;
+
+    RingBuffer *instances;
+    size_t instanceOffset; // this frame's model matrices in the ring
+} SceneUniforms;
+
+static float randomUnit(Uint32 *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) / 16777216.0f;
+}
+
+static void setupObjects(const RenderCommand *command)
+{
+    SceneUniforms *uniforms = command->data;
+    if (!uniforms->deferred)
+    {
+        Cluster_bind(uniforms->clusters, command->program, WINDOW_WIDTH, WINDOW_HEIGHT, CLUSTER_UNIT);
+        PointShadow_bind(uniforms->shadows, command->program, SHADOW_UNIT);
+    }
+
+    // the matrices sit somewhere else in the ring every frame, repoint the bound VAO at them
+    RingBuffer_flush(uniforms->instances);
+    for (int column = 0; column < 4; column++)
+    {
+        void *offset = (void *)(uniforms->instanceOffset + column * sizeof(vec4));
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(mat4), offset);
+    }
+}
+
+// one full screen triangle shades every covered pixel from the G-buffer
+static void setupLighting(const RenderCommand *command)
 {
-    vec3 position;
+    SceneUniforms *uniforms = command->data;
+    GpuTimer_mark(uniforms->timer, GPU_MARK_GEOMETRY);
 
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    GBuffer_end(uniforms->gbuffer);
+    GLState_disable(GL_DEPTH_TEST);
 
-    float constant;
-    float linear;
-    float quadratic;
-} Light;
+    GBuffer_bindTextures(uniforms->gbuffer, GBUFFER_UNIT);
+    Cluster_bind(uniforms->clusters, command->program, WINDOW_WIDTH, WINDOW_HEIGHT, CLUSTER_UNIT);
+    PointShadow_bind(uniforms->shadows, command->program, SHADOW_UNIT);
+}
+
+static void setupLight(const RenderCommand *command)
+{
+    SceneUniforms *uniforms = command->data;
+    GpuTimer_mark(uniforms->timer, GPU_MARK_LIT);
+    GLState_enable(GL_DEPTH_TEST);
+
+    mat4 model;
+    glm_mat4_identity(model);
+    glm_translate(model, uniforms->light->position);
+    glm_scale(model, (vec3){0.2f, 0.2f, 0.2f});
+    glUniformMatrix4fv(uniforms->lightModelLoc, 1, GL_FALSE, (float *)model);
+}
 
 int init()
 {
@@ -37,6 +131,11 @@ int init()
         return 1;
     }
 
+    // the deferred path blits its DEPTH24_STENCIL8 depth here, and a blit
+    // needs matching formats; X11 picks the visual with the window
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+
     window = SDL_CreateWindow("Dodge This", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_BORDERLESS | SDL_WINDOW_OPENGL);
     if (!window)
     {
@@ -73,8 +172,12 @@ int main()
         return 1;
     }
 
+    Job_init(0);
+
     void *vertexShaderSource = SDL_LoadFile("./shaders/common.vert", NULL);
-    void *fragmentShaderSource = SDL_LoadFile("./shaders/objects.frag", NULL);
+    void *instancedVertexShaderSource = SDL_LoadFile("./shaders/instanced.vert", NULL);
+    // objects.frag shares its lighting with deferred.frag, see CreateProgramWithShared
+    void *fragmentShaderSources[2] = {SDL_LoadFile("./shaders/clusterlights.glsl", NULL), SDL_LoadFile("./shaders/objects.frag", NULL)};
     void *lightFragmentShaderSource = SDL_LoadFile("./shaders/light.frag", NULL);
 
     unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -88,12 +191,24 @@ int main()
     if (!success)
     {
         glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        SDL_Log("Vertex shader (light) compile error: %s\n", infoLog);
+    }
+
+    // objects take their model matrix from a per-instance attribute
+    unsigned int instancedVertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(instancedVertexShader, 1, (const char **)&instancedVertexShaderSource, NULL);
+    glCompileShader(instancedVertexShader);
+
+    glGetShaderiv(instancedVertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(instancedVertexShader, 512, NULL, infoLog);
         SDL_Log("Vertex shader (object) compile error: %s\n", infoLog);
     }
 
     // fragment shader
     unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, (const char **)&fragmentShaderSource, NULL);
+    glShaderSource(fragmentShader, 2, (const char **)fragmentShaderSources, NULL);
     glCompileShader(fragmentShader);
 
     // check for shader compile errors
@@ -106,7 +221,7 @@ int main()
 
     // link shaders
     GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, instancedVertexShader);
     glAttachShader(shaderProgram, fragmentShader);
     glLinkProgram(shaderProgram);
 
@@ -117,6 +232,7 @@ int main()
         glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
         SDL_Log("Shader program (object) linking failed: %s\n", infoLog);
     }
+    glDeleteShader(instancedVertexShader);
     glDeleteShader(fragmentShader);
 
     // fragment shader
@@ -149,7 +265,9 @@ int main()
     glDeleteShader(lightFragmentShader);
 
     SDL_free(vertexShaderSource);
-    SDL_free(fragmentShaderSource);
+    SDL_free(instancedVertexShaderSource);
+    SDL_free(fragmentShaderSources[0]);
+    SDL_free(fragmentShaderSources[1]);
     SDL_free(lightFragmentShaderSource);
 
     float vertices[] = {
@@ -197,7 +315,7 @@ int main()
         -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f};
 
     // world space positions of our cubes
-    vec3 cubePositions[10] = {
+    vec3 cubePositions[CUBE_COUNT] = {
         {0.0f, 0.0f, 0.0f},
         {3.0f, 5.0f, -15.0f},
         {-3.5f, -2.2f, -2.5f},
@@ -213,8 +331,8 @@ int main()
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindVertexArray(VAO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
@@ -226,17 +344,54 @@ int main()
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    glBindVertexArray(0);
+    // model matrices of the visible cubes, rewritten every frame; shadow faces take their share too
+    RingBuffer instanceRing;
+    RingBuffer_init(&instanceRing, GL_ARRAY_BUFFER, 2 * INSTANCE_COUNT * sizeof(mat4));
+
+    for (int column = 0; column < 4; column++)
+    {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(mat4), (void *)(column * sizeof(vec4)));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribDivisor(3 + column, 1);
+    }
+
+    GLState_bindVertexArray(0);
+
+    CullBounds cubeBounds;
+    CullBounds_init(&cubeBounds, INSTANCE_COUNT);
+
+    vec3 cubeExtent = {CUBE_RADIUS, CUBE_RADIUS, CUBE_RADIUS};
+    for (int i = 0; i < CUBE_COUNT; i++)
+    {
+        CullBounds_add(&cubeBounds, cubePositions[i], cubeExtent);
+    }
+
+    for (int z = 0; z < FIELD_SIDE; z++)
+    {
+        for (int x = 0; x < FIELD_SIDE; x++)
+        {
+            vec3 position = {(x - FIELD_SIDE / 2) * FIELD_SPACING, -4.0f, (z - FIELD_SIDE / 2) * FIELD_SPACING};
+            CullBounds_add(&cubeBounds, position, (vec3){0.5f, 0.5f, 0.5f});
+        }
+    }
+
+    int *visibleCubes = SDL_malloc(cubeBounds.capacity * sizeof(int));
+    mat4 *instanceModels = SDL_malloc(INSTANCE_COUNT * sizeof(mat4));
+
+    // every instance's model matrix, the floor's set once and the spinning cubes' every frame
+    mat4 *worldModels = SDL_malloc(INSTANCE_COUNT * sizeof(mat4));
+    for (int i = CUBE_COUNT; i < INSTANCE_COUNT; i++)
+        glm_translate_make(worldModels[i], (vec3){cubeBounds.centerX[i], cubeBounds.centerY[i], cubeBounds.centerZ[i]});
 
     unsigned int lightVAO;
     glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
+    GLState_bindVertexArray(lightVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
 
     SDL_Surface *surface = IMG_Load("./resources/container.png");
     if (!surface)
@@ -247,7 +402,7 @@ int main()
     unsigned int textures[2];
     glGenTextures(2, textures);
 
-    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    GLState_bindTexture(0, GL_TEXTURE_2D, textures[0]);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -268,7 +423,7 @@ int main()
         SDL_Log("Error loading image: %s", IMG_GetError());
     }
 
-    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    GLState_bindTexture(0, GL_TEXTURE_2D, textures[1]);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -282,65 +437,87 @@ int main()
     glGenerateMipmap(GL_TEXTURE_2D);
     SDL_FreeSurface(surface);
 
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
     glUniform1i(glGetUniformLocation(shaderProgram, "material.diffuse"), 0);
     glUniform1i(glGetUniformLocation(shaderProgram, "material.specular"), 1);
 
+    RenderMaterial containerMaterial = {1, 2, {textures[0], textures[1]}};
+
     // Preparation for the shaders
     Material material = {
         76.8f};
 
-    Light light = {
+    vec3 ambient = {0.05f, 0.05f, 0.05f};
+
+    Clusters clusters;
+    Cluster_init(&clusters, FIELD_LIGHTS + 1, glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, NEAR_PLANE, FAR_PLANE);
+
+    ClusterLight mainLight = {
         {0.0f, 0.0f, 0.0f},
-        {0.2f, 0.2f, 0.2f},
-        {0.5f, 0.5f, 0.5f},
         {1.0f, 1.0f, 1.0f},
         1.0f,
         0.09f,
         0.032f};
+    Cluster_addLight(&clusters, &mainLight);
+
+    // field lights bob around fixed spots, each with its own phase
+    vec3 *lightAnchors = SDL_malloc(FIELD_LIGHTS * sizeof(vec3));
+    Uint32 seed = 7;
+    for (int i = 0; i < FIELD_LIGHTS; i++)
+    {
+        float extent = FIELD_SIDE * FIELD_SPACING * 0.5f;
+        lightAnchors[i][0] = (randomUnit(&seed) * 2.0f - 1.0f) * extent;
+        lightAnchors[i][1] = -3.0f;
+        lightAnchors[i][2] = (randomUnit(&seed) * 2.0f - 1.0f) * extent;
+
+        ClusterLight fieldLight = {.constant = 1.0f, .linear = 0.7f, .quadratic = 1.8f};
+        glm_vec3_copy(lightAnchors[i], fieldLight.position);
+        for (int channel = 0; channel < 3; channel++)
+            fieldLight.color[channel] = 0.2f + 0.6f * randomUnit(&seed);
+
+        Cluster_addLight(&clusters, &fieldLight);
+    }
+
+    // shadow light i is cluster light i: the main light, then the lamps
+    PointShadows shadows;
+    PointShadow_init(&shadows, 1 + LAMP_COUNT, SHADOW_SIZE, SHADOW_FACE_BUDGET);
+    for (int i = 0; i <= LAMP_COUNT; i++)
+    {
+        ClusterLight *shadowLight = &clusters.lights[i];
+        PointShadow_addLight(&shadows, shadowLight->position, glm_min(Cluster_lightRadius(shadowLight), FAR_PLANE));
+    }
+
+    GLuint shadowProgram = CreateProgram("./shaders/shadow.vert", "./shaders/shadow.frag");
+    GLint lightViewProjectionLoc = glGetUniformLocation(shadowProgram, "lightViewProjection");
 
     vec3 viewPos = {-5.0f, 2.0f, -5.0f};
 
     mat4 projection;
     glm_mat4_identity(projection);
-    glm_perspective(glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f, projection);
+    glm_perspective(glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, NEAR_PLANE, FAR_PLANE, projection);
 
     mat4 view;
     glm_mat4_identity(view);
     glm_lookat(viewPos, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 1.0f, 0.0f}, view);
 
     /* Sets UP the shader for the objects in the scene */
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
 
     // Lighting Uniforms
     unsigned int matShininessLoc = glGetUniformLocation(shaderProgram, "material.shininess");
 
-    unsigned int lightPosLoc = glGetUniformLocation(shaderProgram, "light.position");
-    unsigned int lightAmbientLoc = glGetUniformLocation(shaderProgram, "light.ambient");
-    unsigned int lightDiffuseLoc = glGetUniformLocation(shaderProgram, "light.diffuse");
-    unsigned int lightSpecularLoc = glGetUniformLocation(shaderProgram, "light.specular");
-
-    unsigned int lightConstantLoc = glGetUniformLocation(shaderProgram, "light.constant");
-    unsigned int lightLinearLoc = glGetUniformLocation(shaderProgram, "light.linear");
-    unsigned int lightQuadraticLoc = glGetUniformLocation(shaderProgram, "light.quadratic");
-
+    unsigned int ambientLoc = glGetUniformLocation(shaderProgram, "ambient");
     unsigned int viewPosLoc = glGetUniformLocation(shaderProgram, "viewPos");
 
     glUniform1f(matShininessLoc, material.shininess);
 
-    glUniform3fv(lightPosLoc, 1, light.position);
-    glUniform3fv(lightAmbientLoc, 1, light.ambient);
-    glUniform3fv(lightDiffuseLoc, 1, light.diffuse);
-    glUniform3fv(lightSpecularLoc, 1, light.specular);
-
-    glUniform1f(lightConstantLoc, light.constant);
-    glUniform1f(lightLinearLoc, light.linear);
-    glUniform1f(lightQuadraticLoc, light.quadratic);
+    // the lights themselves come from the cluster buffers
+    glUniform3fv(ambientLoc, 1, ambient);
 
     glUniform3fv(viewPosLoc, 1, viewPos);
     // ------------------------------------------------------------
 
-    // Projection and model matrix
+    // Projection and view matrix
     unsigned int projectionLoc = glGetUniformLocation(shaderProgram, "projection");
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)projection);
 
@@ -348,31 +525,86 @@ int main()
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)view);
 
     mat4 model;
-    glm_mat4_identity(model);
-    glm_translate(model, (vec3){0.0f, 0.0f, 0.0f});
+    unsigned int modelLoc;
+    // ------------------------------------------------------------
 
-    unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
+    // Sets UP the deferred path: a G-buffer pass with the same vertex shader, then a lighting pass
+    GLuint gbufferProgram = CreateProgram("./shaders/instanced.vert", "./shaders/gbuffer.frag");
+    GLState_useProgram(gbufferProgram);
+    glUniform1i(glGetUniformLocation(gbufferProgram, "material.diffuse"), 0);
+    glUniform1i(glGetUniformLocation(gbufferProgram, "material.specular"), 1);
+    glUniformMatrix4fv(glGetUniformLocation(gbufferProgram, "projection"), 1, GL_FALSE, (float *)projection);
+    glUniformMatrix4fv(glGetUniformLocation(gbufferProgram, "view"), 1, GL_FALSE, (float *)view);
+
+    mat4 inverseViewProjection;
+    glm_mat4_mul(projection, view, inverseViewProjection);
+    glm_mat4_inv(inverseViewProjection, inverseViewProjection);
+
+    GLuint lightingProgram = CreateProgramWithShared("./shaders/fullscreen.vert", "./shaders/clusterlights.glsl", "./shaders/deferred.frag");
+    GLState_useProgram(lightingProgram);
+    glUniform1i(glGetUniformLocation(lightingProgram, "gAlbedoSpecular"), GBUFFER_UNIT);
+    glUniform1i(glGetUniformLocation(lightingProgram, "gNormal"), GBUFFER_UNIT + 1);
+    glUniform1i(glGetUniformLocation(lightingProgram, "gDepth"), GBUFFER_UNIT + 2);
+    glUniformMatrix4fv(glGetUniformLocation(lightingProgram, "inverseViewProjection"), 1, GL_FALSE, (float *)inverseViewProjection);
+    glUniform1f(glGetUniformLocation(lightingProgram, "shininess"), material.shininess);
+    glUniform3fv(glGetUniformLocation(lightingProgram, "ambient"), 1, ambient);
+    glUniform3fv(glGetUniformLocation(lightingProgram, "viewPos"), 1, viewPos);
+
+    // core profile draws need a VAO even when the vertex shader makes up the vertices
+    GLuint screenVAO;
+    glGenVertexArrays(1, &screenVAO);
+
+    GBuffer gbuffer;
+    bool deferredSupported = GBuffer_init(&gbuffer, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    GpuTimer forwardTimer, deferredTimer;
+    GpuTimer_init(&forwardTimer);
+    GpuTimer_init(&deferredTimer);
     // ------------------------------------------------------------
 
     // Sets UP the shader for the light in the scene
-    glUseProgram(lightShaderProgram);
+    GLState_useProgram(lightShaderProgram);
 
-    projectionLoc = glGetUniformLocation(shaderProgram, "projection");
+    projectionLoc = glGetUniformLocation(lightShaderProgram, "projection");
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)projection);
 
-    viewLoc = glGetUniformLocation(shaderProgram, "view");
+    viewLoc = glGetUniformLocation(lightShaderProgram, "view");
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)view);
 
     glm_mat4_identity(model);
-    glm_translate(model, light.position);
+    glm_translate(model, mainLight.position);
     glm_scale(model, (vec3){0.2f, 0.2f, 0.2f});
 
-    modelLoc = glGetUniformLocation(shaderProgram, "model");
+    modelLoc = glGetUniformLocation(lightShaderProgram, "model");
     glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
     // ------------------------------
 
-    glEnable(GL_DEPTH_TEST);
+    // the camera never moves, so neither does the frustum
+    mat4 viewProjection;
+    glm_mat4_mul(projection, view, viewProjection);
+
+    Frustum frustum;
+    Frustum_extract(&frustum, viewProjection);
+
+    SceneUniforms sceneUniforms = {
+        modelLoc,
+        &clusters.lights[0],
+        &clusters,
+        &shadows,
+        false,
+        &gbuffer,
+        &forwardTimer,
+        &instanceRing};
+
+    RenderQueue renderQueue;
+    RenderQueue_init(&renderQueue, 16);
+
+    int frameCount = 0;
+    int shadowFaces = 0;
+
+    // setup above bound objects behind the cache's back
+    GLState_invalidate();
+    GLState_enable(GL_DEPTH_TEST);
 
     float lightRotationH = 0;
     float lightRotationV = 0;
@@ -398,7 +630,13 @@ int main()
 
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+                    GLState_polygonMode(GL_LINE);
+                }
+
+                if (event.key.keysym.sym == SDLK_g && !event.key.repeat && deferredSupported)
+                {
+                    sceneUniforms.deferred = !sceneUniforms.deferred;
+                    sceneUniforms.timer = sceneUniforms.deferred ? &deferredTimer : &forwardTimer;
                 }
             }
             break;
@@ -406,7 +644,7 @@ int main()
             {
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                    GLState_polygonMode(GL_FILL);
                 }
             }
             break;
@@ -446,58 +684,201 @@ int main()
         float lightY = sin(lightRotationV) * radiusV;
         float lightZ = cos(lightRotationH) * radiusH;
 
-        light.position[0] = lightX;
-        light.position[1] = lightY;
-        light.position[2] = lightZ;
+        ClusterLight *light = &clusters.lights[0];
+        light->position[0] = lightX;
+        light->position[1] = lightY;
+        light->position[2] = lightZ;
 
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        float time = SDL_GetTicks64() / 1000.0f;
+        for (int i = LAMP_COUNT; i < FIELD_LIGHTS; i++)
+        {
+            float phase = time + i * 0.37f;
+            clusters.lights[1 + i].position[0] = lightAnchors[i][0] + sinf(phase) * 1.5f;
+            clusters.lights[1 + i].position[1] = lightAnchors[i][1] + sinf(phase * 1.7f) * 0.5f;
+            clusters.lights[1 + i].position[2] = lightAnchors[i][2] + cosf(phase) * 1.5f;
+        }
 
-        glUseProgram(shaderProgram);
+        // the spinning cubes turn in place, dirtying the shadow faces they sit in
+        for (int i = 0; i < CUBE_COUNT; i++)
+        {
+            glm_translate_make(worldModels[i], cubePositions[i]);
 
-        unsigned int lightPosLoc = glGetUniformLocation(shaderProgram, "light.position");
-        glUniform3fv(lightPosLoc, 1, light.position);
+            float angle = 20.0f * i + 20.0f;
+            glm_rotate(worldModels[i], glm_rad(angle + (SDL_GetTicks64() / 100.0f) * (i + 1)), (vec3){1.0f, 0.3f, 0.5f});
 
-        glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+            vec3 cubeMin, cubeMax;
+            glm_vec3_sub(cubePositions[i], cubeExtent, cubeMin);
+            glm_vec3_add(cubePositions[i], cubeExtent, cubeMax);
+            PointShadow_moveCaster(&shadows, cubeMin, cubeMax);
+        }
 
-        for (unsigned int i = 0; i < 10; i++)
+        PointShadow_moveLight(&shadows, 0, light->position, glm_min(Cluster_lightRadius(light), FAR_PLANE));
+
+        // the main light first, then the lamps the camera can see, as far as the slots go
+        PointShadow_beginFrame(&shadows);
+        for (int i = 0; i <= LAMP_COUNT; i++)
         {
-            // calculate the model matrix for each object and pass it to shader before drawing
-            mat4 model;
-            glm_mat4_identity(model);
+            PointShadowLight *shadowLight = &shadows.lights[i];
+            if (Frustum_testSphere(&frustum, shadowLight->position, shadowLight->radius))
+                PointShadow_request(&shadows, i);
+        }
 
-            glm_translate(model, cubePositions[i]);
+        RingBuffer_beginFrame(&instanceRing);
 
-            float angle = 20.0f * i + 20.0f;
+        // only faces something moved through are rendered again
+        GLState_useProgram(shadowProgram);
+        GLState_bindVertexArray(VAO);
+
+        int shadowLight, shadowFace;
+        while (PointShadow_next(&shadows, &shadowLight, &shadowFace))
+        {
+            mat4 faceViewProjection;
+            PointShadow_faceViewProjection(&shadows, shadowLight, shadowFace, faceViewProjection);
+
+            Frustum faceFrustum;
+            Frustum_extract(&faceFrustum, faceViewProjection);
+            int casterCount = Cull_frustum(&cubeBounds, &faceFrustum, visibleCubes);
+
+            for (int c = 0; c < casterCount; c++)
+                glm_mat4_copy(worldModels[visibleCubes[c]], instanceModels[c]);
+
+            size_t casterOffset;
+            void *casterData = RingBuffer_alloc(&instanceRing, casterCount * sizeof(mat4), sizeof(vec4), &casterOffset);
+
+            // the ring is full for this frame: the face is left as it was and
+            // stays dirty, so it is drawn next frame
+            if (!casterData)
+                break;
 
-            glm_rotate(model, glm_rad(angle + (SDL_GetTicks64() / 100.0f) * (i + 1)), (vec3){1.0f, 0.3f, 0.5f});
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
+            SDL_memcpy(casterData, instanceModels, casterCount * sizeof(mat4));
+            RingBuffer_flush(&instanceRing);
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            PointShadow_begin(&shadows, shadowLight, shadowFace);
+            glUniformMatrix4fv(lightViewProjectionLoc, 1, GL_FALSE, (float *)faceViewProjection);
+            for (int column = 0; column < 4; column++)
+                glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(mat4), (void *)(casterOffset + column * sizeof(vec4)));
+
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, casterCount);
+            PointShadow_end(&shadows, shadowLight, shadowFace);
         }
 
-        // draw our first triangle
-        glUseProgram(lightShaderProgram);
+        PointShadow_finish(&shadows, WINDOW_WIDTH, WINDOW_HEIGHT);
+        shadowFaces += shadows.stats.faces;
+
+        for (int i = 0; i <= LAMP_COUNT; i++)
+            clusters.lights[i].shadowSlot = PointShadow_sampleSlot(&shadows, i);
+
+        Cluster_update(&clusters, view);
+
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        Uint64 cullStart = SDL_GetPerformanceCounter();
+        int visibleCount = Cull_frustum(&cubeBounds, &frustum, visibleCubes);
+        double cullMs = (double)(SDL_GetPerformanceCounter() - cullStart) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+        for (int v = 0; v < visibleCount; v++)
+            glm_mat4_copy(worldModels[visibleCubes[v]], instanceModels[v]);
+
+        // the mapping is write-combined, so build the matrices elsewhere and copy them over once
+        void *instanceData = RingBuffer_alloc(&instanceRing, visibleCount * sizeof(mat4), sizeof(vec4), &sceneUniforms.instanceOffset);
+        if (instanceData)
+            SDL_memcpy(instanceData, instanceModels, visibleCount * sizeof(mat4));
+        else
+            visibleCount = 0;
+
+        // the light marker is submitted first, the queue puts it where it belongs;
+        // layers keep it after the lighting pass in deferred mode
+        float lightDepth = glm_vec3_distance(viewPos, light->position) / FAR_PLANE;
+
+        RenderCommand lightDraw = {
+            .key = RenderQueue_key(2, lightShaderProgram, 0, lightVAO, lightDepth),
+            .program = lightShaderProgram,
+            .vao = lightVAO,
+            .mode = GL_TRIANGLES,
+            .count = 36,
+            .setup = setupLight,
+            .data = &sceneUniforms};
+        RenderQueue_submit(&renderQueue, &lightDraw);
+
+        GLuint objectProgram = sceneUniforms.deferred ? gbufferProgram : shaderProgram;
+        RenderCommand objectDraw = {
+            .key = RenderQueue_key(0, objectProgram, containerMaterial.id, VAO, 0.0f),
+            .program = objectProgram,
+            .vao = VAO,
+            .material = &containerMaterial,
+            .mode = GL_TRIANGLES,
+            .count = 36,
+            .instances = visibleCount,
+            .setup = setupObjects,
+            .data = &sceneUniforms};
+        RenderQueue_submit(&renderQueue, &objectDraw);
+
+        if (sceneUniforms.deferred)
+        {
+            RenderCommand lightingDraw = {
+                .key = RenderQueue_key(1, lightingProgram, 0, screenVAO, 0.0f),
+                .program = lightingProgram,
+                .vao = screenVAO,
+                .mode = GL_TRIANGLES,
+                .count = 3,
+                .setup = setupLighting,
+                .data = &sceneUniforms};
+            RenderQueue_submit(&renderQueue, &lightingDraw);
+        }
 
-        glm_mat4_identity(model);
-        glm_translate(model, light.position);
-        glm_scale(model, (vec3){0.2f, 0.2f, 0.2f});
+        GpuTimer_beginFrame(&forwardTimer);
+        GpuTimer_beginFrame(&deferredTimer);
+        GpuTimer_mark(sceneUniforms.timer, GPU_MARK_START);
 
-        modelLoc = glGetUniformLocation(shaderProgram, "model");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
+        if (sceneUniforms.deferred)
+            GBuffer_begin(&gbuffer);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        // bind specular map
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        RenderQueue_execute(&renderQueue);
+        RingBuffer_endFrame(&instanceRing);
 
-        glBindVertexArray(lightVAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        // glBindVertexArray(0); // no need to unbind it every time
+        GLStateStats glStats = GLState_endFrame();
+        if (++frameCount % 120 == 0)
+        {
+            RenderQueueStats *stats = &renderQueue.stats;
+            SDL_Log("culling (%s): %d of %d cubes visible, %.3f ms", Cull_pathName(Cull_getPath()), visibleCount, INSTANCE_COUNT, cullMs);
+            SDL_Log("render queue: %d draws, program/texture/vao switches %d/%d/%d unsorted, %d/%d/%d sorted, sort %.3f ms",
+                    stats->draws, stats->unsorted.programs, stats->unsorted.textures, stats->unsorted.vaos,
+                    stats->sorted.programs, stats->sorted.textures, stats->sorted.vaos, stats->sortMs);
+            SDL_Log("gl state: %d calls issued, %d skipped", glStats.issued, glStats.skipped);
+            SDL_Log("clusters: %d lights, %d in range, %d light/cluster pairs, at most %d per cluster, %d dropped, assign %.3f ms on %d workers",
+                    clusters.stats.lights, clusters.stats.visible, clusters.stats.indices, clusters.stats.maxPerCluster,
+                    clusters.stats.overflows, clusters.stats.assignMs, Job_workerCount());
+            SDL_Log("gpu (%s, G toggles): forward %.3f ms, deferred %.3f ms (geometry %.3f ms, lighting %.3f ms)",
+                    sceneUniforms.deferred ? "deferred" : "forward",
+                    GpuTimer_ms(&forwardTimer, GPU_MARK_START, GPU_MARK_LIT),
+                    GpuTimer_ms(&deferredTimer, GPU_MARK_START, GPU_MARK_LIT),
+                    GpuTimer_ms(&deferredTimer, GPU_MARK_START, GPU_MARK_GEOMETRY),
+                    GpuTimer_ms(&deferredTimer, GPU_MARK_GEOMETRY, GPU_MARK_LIT));
+            SDL_Log("instance ring (%s): %zu bytes, waited %.3f ms",
+                    instanceRing.persistent ? "persistent" : "orphaning", instanceRing.stats.used, instanceRing.stats.waitMs);
+            SDL_Log("point shadows: %d of %d requested lights sampled, %d faces rendered last frame, %d over 120 frames, %d postponed, %d evictions",
+                    shadows.stats.resident, shadows.stats.requested, shadows.stats.faces, shadowFaces, shadows.stats.postponed, shadows.stats.evictions);
+            shadowFaces = 0;
+        }
 
         SDL_GL_SwapWindow(window);
     }
 
+    RenderQueue_free(&renderQueue);
+    GpuTimer_free(&forwardTimer);
+    GpuTimer_free(&deferredTimer);
+    GBuffer_free(&gbuffer);
+    PointShadow_free(&shadows);
+    glDeleteProgram(shadowProgram);
+    Cluster_free(&clusters);
+    SDL_free(lightAnchors);
+    RingBuffer_free(&instanceRing);
+    SDL_free(instanceModels);
+    SDL_free(worldModels);
+    SDL_free(visibleCubes);
+    CullBounds_free(&cubeBounds);
+    Job_shutdown();
+
     return 0;
 }
\ No newline at end of file
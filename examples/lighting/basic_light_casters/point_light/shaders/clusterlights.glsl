@@ -0,0 +1,98 @@
+#version 330 core
+
+// Clustered point lights with cached shadows, shared by objects.frag and
+// deferred.frag: each is compiled with this file in front of it.
+
+// filled by Cluster_update, see src/cluster.h
+uniform samplerBuffer clusterLights;   // 3 texels per light
+uniform usamplerBuffer clusterRecords; // first index, count
+uniform usamplerBuffer clusterIndices;
+uniform vec2 clusterTileSize;
+uniform vec2 clusterSlice; // scale, bias
+uniform vec2 clusterDepth; // near, far
+
+const ivec3 clusterGrid = ivec3(16, 9, 24); // CLUSTER_X, CLUSTER_Y, CLUSTER_Z
+
+// filled by PointShadow_bind, lights pick their slot through clusterLights
+uniform sampler2DArrayShadow pointShadows;
+
+int clusterIndex(float windowDepth) {
+    // view space depth back from the depth buffer value
+    float ndcZ = windowDepth * 2.0 - 1.0;
+    float depth = 2.0 * clusterDepth.x * clusterDepth.y /
+        (clusterDepth.y + clusterDepth.x - ndcZ * (clusterDepth.y - clusterDepth.x));
+
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / clusterTileSize), int(floor(log(depth) * clusterSlice.x + clusterSlice.y)));
+    cluster = clamp(cluster, ivec3(0), clusterGrid - 1);
+    return (cluster.z * clusterGrid.y + cluster.y) * clusterGrid.x + cluster.x;
+}
+
+// Point light shadows, 6 layers per slot as laid out by src/pointshadow.h.
+// The face is the major axis of the light to fragment vector, its texture
+// coordinates follow the GL cube map convention and the depth is what that
+// face's 90 degree projection, near 0.05 and far the light's radius, wrote.
+float pointShadow(int slot, vec3 fromLight, float radius) {
+    vec3 a = abs(fromLight);
+    int face;
+    float major;
+    vec2 st;
+    if (a.x >= a.y && a.x >= a.z) {
+        major = a.x;
+        face = fromLight.x > 0.0 ? 0 : 1;
+        st = vec2(fromLight.x > 0.0 ? -fromLight.z : fromLight.z, -fromLight.y);
+    } else if (a.y >= a.z) {
+        major = a.y;
+        face = fromLight.y > 0.0 ? 2 : 3;
+        st = vec2(fromLight.x, fromLight.y > 0.0 ? fromLight.z : -fromLight.z);
+    } else {
+        major = a.z;
+        face = fromLight.z > 0.0 ? 4 : 5;
+        st = vec2(fromLight.z > 0.0 ? fromLight.x : -fromLight.x, -fromLight.y);
+    }
+
+    // a little towards the light against acne, the passes add slope scaled offset
+    float n = 0.05; // POINT_SHADOW_NEAR
+    float distance = max(major - 0.03, n);
+    float depth = ((radius + n) / (radius - n) - 2.0 * radius * n / ((radius - n) * distance)) * 0.5 + 0.5;
+
+    return texture(pointShadows, vec4(st / major * 0.5 + 0.5, slot * 6 + face, depth));
+}
+
+// Phong from every light of the fragment's cluster, ambient not included.
+vec3 clusterLighting(float windowDepth, vec3 fragPos, vec3 norm, vec3 viewDir,
+                     vec3 diffuseColor, vec3 specularColor, float shininess) {
+    vec3 result = vec3(0.0);
+
+    uvec2 record = texelFetch(clusterRecords, clusterIndex(windowDepth)).xy;
+    for (uint i = 0u; i < record.y; i++) {
+        int light = int(texelFetch(clusterIndices, int(record.x + i)).x) * 3;
+        vec4 positionRadius = texelFetch(clusterLights, light);
+        vec4 colorConstant = texelFetch(clusterLights, light + 1);
+        vec3 linearQuadraticShadow = texelFetch(clusterLights, light + 2).xyz;
+
+        vec3 toLight = positionRadius.xyz - fragPos;
+        float distance = length(toLight);
+        if (distance > positionRadius.w)
+            continue;
+
+        float attenuation = 1.0 / (colorConstant.w + linearQuadraticShadow.x * distance +
+            linearQuadraticShadow.y * (distance * distance));
+
+        // shadow slot + 1, 0 for lights without shadows
+        if (linearQuadraticShadow.z > 0.0)
+            attenuation *= pointShadow(int(linearQuadraticShadow.z) - 1, -toLight, positionRadius.w);
+
+        // diffuse
+        vec3 lightDir = toLight / distance;
+        float diff = max(dot(norm, lightDir), 0.0);
+
+        // specular
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+        // result (phong)
+        result += colorConstant.rgb * attenuation * (diff * diffuseColor + spec * specularColor);
+    }
+
+    return result;
+}
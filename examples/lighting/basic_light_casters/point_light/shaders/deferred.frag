@@ -0,0 +1,34 @@
+// compiled after clusterlights.glsl, which holds the #version line
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+uniform float shininess;
+uniform vec3 ambient;
+uniform vec3 viewPos;
+
+out vec4 FragColor;
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float windowDepth = texelFetch(gDepth, pixel, 0).r;
+
+    // nothing was drawn here, keep the clear colour
+    if (windowDepth == 1.0)
+        discard;
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec3 norm = texelFetch(gNormal, pixel, 0).xyz;
+
+    vec4 ndc = vec4(gl_FragCoord.xy / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0, windowDepth * 2.0 - 1.0, 1.0);
+    vec4 world = inverseViewProjection * ndc;
+    vec3 fragPos = world.xyz / world.w;
+
+    vec3 viewDir = normalize(viewPos - fragPos);
+    vec3 result = ambient * albedoSpecular.rgb;
+    result += clusterLighting(windowDepth, fragPos, norm, viewDir, albedoSpecular.rgb, vec3(albedoSpecular.a), shininess);
+
+    FragColor = vec4(result, 1.0);
+}
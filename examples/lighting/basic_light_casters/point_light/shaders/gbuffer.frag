@@ -0,0 +1,23 @@
+#version 330 core
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+uniform Material material;
+
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+
+layout(location = 0) out vec4 AlbedoSpecular;
+layout(location = 1) out vec4 GNormal;
+
+void main() {
+    vec3 specular = vec3(texture(material.specular, TexCoords));
+
+    AlbedoSpecular = vec4(vec3(texture(material.diffuse, TexCoords)), dot(specular, vec3(1.0 / 3.0)));
+    GNormal = vec4(normalize(Normal), 0.0);
+}
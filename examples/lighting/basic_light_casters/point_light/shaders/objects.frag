@@ -1,4 +1,4 @@
-#version 330 core
+// compiled after clusterlights.glsl, which holds the #version line
 
 struct Material {
     sampler2D diffuse;
@@ -6,20 +6,8 @@ struct Material {
     float shininess;
 };
 
-struct Light {
-    vec3 position;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
 uniform Material material;
-uniform Light light;
+uniform vec3 ambient;
 uniform vec3 viewPos;
 
 in vec3 Normal;
@@ -29,31 +17,14 @@ in vec2 TexCoords;
 out vec4 FragColor;
 
 void main() {
-    float distance = length(light.position - FragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance +
-        light.quadratic * (distance * distance));
+    vec3 diffuseColor = vec3(texture(material.diffuse, TexCoords));
+    vec3 specularColor = vec3(texture(material.specular, TexCoords));
 
-    vec3 lightDir = normalize(light.position - FragPos);
-
-    // ambient
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-
-    // diffuse
     vec3 norm = normalize(Normal);
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-
-    // specular
     vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
 
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
+    vec3 result = ambient * diffuseColor;
+    result += clusterLighting(gl_FragCoord.z, FragPos, norm, viewDir, diffuseColor, specularColor, material.shininess);
 
-    // result (phong)
-    vec3 result = ambient + diffuse + specular;
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aModel; // per instance, locations 3-6
+
+uniform mat4 lightViewProjection;
+
+void main() {
+    gl_Position = lightViewProjection * aModel * vec4(aPos, 1.0);
+}
@@ -2,6 +2,7 @@
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include "cglm/cglm.h"
+#include "glstate.h"
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
@@ -182,8 +183,8 @@ int main()
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindVertexArray(VAO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
@@ -192,17 +193,17 @@ int main()
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
 
     unsigned int lightVAO;
     glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
+    GLState_bindVertexArray(lightVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
 
     // Preparation for the shaders
     vec3 lightPos = {0.0f, 0.0f, 0.0f};
@@ -217,7 +218,7 @@ int main()
     glm_lookat(viewPos, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 1.0f, 0.0f}, view);
 
     /* Sets UP the shader for the objects in the scene */
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
 
     // Lighting Uniforms
     unsigned int objColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
@@ -247,7 +248,7 @@ int main()
     // ------------------------------------------------------------
 
     // Sets UP the shader for the light in the scene
-    glUseProgram(lightShaderProgram);
+    GLState_useProgram(lightShaderProgram);
 
     projectionLoc = glGetUniformLocation(shaderProgram, "projection");
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)projection);
@@ -263,7 +264,7 @@ int main()
     glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
     // ------------------------------
 
-    glEnable(GL_DEPTH_TEST);
+    GLState_enable(GL_DEPTH_TEST);
 
     float lightRotationH = 0;
     float lightRotationV = 0;
@@ -289,7 +290,7 @@ int main()
 
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+                    GLState_polygonMode(GL_LINE);
                 }
             }
             break;
@@ -297,7 +298,7 @@ int main()
             {
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                    GLState_polygonMode(GL_FILL);
                 }
             }
             break;
@@ -343,16 +344,16 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
+        GLState_useProgram(shaderProgram);
 
         unsigned int lightPosLoc = glGetUniformLocation(shaderProgram, "lightPos");
         glUniform3fv(lightPosLoc, 1, lightPos);
 
-        glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+        GLState_bindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         glDrawArrays(GL_TRIANGLES, 0, 36);
 
         // draw our first triangle
-        glUseProgram(lightShaderProgram);
+        GLState_useProgram(lightShaderProgram);
 
         glm_mat4_identity(model);
         glm_translate(model, lightPos);
@@ -361,7 +362,7 @@ int main()
         modelLoc = glGetUniformLocation(shaderProgram, "model");
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
 
-        glBindVertexArray(lightVAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+        GLState_bindVertexArray(lightVAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         glDrawArrays(GL_TRIANGLES, 0, 36);
         // glBindVertexArray(0); // no need to unbind it every time
 
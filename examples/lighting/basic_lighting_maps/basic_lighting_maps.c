@@ -3,6 +3,7 @@
 #include <SDL2/SDL_image.h>
 #include <GL/glew.h>
 #include "cglm/cglm.h"
+#include "glstate.h"
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
@@ -196,8 +197,8 @@ int main()
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindVertexArray(VAO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
@@ -209,17 +210,17 @@ int main()
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
 
     unsigned int lightVAO;
     glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
+    GLState_bindVertexArray(lightVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, VBO);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
 
     SDL_Surface *surface = IMG_Load("./resources/container.png");
     if (!surface)
@@ -230,7 +231,7 @@ int main()
     unsigned int textures[2];
     glGenTextures(2, textures);
 
-    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    GLState_bindTexture(0, GL_TEXTURE_2D, textures[0]);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -251,7 +252,7 @@ int main()
         SDL_Log("Error loading image: %s", IMG_GetError());
     }
 
-    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    GLState_bindTexture(0, GL_TEXTURE_2D, textures[1]);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -265,7 +266,7 @@ int main()
     glGenerateMipmap(GL_TEXTURE_2D);
     SDL_FreeSurface(surface);
 
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
     glUniform1i(glGetUniformLocation(shaderProgram, "material.diffuse"), 0);
     glUniform1i(glGetUniformLocation(shaderProgram, "material.specular"), 1);
 
@@ -291,7 +292,7 @@ int main()
     glm_lookat(viewPos, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 1.0f, 0.0f}, view);
 
     /* Sets UP the shader for the objects in the scene */
-    glUseProgram(shaderProgram);
+    GLState_useProgram(shaderProgram);
 
     // Lighting Uniforms
     unsigned int matShininessLoc = glGetUniformLocation(shaderProgram, "material.shininess");
@@ -329,7 +330,7 @@ int main()
     // ------------------------------------------------------------
 
     // Sets UP the shader for the light in the scene
-    glUseProgram(lightShaderProgram);
+    GLState_useProgram(lightShaderProgram);
 
     projectionLoc = glGetUniformLocation(shaderProgram, "projection");
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)projection);
@@ -345,7 +346,7 @@ int main()
     glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
     // ------------------------------
 
-    glEnable(GL_DEPTH_TEST);
+    GLState_enable(GL_DEPTH_TEST);
 
     float lightRotationH = 0;
     float lightRotationV = 0;
@@ -371,7 +372,7 @@ int main()
 
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+                    GLState_polygonMode(GL_LINE);
                 }
             }
             break;
@@ -379,7 +380,7 @@ int main()
             {
                 if (event.key.keysym.sym == SDLK_d)
                 {
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                    GLState_polygonMode(GL_FILL);
                 }
             }
             break;
@@ -426,16 +427,16 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
+        GLState_useProgram(shaderProgram);
 
         unsigned int lightPosLoc = glGetUniformLocation(shaderProgram, "light.position");
         glUniform3fv(lightPosLoc, 1, light.position);
 
-        glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+        GLState_bindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         glDrawArrays(GL_TRIANGLES, 0, 36);
 
         // draw our first triangle
-        glUseProgram(lightShaderProgram);
+        GLState_useProgram(lightShaderProgram);
 
         glm_mat4_identity(model);
         glm_translate(model, light.position);
@@ -444,13 +445,11 @@ int main()
         modelLoc = glGetUniformLocation(shaderProgram, "model");
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
+        GLState_bindTexture(0, GL_TEXTURE_2D, textures[0]);
         // bind specular map
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        GLState_bindTexture(1, GL_TEXTURE_2D, textures[1]);
 
-        glBindVertexArray(lightVAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+        GLState_bindVertexArray(lightVAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         glDrawArrays(GL_TRIANGLES, 0, 36);
         // glBindVertexArray(0); // no need to unbind it every time
 
@@ -0,0 +1,212 @@
+#include <float.h>
+#include <SDL2/SDL.h>
+
+#include "bvh.h"
+#include "job.h"
+#include "obj.h"
+
+#define MODEL "../../examples/model/model_loading/resources/landscape.obj"
+#define RAY_COUNT (1 << 18)
+#define ITERATIONS 4
+
+typedef struct RayBatch
+{
+    const Bvh *bvh;
+    vec3 *origins, *directions;
+    float *distances;
+    float *results; // hit distance, or FLT_MAX; 1 or 0 for occlusion
+    bool occlusion;
+} RayBatch;
+
+static double elapsedMs(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static float randomRange(Uint32 *seed, float min, float max)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return min + (max - min) * ((*seed >> 8) / 16777216.0f);
+}
+
+static void traceRays(void *data, int start, int end)
+{
+    RayBatch *batch = data;
+    for (int i = start; i < end; i++)
+    {
+        if (batch->occlusion)
+        {
+            batch->results[i] = Bvh_occluded(batch->bvh, batch->origins[i], batch->directions[i], batch->distances[i]) ? 1.0f : 0.0f;
+            continue;
+        }
+
+        BvhHit hit;
+        batch->results[i] = Bvh_intersect(batch->bvh, batch->origins[i], batch->directions[i], batch->distances[i], &hit) ? hit.t : FLT_MAX;
+    }
+}
+
+// straight down onto the terrain, give or take
+static void downRays(RayBatch *batch, vec3 min, vec3 max)
+{
+    Uint32 seed = 12345;
+    for (int i = 0; i < RAY_COUNT; i++)
+    {
+        batch->origins[i][0] = randomRange(&seed, min[0], max[0]);
+        batch->origins[i][1] = max[1] + 1.0f;
+        batch->origins[i][2] = randomRange(&seed, min[2], max[2]);
+        glm_vec3_copy((vec3){randomRange(&seed, -0.3f, 0.3f), -1.0f, randomRange(&seed, -0.3f, 0.3f)}, batch->directions[i]);
+        batch->distances[i] = FLT_MAX;
+    }
+    batch->occlusion = false;
+}
+
+// Mrays/s
+static double runRays(RayBatch *batch, bool parallel, double *checksum)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        if (parallel)
+            Job_parallelFor(RAY_COUNT, 1024, traceRays, batch);
+        else
+            traceRays(batch, 0, RAY_COUNT);
+    }
+    double ms = elapsedMs(start);
+
+    *checksum = 0.0;
+    for (int i = 0; i < RAY_COUNT; i++)
+        *checksum += batch->results[i] < FLT_MAX ? batch->results[i] : 0.0f;
+
+    return (double)RAY_COUNT * ITERATIONS / ms / 1000.0;
+}
+
+static void runAllPaths(RayBatch *batch, const char *label)
+{
+    BvhPath paths[] = {BVH_SCALAR, BVH_SSE};
+    for (int p = 0; p < 2; p++)
+    {
+        Bvh_setPath(paths[p]);
+        for (int parallel = 0; parallel < 2; parallel++)
+        {
+            double checksum;
+            double mrays = runRays(batch, parallel, &checksum);
+            SDL_Log("  %-10s %-6s %2d threads %8.2f Mrays/s  checksum %.1f", label, Bvh_pathName(Bvh_getPath()), parallel ? Job_workerCount() : 1, mrays, checksum);
+        }
+    }
+}
+
+int main()
+{
+    vec3 *model;
+    int modelCount = Obj_loadTriangles(MODEL, &model);
+    if (modelCount <= 0)
+        return 1;
+
+    vec3 modelMin = {FLT_MAX, FLT_MAX, FLT_MAX}, modelMax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (int v = 0; v < modelCount * 3; v++)
+    {
+        glm_vec3_minv(modelMin, model[v], modelMin);
+        glm_vec3_maxv(modelMax, model[v], modelMax);
+    }
+
+    Job_init(0);
+    SDL_Log("%d triangles in %s, %d threads, %d rays x %d iterations", modelCount, MODEL, Job_workerCount(), RAY_COUNT, ITERATIONS);
+
+    // the landscape tiled side by side
+    int tilings[] = {1, 4, 12};
+    for (int k = 0; k < 3; k++)
+    {
+        int side = tilings[k];
+        int triangleCount = modelCount * side * side;
+        vec3 *vertices = SDL_malloc(triangleCount * 3 * sizeof(vec3));
+        vec3 *moved = SDL_malloc(triangleCount * 3 * sizeof(vec3));
+
+        float sizeX = modelMax[0] - modelMin[0], sizeZ = modelMax[2] - modelMin[2];
+        for (int tile = 0; tile < side * side; tile++)
+        {
+            for (int v = 0; v < modelCount * 3; v++)
+            {
+                float *vertex = vertices[tile * modelCount * 3 + v];
+                glm_vec3_copy(model[v], vertex);
+                vertex[0] += sizeX * (tile % side);
+                vertex[2] += sizeZ * (tile / side);
+            }
+        }
+
+        Bvh bvh;
+        Bvh_build(&bvh, vertices, triangleCount);
+        double parallelMs = bvh.stats.buildMs;
+        Bvh_free(&bvh);
+
+        // the pool always keeps one worker, so the smallest is the caller plus one
+        Job_shutdown();
+        Job_init(1);
+        int fewThreads = Job_workerCount();
+        Bvh_build(&bvh, vertices, triangleCount);
+        double fewMs = bvh.stats.buildMs;
+        Bvh_free(&bvh);
+        Job_shutdown();
+        Job_init(0);
+
+        Bvh_build(&bvh, vertices, triangleCount);
+        SDL_Log("%8d triangles: build %8.2f ms (%d threads) %8.2f ms (%d threads), %d nodes, %d leaves, depth %d", triangleCount, parallelMs, Job_workerCount(), fewMs, fewThreads, bvh.stats.nodes, bvh.stats.leaves, bvh.stats.depth);
+
+        // closest hits from above, then short segments across the terrain for line of sight
+        RayBatch batch = {&bvh};
+        batch.origins = SDL_malloc(RAY_COUNT * sizeof(vec3));
+        batch.directions = SDL_malloc(RAY_COUNT * sizeof(vec3));
+        batch.distances = SDL_malloc(RAY_COUNT * sizeof(float));
+        batch.results = SDL_malloc(RAY_COUNT * sizeof(float));
+
+        vec3 max = {modelMin[0] + sizeX * side, modelMax[1], modelMin[2] + sizeZ * side};
+        downRays(&batch, modelMin, max);
+        runAllPaths(&batch, "closest");
+
+        Uint32 seed = 54321;
+        for (int i = 0; i < RAY_COUNT; i++)
+        {
+            vec3 target;
+            for (int axis = 0; axis < 3; axis += 2)
+                target[axis] = batch.origins[i][axis] + randomRange(&seed, -0.1f, 0.1f) * (axis ? sizeZ : sizeX);
+            batch.origins[i][1] = randomRange(&seed, modelMin[1], modelMax[1]);
+            target[1] = randomRange(&seed, modelMin[1], modelMax[1]);
+            glm_vec3_sub(target, batch.origins[i], batch.directions[i]);
+            batch.distances[i] = 1.0f;
+        }
+        batch.occlusion = true;
+        runAllPaths(&batch, "occlusion");
+
+        // a swell across the terrain, refit against a fresh build
+        float height = modelMax[1] - modelMin[1];
+        for (int v = 0; v < triangleCount * 3; v++)
+        {
+            glm_vec3_copy(vertices[v], moved[v]);
+            moved[v][1] += 0.25f * height * sinf(vertices[v][0] / sizeX * 6.0f) * cosf(vertices[v][2] / sizeZ * 6.0f);
+        }
+
+        Bvh_refit(&bvh, moved);
+        Bvh rebuilt;
+        Bvh_build(&rebuilt, moved, triangleCount);
+
+        Bvh_setPath(BVH_SSE);
+        double refitChecksum, rebuiltChecksum;
+        downRays(&batch, modelMin, max);
+        double refitRays = runRays(&batch, true, &refitChecksum);
+        batch.bvh = &rebuilt;
+        double rebuiltRays = runRays(&batch, true, &rebuiltChecksum);
+        SDL_Log("  refit %8.2f ms, %8.2f Mrays/s after vs %8.2f Mrays/s rebuilt in %8.2f ms, checksums %.1f %.1f", bvh.stats.refitMs, refitRays, rebuiltRays, rebuilt.stats.buildMs, refitChecksum, rebuiltChecksum);
+
+        Bvh_free(&rebuilt);
+        Bvh_free(&bvh);
+        SDL_free(batch.origins);
+        SDL_free(batch.directions);
+        SDL_free(batch.distances);
+        SDL_free(batch.results);
+        SDL_free(vertices);
+        SDL_free(moved);
+    }
+
+    Job_shutdown();
+    SDL_free(model);
+    return 0;
+}
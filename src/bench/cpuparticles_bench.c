@@ -0,0 +1,74 @@
+#include <SDL2/SDL.h>
+
+#include "cpuparticles.h"
+#include "job.h"
+
+// a steady fountain: a second of life on average, so emitting
+// PARTICLE_COUNT per second keeps about that many alive
+#define PARTICLE_COUNT 500000
+#define FRAME_TIME (1.0f / 60.0f)
+#define WARMUP_FRAMES 120
+#define FRAMES 240
+
+static void step(CpuParticles *particles, float *vertices, double *updateMs, double *packMs)
+{
+    CpuParticles_emit(particles, (int)(PARTICLE_COUNT * FRAME_TIME), (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 6.0f, 0.0f}, 4.0f, 1.0f);
+    CpuParticles_update(particles, FRAME_TIME);
+    CpuParticles_pack(particles, vertices);
+
+    CpuParticleStats stats = CpuParticles_stats(particles);
+    *updateMs += stats.updateMs;
+    *packMs += stats.packMs;
+}
+
+static void runPath(CpuParticlePath path, float *vertices)
+{
+    CpuParticles_setPath(path);
+
+    CpuParticles particles;
+    CpuParticles_init(&particles, PARTICLE_COUNT * 2);
+    glm_vec4_copy((vec4){0.0f, 1.0f, 0.0f, 2.0f}, particles.plane);
+
+    double updateMs = 0.0, packMs = 0.0;
+    for (int frame = 0; frame < WARMUP_FRAMES; frame++)
+        step(&particles, vertices, &updateMs, &packMs);
+
+    updateMs = packMs = 0.0;
+    int least = particles.count, most = particles.count;
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        step(&particles, vertices, &updateMs, &packMs);
+        least = SDL_min(least, particles.count);
+        most = SDL_max(most, particles.count);
+    }
+
+    // both paths run the same arithmetic, so they should agree exactly
+    double checksum = 0.0;
+    for (int i = 0; i < particles.count; i++)
+        checksum += particles.positionX[i] + particles.positionY[i] + particles.positionZ[i];
+
+    SDL_Log("%-6s %d-%d alive, update %.3f ms, pack %.3f ms, %.3f ms a frame, checksum %.3f",
+            CpuParticles_pathName(CpuParticles_getPath()), least, most, updateMs / FRAMES, packMs / FRAMES, (updateMs + packMs) / FRAMES, checksum);
+
+    CpuParticles_free(&particles);
+}
+
+int main()
+{
+    Job_init(0);
+
+    // stands in for the mapped ring buffer region
+    float *vertices = SDL_malloc((size_t)PARTICLE_COUNT * 2 * 4 * sizeof(float));
+
+    SDL_Log("Simulating ~%d particles, %d frames (detected path: %s), %d threads",
+            PARTICLE_COUNT, FRAMES, CpuParticles_pathName(CpuParticles_getPath()), Job_workerCount());
+
+    CpuParticlePath paths[] = {CPU_PARTICLES_SCALAR, CPU_PARTICLES_AVX};
+    for (int i = 0; i < 2; i++)
+        runPath(paths[i], vertices);
+
+    SDL_free(vertices);
+    Job_shutdown();
+
+    return 0;
+}
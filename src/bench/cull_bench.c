@@ -0,0 +1,72 @@
+#include <SDL2/SDL.h>
+
+#include "cull.h"
+
+#define ITERATIONS 50
+
+static double runPath(const CullBounds *bounds, const Frustum *frustum, int *visible, CullPath path, int *visibleCount)
+{
+    Cull_setPath(path);
+
+    // warm up caches before timing
+    *visibleCount = Cull_frustum(bounds, frustum, visible);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        *visibleCount = Cull_frustum(bounds, frustum, visible);
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    return (double)(end - start) * 1000.0 / (double)SDL_GetPerformanceFrequency() / ITERATIONS;
+}
+
+int main()
+{
+    // camera in the middle of the field, so roughly a tenth of it is visible
+    mat4 view, projection, viewProjection;
+    glm_lookat((vec3){0.0f, 10.0f, 0.0f}, (vec3){0.0f, 0.0f, -100.0f}, (vec3){0.0f, 1.0f, 0.0f}, view);
+    glm_perspective(glm_rad(45.0f), 16.0f / 9.0f, 0.1f, 500.0f, projection);
+    glm_mat4_mul(projection, view, viewProjection);
+
+    Frustum frustum;
+    Frustum_extract(&frustum, viewProjection);
+
+    SDL_Log("Culling against 6 planes, %d iterations (detected path: %s)", ITERATIONS, Cull_pathName(Cull_getPath()));
+
+    int counts[] = {10000, 100000, 1000000};
+    for (int c = 0; c < 3; c++)
+    {
+        int count = counts[c];
+
+        CullBounds bounds;
+        CullBounds_init(&bounds, count);
+        int *visible = SDL_malloc(bounds.capacity * sizeof(int));
+
+        Uint32 seed = 12345;
+        for (int i = 0; i < count; i++)
+        {
+            vec3 center, extent;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                center[axis] = ((seed >> 8) / 16777216.0f - 0.5f) * (axis == 1 ? 20.0f : 1000.0f);
+                extent[axis] = 0.5f + (seed & 3);
+            }
+            CullBounds_add(&bounds, center, extent);
+        }
+
+        CullPath paths[] = {CULL_SCALAR, CULL_SSE, CULL_AVX2};
+        for (int p = 0; p < 3; p++)
+        {
+            int visibleCount;
+            double ms = runPath(&bounds, &frustum, visible, paths[p], &visibleCount);
+            SDL_Log("%8d objects %-6s %8.3f ms %10.1f Mobjects/s  %d visible", count, Cull_pathName(Cull_getPath()), ms, count / ms / 1000.0, visibleCount);
+        }
+
+        SDL_free(visible);
+        CullBounds_free(&bounds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+#include <float.h>
+#include <SDL2/SDL.h>
+
+#include "heightfield.h"
+#include "job.h"
+#include "noise.h"
+
+// the jetattack terrain: 32 units a chunk, a sample per unit, 14 high
+#define TILE_CELLS 32
+#define TILE_SIZE 32.0f
+#define TILES_SIDE 16
+#define MAX_HEIGHT 14.0f
+#define QUERY_COUNT (1 << 20)
+#define ITERATIONS 4
+#define VERIFY_COUNT 2000
+#define VERIFY_GRID 64
+
+typedef enum QueryType
+{
+    QUERY_RAY,
+    QUERY_SEGMENT,
+    QUERY_SPHERE
+} QueryType;
+
+typedef struct Queries
+{
+    const HeightfieldTiles *tiles;
+    QueryType type;
+    vec3 *origins;
+    vec3 *directions; // the far end for segments
+    float *sizes;     // ray length or sphere radius
+    bool *hits;
+} Queries;
+
+static Heightfield fields[TILES_SIDE * TILES_SIDE];
+
+static const Heightfield *lookupTile(void *data, int tileX, int tileZ)
+{
+    if (tileX < 0 || tileZ < 0 || tileX >= TILES_SIDE || tileZ >= TILES_SIDE)
+        return NULL;
+
+    return &fields[tileZ * TILES_SIDE + tileX];
+}
+
+static float randomRange(Uint32 *seed, float min, float max)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return min + (max - min) * ((*seed >> 8) / 16777216.0f);
+}
+
+static void runQueries(void *data, int start, int end)
+{
+    Queries *queries = data;
+    for (int i = start; i < end; i++)
+    {
+        HeightfieldHit hit;
+        HeightfieldContact contact;
+        vec3 direction;
+        switch (queries->type)
+        {
+        case QUERY_RAY:
+            queries->hits[i] = Heightfield_raycastTiles(queries->tiles, queries->origins[i], queries->directions[i], queries->sizes[i], &hit);
+            break;
+        case QUERY_SEGMENT:
+            glm_vec3_sub(queries->directions[i], queries->origins[i], direction);
+            queries->hits[i] = Heightfield_raycastTiles(queries->tiles, queries->origins[i], direction, 1.0f, &hit);
+            break;
+        case QUERY_SPHERE:
+            queries->hits[i] = Heightfield_sphereTiles(queries->tiles, queries->origins[i], queries->sizes[i], &contact);
+            break;
+        }
+    }
+}
+
+// how far the ground at x, z reaches above the sphere's underside, or -FLT_MAX
+static float groundDepth(vec3 center, float radius, float x, float z)
+{
+    float distance2 = (x - center[0]) * (x - center[0]) + (z - center[2]) * (z - center[2]);
+    const Heightfield *field = lookupTile(NULL, (int)floorf(x / TILE_SIZE), (int)floorf(z / TILE_SIZE));
+    if (distance2 >= radius * radius || !field)
+        return -FLT_MAX;
+
+    return Heightfield_heightAt(field, x, z) - (center[1] - sqrtf(radius * radius - distance2));
+}
+
+// Deepest contact by brute force: a grid over the sphere's footprint, then a
+// shrinking compass search from every sample near the best one.
+static float bruteSphere(vec3 center, float radius)
+{
+    float best = 0.0f;
+    float step = 2.0f * radius / VERIFY_GRID;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        float threshold = best - 0.5f;
+        for (int a = 0; a <= VERIFY_GRID; a++)
+        {
+            for (int b = 0; b <= VERIFY_GRID; b++)
+            {
+                float x = center[0] - radius + a * step, z = center[2] - radius + b * step;
+                float depth = groundDepth(center, radius, x, z);
+                if (pass == 0 || depth <= 0.0f || depth < threshold)
+                {
+                    best = glm_max(best, depth);
+                    continue;
+                }
+
+                for (float reach = step; reach > 1e-5f; reach *= 0.5f)
+                {
+                    bool moved = true;
+                    while (moved)
+                    {
+                        moved = false;
+                        float offsets[4][2] = {{reach, 0.0f}, {-reach, 0.0f}, {0.0f, reach}, {0.0f, -reach}};
+                        for (int o = 0; o < 4 && !moved; o++)
+                        {
+                            float next = groundDepth(center, radius, x + offsets[o][0], z + offsets[o][1]);
+                            if (next > depth)
+                            {
+                                depth = next;
+                                x += offsets[o][0];
+                                z += offsets[o][1];
+                                moved = true;
+                            }
+                        }
+                    }
+                }
+                best = glm_max(best, depth);
+            }
+        }
+    }
+
+    return best;
+}
+
+// the exact query must never come out shallower than brute force finds
+static void verifySpheres(const HeightfieldTiles *tiles)
+{
+    Uint32 seed = 777;
+    const float world = TILES_SIDE * TILE_SIZE;
+    int worse = 0, missed = 0;
+    float worst = 0.0f;
+    for (int i = 0; i < VERIFY_COUNT; i++)
+    {
+        float x = randomRange(&seed, 4.0f, world - 4.0f), z = randomRange(&seed, 4.0f, world - 4.0f);
+        float radius = randomRange(&seed, 0.3f, 3.0f);
+        vec3 center = {x, groundDepth((vec3){x, 0.0f, z}, 1.0f, x, z) + 1.0f + randomRange(&seed, -1.0f, 3.0f), z};
+
+        HeightfieldContact contact;
+        float depth = Heightfield_sphereTiles(tiles, center, radius, &contact) ? contact.depth : 0.0f;
+        float reference = bruteSphere(center, radius);
+        if (reference - depth > 1e-3f)
+        {
+            worse++;
+            missed += depth == 0.0f;
+        }
+        worst = glm_max(worst, reference - depth);
+    }
+
+    SDL_Log("spheres vs brute force: %d/%d shallower by over 0.001 (%d missed), worst %.5f", worse, VERIFY_COUNT, missed, worst);
+}
+
+// queries per second
+static double runType(Queries *queries, bool parallel, int *hitCount)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        if (parallel)
+            Job_parallelFor(QUERY_COUNT, 4096, runQueries, queries);
+        else
+            runQueries(queries, 0, QUERY_COUNT);
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    *hitCount = 0;
+    for (int i = 0; i < QUERY_COUNT; i++)
+        *hitCount += queries->hits[i];
+
+    double seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+    return (double)QUERY_COUNT * ITERATIONS / seconds;
+}
+
+int main()
+{
+    NoiseParams noise = {NOISE_SIMPLEX, NOISE_FBM, 1337, 5, 0.015f, 2.0f, 0.5f};
+
+    Uint64 buildStart = SDL_GetPerformanceCounter();
+    for (int tile = 0; tile < TILES_SIDE * TILES_SIDE; tile++)
+    {
+        Heightfield *field = &fields[tile];
+        Heightfield_init(field, TILE_CELLS, TILE_SIZE / TILE_CELLS);
+
+        float originX = (tile % TILES_SIDE) * TILE_SIZE, originZ = (tile / TILES_SIDE) * TILE_SIZE;
+        for (int j = 0; j <= TILE_CELLS; j++)
+        {
+            for (int i = 0; i <= TILE_CELLS; i++)
+                field->heights[j * (TILE_CELLS + 1) + i] = Noise_sample(&noise, originX + i * field->cellSize, originZ + j * field->cellSize) * MAX_HEIGHT;
+        }
+        Heightfield_build(field, originX, originZ);
+    }
+    double buildMs = (double)(SDL_GetPerformanceCounter() - buildStart) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+    HeightfieldTiles tiles = {lookupTile, NULL, TILE_SIZE, 0.0f, MAX_HEIGHT};
+    Job_init(0);
+
+    verifySpheres(&tiles);
+
+    Queries queries = {&tiles};
+    queries.origins = SDL_malloc(QUERY_COUNT * sizeof(vec3));
+    queries.directions = SDL_malloc(QUERY_COUNT * sizeof(vec3));
+    queries.sizes = SDL_malloc(QUERY_COUNT * sizeof(float));
+    queries.hits = SDL_malloc(QUERY_COUNT * sizeof(bool));
+
+    SDL_Log("%dx%d tiles of %d^2 cells (sampled in %.1f ms), %d queries x %d iterations, %d threads",
+            TILES_SIDE, TILES_SIDE, TILE_CELLS, buildMs, QUERY_COUNT, ITERATIONS, Job_workerCount());
+
+    const char *names[] = {"bullet rays", "sight lines", "spheres"};
+    const float world = TILES_SIDE * TILE_SIZE;
+    for (QueryType type = QUERY_RAY; type <= QUERY_SPHERE; type++)
+    {
+        // bullets fly level or dive from jet height, AI looks 64 units around
+        // from near the ground, spheres sit on or just above it
+        Uint32 seed = 12345;
+        for (int i = 0; i < QUERY_COUNT; i++)
+        {
+            float x = randomRange(&seed, 0.0f, world), z = randomRange(&seed, 0.0f, world);
+            float angle = randomRange(&seed, 0.0f, 2.0f * GLM_PIf);
+            switch (type)
+            {
+            case QUERY_RAY:
+                glm_vec3_copy((vec3){x, randomRange(&seed, 16.0f, 24.0f), z}, queries.origins[i]);
+                glm_vec3_copy((vec3){cosf(angle), randomRange(&seed, -0.5f, 0.05f), sinf(angle)}, queries.directions[i]);
+                glm_vec3_normalize(queries.directions[i]);
+                queries.sizes[i] = 150.0f;
+                break;
+            case QUERY_SEGMENT:
+            {
+                float reach = randomRange(&seed, 0.0f, 64.0f);
+                glm_vec3_copy((vec3){x, randomRange(&seed, 2.0f, 18.0f), z}, queries.origins[i]);
+                glm_vec3_copy((vec3){x + cosf(angle) * reach, randomRange(&seed, 2.0f, 18.0f), z + sinf(angle) * reach}, queries.directions[i]);
+                break;
+            }
+            case QUERY_SPHERE:
+            {
+                int tile = SDL_min((int)(z / TILE_SIZE), TILES_SIDE - 1) * TILES_SIDE + SDL_min((int)(x / TILE_SIZE), TILES_SIDE - 1);
+                float ground = Heightfield_heightAt(&fields[tile], x, z);
+                glm_vec3_copy((vec3){x, ground + randomRange(&seed, -1.0f, 3.0f), z}, queries.origins[i]);
+                queries.sizes[i] = randomRange(&seed, 0.5f, 2.0f);
+                break;
+            }
+            }
+        }
+
+        queries.type = type;
+        for (int parallel = 0; parallel < 2; parallel++)
+        {
+            int hitCount;
+            double rate = runType(&queries, parallel, &hitCount);
+            SDL_Log("%-12s %2d threads %8.2f Mqueries/s  %5.1f%% hit", names[type], parallel ? Job_workerCount() : 1, rate / 1e6, 100.0 * hitCount / QUERY_COUNT);
+        }
+    }
+
+    SDL_free(queries.origins);
+    SDL_free(queries.directions);
+    SDL_free(queries.sizes);
+    SDL_free(queries.hits);
+
+    for (int tile = 0; tile < TILES_SIDE * TILES_SIDE; tile++)
+        Heightfield_free(&fields[tile]);
+
+    Job_shutdown();
+    return 0;
+}
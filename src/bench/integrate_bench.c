@@ -0,0 +1,53 @@
+#include <SDL2/SDL.h>
+
+#include "integrate.h"
+
+#define ENTITY_COUNT 100000
+#define ITERATIONS 500
+
+static double runPath(Bodies *bodies, IntegratePath path, const Playfield *playfield)
+{
+    Integrate_setPath(path);
+
+    // warm up caches before timing
+    Integrate_bodies(bodies, 1.0f / 60.0f, playfield);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        Integrate_bodies(bodies, 1.0f / 60.0f, playfield);
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    double ms = (double)(end - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    return (double)ENTITY_COUNT * ITERATIONS / ms;
+}
+
+int main()
+{
+    Playfield playfield = {{-50.0f, -50.0f, -50.0f}, {50.0f, 50.0f, 50.0f}};
+
+    Bodies bodies;
+    Bodies_init(&bodies, ENTITY_COUNT);
+
+    for (int i = 0; i < ENTITY_COUNT; i++)
+    {
+        int body = Bodies_add(&bodies, (i % 100) - 50.0f, (i % 37) - 18.0f, (i % 13) - 6.0f);
+        bodies.speedX[body] = (i % 7) - 3.0f;
+        bodies.speedY[body] = (i % 5) - 2.0f;
+        bodies.accelY[body] = -9.8f;
+    }
+
+    SDL_Log("Integrating %d entities, %d iterations (detected path: %s)", ENTITY_COUNT, ITERATIONS, Integrate_pathName(Integrate_getPath()));
+
+    IntegratePath paths[] = {INTEGRATE_SCALAR, INTEGRATE_SSE, INTEGRATE_AVX};
+    for (int i = 0; i < 3; i++)
+    {
+        double rate = runPath(&bodies, paths[i], &playfield);
+        SDL_Log("%-6s %12.0f entities/ms", Integrate_pathName(Integrate_getPath()), rate);
+    }
+
+    Bodies_free(&bodies);
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "cglm/cglm.h"
+
+#include "glstate.h"
+#include "mesharena.h"
+#include "multidraw.h"
+#include "ringbuffer.h"
+
+#define FRAMES 20
+#define SHAPES 16
+
+// per draw model matrix from a uniform (classic path) or an instanced attribute
+static const char *uniformVertexSource =
+    "#version 330 core\n"
+    "layout(location = 0) in vec3 aPos;\n"
+    "uniform mat4 model;\n"
+    "uniform mat4 viewProjection;\n"
+    "void main() { gl_Position = viewProjection * model * vec4(aPos, 1.0); }\n";
+
+static const char *instancedVertexSource =
+    "#version 330 core\n"
+    "layout(location = 0) in vec3 aPos;\n"
+    "layout(location = 3) in mat4 aModel;\n"
+    "uniform mat4 viewProjection;\n"
+    "void main() { gl_Position = viewProjection * aModel * vec4(aPos, 1.0); }\n";
+
+static const char *fragmentSource =
+    "#version 330 core\n"
+    "out vec4 FragColor;\n"
+    "void main() { FragColor = vec4(1.0); }\n";
+
+typedef enum BenchPath
+{
+    BENCH_PER_DRAW,
+    BENCH_LOOP,
+    BENCH_BASEVERTEX,
+    BENCH_INDIRECT
+} BenchPath;
+
+static const char *benchPathNames[] = {"per-draw", "loop", "basevertex", "indirect"};
+
+static GLuint compileProgram(const char *vertexSource)
+{
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexSource, NULL);
+    glCompileShader(vertexShader);
+
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+    glCompileShader(fragmentShader);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+
+    int success;
+    char infoLog[512];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        SDL_Log("Shader program linking failed: %s\n", infoLog);
+    }
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    return program;
+}
+
+// boxes of different proportions, so every draw has its own base vertex
+static void addShapes(MeshArena *arena, Mesh *shapes)
+{
+    static const unsigned int indices[36] = {
+        0, 1, 2, 2, 3, 0, 4, 6, 5, 6, 4, 7, 0, 3, 7, 7, 4, 0,
+        1, 5, 6, 6, 2, 1, 3, 2, 6, 6, 7, 3, 0, 4, 5, 5, 1, 0};
+
+    for (int s = 0; s < SHAPES; s++)
+    {
+        float x = 0.05f + 0.01f * (s & 3), y = 0.05f + 0.01f * (s >> 2), z = 0.05f;
+        float vertices[8 * 3] = {
+            -x, -y, -z, x, -y, -z, x, y, -z, -x, y, -z,
+            -x, -y, z, x, -y, z, x, y, z, -x, y, z};
+
+        MeshArena_add(arena, vertices, 8, indices, 36, &shapes[s]);
+    }
+}
+
+static void buildModels(mat4 *models, int count)
+{
+    int side = (int)SDL_ceilf(SDL_sqrtf((float)count));
+    for (int i = 0; i < count; i++)
+    {
+        glm_mat4_identity(models[i]);
+        glm_translate(models[i], (vec3){(i % side) / (float)side * 2.0f - 1.0f, (i / side) / (float)side * 2.0f - 1.0f, 0.0f});
+    }
+}
+
+static void drawFrame(BenchPath path, int count, MeshArena *arena, Mesh *shapes, mat4 *models,
+                      MultiDraw *draws, RingBuffer *modelRing, GLuint uniformProgram, GLuint instancedProgram)
+{
+    if (path == BENCH_PER_DRAW)
+    {
+        GLState_useProgram(uniformProgram);
+        GLState_bindVertexArray(arena->VAO);
+        GLint modelLoc = glGetUniformLocation(uniformProgram, "model");
+
+        for (int i = 0; i < count; i++)
+        {
+            const Mesh *mesh = &shapes[i % SHAPES];
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)models[i]);
+            glDrawElementsBaseVertex(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT,
+                                     (void *)(uintptr_t)(mesh->firstIndex * sizeof(GLuint)), mesh->baseVertex);
+        }
+        return;
+    }
+
+    MultiDraw_setPath(path == BENCH_INDIRECT ? MULTIDRAW_INDIRECT : (path == BENCH_BASEVERTEX ? MULTIDRAW_BASEVERTEX : MULTIDRAW_LOOP));
+    MultiDraw_beginFrame(draws);
+    RingBuffer_beginFrame(modelRing);
+
+    // basevertex has no way to reach per draw data, it draws every shape at the origin
+    MultiDrawData modelData = {modelRing->buffer, 0, 3, 4, sizeof(mat4)};
+    if (path != BENCH_BASEVERTEX)
+    {
+        void *memory = RingBuffer_alloc(modelRing, count * sizeof(mat4), sizeof(vec4), &modelData.offset);
+        SDL_memcpy(memory, models, count * sizeof(mat4));
+        RingBuffer_flush(modelRing);
+    }
+
+    GLState_useProgram(path == BENCH_BASEVERTEX ? uniformProgram : instancedProgram);
+    for (int i = 0; i < count; i++)
+        MultiDraw_add(draws, &shapes[i % SHAPES], 1);
+
+    MultiDraw_submit(draws, arena, GL_TRIANGLES, path == BENCH_BASEVERTEX ? NULL : &modelData);
+
+    MultiDraw_endFrame(draws);
+    RingBuffer_endFrame(modelRing);
+}
+
+int main()
+{
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    {
+        SDL_Log("Error initializing SDL: %s", SDL_GetError());
+        return 1;
+    }
+
+    // ask for 4.3 so the indirect path exists, settle for 3.3
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+    SDL_Window *window = SDL_CreateWindow("multidraw bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 640, 360, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext context = window ? SDL_GL_CreateContext(window) : NULL;
+    if (window && !context)
+    {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        context = SDL_GL_CreateContext(window);
+    }
+
+    if (!context)
+    {
+        SDL_Log("Error creating GL context: %s", SDL_GetError());
+        return 1;
+    }
+
+    glewExperimental = GL_TRUE;
+    glewInit();
+    SDL_GL_SetSwapInterval(0);
+
+    GLuint uniformProgram = compileProgram(uniformVertexSource);
+    GLuint instancedProgram = compileProgram(instancedVertexSource);
+
+    mat4 viewProjection;
+    glm_mat4_identity(viewProjection);
+    GLuint programs[] = {uniformProgram, instancedProgram};
+    for (int p = 0; p < 2; p++)
+    {
+        GLState_useProgram(programs[p]);
+        glUniformMatrix4fv(glGetUniformLocation(programs[p], "viewProjection"), 1, GL_FALSE, (float *)viewProjection);
+    }
+
+    MeshFormat format = {3 * sizeof(float), 1, {{3, 0}}};
+    MeshArena arena;
+    MeshArena_init(&arena, &format, SHAPES * 8, SHAPES * 36);
+
+    Mesh shapes[SHAPES];
+    addShapes(&arena, shapes);
+
+    SDL_Log("%s, %d frames per run (detected path: %s)", glGetString(GL_VERSION), FRAMES, MultiDraw_pathName(MultiDraw_getPath()));
+
+    int counts[] = {1000, 10000, 100000};
+    for (int c = 0; c < 3; c++)
+    {
+        int count = counts[c];
+
+        mat4 *models = SDL_SIMDAlloc(count * sizeof(mat4));
+        buildModels(models, count);
+
+        MultiDraw draws;
+        MultiDraw_init(&draws, count);
+
+        RingBuffer modelRing;
+        RingBuffer_init(&modelRing, GL_ARRAY_BUFFER, count * sizeof(mat4));
+
+        for (BenchPath path = BENCH_PER_DRAW; path <= BENCH_INDIRECT; path++)
+        {
+            if (path == BENCH_INDIRECT && !draws.indirect.buffer)
+            {
+                SDL_Log("  %7d draws  %-10s  unsupported", count, benchPathNames[path]);
+                continue;
+            }
+
+            // warm up, then time submission alone and submission plus GPU
+            drawFrame(path, count, &arena, shapes, models, &draws, &modelRing, uniformProgram, instancedProgram);
+            glFinish();
+
+            double submitMs = 0.0, frameMs = 0.0;
+            for (int f = 0; f < FRAMES; f++)
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+
+                Uint64 start = SDL_GetPerformanceCounter();
+                drawFrame(path, count, &arena, shapes, models, &draws, &modelRing, uniformProgram, instancedProgram);
+                Uint64 submitted = SDL_GetPerformanceCounter();
+                glFinish();
+                Uint64 finished = SDL_GetPerformanceCounter();
+
+                submitMs += (double)(submitted - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+                frameMs += (double)(finished - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+            }
+
+            SDL_Log("  %7d draws  %-10s  submit %8.3f ms  frame %8.3f ms", count, benchPathNames[path], submitMs / FRAMES, frameMs / FRAMES);
+        }
+
+        RingBuffer_free(&modelRing);
+        MultiDraw_free(&draws);
+        SDL_SIMDFree(models);
+    }
+
+    MeshArena_free(&arena);
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return 0;
+}
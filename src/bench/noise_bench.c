@@ -0,0 +1,123 @@
+#include <SDL2/SDL.h>
+
+#include "noise.h"
+
+#define SAMPLE_COUNT (256 * 256)
+#define ITERATIONS 20
+// odd, so every batch also ends in scalar leftovers
+#define VERIFY_SIDE 1021
+#define VERIFY_COUNT (VERIFY_SIDE * VERIFY_SIDE)
+
+static float sampleX[SAMPLE_COUNT];
+static float sampleZ[SAMPLE_COUNT];
+static float heights[SAMPLE_COUNT];
+
+static float verifyX[VERIFY_COUNT];
+static float verifyZ[VERIFY_COUNT];
+static float expected[VERIFY_COUNT];
+static float actual[VERIFY_COUNT];
+
+static const char *typeNames[] = {"value", "perlin", "simplex"};
+static const char *fractalNames[] = {"fbm", "ridged"};
+
+// Every path must give the same bits as single samples, or terrain built in
+// batches would not match the heights collision reads one at a time.
+// Returns the number of mismatches.
+static int verifyPaths()
+{
+    for (int i = 0; i < VERIFY_COUNT; i++)
+    {
+        // both signs and off the lattice, where floor and hashing differ most
+        verifyX[i] = (i % VERIFY_SIDE - VERIFY_SIDE / 2) * 0.613f;
+        verifyZ[i] = (i / VERIFY_SIDE - VERIFY_SIDE / 2) * 0.587f;
+    }
+
+    int mismatches = 0;
+    for (int type = NOISE_VALUE; type <= NOISE_SIMPLEX; type++)
+    {
+        for (int fractal = NOISE_FBM; fractal <= NOISE_RIDGED; fractal++)
+        {
+            NoiseParams params = {type, fractal, 1337, 5, 0.015f, 2.0f, 0.5f};
+            for (int i = 0; i < VERIFY_COUNT; i++)
+                expected[i] = Noise_sample(&params, verifyX[i], verifyZ[i]);
+
+            NoisePath paths[] = {NOISE_SCALAR, NOISE_SSE2, NOISE_AVX2};
+            for (int p = 0; p < 3; p++)
+            {
+                Noise_setPath(paths[p]);
+                if (Noise_getPath() != paths[p])
+                {
+                    SDL_Log("%-8s %-6s %-6s not available, skipped", typeNames[type], fractalNames[fractal], Noise_pathName(paths[p]));
+                    continue;
+                }
+
+                Noise_sampleBatch(&params, verifyX, verifyZ, actual, VERIFY_COUNT);
+
+                int wrong = 0;
+                for (int i = 0; i < VERIFY_COUNT; i++)
+                {
+                    if (SDL_memcmp(&expected[i], &actual[i], sizeof(float)) == 0)
+                        continue;
+
+                    if (wrong++ < 4)
+                        SDL_Log("  mismatch at (%g, %g): single %.9g, batch %.9g", verifyX[i], verifyZ[i], expected[i], actual[i]);
+                }
+
+                SDL_Log("%-8s %-6s %-6s %d/%d samples differ from single calls", typeNames[type], fractalNames[fractal], Noise_pathName(paths[p]), wrong, VERIFY_COUNT);
+                mismatches += wrong;
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+static double runPath(const NoiseParams *params, NoisePath path)
+{
+    Noise_setPath(path);
+    Noise_sampleBatch(params, sampleX, sampleZ, heights, SAMPLE_COUNT);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        Noise_sampleBatch(params, sampleX, sampleZ, heights, SAMPLE_COUNT);
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    double seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+    return (double)SAMPLE_COUNT * ITERATIONS / seconds;
+}
+
+int main()
+{
+    for (int i = 0; i < SAMPLE_COUNT; i++)
+    {
+        sampleX[i] = (i % 256) * 0.5f;
+        sampleZ[i] = (i / 256) * 0.5f;
+    }
+
+    NoisePath detected = Noise_getPath();
+    int mismatches = verifyPaths();
+
+    SDL_Log("%d samples x %d iterations, 5 octaves fBm (detected path: %s)", SAMPLE_COUNT, ITERATIONS, Noise_pathName(detected));
+
+    for (int type = NOISE_VALUE; type <= NOISE_SIMPLEX; type++)
+    {
+        NoiseParams params = {type, NOISE_FBM, 1337, 5, 0.015f, 2.0f, 0.5f};
+
+        NoisePath paths[] = {NOISE_SCALAR, NOISE_SSE2, NOISE_AVX2};
+        for (int i = 0; i < 3; i++)
+        {
+            double rate = runPath(&params, paths[i]);
+            SDL_Log("%-8s %-6s %8.2f Msamples/s", typeNames[type], Noise_pathName(Noise_getPath()), rate / 1e6);
+        }
+    }
+
+    if (mismatches)
+    {
+        SDL_Log("%d samples are not bit-identical across paths", mismatches);
+        return 1;
+    }
+
+    return 0;
+}
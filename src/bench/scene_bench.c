@@ -0,0 +1,99 @@
+#include <SDL2/SDL.h>
+
+#include "scene.h"
+
+// a forest of small rigs: a root, its limbs, and the joints along each limb
+#define ROOTS 1000
+#define LIMBS 10
+#define JOINTS 9
+#define ITERATIONS 200
+
+typedef enum Workload
+{
+    WORKLOAD_STATIC,
+    WORKLOAD_JOINTS,
+    WORKLOAD_ROOTS,
+    WORKLOAD_EVERYTHING
+} Workload;
+
+static int roots[ROOTS];
+static int joints[ROOTS * LIMBS * JOINTS];
+
+static void touch(Scene *scene, Workload workload, int iteration)
+{
+    versor spin;
+    glm_quatv(spin, iteration * 0.01f, (vec3){0.0f, 1.0f, 0.0f});
+
+    switch (workload)
+    {
+    case WORKLOAD_STATIC:
+        break;
+    case WORKLOAD_JOINTS:
+        // a joint in a hundred bends, a few nodes below it follow
+        for (int i = iteration % 100; i < ROOTS * LIMBS * JOINTS; i += 100)
+            Scene_setRotation(scene, joints[i], spin);
+        break;
+    case WORKLOAD_ROOTS:
+        for (int i = iteration % 100; i < ROOTS; i += 100)
+            Scene_setRotation(scene, roots[i], spin);
+        break;
+    case WORKLOAD_EVERYTHING:
+        // what rebuilding every transform from scratch each frame costs
+        for (int i = 0; i < ROOTS; i++)
+            Scene_setRotation(scene, roots[i], spin);
+        break;
+    }
+}
+
+int main()
+{
+    Scene scene;
+    Scene_init(&scene, ROOTS * (1 + LIMBS * (1 + JOINTS)));
+
+    versor identity;
+    glm_quat_identity(identity);
+    vec3 one = {1.0f, 1.0f, 1.0f};
+
+    int jointCount = 0;
+    for (int r = 0; r < ROOTS; r++)
+    {
+        roots[r] = Scene_add(&scene, -1, (vec3){(r % 32) * 4.0f, 0.0f, (r / 32) * 4.0f}, identity, one);
+        for (int l = 0; l < LIMBS; l++)
+        {
+            versor splay;
+            glm_quatv(splay, l * 2.0f * GLM_PIf / LIMBS, (vec3){0.0f, 1.0f, 0.0f});
+            int parent = Scene_add(&scene, roots[r], (vec3){0.5f, 0.0f, 0.0f}, splay, one);
+
+            // each joint hangs off the one before
+            for (int j = 0; j < JOINTS; j++)
+            {
+                parent = Scene_add(&scene, parent, (vec3){0.2f, 0.0f, 0.0f}, identity, one);
+                joints[jointCount++] = parent;
+            }
+        }
+    }
+    Scene_update(&scene);
+
+    SDL_Log("%d nodes (%d rigs of %d limbs x %d joints), %d iterations", scene.count, ROOTS, LIMBS, JOINTS, ITERATIONS);
+
+    const char *names[] = {"static", "1% joints", "1% roots", "everything"};
+    for (Workload workload = WORKLOAD_STATIC; workload <= WORKLOAD_EVERYTHING; workload++)
+    {
+        int rebuilt = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            touch(&scene, workload, i);
+            Scene_update(&scene);
+            rebuilt += Scene_stats(&scene).rebuilt;
+        }
+        Uint64 end = SDL_GetPerformanceCounter();
+
+        double ms = (double)(end - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+        SDL_Log("%-10s %7d matrices rebuilt per update, %8.4f ms", names[workload], rebuilt / ITERATIONS, ms / ITERATIONS);
+    }
+
+    Scene_free(&scene);
+
+    return 0;
+}
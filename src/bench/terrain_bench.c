@@ -0,0 +1,222 @@
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "job.h"
+#include "terrain.h"
+
+// Collision through the Terrain_* entry points, the way the game calls them.
+// Run it from src/jetattack so the terrain finds its shaders.
+#define QUERY_COUNT (1 << 18)
+#define ITERATIONS 4
+#define STREAM_MS 2000
+#define STREAM_HOP_MS 100
+
+typedef enum QueryType
+{
+    QUERY_RAY,
+    QUERY_SEGMENT,
+    QUERY_SPHERE
+} QueryType;
+
+typedef struct Queries
+{
+    QueryType type;
+    vec3 *origins;
+    vec3 *directions; // the far end for segments
+    float *sizes;     // ray length or sphere radius
+    bool *hits;
+} Queries;
+
+typedef struct Stream
+{
+    Queries *queries;
+    SDL_atomic_t running;
+    int done;
+    int hits;
+} Stream;
+
+static float randomRange(Uint32 *seed, float min, float max)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return min + (max - min) * ((*seed >> 8) / 16777216.0f);
+}
+
+static void runQueries(void *data, int start, int end)
+{
+    Queries *queries = data;
+    for (int i = start; i < end; i++)
+    {
+        HeightfieldHit hit;
+        HeightfieldContact contact;
+        switch (queries->type)
+        {
+        case QUERY_RAY:
+            queries->hits[i] = Terrain_raycast(queries->origins[i], queries->directions[i], queries->sizes[i], &hit);
+            break;
+        case QUERY_SEGMENT:
+            queries->hits[i] = Terrain_segment(queries->origins[i], queries->directions[i], &hit);
+            break;
+        case QUERY_SPHERE:
+            queries->hits[i] = Terrain_sphere(queries->origins[i], queries->sizes[i], &contact);
+            break;
+        }
+    }
+}
+
+// queries per second
+static double runType(Queries *queries, bool parallel, int *hitCount)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        if (parallel)
+            Job_parallelFor(QUERY_COUNT, 4096, runQueries, queries);
+        else
+            runQueries(queries, 0, QUERY_COUNT);
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    *hitCount = 0;
+    for (int i = 0; i < QUERY_COUNT; i++)
+        *hitCount += queries->hits[i];
+
+    double seconds = (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+    return (double)QUERY_COUNT * ITERATIONS / seconds;
+}
+
+// keeps querying while the main thread streams chunks in and out
+static int streamMain(void *data)
+{
+    Stream *stream = data;
+    while (SDL_AtomicGet(&stream->running))
+    {
+        runQueries(stream->queries, 0, 4096);
+        stream->done += 4096;
+        for (int i = 0; i < 4096; i++)
+            stream->hits += stream->queries->hits[i];
+    }
+
+    return 0;
+}
+
+static void waitForChunks(vec3 focus)
+{
+    do
+    {
+        SDL_Delay(1);
+        Terrain_update(focus);
+    } while (Terrain_stats().building > 0);
+}
+
+int main()
+{
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    {
+        SDL_Log("Error initializing SDL: %s", SDL_GetError());
+        return 1;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+    SDL_Window *window = SDL_CreateWindow("terrain bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 640, 360, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext context = window ? SDL_GL_CreateContext(window) : NULL;
+    if (!context)
+    {
+        SDL_Log("Error creating GL context: %s", SDL_GetError());
+        return 1;
+    }
+
+    glewExperimental = GL_TRUE;
+    glewInit();
+
+    Job_init(0);
+    Terrain_init(1337);
+
+    vec3 focus = {0.0f, 0.0f, 0.0f};
+    waitForChunks(focus);
+
+    Queries queries = {0};
+    queries.origins = SDL_malloc(QUERY_COUNT * sizeof(vec3));
+    queries.directions = SDL_malloc(QUERY_COUNT * sizeof(vec3));
+    queries.sizes = SDL_malloc(QUERY_COUNT * sizeof(float));
+    queries.hits = SDL_malloc(QUERY_COUNT * sizeof(bool));
+
+    SDL_Log("%d resident chunks, %d queries x %d iterations, %d threads",
+            Terrain_stats().resident, QUERY_COUNT, ITERATIONS, Job_workerCount());
+
+    // everything inside the chunks kept around a focus at the origin
+    const char *names[] = {"bullet rays", "sight lines", "spheres"};
+    for (QueryType type = QUERY_RAY; type <= QUERY_SPHERE; type++)
+    {
+        Uint32 seed = 12345;
+        for (int i = 0; i < QUERY_COUNT; i++)
+        {
+            float x = randomRange(&seed, -80.0f, 112.0f), z = randomRange(&seed, -176.0f, 48.0f);
+            float angle = randomRange(&seed, 0.0f, 2.0f * GLM_PIf);
+            switch (type)
+            {
+            case QUERY_RAY:
+                glm_vec3_copy((vec3){x, randomRange(&seed, 16.0f, 24.0f), z}, queries.origins[i]);
+                glm_vec3_copy((vec3){cosf(angle), randomRange(&seed, -0.5f, 0.05f), sinf(angle)}, queries.directions[i]);
+                queries.sizes[i] = 150.0f;
+                break;
+            case QUERY_SEGMENT:
+            {
+                float reach = randomRange(&seed, 0.0f, 64.0f);
+                glm_vec3_copy((vec3){x, randomRange(&seed, 2.0f, 18.0f), z}, queries.origins[i]);
+                glm_vec3_copy((vec3){x + cosf(angle) * reach, randomRange(&seed, 2.0f, 18.0f), z + sinf(angle) * reach}, queries.directions[i]);
+                break;
+            }
+            case QUERY_SPHERE:
+                glm_vec3_copy((vec3){x, Terrain_heightAt(x, z) + randomRange(&seed, -1.0f, 3.0f), z}, queries.origins[i]);
+                queries.sizes[i] = randomRange(&seed, 0.5f, 2.0f);
+                break;
+            }
+        }
+
+        queries.type = type;
+        for (int parallel = 0; parallel < 2; parallel++)
+        {
+            int hitCount;
+            double rate = runType(&queries, parallel, &hitCount);
+            SDL_Log("%-12s %2d threads %8.2f Mqueries/s  %5.1f%% hit", names[type], parallel ? Job_workerCount() : 1, rate / 1e6, 100.0 * hitCount / QUERY_COUNT);
+        }
+    }
+
+    // spheres from another thread while the window hops back and forth by
+    // four chunks, evicting and rebuilding those under half of them; neither
+    // side waits on the other
+    Stream stream = {&queries};
+    SDL_AtomicSet(&stream.running, 1);
+    SDL_Thread *thread = SDL_CreateThread(streamMain, "terrain queries", &stream);
+
+    int startEvicted = Terrain_stats().evicted;
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 elapsedMs;
+    while ((elapsedMs = (SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency()) < STREAM_MS)
+    {
+        focus[2] = (elapsedMs / STREAM_HOP_MS) % 2 ? -4.0f * TERRAIN_CHUNK_SIZE : 0.0f;
+        Terrain_update(focus);
+        SDL_Delay(1);
+    }
+    SDL_AtomicSet(&stream.running, 0);
+    SDL_WaitThread(thread, NULL);
+
+    SDL_Log("streaming    %8.2f Mqueries/s  %5.1f%% hit while %d chunks were evicted",
+            stream.done / (STREAM_MS / 1000.0) / 1e6, 100.0 * stream.hits / stream.done, Terrain_stats().evicted - startEvicted);
+
+    SDL_free(queries.origins);
+    SDL_free(queries.directions);
+    SDL_free(queries.sizes);
+    SDL_free(queries.hits);
+
+    Terrain_free();
+    Job_shutdown();
+
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
@@ -2,6 +2,10 @@
 #include "cglm/cglm.h"
 #include "SDL2/SDL.h"
 
+#include "glstate.h"
+#include "integrate.h"
+#include "mesharena.h"
+
 static float vertices[] = {
     0.0f, 0.0f, 0.0f
 };
@@ -9,15 +13,16 @@ static float vertices[] = {
 typedef struct Ball
 {
     GLuint shaderProgram;
-    unsigned int VAO, VBO, EBO;
+    MeshArena *meshes;
+    Mesh mesh;
 
-    vec3 position;
-    vec3 speed;
+    Bodies *bodies;
+    int body;
 } Ball;
 
 static Ball ball;
 
-void Ball_init()
+void Ball_init(Bodies *bodies, MeshArena *meshes)
 {
     // Shader program
     void *vertexShaderSource = SDL_LoadFile("./shaders/ball.vert", NULL);
@@ -69,37 +74,16 @@ void Ball_init()
     SDL_free(vertexShaderSource);
     SDL_free(fragmentShaderSource);
 
-    glGenVertexArrays(1, &(ball.VAO));
-    glGenBuffers(1, &(ball.VBO));
-
-    // Bind and buffer data
-    glBindVertexArray(ball.VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, ball.VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // Set vertex attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-
-    // Unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    ball.meshes = meshes;
+    MeshArena_add(meshes, vertices, 1, NULL, 0, &ball.mesh);
 
-    glm_vec3_zero(&ball.position);
-    ball.position[1] = 10.0f;
-
-    glm_vec3_zero(&ball.speed);
-}
-
-void Ball_update(float deltaTime)
-{
-    ball.position[0] += ball.speed[0] * deltaTime;
+    ball.bodies = bodies;
+    ball.body = Bodies_add(bodies, 0.0f, 10.0f, 0.0f);
 }
 
-void Ball_draw(mat4 *view, mat4 *projection)
+void Ball_draw(mat4 *view, mat4 *projection, mat4 *models)
 {
-    glUseProgram(ball.shaderProgram);
+    GLState_useProgram(ball.shaderProgram);
 
     unsigned int viewLoc = glGetUniformLocation(ball.shaderProgram, "view");
     unsigned int projectionLoc = glGetUniformLocation(ball.shaderProgram, "projection");
@@ -108,14 +92,10 @@ void Ball_draw(mat4 *view, mat4 *projection)
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)*projection);
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)*view);
 
-    mat4 model;
-    glm_mat4_identity(model);
-    glm_translate(model, ball.position);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)models[ball.body]);
 
-glPointSize(10.0f);
-    glBindVertexArray(ball.VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-    glDrawArrays(GL_POINTS, 0, 1); // set the count to 6 since we're drawing 6 vertices now (2 triangles); not 3!
+    GLState_pointSize(10.0f);
+    MeshArena_draw(ball.meshes, &ball.mesh, GL_POINTS);
 }
 
 const int BALL_SPEED = 10;
@@ -123,11 +103,11 @@ void Ball_setDir(int dir)
 {
     if(dir < 0)
     {
-        ball.speed[0] = -BALL_SPEED;
+        ball.bodies->speedX[ball.body] = -BALL_SPEED;
     } else if(dir > 0)
     {
-        ball.speed[0] = BALL_SPEED;
+        ball.bodies->speedX[ball.body] = BALL_SPEED;
     } else {
-        ball.speed[0] = 0;
+        ball.bodies->speedX[ball.body] = 0;
     }
 }
@@ -1,9 +1,11 @@
 #ifndef BALL_INCLUDED
 #define BALL_INCLUDED
 
-void Ball_init();
-void Ball_update(float deltaTime);
-void Ball_draw(mat4 *view, mat4 *projection);
+#include "integrate.h"
+#include "mesharena.h"
+
+void Ball_init(Bodies *bodies, MeshArena *meshes);
+void Ball_draw(mat4 *view, mat4 *projection, mat4 *models);
 void Ball_setDir(int dir);
 
 #endif
\ No newline at end of file
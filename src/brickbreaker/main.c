@@ -3,7 +3,14 @@
 #include <GL/glew.h>
 #include "cglm/cglm.h"
 
+#include "glstate.h"
+#include "integrate.h"
+#include "job.h"
+#include "mesharena.h"
+#include "particles.h"
+#include "triplebuffer.h"
 #include "paddle.h"
+#include "ball.h"
 
 #define TARGET_FPS 6000
 #define MS_PER_FRAME 1000 / TARGET_FPS
@@ -11,11 +18,41 @@
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
 
+#define MAX_BODIES 64
+#define SIM_HZ 120
+#define DEBRIS_PARTICLES (1 << 16)
+#define DEBRIS_PER_IMPACT 4000
+
 bool isRunning = false;
 static SDL_Window *window;
 static SDL_Renderer *renderer;
 static SDL_GLContext *context;
 
+static Bodies bodies;
+static MeshArena meshes;
+static ParticleSystem particles;
+static Playfield playfield = {
+    {-26.0f, -20.0f, 0.0f},
+    {26.0f, 20.0f, 0.0f}};
+
+// Everything the renderer needs from one simulation step. With --threaded
+// the simulation owns `bodies` and only hands these over through a triple
+// buffer, so the GL thread never touches simulation state.
+typedef struct Snapshot
+{
+    Uint64 tick;
+    int bodyCount;
+    mat4 models[MAX_BODIES];
+
+    // every wall the paddle has run into so far, and where the last one was
+    int impacts;
+    vec3 impactPosition;
+} Snapshot;
+
+static TripleBuffer snapshots;
+static SDL_atomic_t paddleDir;
+static SDL_atomic_t simRunning;
+
 int init()
 {
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS | SDL_INIT_GAMECONTROLLER) != 0)
@@ -51,8 +88,97 @@ int init()
     isRunning = true;
 }
 
-int main()
+// Body updates and model matrices are independent per body, so both run as
+// parallel-for ranges; grains are multiples of 8 to keep the AVX path whole.
+static void updateBodies(void *data, int start, int end)
+{
+    float deltaTime = *(float *)data;
+    Integrate_range(&bodies, start, end, deltaTime, &playfield);
+}
+
+static void buildModels(void *data, int start, int end)
+{
+    mat4 *models = data;
+    for (int i = start; i < end; i++)
+    {
+        glm_translate_make(models[i], (vec3){bodies.positionX[i], bodies.positionY[i], bodies.positionZ[i]});
+    }
+}
+
+static int impacts;
+static vec3 impactPosition;
+static bool paddlePinned;
+
+static void simulate(float deltaTime, Snapshot *snapshot)
+{
+    int dir = SDL_AtomicGet(&paddleDir);
+    Paddle_setDir(dir);
+
+    Job_parallelFor(bodies.count, 256, updateBodies, &deltaTime);
+    Job_parallelFor(bodies.count, 64, buildModels, snapshot->models);
+
+    snapshot->bodyCount = bodies.count;
+
+    // the playfield edge stops the paddle dead; count the moment it arrives
+    int paddle = Paddle_getBody();
+    bool pinned = dir != 0 && bodies.speedX[paddle] == 0.0f;
+    if (pinned && !paddlePinned)
+    {
+        impacts++;
+        glm_vec3_copy((vec3){bodies.positionX[paddle], bodies.positionY[paddle], bodies.positionZ[paddle]}, impactPosition);
+    }
+    paddlePinned = pinned;
+
+    snapshot->impacts = impacts;
+    glm_vec3_copy(impactPosition, snapshot->impactPosition);
+}
+
+// Fixed-rate simulation loop used by --threaded; it is the only thread that
+// submits jobs in that mode.
+static int simulationMain(void *data)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 ticksPerStep = frequency / SIM_HZ;
+    Uint64 prev = SDL_GetPerformanceCounter();
+    Uint64 tick = 0;
+
+    while (SDL_AtomicGet(&simRunning))
+    {
+        Uint64 now = SDL_GetPerformanceCounter();
+        float deltaTime = (float)(now - prev) / (float)frequency;
+        prev = now;
+
+        Snapshot *snapshot = TripleBuffer_writeSlot(&snapshots);
+        simulate(deltaTime, snapshot);
+        snapshot->tick = ++tick;
+        TripleBuffer_publish(&snapshots);
+
+        Uint64 elapsed = SDL_GetPerformanceCounter() - now;
+        if (elapsed < ticksPerStep)
+            SDL_Delay((Uint32)((ticksPerStep - elapsed) * 1000 / frequency));
+    }
+
+    return 0;
+}
+
+static int readPaddleDir()
+{
+    int arrayLen;
+    const Uint8 *keyStates = SDL_GetKeyboardState(&arrayLen);
+    if(keyStates[SDL_SCANCODE_LEFT] && keyStates[SDL_SCANCODE_RIGHT]) {
+        return 0;
+    } else if(keyStates[SDL_SCANCODE_LEFT]) {
+        return -1;
+    } else if(keyStates[SDL_SCANCODE_RIGHT]) {
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
 {
+    bool threaded = argc > 1 && SDL_strcmp(argv[1], "--threaded") == 0;
+
     if (init() != 0)
     {
         return 1;
@@ -66,8 +192,48 @@ int main()
     glm_perspective(glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f, projection);
     glm_translate(view, (vec3){0.0f, 0.0f, -50.0f});
 
-    Paddle_init();
-    Ball_init();
+    Job_init(0);
+    Bodies_init(&bodies, MAX_BODIES);
+
+    // paddle and ball are both bare positions, so they share one arena and one VAO
+    MeshFormat positionFormat = {3 * sizeof(float), 1, {{3, 0}}};
+    MeshArena_init(&meshes, &positionFormat, 1024, 1024);
+
+    Paddle_init(&bodies, &meshes);
+    Ball_init(&bodies, &meshes);
+
+    // debris thrown up from the walls, falling back onto the playfield floor
+    Particles_init(&particles, DEBRIS_PARTICLES);
+    int debris = Particles_addEmitter(&particles, DEBRIS_PARTICLES);
+    if (debris >= 0)
+    {
+        ParticleEmitter *emitter = &particles.emitters[debris];
+        glm_vec3_copy((vec3){0.0f, 12.0f, 0.0f}, emitter->velocity);
+        emitter->spread = 10.0f;
+        emitter->lifetime = 2.0f;
+        emitter->size = 0.3f;
+        glm_vec4_copy((vec4){0.9f, 0.8f, 0.5f, 1.0f}, emitter->color);
+    }
+    glm_vec4_copy((vec4){0.0f, 1.0f, 0.0f, -playfield.min[1]}, particles.plane);
+
+    TripleBuffer_init(&snapshots, sizeof(Snapshot));
+
+    SDL_Thread *simulationThread = NULL;
+    if (threaded)
+    {
+        SDL_AtomicSet(&simRunning, 1);
+        simulationThread = SDL_CreateThread(simulationMain, "simulation", NULL);
+        if (!simulationThread)
+        {
+            SDL_Log("Error creating simulation thread: %s", SDL_GetError());
+            threaded = false;
+        }
+    }
+
+    // single-threaded mode simulates straight into this snapshot
+    Snapshot *localSnapshot = SDL_calloc(1, sizeof(Snapshot));
+    const Snapshot *snapshot = NULL;
+    int impactsSeen = 0;
 
     Uint64 msPrevFrame = 0;
     int frameCount = 0;
@@ -111,29 +277,70 @@ int main()
 
         SDL_PumpEvents();
 
-        int arrayLen;
-        Uint8* keyStates = SDL_GetKeyboardState(&arrayLen);
-        if(keyStates[SDL_SCANCODE_LEFT] && keyStates[SDL_SCANCODE_RIGHT]) {
-            Paddle_setDir(0);
-        } else if(keyStates[SDL_SCANCODE_LEFT]) {
-            Paddle_setDir(-1);
-        } else if(keyStates[SDL_SCANCODE_RIGHT]) {
-            Paddle_setDir(1);
-        } else {
-            Paddle_setDir(0);
-        }
+        SDL_AtomicSet(&paddleDir, readPaddleDir());
 
-        Paddle_update(deltaTime);
-        Ball_update(deltaTime);
+        if (threaded)
+        {
+            // keep drawing the previous snapshot until a newer one is published
+            if (TripleBuffer_acquire(&snapshots))
+                snapshot = TripleBuffer_readSlot(&snapshots);
+        }
+        else
+        {
+            simulate(deltaTime, localSnapshot);
+            localSnapshot->tick++;
+            snapshot = localSnapshot;
+        }
 
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        Paddle_draw(&view, &projection);
-        Ball_draw(&view, &projection);
+        if (snapshot)
+        {
+            Paddle_draw(&view, &projection, (mat4 *)snapshot->models);
+            Ball_draw(&view, &projection, (mat4 *)snapshot->models);
+
+            // a snapshot may be drawn more than once, so burst only for new impacts
+            if (debris >= 0 && snapshot->impacts != impactsSeen)
+            {
+                glm_vec3_copy((float *)snapshot->impactPosition, particles.emitters[debris].position);
+                Particles_burst(&particles, debris, (snapshot->impacts - impactsSeen) * DEBRIS_PER_IMPACT);
+                impactsSeen = snapshot->impacts;
+            }
+        }
+
+        Particles_update(&particles, deltaTime);
+        Particles_draw(&particles, &view, &projection, WINDOW_HEIGHT);
+
+        GLStateStats glStats = GLState_endFrame();
+        if (++frameCount % 120 == 0)
+        {
+            MeshArenaStats meshStats = MeshArena_stats(&meshes);
+            SDL_Log("%.0f fps, gl state: %d calls issued, %d skipped", fps, glStats.issued, glStats.skipped);
+            SDL_Log("mesh arena: %d meshes, %d/%d vertices, %d/%d indices, %d holes, %.0f%% fragmented",
+                    meshStats.meshes, meshStats.vertexUsed, meshStats.vertexCapacity, meshStats.indexUsed, meshStats.indexCapacity,
+                    meshStats.vertexHoles + meshStats.indexHoles, 100.0f * SDL_max(meshStats.vertexFragmentation, meshStats.indexFragmentation));
+
+            ParticleStats particleStats = Particles_stats(&particles);
+            SDL_Log("particles: %d slots, %d spawned, update %.3f ms, draw %.3f ms",
+                    particleStats.slots, particleStats.spawned, particleStats.updateMs, particleStats.drawMs);
+        }
 
         SDL_GL_SwapWindow(window);
     }
 
+    if (simulationThread)
+    {
+        SDL_AtomicSet(&simRunning, 0);
+        SDL_WaitThread(simulationThread, NULL);
+    }
+
+    Particles_free(&particles);
+    SDL_free(localSnapshot);
+    TripleBuffer_free(&snapshots);
+    MeshArena_free(&meshes);
+    Bodies_free(&bodies);
+    Job_shutdown();
+
     return 0;
 }
\ No newline at end of file
@@ -2,6 +2,10 @@
 #include "cglm/cglm.h"
 #include "SDL2/SDL.h"
 
+#include "glstate.h"
+#include "integrate.h"
+#include "mesharena.h"
+
 static float vertices[] = {
     10.0f, 0.5f, 0.0f,   // top right
     10.0f, -0.5f, 0.0f,  // bottom right
@@ -18,15 +22,16 @@ static unsigned int indices[] = {
 typedef struct Paddle
 {
     GLuint shaderProgram;
-    unsigned int VAO, VBO, EBO;
+    MeshArena *meshes;
+    Mesh mesh;
 
-    vec3 position;
-    vec3 speed;
+    Bodies *bodies;
+    int body;
 } Paddle;
 
 static Paddle paddle;
 
-void Paddle_init()
+void Paddle_init(Bodies *bodies, MeshArena *meshes)
 {
     // Shader program
     void *vertexShaderSource = SDL_LoadFile("./shaders/paddle.vert", NULL);
@@ -78,41 +83,16 @@ void Paddle_init()
     SDL_free(vertexShaderSource);
     SDL_free(fragmentShaderSource);
 
-    glGenVertexArrays(1, &(paddle.VAO));
-    glGenBuffers(1, &(paddle.VBO));
-    glGenBuffers(1, &(paddle.EBO));
-
-    // Bind and buffer data
-    glBindVertexArray(paddle.VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, paddle.VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, paddle.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    // Set vertex attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-
-    // Unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    glm_vec3_zero(&paddle.position);
-    paddle.position[1] = -20.0f;
+    paddle.meshes = meshes;
+    MeshArena_add(meshes, vertices, 4, indices, 6, &paddle.mesh);
 
-    glm_vec3_zero(&paddle.speed);
+    paddle.bodies = bodies;
+    paddle.body = Bodies_add(bodies, 0.0f, -20.0f, 0.0f);
 }
 
-void Paddle_update(float deltaTime)
+void Paddle_draw(mat4 *view, mat4 *projection, mat4 *models)
 {
-    paddle.position[0] += paddle.speed[0] * deltaTime;
-}
-
-void Paddle_draw(mat4 *view, mat4 *projection)
-{
-    glUseProgram(paddle.shaderProgram);
+    GLState_useProgram(paddle.shaderProgram);
 
     unsigned int viewLoc = glGetUniformLocation(paddle.shaderProgram, "view");
     unsigned int projectionLoc = glGetUniformLocation(paddle.shaderProgram, "projection");
@@ -121,14 +101,9 @@ void Paddle_draw(mat4 *view, mat4 *projection)
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)*projection);
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)*view);
 
-    mat4 model;
-    glm_mat4_identity(model);
-    glm_translate(model, paddle.position);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
-
-    glBindVertexArray(paddle.VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)models[paddle.body]);
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0); // set the count to 6 since we're drawing 6 vertices now (2 triangles); not 3!
+    MeshArena_draw(paddle.meshes, &paddle.mesh, GL_TRIANGLES);
 }
 
 const int PADDLE_SPEED = 10;
@@ -136,11 +111,16 @@ void Paddle_setDir(int dir)
 {
     if(dir < 0)
     {
-        paddle.speed[0] = -PADDLE_SPEED;
+        paddle.bodies->speedX[paddle.body] = -PADDLE_SPEED;
     } else if(dir > 0)
     {
-        paddle.speed[0] = PADDLE_SPEED;
+        paddle.bodies->speedX[paddle.body] = PADDLE_SPEED;
     } else {
-        paddle.speed[0] = 0;
+        paddle.bodies->speedX[paddle.body] = 0;
     }
 }
+
+int Paddle_getBody()
+{
+    return paddle.body;
+}
@@ -1,9 +1,12 @@
 #ifndef PADDLE_INCLUDED
 #define PADDLE_INCLUDED
 
-void Paddle_init();
-void Paddle_update(float deltaTime);
-void Paddle_draw(mat4 *view, mat4 *projection);
+#include "integrate.h"
+#include "mesharena.h"
+
+void Paddle_init(Bodies *bodies, MeshArena *meshes);
+void Paddle_draw(mat4 *view, mat4 *projection, mat4 *models);
 void Paddle_setDir(int dir);
+int Paddle_getBody();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#version 330 core
+
+layout (location = 0) in vec4 positionAge;
+layout (location = 1) in vec4 velocityLife;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float pointScale;
+
+uniform int emitterCount;
+uniform ivec4 emitterSlots[8];
+uniform vec4 emitterColors[8];
+uniform float emitterSizes[8];
+
+out vec4 Color;
+
+void main()
+{
+    int emitter = 0;
+    for (int e = 0; e < emitterCount; e++)
+    {
+        if (gl_VertexID >= emitterSlots[e].x && gl_VertexID < emitterSlots[e].x + emitterSlots[e].y)
+            emitter = e;
+    }
+
+    // dead particles land outside the clip volume and are dropped; the size
+    // stays positive, a point size of 0 is undefined
+    if (positionAge.w >= velocityLife.w)
+    {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 1.0;
+        return;
+    }
+
+    vec4 viewPos = view * vec4(positionAge.xyz, 1.0);
+    gl_Position = projection * viewPos;
+    gl_PointSize = emitterSizes[emitter] * pointScale / max(-viewPos.z, 0.01);
+
+    Color = emitterColors[emitter];
+    Color.a *= 1.0 - positionAge.w / velocityLife.w;
+}
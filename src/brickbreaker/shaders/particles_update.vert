@@ -0,0 +1,83 @@
+#version 330 core
+
+layout (location = 0) in vec4 inPositionAge;
+layout (location = 1) in vec4 inVelocityLife;
+
+uniform float deltaTime;
+uniform vec3 gravity;
+uniform vec4 plane;
+uniform float restitution;
+uniform uint seed;
+
+// per emitter: first slot, slot count, cursor, slots to spawn this frame
+uniform int emitterCount;
+uniform ivec4 emitterSlots[8];
+uniform vec4 emitterLaunches[8];   // position, spread
+uniform vec4 emitterVelocities[8]; // velocity, lifetime
+
+out vec4 positionAge;
+out vec4 velocityLife;
+
+uint state;
+
+float random()
+{
+    state = state * 1664525u + 1013904223u;
+    return float(state >> 8) / 16777216.0;
+}
+
+void main()
+{
+    int emitter = -1;
+    for (int e = 0; e < emitterCount; e++)
+    {
+        if (gl_VertexID >= emitterSlots[e].x && gl_VertexID < emitterSlots[e].x + emitterSlots[e].y)
+            emitter = e;
+    }
+
+    positionAge = inPositionAge;
+    velocityLife = inVelocityLife;
+    if (emitter < 0)
+        return;
+
+    // the spawn window wraps around the end of the emitter's range
+    ivec4 slots = emitterSlots[emitter];
+    int local = gl_VertexID - slots.x;
+    int offset = local - slots.z;
+    if (offset < 0)
+        offset += slots.y;
+
+    if (offset < slots.w)
+    {
+        state = uint(gl_VertexID) * 747796405u ^ seed;
+        state = state * 2891336453u + 1u;
+
+        float z = random() * 2.0 - 1.0;
+        float angle = random() * 6.2831853;
+        vec3 direction = vec3(sqrt(1.0 - z * z) * vec2(cos(angle), sin(angle)), z);
+
+        vec4 launch = emitterLaunches[emitter];
+        vec4 velocity = emitterVelocities[emitter];
+        velocityLife = vec4(velocity.xyz + direction * launch.w * random(), velocity.w * (0.75 + 0.5 * random()));
+        // spread the frame's spawns over the frame so a steady rate does not band
+        positionAge = vec4(launch.xyz, random() * deltaTime);
+        return;
+    }
+
+    if (inPositionAge.w >= inVelocityLife.w)
+        return;
+
+    vec3 velocity = inVelocityLife.xyz + gravity * deltaTime;
+    vec3 position = inPositionAge.xyz + velocity * deltaTime;
+
+    float distance = dot(plane.xyz, position) + plane.w;
+    float approach = dot(plane.xyz, velocity);
+    if (distance < 0.0 && approach < 0.0)
+    {
+        position -= plane.xyz * distance;
+        velocity -= plane.xyz * approach * (1.0 + restitution);
+    }
+
+    positionAge = vec4(position, inPositionAge.w + deltaTime);
+    velocityLife = vec4(velocity, inVelocityLife.w);
+}
@@ -0,0 +1,602 @@
+#include <float.h>
+#include <SDL2/SDL.h>
+
+#include "bvh.h"
+#include "job.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BVH_X86
+#endif
+
+// Subtrees end in a leaf at this depth whatever they hold, so a traversal
+// never has more than BVH_MAX_DEPTH nodes pending and the stack below can
+// not overflow.
+#define BVH_MAX_DEPTH 64
+#define BVH_STACK BVH_MAX_DEPTH
+
+typedef bool (*TraverseFn)(const Bvh *bvh, vec3 origin, vec3 direction, float maxDistance, BvhHit *hit, bool any);
+
+static TraverseFn traverseFn = NULL;
+static BvhPath bvhPath = BVH_SCALAR;
+
+typedef struct BuildState
+{
+    Bvh *bvh;
+    const vec3 *vertices;
+    vec3 *mins, *maxs, *centroids; // per triangle
+    int *order;
+    SDL_atomic_t nodeCount;
+} BuildState;
+
+typedef struct BuildTask
+{
+    BuildState *state;
+    int node, first, count, depth;
+} BuildTask;
+
+typedef struct Bin
+{
+    vec3 min, max;
+    int count;
+} Bin;
+
+static double elapsedMs(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static float halfArea(vec3 min, vec3 max)
+{
+    vec3 size;
+    glm_vec3_sub(max, min, size);
+    return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+static void triangleBounds(void *data, int start, int end)
+{
+    BuildState *state = data;
+    for (int t = start; t < end; t++)
+    {
+        const float *a = state->vertices[t * 3], *b = state->vertices[t * 3 + 1], *c = state->vertices[t * 3 + 2];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            state->mins[t][axis] = glm_min(a[axis], glm_min(b[axis], c[axis]));
+            state->maxs[t][axis] = glm_max(a[axis], glm_max(b[axis], c[axis]));
+            state->centroids[t][axis] = (state->mins[t][axis] + state->maxs[t][axis]) * 0.5f;
+        }
+        state->order[t] = t;
+    }
+}
+
+static int binOf(float centroid, float min, float scale)
+{
+    int bin = (int)((centroid - min) * scale);
+    return SDL_clamp(bin, 0, BVH_BINS - 1);
+}
+
+// Finds the cheapest of the BVH_BINS - 1 planes on each axis. Returns the
+// axis, or -1 when every centroid is in the same spot.
+static int findSplit(BuildState *state, int first, int count, vec3 centroidMin, vec3 centroidMax, int *split, float *cost)
+{
+    int bestAxis = -1;
+    *cost = FLT_MAX;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float extent = centroidMax[axis] - centroidMin[axis];
+        if (extent <= 0.0f)
+            continue;
+
+        Bin bins[BVH_BINS];
+        for (int b = 0; b < BVH_BINS; b++)
+        {
+            glm_vec3_fill(bins[b].min, FLT_MAX);
+            glm_vec3_fill(bins[b].max, -FLT_MAX);
+            bins[b].count = 0;
+        }
+
+        float scale = BVH_BINS / extent;
+        for (int i = first; i < first + count; i++)
+        {
+            int t = state->order[i];
+            Bin *bin = &bins[binOf(state->centroids[t][axis], centroidMin[axis], scale)];
+            glm_vec3_minv(bin->min, state->mins[t], bin->min);
+            glm_vec3_maxv(bin->max, state->maxs[t], bin->max);
+            bin->count++;
+        }
+
+        // area times count left of each plane, then right of it
+        float leftCosts[BVH_BINS - 1];
+        vec3 min, max;
+        glm_vec3_fill(min, FLT_MAX);
+        glm_vec3_fill(max, -FLT_MAX);
+        int left = 0;
+        for (int b = 0; b < BVH_BINS - 1; b++)
+        {
+            left += bins[b].count;
+            glm_vec3_minv(min, bins[b].min, min);
+            glm_vec3_maxv(max, bins[b].max, max);
+            leftCosts[b] = left ? halfArea(min, max) * left : 0.0f;
+        }
+
+        glm_vec3_fill(min, FLT_MAX);
+        glm_vec3_fill(max, -FLT_MAX);
+        int right = 0;
+        for (int b = BVH_BINS - 1; b > 0; b--)
+        {
+            right += bins[b].count;
+            glm_vec3_minv(min, bins[b].min, min);
+            glm_vec3_maxv(max, bins[b].max, max);
+
+            float planeCost = leftCosts[b - 1] + (right ? halfArea(min, max) * right : 0.0f);
+            if (right < count && right > 0 && planeCost < *cost)
+            {
+                *cost = planeCost;
+                *split = b - 1;
+                bestAxis = axis;
+            }
+        }
+    }
+
+    return bestAxis;
+}
+
+static void buildNode(BuildState *state, int nodeIndex, int first, int count, int depth);
+
+static void buildTask(void *data, int start, int end)
+{
+    BuildTask *task = data;
+    buildNode(task->state, task->node, task->first, task->count, task->depth);
+}
+
+// depth counts the root as 1
+static void buildNode(BuildState *state, int nodeIndex, int first, int count, int depth)
+{
+    BvhNode *node = &state->bvh->nodes[nodeIndex];
+
+    vec3 centroidMin, centroidMax;
+    glm_vec3_fill(node->min, FLT_MAX);
+    glm_vec3_fill(node->max, -FLT_MAX);
+    glm_vec3_fill(centroidMin, FLT_MAX);
+    glm_vec3_fill(centroidMax, -FLT_MAX);
+    for (int i = first; i < first + count; i++)
+    {
+        int t = state->order[i];
+        glm_vec3_minv(node->min, state->mins[t], node->min);
+        glm_vec3_maxv(node->max, state->maxs[t], node->max);
+        glm_vec3_minv(centroidMin, state->centroids[t], centroidMin);
+        glm_vec3_maxv(centroidMax, state->centroids[t], centroidMax);
+    }
+
+    node->first = first;
+    node->count = count;
+    if (count <= 1 || depth >= BVH_MAX_DEPTH)
+        return;
+
+    // a traversal step costs as much as one triangle test
+    int split = 0;
+    float splitCost;
+    int axis = findSplit(state, first, count, centroidMin, centroidMax, &split, &splitCost);
+    if (count <= BVH_MAX_LEAF && (axis < 0 || 1.0f + splitCost / halfArea(node->min, node->max) >= count))
+        return;
+
+    int middle = first;
+    if (axis >= 0)
+    {
+        float scale = BVH_BINS / (centroidMax[axis] - centroidMin[axis]);
+        for (int i = first; i < first + count; i++)
+        {
+            int t = state->order[i];
+            if (binOf(state->centroids[t][axis], centroidMin[axis], scale) <= split)
+            {
+                state->order[i] = state->order[middle];
+                state->order[middle++] = t;
+            }
+        }
+    }
+
+    // coincident centroids, any halving will do
+    if (middle == first || middle == first + count)
+        middle = first + count / 2;
+
+    int left = SDL_AtomicAdd(&state->nodeCount, 2);
+    node->first = left;
+    node->count = 0;
+
+    // big subtrees build on the job system, the right one on this thread meanwhile
+    if (count >= BVH_TASK_SIZE)
+    {
+        BuildTask task = {state, left, first, middle - first, depth + 1};
+        Job job = {buildTask, &task, 0, 1};
+        JobCounter counter = {{0}};
+        Job_submit(&job, &counter);
+
+        buildNode(state, left + 1, middle, first + count - middle, depth + 1);
+        Job_wait(&counter);
+        return;
+    }
+
+    buildNode(state, left, first, middle - first, depth + 1);
+    buildNode(state, left + 1, middle, first + count - middle, depth + 1);
+}
+
+static void measureTree(Bvh *bvh)
+{
+    int stack[BVH_STACK], depths[BVH_STACK];
+    int top = 0;
+    stack[top] = 0;
+    depths[top++] = 1;
+
+    bvh->stats.leaves = 0;
+    bvh->stats.depth = 0;
+    while (top > 0)
+    {
+        top--;
+        const BvhNode *node = &bvh->nodes[stack[top]];
+        int depth = depths[top];
+        bvh->stats.depth = SDL_max(bvh->stats.depth, depth);
+
+        if (node->count > 0 || bvh->triangleCount == 0)
+        {
+            bvh->stats.leaves++;
+            continue;
+        }
+
+        SDL_assert(top + 2 <= BVH_STACK);
+        for (int child = 0; child < 2; child++)
+        {
+            stack[top] = node->first + child;
+            depths[top++] = depth + 1;
+        }
+    }
+
+    bvh->stats.nodes = bvh->nodeCount;
+}
+
+void Bvh_build(Bvh *bvh, const vec3 *vertices, int triangleCount)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    SDL_memset(bvh, 0, sizeof(Bvh));
+    bvh->triangleCount = triangleCount;
+
+    // node 1 stays unused so sibling pairs start at even indices
+    int capacity = SDL_max(2 * triangleCount, 2);
+    // a sibling pair fills one 64 byte line only if the array starts on one
+    bvh->nodeMemory = SDL_malloc(capacity * sizeof(BvhNode) + 63);
+    bvh->nodes = (BvhNode *)(((uintptr_t)bvh->nodeMemory + 63) & ~(uintptr_t)63);
+    bvh->vertices = SDL_malloc(SDL_max(triangleCount, 1) * 3 * sizeof(vec3));
+    bvh->triangleIds = SDL_malloc(SDL_max(triangleCount, 1) * sizeof(int));
+    SDL_memset(&bvh->nodes[1], 0, sizeof(BvhNode));
+
+    BuildState state;
+    state.bvh = bvh;
+    state.vertices = vertices;
+    state.mins = SDL_malloc(SDL_max(triangleCount, 1) * sizeof(vec3));
+    state.maxs = SDL_malloc(SDL_max(triangleCount, 1) * sizeof(vec3));
+    state.centroids = SDL_malloc(SDL_max(triangleCount, 1) * sizeof(vec3));
+    state.order = SDL_malloc(SDL_max(triangleCount, 1) * sizeof(int));
+    SDL_AtomicSet(&state.nodeCount, 2);
+
+    Job_parallelFor(triangleCount, 4096, triangleBounds, &state);
+    buildNode(&state, 0, 0, triangleCount, 1);
+    bvh->nodeCount = SDL_AtomicGet(&state.nodeCount);
+
+    for (int i = 0; i < triangleCount; i++)
+    {
+        int t = state.order[i];
+        SDL_memcpy(bvh->vertices[i * 3], vertices[t * 3], 3 * sizeof(vec3));
+        bvh->triangleIds[i] = t;
+    }
+
+    SDL_free(state.mins);
+    SDL_free(state.maxs);
+    SDL_free(state.centroids);
+    SDL_free(state.order);
+
+    measureTree(bvh);
+    bvh->stats.buildMs = elapsedMs(start);
+}
+
+void Bvh_free(Bvh *bvh)
+{
+    SDL_free(bvh->nodeMemory);
+    SDL_free(bvh->vertices);
+    SDL_free(bvh->triangleIds);
+    SDL_memset(bvh, 0, sizeof(Bvh));
+}
+
+void Bvh_refit(Bvh *bvh, const vec3 *vertices)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < bvh->triangleCount; i++)
+        SDL_memcpy(bvh->vertices[i * 3], vertices[bvh->triangleIds[i] * 3], 3 * sizeof(vec3));
+
+    // children always come after their parent, so walking backwards visits them first
+    for (int n = bvh->nodeCount - 1; n >= 0 && bvh->triangleCount > 0; n--)
+    {
+        if (n == 1)
+            continue;
+
+        BvhNode *node = &bvh->nodes[n];
+        if (node->count > 0)
+        {
+            glm_vec3_fill(node->min, FLT_MAX);
+            glm_vec3_fill(node->max, -FLT_MAX);
+            for (int v = node->first * 3; v < (node->first + node->count) * 3; v++)
+            {
+                glm_vec3_minv(node->min, bvh->vertices[v], node->min);
+                glm_vec3_maxv(node->max, bvh->vertices[v], node->max);
+            }
+            continue;
+        }
+
+        const BvhNode *left = &bvh->nodes[node->first], *right = &bvh->nodes[node->first + 1];
+        glm_vec3_minv((float *)left->min, (float *)right->min, node->min);
+        glm_vec3_maxv((float *)left->max, (float *)right->max, node->max);
+    }
+
+    bvh->stats.refitMs = elapsedMs(start);
+}
+
+// Moller-Trumbore, both sides
+static float triangleHit(const vec3 *triangle, vec3 origin, vec3 direction)
+{
+    vec3 edge1, edge2, p, s, q;
+    glm_vec3_sub((float *)triangle[1], (float *)triangle[0], edge1);
+    glm_vec3_sub((float *)triangle[2], (float *)triangle[0], edge2);
+
+    glm_vec3_cross(direction, edge2, p);
+    float determinant = glm_vec3_dot(edge1, p);
+    if (fabsf(determinant) < 1e-12f)
+        return FLT_MAX;
+
+    float inverse = 1.0f / determinant;
+    glm_vec3_sub(origin, (float *)triangle[0], s);
+    float u = glm_vec3_dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f)
+        return FLT_MAX;
+
+    glm_vec3_cross(s, edge1, q);
+    float v = glm_vec3_dot(direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f)
+        return FLT_MAX;
+
+    float t = glm_vec3_dot(edge2, q) * inverse;
+    return t > 0.0f ? t : FLT_MAX;
+}
+
+// true when any is set and something was hit
+static bool leafHit(const Bvh *bvh, const BvhNode *node, vec3 origin, vec3 direction, float *closest, int *found, bool any)
+{
+    for (int i = node->first; i < node->first + node->count; i++)
+    {
+        float t = triangleHit(&bvh->vertices[i * 3], origin, direction);
+        if (t < *closest)
+        {
+            *closest = t;
+            *found = i;
+            if (any)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+static void rayInverse(vec3 direction, vec3 inverse)
+{
+    // a tiny stand-in for zero keeps the slab test free of 0 * inf
+    for (int axis = 0; axis < 3; axis++)
+        inverse[axis] = 1.0f / (fabsf(direction[axis]) > 1e-20f ? direction[axis] : copysignf(1e-20f, direction[axis]));
+}
+
+static bool finishHit(const Bvh *bvh, int found, float closest, BvhHit *hit)
+{
+    if (found < 0)
+        return false;
+
+    if (hit)
+    {
+        const vec3 *triangle = &bvh->vertices[found * 3];
+        vec3 edge1, edge2;
+        glm_vec3_sub((float *)triangle[1], (float *)triangle[0], edge1);
+        glm_vec3_sub((float *)triangle[2], (float *)triangle[0], edge2);
+        glm_vec3_cross(edge1, edge2, hit->normal);
+        glm_vec3_normalize(hit->normal);
+
+        hit->t = closest;
+        hit->triangle = bvh->triangleIds[found];
+    }
+
+    return true;
+}
+
+// entry distance of the ray into the box, or FLT_MAX when it misses within maxDistance
+static float boxEntry(const BvhNode *node, vec3 origin, vec3 inverse, float maxDistance)
+{
+    float near = 0.0f, far = maxDistance;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float t0 = (node->min[axis] - origin[axis]) * inverse[axis];
+        float t1 = (node->max[axis] - origin[axis]) * inverse[axis];
+        near = glm_max(near, glm_min(t0, t1));
+        far = glm_min(far, glm_max(t0, t1));
+    }
+
+    return near <= far ? near : FLT_MAX;
+}
+
+static bool traverseScalar(const Bvh *bvh, vec3 origin, vec3 direction, float maxDistance, BvhHit *hit, bool any)
+{
+    if (bvh->triangleCount == 0)
+        return false;
+
+    vec3 inverse;
+    rayInverse(direction, inverse);
+
+    int found = -1;
+    float closest = maxDistance;
+
+    int stack[BVH_STACK];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const BvhNode *node = &bvh->nodes[stack[--top]];
+        if (node->count > 0)
+        {
+            if (leafHit(bvh, node, origin, direction, &closest, &found, any))
+                return true;
+            continue;
+        }
+
+        // nearer child on top, so it is visited first and shrinks closest for the other
+        float leftEntry = boxEntry(&bvh->nodes[node->first], origin, inverse, closest);
+        float rightEntry = boxEntry(&bvh->nodes[node->first + 1], origin, inverse, closest);
+        int nearChild = leftEntry <= rightEntry ? node->first : node->first + 1;
+        int farChild = nearChild == node->first ? node->first + 1 : node->first;
+
+        SDL_assert(top + 2 <= BVH_STACK);
+        if (SDL_max(leftEntry, rightEntry) < FLT_MAX)
+            stack[top++] = farChild;
+        if (SDL_min(leftEntry, rightEntry) < FLT_MAX)
+            stack[top++] = nearChild;
+    }
+
+    return finishHit(bvh, found, closest, hit);
+}
+
+#ifdef BVH_X86
+// The slab test of both children at once. x and y of the two boxes are
+// interleaved into one register and z into another, so each reduction serves
+// both; the fourth lane of a node holds its first or count field and is
+// masked off before any arithmetic. Returns a bit per child that the ray
+// enters before maxDistance, with the entry distances in entries.
+__attribute__((target("sse2"))) static inline int childrenEntrySSE(const BvhNode *children, __m128 origin, __m128 inverse, __m128 mask, __m128 maxDistance, float *entries)
+{
+    __m128 leftT0 = _mm_mul_ps(_mm_sub_ps(_mm_and_ps(_mm_loadu_ps(children[0].min), mask), origin), inverse);
+    __m128 leftT1 = _mm_mul_ps(_mm_sub_ps(_mm_and_ps(_mm_loadu_ps(children[0].max), mask), origin), inverse);
+    __m128 rightT0 = _mm_mul_ps(_mm_sub_ps(_mm_and_ps(_mm_loadu_ps(children[1].min), mask), origin), inverse);
+    __m128 rightT1 = _mm_mul_ps(_mm_sub_ps(_mm_and_ps(_mm_loadu_ps(children[1].max), mask), origin), inverse);
+
+    __m128 leftNears = _mm_min_ps(leftT0, leftT1), leftFars = _mm_max_ps(leftT0, leftT1);
+    __m128 rightNears = _mm_min_ps(rightT0, rightT1), rightFars = _mm_max_ps(rightT0, rightT1);
+
+    // lanes 0 and 1 end up as the left and right child
+    __m128 nearXY = _mm_unpacklo_ps(leftNears, rightNears), nearZ = _mm_unpackhi_ps(leftNears, rightNears);
+    __m128 farXY = _mm_unpacklo_ps(leftFars, rightFars), farZ = _mm_unpackhi_ps(leftFars, rightFars);
+    __m128 near = _mm_max_ps(_mm_max_ps(nearXY, _mm_movehl_ps(nearXY, nearXY)), _mm_max_ps(nearZ, _mm_setzero_ps()));
+    __m128 far = _mm_min_ps(_mm_min_ps(farXY, _mm_movehl_ps(farXY, farXY)), _mm_min_ps(farZ, maxDistance));
+
+    _mm_storel_pi((__m64 *)entries, near);
+    return _mm_movemask_ps(_mm_cmple_ps(near, far)) & 3;
+}
+
+__attribute__((target("sse2"))) static bool traverseSSE(const Bvh *bvh, vec3 origin, vec3 direction, float maxDistance, BvhHit *hit, bool any)
+{
+    if (bvh->triangleCount == 0)
+        return false;
+
+    vec3 inverse;
+    rayInverse(direction, inverse);
+
+    __m128 origins = _mm_setr_ps(origin[0], origin[1], origin[2], 0.0f);
+    __m128 inverses = _mm_setr_ps(inverse[0], inverse[1], inverse[2], 0.0f);
+    __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+
+    int found = -1;
+    float closest = maxDistance;
+
+    int stack[BVH_STACK];
+    int top = 0;
+    int current = 0;
+
+    // descends straight into the nearer child that was hit and only pushes
+    // the farther one, so a single hit child never goes through the stack
+    while (current >= 0)
+    {
+        const BvhNode *node = &bvh->nodes[current];
+        if (node->count > 0)
+        {
+            if (leafHit(bvh, node, origin, direction, &closest, &found, any))
+                return true;
+            current = top > 0 ? stack[--top] : -1;
+            continue;
+        }
+
+        float entries[2];
+        int hits = childrenEntrySSE(&bvh->nodes[node->first], origins, inverses, mask, _mm_set1_ps(closest), entries);
+        switch (hits)
+        {
+        case 0:
+            current = top > 0 ? stack[--top] : -1;
+            break;
+        case 1:
+        case 2:
+            current = node->first + (hits >> 1);
+            break;
+        default:
+        {
+            int nearSide = entries[1] < entries[0];
+            SDL_assert(top < BVH_STACK);
+            stack[top++] = node->first + 1 - nearSide;
+            current = node->first + nearSide;
+            break;
+        }
+        }
+    }
+
+    return finishHit(bvh, found, closest, hit);
+}
+#endif
+
+BvhPath Bvh_getPath()
+{
+    if (!traverseFn)
+    {
+#ifdef BVH_X86
+        if (SDL_HasSSE2())
+            Bvh_setPath(BVH_SSE);
+        else
+#endif
+            Bvh_setPath(BVH_SCALAR);
+    }
+
+    return bvhPath;
+}
+
+void Bvh_setPath(BvhPath path)
+{
+#ifdef BVH_X86
+    if (path == BVH_SSE && SDL_HasSSE2())
+    {
+        traverseFn = traverseSSE;
+        bvhPath = BVH_SSE;
+        return;
+    }
+#endif
+
+    traverseFn = traverseScalar;
+    bvhPath = BVH_SCALAR;
+}
+
+const char *Bvh_pathName(BvhPath path)
+{
+    return path == BVH_SSE ? "sse" : "scalar";
+}
+
+bool Bvh_intersect(const Bvh *bvh, vec3 origin, vec3 direction, float maxDistance, BvhHit *hit)
+{
+    Bvh_getPath();
+    return traverseFn(bvh, origin, direction, maxDistance, hit, false);
+}
+
+bool Bvh_occluded(const Bvh *bvh, vec3 origin, vec3 direction, float maxDistance)
+{
+    Bvh_getPath();
+    return traverseFn(bvh, origin, direction, maxDistance, NULL, true);
+}
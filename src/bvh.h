@@ -0,0 +1,87 @@
+#ifndef BVH_INCLUDED
+#define BVH_INCLUDED
+
+#include <stdbool.h>
+#include "cglm/cglm.h"
+
+// Bounding volume hierarchy over triangles for ray queries on the CPU:
+// picking, line of sight, baking. Triangles are copied in, three vertices
+// each, and reordered so every leaf owns a contiguous run; hits report the
+// index the triangle was given.
+//
+// Splits are chosen by the surface area heuristic over BVH_BINS bins per
+// axis, and subtrees of at least BVH_TASK_SIZE triangles build as jobs on
+// the job system. Siblings sit next to each other from an even index of a
+// 64 byte aligned array, so a node's two children share one cache line.
+// Subtrees deeper than 64 levels stop in larger leaves.
+#define BVH_BINS 16
+#define BVH_MAX_LEAF 8 // below this the heuristic decides when to stop
+#define BVH_TASK_SIZE 4096
+
+// 32 bytes; an inner node's children are first and first + 1
+typedef struct BvhNode
+{
+    vec3 min;
+    int first; // child or triangle
+    vec3 max;
+    int count; // triangles, 0 for inner nodes
+} BvhNode;
+
+typedef struct BvhHit
+{
+    float t;
+    int triangle;
+    vec3 normal; // geometric, unit length, facing whichever way the winding says
+} BvhHit;
+
+typedef struct BvhStats
+{
+    int nodes;
+    int leaves;
+    int depth;
+    double buildMs;
+    double refitMs;
+} BvhStats;
+
+typedef struct Bvh
+{
+    BvhNode *nodes; // 64 byte aligned within nodeMemory
+    void *nodeMemory;
+    int nodeCount;
+
+    vec3 *vertices; // 3 per triangle, in leaf order
+    int *triangleIds;
+    int triangleCount;
+
+    BvhStats stats;
+} Bvh;
+
+typedef enum BvhPath
+{
+    BVH_SCALAR,
+    BVH_SSE
+} BvhPath;
+
+// Scalar or SSE ray/box tests, the best the CPU has unless set. The SSE path
+// tests both children of a node at once and walks straight into the nearer
+// one; it gains while the tree sits in cache, big trees are bound by memory
+// and run about the same either way.
+BvhPath Bvh_getPath();
+void Bvh_setPath(BvhPath path);
+const char *Bvh_pathName(BvhPath path);
+
+void Bvh_build(Bvh *bvh, const vec3 *vertices, int triangleCount);
+void Bvh_free(Bvh *bvh);
+
+// Moves the triangles to vertices, given in the original order, and grows or
+// shrinks every box to fit without changing the tree. Cheap, but the tree
+// gets slower the further things move from where it was built.
+void Bvh_refit(Bvh *bvh, const vec3 *vertices);
+
+// nearest hit closer than maxDistance; direction need not be unit length, t is in its units
+bool Bvh_intersect(const Bvh *bvh, vec3 origin, vec3 direction, float maxDistance, BvhHit *hit);
+
+// any hit closer than maxDistance
+bool Bvh_occluded(const Bvh *bvh, vec3 origin, vec3 direction, float maxDistance);
+
+#endif
@@ -0,0 +1,201 @@
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "cascade.h"
+#include "glstate.h"
+
+static double elapsedMs(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+// Smallest sphere around a frustum slice, centred on the view axis. It only
+// depends on the projection, so it is worked out once.
+static void fitSlice(ShadowCascades *cascades, int cascade, float tanX, float tanY)
+{
+    float near = cascades->splits[cascade];
+    float far = cascades->splits[cascade + 1];
+    float spread = tanX * tanX + tanY * tanY;
+
+    float center = (far + near) * (1.0f + spread) * 0.5f;
+    float radius;
+    if (center > far)
+    {
+        center = far;
+        radius = far * sqrtf(spread);
+    }
+    else
+        radius = sqrtf(far * far * spread + (far - center) * (far - center));
+
+    glm_vec3_copy((vec3){0.0f, 0.0f, -center}, cascades->centers[cascade]);
+    cascades->radii[cascade] = radius;
+}
+
+void Cascade_init(ShadowCascades *cascades, int size, float fovy, float aspect, float near, float far, float lambda)
+{
+    SDL_memset(cascades, 0, sizeof(ShadowCascades));
+    cascades->size = size;
+    cascades->casterDistance = far;
+
+    // practical split scheme: blend of logarithmic and uniform
+    for (int i = 0; i <= SHADOW_CASCADES; i++)
+    {
+        float t = (float)i / SHADOW_CASCADES;
+        float logarithmic = near * powf(far / near, t);
+        float uniform = near + (far - near) * t;
+        cascades->splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+    }
+
+    float tanY = tanf(fovy * 0.5f);
+    for (int i = 0; i < SHADOW_CASCADES; i++)
+    {
+        fitSlice(cascades, i, tanY * aspect, tanY);
+
+        // 1, 2, 4, 4... with the phases spread so two cascades render per frame
+        cascades->intervals[i] = i == 0 ? 1 : (i == 1 ? 2 : 4);
+        cascades->phases[i] = i < 2 ? i : ((i - 2) * 2) % 4;
+        cascades->stats[i].age = -1;
+    }
+
+    glGenTextures(1, &cascades->texture);
+    GLState_bindTexture(0, GL_TEXTURE_2D_ARRAY, cascades->texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, size, size, SHADOW_CASCADES, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+    // hardware depth comparison with bilinear filtering, nothing is shadowed outside the map
+    float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    GLState_bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &cascades->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, cascades->framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades->texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        SDL_Log("Cascades: framebuffer incomplete (0x%x)", status);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GpuTimer_init(&cascades->timer);
+}
+
+void Cascade_free(ShadowCascades *cascades)
+{
+    GpuTimer_free(&cascades->timer);
+    glDeleteFramebuffers(1, &cascades->framebuffer);
+    glDeleteTextures(1, &cascades->texture);
+    GLState_invalidate();
+}
+
+int Cascade_update(ShadowCascades *cascades, mat4 view, vec3 lightDirection)
+{
+    GpuTimer_beginFrame(&cascades->timer);
+    cascades->frame++;
+
+    mat4 inverseView;
+    glm_mat4_inv(view, inverseView);
+
+    // a fixed orientation, so snapping in this space is snapping to the map's texels
+    vec3 direction;
+    glm_vec3_normalize_to(lightDirection, direction);
+    vec3 up = {0.0f, 1.0f, 0.0f};
+    if (fabsf(direction[1]) > 0.99f)
+        glm_vec3_copy((vec3){1.0f, 0.0f, 0.0f}, up);
+
+    mat4 lightRotation;
+    glm_look((vec3){0.0f, 0.0f, 0.0f}, direction, up, lightRotation);
+
+    int dueCount = 0;
+    for (int c = 0; c < SHADOW_CASCADES; c++)
+    {
+        CascadeStats *stats = &cascades->stats[c];
+        stats->gpuMs = GpuTimer_ms(&cascades->timer, c * 2, c * 2 + 1);
+
+        cascades->due[c] = stats->age < 0 || cascades->frame % cascades->intervals[c] == cascades->phases[c];
+        if (stats->age >= 0)
+            stats->age++;
+
+        if (!cascades->due[c])
+            continue;
+
+        dueCount++;
+
+        vec3 center;
+        glm_mat4_mulv3(inverseView, cascades->centers[c], 1.0f, center);
+        glm_mat4_mulv3(lightRotation, center, 1.0f, center);
+
+        float radius = cascades->radii[c];
+        float texel = 2.0f * radius / cascades->size;
+        center[0] = floorf(center[0] / texel) * texel;
+        center[1] = floorf(center[1] / texel) * texel;
+
+        // light space looks down -z; the box reaches back towards the light for casters
+        mat4 projection;
+        glm_ortho(center[0] - radius, center[0] + radius, center[1] - radius, center[1] + radius,
+                  -(center[2] + radius + cascades->casterDistance), -(center[2] - radius), projection);
+
+        glm_mat4_mul(projection, lightRotation, cascades->viewProjections[c]);
+        Frustum_extract(&cascades->frustums[c], cascades->viewProjections[c]);
+    }
+
+    return dueCount;
+}
+
+void Cascade_begin(ShadowCascades *cascades, int cascade)
+{
+    cascades->renderStart = SDL_GetPerformanceCounter();
+    GpuTimer_mark(&cascades->timer, cascade * 2);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, cascades->framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades->texture, 0, cascade);
+    glViewport(0, 0, cascades->size, cascades->size);
+
+    GLState_depthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // slope scaled bias against acne, the shader only adds a small constant
+    GLState_enable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+}
+
+void Cascade_end(ShadowCascades *cascades, int cascade, int draws, int tested)
+{
+    GpuTimer_mark(&cascades->timer, cascade * 2 + 1);
+
+    CascadeStats *stats = &cascades->stats[cascade];
+    stats->draws = draws;
+    stats->tested = tested;
+    stats->age = 0;
+    stats->cpuMs = elapsedMs(cascades->renderStart);
+}
+
+void Cascade_finish(ShadowCascades *cascades, int width, int height)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    GLState_disable(GL_POLYGON_OFFSET_FILL);
+}
+
+void Cascade_bind(ShadowCascades *cascades, GLuint program, int unit)
+{
+    if (cascades->program != program)
+    {
+        cascades->program = program;
+        cascades->locations[0] = glGetUniformLocation(program, "shadowMap");
+        cascades->locations[1] = glGetUniformLocation(program, "cascadeMatrices");
+        cascades->locations[2] = glGetUniformLocation(program, "cascadeSplits");
+    }
+
+    GLState_bindTexture(unit, GL_TEXTURE_2D_ARRAY, cascades->texture);
+    glUniform1i(cascades->locations[0], unit);
+    glUniformMatrix4fv(cascades->locations[1], SHADOW_CASCADES, GL_FALSE, (float *)cascades->viewProjections);
+    glUniform1fv(cascades->locations[2], SHADOW_CASCADES, &cascades->splits[1]);
+}
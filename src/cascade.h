@@ -0,0 +1,84 @@
+#ifndef CASCADE_INCLUDED
+#define CASCADE_INCLUDED
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "cglm/cglm.h"
+
+#include "frustum.h"
+#include "gputimer.h"
+
+// Cascaded shadow maps for a directional light. The camera frustum is split
+// into SHADOW_CASCADES depth ranges, blending logarithmic and uniform splits
+// by lambda, and each range gets its own layer of a depth texture array.
+//
+// A cascade is fitted with a bounding sphere of its frustum slice, so its
+// size never changes as the camera turns, and its centre is snapped to whole
+// shadow texels in light space, so shadow edges do not crawl as it moves.
+//
+// Far cascades are re-rendered less often: cascade 0 every frame, cascade 1
+// every other frame and the rest every fourth, interleaved so two cascades
+// render per frame. A cascade keeps the matrix it was last rendered with, so
+// its shadows lag behind moving casters but always line up with the map.
+#define SHADOW_CASCADES 4
+
+typedef struct CascadeStats
+{
+    int draws;     // casters drawn the last time it was rendered
+    int tested;    // culling tests that took
+    int age;       // frames since it was rendered
+    double cpuMs;  // culling and submission
+    double gpuMs;
+} CascadeStats;
+
+typedef struct ShadowCascades
+{
+    GLuint texture; // GL_TEXTURE_2D_ARRAY, one layer per cascade
+    GLuint framebuffer;
+    int size;
+
+    float splits[SHADOW_CASCADES + 1]; // view depths bounding each cascade
+    float radii[SHADOW_CASCADES];
+    vec3 centers[SHADOW_CASCADES];     // of each slice, in view space
+    float casterDistance;              // casters this far towards the light still cast
+
+    int intervals[SHADOW_CASCADES];
+    int phases[SHADOW_CASCADES];
+    int frame;
+    bool due[SHADOW_CASCADES];
+
+    mat4 viewProjections[SHADOW_CASCADES]; // world to light clip space
+    Frustum frustums[SHADOW_CASCADES];     // for culling casters
+
+    Uint64 renderStart;
+    GpuTimer timer;
+    CascadeStats stats[SHADOW_CASCADES];
+
+    GLuint program; // the uniform locations below belong to it
+    GLint locations[3];
+} ShadowCascades;
+
+// Splits follow a glm_perspective(fovy, aspect, near, far) projection;
+// lambda 0 is uniform, 1 logarithmic.
+void Cascade_init(ShadowCascades *cascades, int size, float fovy, float aspect, float near, float far, float lambda);
+void Cascade_free(ShadowCascades *cascades);
+
+// Decides which cascades render this frame and fits them to the camera.
+// Returns how many are due.
+int Cascade_update(ShadowCascades *cascades, mat4 view, vec3 lightDirection);
+
+// Draw the casters of a due cascade between begin and end, through a program
+// that transforms by viewProjections[cascade]; draws is what got drawn.
+void Cascade_begin(ShadowCascades *cascades, int cascade);
+void Cascade_end(ShadowCascades *cascades, int cascade, int draws, int tested);
+
+// back to the default framebuffer and the given viewport
+void Cascade_finish(ShadowCascades *cascades, int width, int height);
+
+// Binds the map to unit and sets shadowMap (sampler2DArrayShadow),
+// cascadeMatrices[SHADOW_CASCADES] and cascadeSplits (far depth of each) on
+// the bound program.
+void Cascade_bind(ShadowCascades *cascades, GLuint program, int unit);
+
+#endif
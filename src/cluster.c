@@ -0,0 +1,313 @@
+#include <float.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "cluster.h"
+#include "glstate.h"
+#include "job.h"
+
+#define TEXELS_PER_LIGHT 3
+
+static double elapsedMs(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static float sliceDepth(const Clusters *clusters, int slice)
+{
+    return clusters->near * powf(clusters->far / clusters->near, (float)slice / CLUSTER_Z);
+}
+
+static int sliceOf(const Clusters *clusters, float depth)
+{
+    int slice = (int)floorf(logf(depth) * clusters->sliceScale + clusters->sliceBias);
+    return SDL_clamp(slice, 0, CLUSTER_Z - 1);
+}
+
+// the box spanned by a tile's corners on the slice's near and far planes
+static void buildBounds(Clusters *clusters, float fovy, float aspect)
+{
+    float tanY = tanf(fovy * 0.5f);
+    float tanX = tanY * aspect;
+
+    for (int z = 0; z < CLUSTER_Z; z++)
+    {
+        float depths[2] = {sliceDepth(clusters, z), sliceDepth(clusters, z + 1)};
+
+        for (int y = 0; y < CLUSTER_Y; y++)
+        {
+            glm_vec3_fill(clusters->rowMins[z][y], FLT_MAX);
+            glm_vec3_fill(clusters->rowMaxs[z][y], -FLT_MAX);
+
+            for (int x = 0; x < CLUSTER_X; x++)
+            {
+                int c = (z * CLUSTER_Y + y) * CLUSTER_X + x;
+                float *min = clusters->mins[c];
+                float *max = clusters->maxs[c];
+                glm_vec3_fill(min, FLT_MAX);
+                glm_vec3_fill(max, -FLT_MAX);
+
+                for (int corner = 0; corner < 8; corner++)
+                {
+                    float ndcX = -1.0f + 2.0f * (float)(x + (corner & 1)) / CLUSTER_X;
+                    float ndcY = -1.0f + 2.0f * (float)(y + ((corner >> 1) & 1)) / CLUSTER_Y;
+                    float depth = depths[corner >> 2];
+
+                    vec3 point = {ndcX * depth * tanX, ndcY * depth * tanY, -depth};
+                    glm_vec3_minv(min, point, min);
+                    glm_vec3_maxv(max, point, max);
+                }
+
+                glm_vec3_minv(clusters->rowMins[z][y], min, clusters->rowMins[z][y]);
+                glm_vec3_maxv(clusters->rowMaxs[z][y], max, clusters->rowMaxs[z][y]);
+            }
+        }
+    }
+}
+
+void Cluster_init(Clusters *clusters, int lightCapacity, float fovy, float aspect, float near, float far)
+{
+    SDL_memset(clusters, 0, sizeof(Clusters));
+
+    clusters->near = near;
+    clusters->far = far;
+    clusters->sliceScale = CLUSTER_Z / logf(far / near);
+    clusters->sliceBias = -CLUSTER_Z * logf(near) / logf(far / near);
+
+    clusters->mins = SDL_malloc(CLUSTER_COUNT * sizeof(vec3));
+    clusters->maxs = SDL_malloc(CLUSTER_COUNT * sizeof(vec3));
+    buildBounds(clusters, fovy, aspect);
+
+    clusters->lightCapacity = lightCapacity;
+    clusters->lights = SDL_malloc(lightCapacity * sizeof(ClusterLight));
+    clusters->viewSpheres = SDL_malloc(lightCapacity * sizeof(vec4));
+    clusters->firstSlice = SDL_malloc(lightCapacity * sizeof(int));
+    clusters->lastSlice = SDL_malloc(lightCapacity * sizeof(int));
+    clusters->lightTexels = SDL_malloc(lightCapacity * TEXELS_PER_LIGHT * sizeof(vec4));
+
+    clusters->counts = SDL_malloc(CLUSTER_COUNT * sizeof(int));
+    clusters->scratch = SDL_malloc(CLUSTER_COUNT * CLUSTER_MAX_LIGHTS * sizeof(unsigned int));
+    clusters->records = SDL_malloc(CLUSTER_COUNT * 2 * sizeof(unsigned int));
+    clusters->indices = SDL_malloc(CLUSTER_COUNT * CLUSTER_MAX_LIGHTS * sizeof(unsigned int));
+
+    GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+    glGenBuffers(3, clusters->buffers);
+    glGenTextures(3, clusters->textures);
+
+    for (int i = 0; i < 3; i++)
+    {
+        // a buffer texture needs storage behind it even before the first update
+        GLState_bindBuffer(GL_TEXTURE_BUFFER, clusters->buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 4 * sizeof(float), NULL, GL_STREAM_DRAW);
+
+        GLState_bindTexture(0, GL_TEXTURE_BUFFER, clusters->textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], clusters->buffers[i]);
+    }
+
+    GLState_bindTexture(0, GL_TEXTURE_BUFFER, 0);
+}
+
+void Cluster_free(Clusters *clusters)
+{
+    // deleting bound objects unbinds them behind the cache's back
+    glDeleteTextures(3, clusters->textures);
+    glDeleteBuffers(3, clusters->buffers);
+    GLState_invalidate();
+
+    SDL_free(clusters->mins);
+    SDL_free(clusters->maxs);
+    SDL_free(clusters->lights);
+    SDL_free(clusters->viewSpheres);
+    SDL_free(clusters->firstSlice);
+    SDL_free(clusters->lastSlice);
+    SDL_free(clusters->lightTexels);
+    SDL_free(clusters->counts);
+    SDL_free(clusters->scratch);
+    SDL_free(clusters->records);
+    SDL_free(clusters->indices);
+}
+
+int Cluster_addLight(Clusters *clusters, const ClusterLight *light)
+{
+    if (clusters->lightCount == clusters->lightCapacity)
+    {
+        SDL_Log("Clusters full (capacity %d lights)", clusters->lightCapacity);
+        return -1;
+    }
+
+    clusters->lights[clusters->lightCount] = *light;
+    return clusters->lightCount++;
+}
+
+float Cluster_lightRadius(const ClusterLight *light)
+{
+    float brightest = glm_max(light->color[0], glm_max(light->color[1], light->color[2]));
+
+    // solve constant + linear * d + quadratic * d^2 = brightest * 256 / 5
+    // a light too dim to ever reach that has no real root and gets radius 0
+    float target = light->constant - brightest * 256.0f / 5.0f;
+    if (light->quadratic > 0.0f)
+    {
+        float discriminant = glm_max(light->linear * light->linear - 4.0f * light->quadratic * target, 0.0f);
+        return glm_max((-light->linear + sqrtf(discriminant)) / (2.0f * light->quadratic), 0.0f);
+    }
+
+    if (light->linear > 0.0f)
+        return glm_max(-target / light->linear, 0.0f);
+
+    return FLT_MAX;
+}
+
+static bool sphereTouchesBox(const float *sphere, const float *min, const float *max)
+{
+    float distance = 0.0f;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float outside = glm_max(min[axis] - sphere[axis], 0.0f) + glm_max(sphere[axis] - max[axis], 0.0f);
+        distance += outside * outside;
+    }
+
+    return distance <= sphere[3] * sphere[3];
+}
+
+// every cluster belongs to exactly one slice, so slices can be filled in parallel
+static void assignSlices(void *data, int start, int end)
+{
+    Clusters *clusters = data;
+
+    for (int z = start; z < end; z++)
+    {
+        int first = z * CLUSTER_X * CLUSTER_Y;
+        SDL_memset(&clusters->counts[first], 0, CLUSTER_X * CLUSTER_Y * sizeof(int));
+        clusters->sliceOverflows[z] = 0;
+
+        for (int l = 0; l < clusters->lightCount; l++)
+        {
+            if (z < clusters->firstSlice[l] || z > clusters->lastSlice[l])
+                continue;
+
+            const float *sphere = clusters->viewSpheres[l];
+            for (int y = 0; y < CLUSTER_Y; y++)
+            {
+                if (!sphereTouchesBox(sphere, clusters->rowMins[z][y], clusters->rowMaxs[z][y]))
+                    continue;
+
+                for (int x = 0; x < CLUSTER_X; x++)
+                {
+                    int c = first + y * CLUSTER_X + x;
+                    if (!sphereTouchesBox(sphere, clusters->mins[c], clusters->maxs[c]))
+                        continue;
+
+                    if (clusters->counts[c] == CLUSTER_MAX_LIGHTS)
+                    {
+                        clusters->sliceOverflows[z]++;
+                        continue;
+                    }
+
+                    clusters->scratch[c * CLUSTER_MAX_LIGHTS + clusters->counts[c]++] = l;
+                }
+            }
+        }
+    }
+}
+
+void Cluster_update(Clusters *clusters, mat4 view)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    clusters->stats.lights = clusters->lightCount;
+    clusters->stats.visible = 0;
+
+    for (int l = 0; l < clusters->lightCount; l++)
+    {
+        const ClusterLight *light = &clusters->lights[l];
+        float radius = glm_min(Cluster_lightRadius(light), clusters->far);
+
+        float *sphere = clusters->viewSpheres[l];
+        glm_mat4_mulv3(view, (float *)light->position, 1.0f, sphere);
+        sphere[3] = radius;
+
+        float depth = -sphere[2];
+        if (depth + radius < clusters->near || depth - radius > clusters->far)
+        {
+            clusters->firstSlice[l] = 1;
+            clusters->lastSlice[l] = 0;
+        }
+        else
+        {
+            clusters->firstSlice[l] = sliceOf(clusters, glm_max(depth - radius, clusters->near));
+            clusters->lastSlice[l] = sliceOf(clusters, glm_min(depth + radius, clusters->far));
+            clusters->stats.visible++;
+        }
+
+        float *texels = &clusters->lightTexels[l * TEXELS_PER_LIGHT * 4];
+        glm_vec3_copy((float *)light->position, texels);
+        texels[3] = radius;
+        glm_vec3_copy((float *)light->color, texels + 4);
+        texels[7] = light->constant;
+        texels[8] = light->linear;
+        texels[9] = light->quadratic;
+        texels[10] = (float)light->shadowSlot;
+        texels[11] = 0.0f;
+    }
+
+    Job_parallelFor(CLUSTER_Z, 1, assignSlices, clusters);
+
+    // compact the fixed size slots into one list
+    int offset = 0;
+    clusters->stats.maxPerCluster = 0;
+    for (int c = 0; c < CLUSTER_COUNT; c++)
+    {
+        int count = clusters->counts[c];
+        clusters->records[c * 2] = offset;
+        clusters->records[c * 2 + 1] = count;
+
+        SDL_memcpy(&clusters->indices[offset], &clusters->scratch[c * CLUSTER_MAX_LIGHTS], count * sizeof(unsigned int));
+        offset += count;
+        clusters->stats.maxPerCluster = SDL_max(clusters->stats.maxPerCluster, count);
+    }
+
+    clusters->stats.indices = offset;
+    clusters->stats.overflows = 0;
+    for (int z = 0; z < CLUSTER_Z; z++)
+        clusters->stats.overflows += clusters->sliceOverflows[z];
+
+    // glBufferData hands back fresh storage, so last frame's draws are never waited on
+    const void *sources[3] = {clusters->lightTexels, clusters->records, clusters->indices};
+    size_t sizes[3] = {
+        (size_t)SDL_max(clusters->lightCount, 1) * TEXELS_PER_LIGHT * sizeof(vec4),
+        CLUSTER_COUNT * 2 * sizeof(unsigned int),
+        (size_t)SDL_max(offset, 1) * sizeof(unsigned int)};
+
+    for (int i = 0; i < 3; i++)
+    {
+        GLState_bindBuffer(GL_TEXTURE_BUFFER, clusters->buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, sizes[i], sources[i], GL_STREAM_DRAW);
+    }
+
+    clusters->stats.assignMs = elapsedMs(start);
+}
+
+void Cluster_bind(Clusters *clusters, GLuint program, int width, int height, int firstUnit)
+{
+    static const char *names[6] = {
+        "clusterLights", "clusterRecords", "clusterIndices",
+        "clusterTileSize", "clusterSlice", "clusterDepth"};
+
+    if (clusters->program != program)
+    {
+        clusters->program = program;
+        for (int i = 0; i < 6; i++)
+            clusters->locations[i] = glGetUniformLocation(program, names[i]);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        GLState_bindTexture(firstUnit + i, GL_TEXTURE_BUFFER, clusters->textures[i]);
+        glUniform1i(clusters->locations[i], firstUnit + i);
+    }
+
+    glUniform2f(clusters->locations[3], (float)width / CLUSTER_X, (float)height / CLUSTER_Y);
+    glUniform2f(clusters->locations[4], clusters->sliceScale, clusters->sliceBias);
+    glUniform2f(clusters->locations[5], clusters->near, clusters->far);
+}
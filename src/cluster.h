@@ -0,0 +1,101 @@
+#ifndef CLUSTER_INCLUDED
+#define CLUSTER_INCLUDED
+
+#include <GL/glew.h>
+#include "cglm/cglm.h"
+
+// Clustered forward lighting. The view frustum is cut into a grid of
+// CLUSTER_X by CLUSTER_Y screen tiles and CLUSTER_Z depth slices, spaced
+// exponentially so clusters stay roughly cube shaped. Every frame the point
+// lights are assigned to the clusters their range overlaps, one job per
+// depth slice, and the result is compacted into three texture buffers:
+//
+//   clusterLights   RGBA32F, 3 texels per light: position and radius,
+//                   color and constant, linear, quadratic and shadow slot
+//   clusterRecords  RG32UI, per cluster: first index and light count
+//   clusterIndices  R32UI, the light indices of every cluster back to back
+//
+// A fragment shader finds its cluster from gl_FragCoord and loops over that
+// cluster's lights only; see Cluster_bind for the uniforms it expects.
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define CLUSTER_MAX_LIGHTS 256 // per cluster, the rest are dropped
+
+typedef struct ClusterLight
+{
+    vec3 position; // world space
+    vec3 color;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    int shadowSlot; // slot + 1 of its shadow in a PointShadows atlas, 0 for none
+} ClusterLight;
+
+typedef struct ClusterStats
+{
+    int lights;
+    int visible;       // lights touching at least one slice
+    int indices;       // light/cluster pairs
+    int maxPerCluster;
+    int overflows;     // pairs dropped by full clusters
+    double assignMs;   // assignment, compaction and upload
+} ClusterStats;
+
+typedef struct Clusters
+{
+    float near, far;
+    float sliceScale, sliceBias; // slice = log(depth) * scale + bias
+
+    // view space bounds of every cluster and of every row of a slice
+    vec3 *mins, *maxs;
+    vec3 rowMins[CLUSTER_Z][CLUSTER_Y], rowMaxs[CLUSTER_Z][CLUSTER_Y];
+
+    int lightCapacity;
+    int lightCount;
+    ClusterLight *lights;
+
+    // per frame: view space sphere, slice range and the GPU copy of each light
+    vec4 *viewSpheres;
+    int *firstSlice, *lastSlice;
+    float *lightTexels;
+
+    int *counts;              // per cluster
+    unsigned int *scratch;    // CLUSTER_MAX_LIGHTS slots per cluster
+    unsigned int *records;
+    unsigned int *indices;
+    int sliceOverflows[CLUSTER_Z];
+
+    GLuint buffers[3];
+    GLuint textures[3];
+
+    GLuint program; // the uniform locations below belong to it
+    GLint locations[6];
+
+    ClusterStats stats;
+} Clusters;
+
+// the grid follows a glm_perspective(fovy, aspect, near, far) projection
+void Cluster_init(Clusters *clusters, int lightCapacity, float fovy, float aspect, float near, float far);
+void Cluster_free(Clusters *clusters);
+
+// Returns the light's index, or -1 when full. Lights can be edited through
+// clusters->lights between frames.
+int Cluster_addLight(Clusters *clusters, const ClusterLight *light);
+
+// distance at which the light drops below 5/256 of its brightness
+float Cluster_lightRadius(const ClusterLight *light);
+
+// assigns the lights to clusters and uploads the texture buffers
+void Cluster_update(Clusters *clusters, mat4 view);
+
+// Binds the texture buffers to units firstUnit..firstUnit + 2 and sets the
+// samplers clusterLights, clusterRecords and clusterIndices plus
+// clusterTileSize, clusterSlice (scale, bias) and clusterDepth (near, far)
+// on the bound program.
+void Cluster_bind(Clusters *clusters, GLuint program, int width, int height, int firstUnit);
+
+#endif
@@ -0,0 +1,467 @@
+#include <SDL2/SDL.h>
+
+#include "cpuparticles.h"
+#include "glstate.h"
+#include "job.h"
+#include "shader.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_PARTICLES_X86
+#endif
+
+enum
+{
+    DRAW_VIEW,
+    DRAW_PROJECTION,
+    DRAW_POINT_SCALE,
+    DRAW_COLOR,
+    DRAW_SIZE
+};
+
+typedef struct PackRange
+{
+    CpuParticles *particles;
+    float *destination;
+} PackRange;
+
+// updates [start, end), writes the indices that died to dead and returns how many
+typedef int (*UpdateFn)(CpuParticles *particles, int start, int end, int *dead);
+
+// writes [start, end) as 4 floats each, at destination + 4 * start
+typedef void (*PackFn)(const CpuParticles *particles, int start, int end, float *destination);
+
+static UpdateFn updateFn = NULL;
+static PackFn packFn = NULL;
+static CpuParticlePath updatePath = CPU_PARTICLES_SCALAR;
+
+static float randomUnit(Uint32 *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) / 16777216.0f;
+}
+
+void CpuParticles_init(CpuParticles *particles, int capacity)
+{
+    SDL_zerop(particles);
+
+    // whole chunks, so the vector loops never read past the arrays
+    capacity = (capacity + CPU_PARTICLE_CHUNK - 1) / CPU_PARTICLE_CHUNK * CPU_PARTICLE_CHUNK;
+    particles->capacity = capacity;
+
+    float **arrays[] = {
+        &particles->positionX, &particles->positionY, &particles->positionZ,
+        &particles->velocityX, &particles->velocityY, &particles->velocityZ,
+        &particles->age, &particles->lifetime};
+
+    for (int i = 0; i < 8; i++)
+        *arrays[i] = SDL_SIMDAlloc(capacity * sizeof(float));
+
+    particles->deadIndices = SDL_malloc(capacity * sizeof(int));
+    particles->deadCounts = SDL_calloc(capacity / CPU_PARTICLE_CHUNK, sizeof(int));
+
+    glm_vec3_copy((vec3){0.0f, -9.81f, 0.0f}, particles->gravity);
+    glm_vec4_copy((vec4){0.0f, 1.0f, 0.0f, 1e6f}, particles->plane);
+    particles->restitution = 0.4f;
+    particles->seed = 12345;
+
+    glm_vec4_one(particles->color);
+    particles->size = 0.1f;
+}
+
+void CpuParticles_initDrawing(CpuParticles *particles)
+{
+    RingBuffer_init(&particles->ring, GL_ARRAY_BUFFER, (size_t)particles->capacity * 4 * sizeof(float));
+
+    particles->program = CreateProgram("./shaders/cpuparticles.vert", "./shaders/particles.frag");
+    const char *names[] = {"view", "projection", "pointScale", "color", "size"};
+    for (int i = 0; i < 5; i++)
+        particles->locations[i] = glGetUniformLocation(particles->program, names[i]);
+
+    // the attribute pointer moves with the ring every frame, so it is set at draw time
+    glGenVertexArrays(1, &particles->vao);
+    GLState_bindVertexArray(particles->vao);
+    glEnableVertexAttribArray(0);
+    GLState_bindVertexArray(0);
+}
+
+void CpuParticles_free(CpuParticles *particles)
+{
+    if (particles->program)
+    {
+        RingBuffer_free(&particles->ring);
+        glDeleteVertexArrays(1, &particles->vao);
+        glDeleteProgram(particles->program);
+        GLState_invalidate();
+    }
+
+    SDL_SIMDFree(particles->positionX);
+    SDL_SIMDFree(particles->positionY);
+    SDL_SIMDFree(particles->positionZ);
+    SDL_SIMDFree(particles->velocityX);
+    SDL_SIMDFree(particles->velocityY);
+    SDL_SIMDFree(particles->velocityZ);
+    SDL_SIMDFree(particles->age);
+    SDL_SIMDFree(particles->lifetime);
+    SDL_free(particles->deadIndices);
+    SDL_free(particles->deadCounts);
+
+    SDL_zerop(particles);
+}
+
+int CpuParticles_emit(CpuParticles *particles, int count, vec3 position, vec3 velocity, float spread, float lifetime)
+{
+    count = SDL_min(count, particles->capacity - particles->count);
+    for (int n = 0; n < count; n++)
+    {
+        float z = randomUnit(&particles->seed) * 2.0f - 1.0f;
+        float angle = randomUnit(&particles->seed) * 2.0f * GLM_PIf;
+        float radius = sqrtf(1.0f - z * z);
+        float speed = spread * randomUnit(&particles->seed);
+
+        int i = particles->count++;
+        particles->positionX[i] = position[0];
+        particles->positionY[i] = position[1];
+        particles->positionZ[i] = position[2];
+        particles->velocityX[i] = velocity[0] + radius * cosf(angle) * speed;
+        particles->velocityY[i] = velocity[1] + radius * sinf(angle) * speed;
+        particles->velocityZ[i] = velocity[2] + z * speed;
+        particles->age[i] = 0.0f;
+        particles->lifetime[i] = lifetime * (0.75f + 0.5f * randomUnit(&particles->seed));
+    }
+
+    particles->emitted += count;
+    return count;
+}
+
+static int updateScalar(CpuParticles *particles, int start, int end, int *dead)
+{
+    float dt = particles->deltaTime;
+    const float *gravity = particles->gravity;
+    const float *plane = particles->plane;
+    float bounce = 1.0f + particles->restitution;
+
+    int deadCount = 0;
+    for (int i = start; i < end; i++)
+    {
+        float vx = particles->velocityX[i] + gravity[0] * dt;
+        float vy = particles->velocityY[i] + gravity[1] * dt;
+        float vz = particles->velocityZ[i] + gravity[2] * dt;
+        float px = particles->positionX[i] + vx * dt;
+        float py = particles->positionY[i] + vy * dt;
+        float pz = particles->positionZ[i] + vz * dt;
+
+        float distance = plane[0] * px + plane[1] * py + plane[2] * pz + plane[3];
+        float approach = plane[0] * vx + plane[1] * vy + plane[2] * vz;
+        if (distance < 0.0f && approach < 0.0f)
+        {
+            px -= plane[0] * distance;
+            py -= plane[1] * distance;
+            pz -= plane[2] * distance;
+            vx -= plane[0] * (approach * bounce);
+            vy -= plane[1] * (approach * bounce);
+            vz -= plane[2] * (approach * bounce);
+        }
+
+        particles->positionX[i] = px;
+        particles->positionY[i] = py;
+        particles->positionZ[i] = pz;
+        particles->velocityX[i] = vx;
+        particles->velocityY[i] = vy;
+        particles->velocityZ[i] = vz;
+
+        float age = particles->age[i] + dt;
+        particles->age[i] = age;
+        if (age >= particles->lifetime[i])
+            dead[deadCount++] = i;
+    }
+
+    return deadCount;
+}
+
+static void packScalar(const CpuParticles *particles, int start, int end, float *destination)
+{
+    float *out = destination + (size_t)start * 4;
+    for (int i = start; i < end; i++)
+    {
+        out[0] = particles->positionX[i];
+        out[1] = particles->positionY[i];
+        out[2] = particles->positionZ[i];
+        out[3] = 1.0f - particles->age[i] / particles->lifetime[i];
+        out += 4;
+    }
+}
+
+#ifdef CPU_PARTICLES_X86
+// the same arithmetic as updateScalar, a bounce applied through a mask
+__attribute__((target("avx"))) static int updateAVX(CpuParticles *particles, int start, int end, int *dead)
+{
+    __m256 dt = _mm256_set1_ps(particles->deltaTime);
+    __m256 gx = _mm256_set1_ps(particles->gravity[0]);
+    __m256 gy = _mm256_set1_ps(particles->gravity[1]);
+    __m256 gz = _mm256_set1_ps(particles->gravity[2]);
+    __m256 nx = _mm256_set1_ps(particles->plane[0]);
+    __m256 ny = _mm256_set1_ps(particles->plane[1]);
+    __m256 nz = _mm256_set1_ps(particles->plane[2]);
+    __m256 offset = _mm256_set1_ps(particles->plane[3]);
+    __m256 bounce = _mm256_set1_ps(1.0f + particles->restitution);
+    __m256 zero = _mm256_setzero_ps();
+
+    int vectorEnd = start + ((end - start) & ~7);
+    int deadCount = 0;
+    for (int i = start; i < vectorEnd; i += 8)
+    {
+        __m256 vx = _mm256_add_ps(_mm256_load_ps(particles->velocityX + i), _mm256_mul_ps(gx, dt));
+        __m256 vy = _mm256_add_ps(_mm256_load_ps(particles->velocityY + i), _mm256_mul_ps(gy, dt));
+        __m256 vz = _mm256_add_ps(_mm256_load_ps(particles->velocityZ + i), _mm256_mul_ps(gz, dt));
+        __m256 px = _mm256_add_ps(_mm256_load_ps(particles->positionX + i), _mm256_mul_ps(vx, dt));
+        __m256 py = _mm256_add_ps(_mm256_load_ps(particles->positionY + i), _mm256_mul_ps(vy, dt));
+        __m256 pz = _mm256_add_ps(_mm256_load_ps(particles->positionZ + i), _mm256_mul_ps(vz, dt));
+
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, px), _mm256_mul_ps(ny, py)), _mm256_mul_ps(nz, pz)), offset);
+        __m256 approach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, vx), _mm256_mul_ps(ny, vy)), _mm256_mul_ps(nz, vz));
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(distance, zero, _CMP_LT_OQ), _mm256_cmp_ps(approach, zero, _CMP_LT_OQ));
+
+        if (_mm256_movemask_ps(hit))
+        {
+            __m256 push = _mm256_and_ps(distance, hit);
+            __m256 kick = _mm256_and_ps(_mm256_mul_ps(approach, bounce), hit);
+            px = _mm256_sub_ps(px, _mm256_mul_ps(nx, push));
+            py = _mm256_sub_ps(py, _mm256_mul_ps(ny, push));
+            pz = _mm256_sub_ps(pz, _mm256_mul_ps(nz, push));
+            vx = _mm256_sub_ps(vx, _mm256_mul_ps(nx, kick));
+            vy = _mm256_sub_ps(vy, _mm256_mul_ps(ny, kick));
+            vz = _mm256_sub_ps(vz, _mm256_mul_ps(nz, kick));
+        }
+
+        _mm256_store_ps(particles->positionX + i, px);
+        _mm256_store_ps(particles->positionY + i, py);
+        _mm256_store_ps(particles->positionZ + i, pz);
+        _mm256_store_ps(particles->velocityX + i, vx);
+        _mm256_store_ps(particles->velocityY + i, vy);
+        _mm256_store_ps(particles->velocityZ + i, vz);
+
+        __m256 age = _mm256_add_ps(_mm256_load_ps(particles->age + i), dt);
+        _mm256_store_ps(particles->age + i, age);
+
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(age, _mm256_load_ps(particles->lifetime + i), _CMP_GE_OQ));
+        while (mask)
+        {
+            dead[deadCount++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return deadCount + updateScalar(particles, vectorEnd, end, dead + deadCount);
+}
+
+// transposes 8 particles at a time from the four arrays into xyzw order
+__attribute__((target("avx"))) static void packAVX(const CpuParticles *particles, int start, int end, float *destination)
+{
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    int vectorEnd = start + ((end - start) & ~7);
+    for (int i = start; i < vectorEnd; i += 8)
+    {
+        __m256 x = _mm256_load_ps(particles->positionX + i);
+        __m256 y = _mm256_load_ps(particles->positionY + i);
+        __m256 z = _mm256_load_ps(particles->positionZ + i);
+        __m256 w = _mm256_sub_ps(one, _mm256_div_ps(_mm256_load_ps(particles->age + i), _mm256_load_ps(particles->lifetime + i)));
+
+        // each 128-bit half transposes on its own: particles 0-3 low, 4-7 high
+        __m256 xy0 = _mm256_unpacklo_ps(x, y);
+        __m256 xy1 = _mm256_unpackhi_ps(x, y);
+        __m256 zw0 = _mm256_unpacklo_ps(z, w);
+        __m256 zw1 = _mm256_unpackhi_ps(z, w);
+        __m256 p04 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 p15 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 p26 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 p37 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+
+        float *out = destination + (size_t)i * 4;
+        _mm256_storeu_ps(out, _mm256_permute2f128_ps(p04, p15, 0x20));
+        _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(p26, p37, 0x20));
+        _mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(p04, p15, 0x31));
+        _mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(p26, p37, 0x31));
+    }
+
+    packScalar(particles, vectorEnd, end, destination);
+}
+#endif
+
+CpuParticlePath CpuParticles_getPath()
+{
+    if (!updateFn)
+    {
+#ifdef CPU_PARTICLES_X86
+        if (SDL_HasAVX())
+            CpuParticles_setPath(CPU_PARTICLES_AVX);
+        else
+#endif
+            CpuParticles_setPath(CPU_PARTICLES_SCALAR);
+    }
+
+    return updatePath;
+}
+
+void CpuParticles_setPath(CpuParticlePath path)
+{
+#ifdef CPU_PARTICLES_X86
+    if (path == CPU_PARTICLES_AVX && SDL_HasAVX())
+    {
+        updateFn = updateAVX;
+        packFn = packAVX;
+        updatePath = CPU_PARTICLES_AVX;
+        return;
+    }
+#endif
+
+    updateFn = updateScalar;
+    packFn = packScalar;
+    updatePath = CPU_PARTICLES_SCALAR;
+}
+
+const char *CpuParticles_pathName(CpuParticlePath path)
+{
+    switch (path)
+    {
+    case CPU_PARTICLES_AVX:
+        return "avx";
+    default:
+        return "scalar";
+    }
+}
+
+static void updateChunks(void *data, int start, int end)
+{
+    CpuParticles *particles = data;
+    for (int chunk = start; chunk < end; chunk++)
+    {
+        int first = chunk * CPU_PARTICLE_CHUNK;
+        int last = SDL_min(first + CPU_PARTICLE_CHUNK, particles->count);
+        particles->deadCounts[chunk] = updateFn(particles, first, last, particles->deadIndices + first);
+    }
+}
+
+static void moveParticle(CpuParticles *particles, int from, int to)
+{
+    particles->positionX[to] = particles->positionX[from];
+    particles->positionY[to] = particles->positionY[from];
+    particles->positionZ[to] = particles->positionZ[from];
+    particles->velocityX[to] = particles->velocityX[from];
+    particles->velocityY[to] = particles->velocityY[from];
+    particles->velocityZ[to] = particles->velocityZ[from];
+    particles->age[to] = particles->age[from];
+    particles->lifetime[to] = particles->lifetime[from];
+}
+
+// Fills each hole, lowest first, with the last particle. Dead particles
+// already at the end are dropped instead of moved, and once the holes
+// reach the end everything left is gone.
+static void compact(CpuParticles *particles, int chunkCount)
+{
+    int count = particles->count;
+    for (int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        const int *dead = particles->deadIndices + chunk * CPU_PARTICLE_CHUNK;
+        for (int k = 0; k < particles->deadCounts[chunk]; k++)
+        {
+            int hole = dead[k];
+            while (count > hole && particles->age[count - 1] >= particles->lifetime[count - 1])
+                count--;
+
+            if (hole >= count)
+            {
+                particles->count = count;
+                return;
+            }
+
+            moveParticle(particles, --count, hole);
+        }
+    }
+
+    particles->count = count;
+}
+
+void CpuParticles_update(CpuParticles *particles, float deltaTime)
+{
+    CpuParticles_getPath();
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    int before = particles->count;
+    int chunkCount = (particles->count + CPU_PARTICLE_CHUNK - 1) / CPU_PARTICLE_CHUNK;
+    particles->deltaTime = deltaTime;
+    Job_parallelFor(chunkCount, 1, updateChunks, particles);
+    compact(particles, chunkCount);
+
+    particles->stats.spawned = particles->emitted;
+    particles->stats.died = before - particles->count;
+    particles->emitted = 0;
+    particles->stats.updateMs = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static void packChunks(void *data, int start, int end)
+{
+    PackRange *range = data;
+    int count = range->particles->count;
+    packFn(range->particles, start * CPU_PARTICLE_CHUNK, SDL_min(end * CPU_PARTICLE_CHUNK, count), range->destination);
+}
+
+void CpuParticles_pack(CpuParticles *particles, float *destination)
+{
+    CpuParticles_getPath();
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    PackRange range = {particles, destination};
+    Job_parallelFor((particles->count + CPU_PARTICLE_CHUNK - 1) / CPU_PARTICLE_CHUNK, 1, packChunks, &range);
+
+    particles->stats.packMs = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+void CpuParticles_draw(CpuParticles *particles, mat4 *view, mat4 *projection, float viewportHeight)
+{
+    RingBuffer_beginFrame(&particles->ring);
+
+    size_t offset;
+    float *vertices = particles->count ? RingBuffer_alloc(&particles->ring, (size_t)particles->count * 4 * sizeof(float), 4 * sizeof(float), &offset) : NULL;
+    if (particles->count && !vertices)
+        particles->stats.overflows++;
+
+    if (vertices)
+    {
+        CpuParticles_pack(particles, vertices);
+        RingBuffer_flush(&particles->ring);
+
+        GLState_bindVertexArray(particles->vao);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(uintptr_t)offset);
+
+        GLState_useProgram(particles->program);
+        glUniformMatrix4fv(particles->locations[DRAW_VIEW], 1, GL_FALSE, (float *)*view);
+        glUniformMatrix4fv(particles->locations[DRAW_PROJECTION], 1, GL_FALSE, (float *)*projection);
+        glUniform1f(particles->locations[DRAW_POINT_SCALE], viewportHeight * (*projection)[1][1] * 0.5f);
+        glUniform4fv(particles->locations[DRAW_COLOR], 1, particles->color);
+        glUniform1f(particles->locations[DRAW_SIZE], particles->size);
+
+        GLState_enable(GL_PROGRAM_POINT_SIZE);
+        GLState_enable(GL_BLEND);
+        GLState_blendFunc(GL_SRC_ALPHA, GL_ONE);
+        GLState_depthMask(GL_FALSE);
+
+        glDrawArrays(GL_POINTS, 0, particles->count);
+
+        GLState_depthMask(GL_TRUE);
+        GLState_disable(GL_BLEND);
+        GLState_disable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    RingBuffer_endFrame(&particles->ring);
+}
+
+CpuParticleStats CpuParticles_stats(const CpuParticles *particles)
+{
+    CpuParticleStats stats = particles->stats;
+    stats.count = particles->count;
+    return stats;
+}
@@ -0,0 +1,94 @@
+#ifndef CPUPARTICLES_INCLUDED
+#define CPUPARTICLES_INCLUDED
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "cglm/cglm.h"
+
+#include "ringbuffer.h"
+
+// Particles simulated on the CPU, for software GL where transform feedback
+// runs on the CPU anyway, and slowly. The same motion as the GPU system:
+// gravity, a lifetime, and bounces off one plane.
+//
+// Live particles are packed at the front of structure-of-arrays storage.
+// Updating runs in fixed chunks across the job system, 8 particles per AVX
+// instruction, and each chunk lists the particles that died in it; one
+// serial pass then fills those holes by swapping in particles from the
+// end. Drawing packs position and fade into a ring buffer region, so the
+// upload never waits on a buffer the GPU is still reading.
+//
+// Drawing loads ./shaders/cpuparticles.vert and particles.frag.
+#define CPU_PARTICLE_CHUNK 4096 // a multiple of 8 so only the last chunk has a scalar tail
+
+typedef enum CpuParticlePath
+{
+    CPU_PARTICLES_SCALAR,
+    CPU_PARTICLES_AVX
+} CpuParticlePath;
+
+typedef struct CpuParticleStats
+{
+    int count;
+    int spawned, died; // in the last update
+    double updateMs;   // the parallel step and the compaction
+    double packMs;     // writing the vertex data
+    int overflows;     // frames that did not fit the ring buffer
+} CpuParticleStats;
+
+typedef struct CpuParticles
+{
+    int count;
+    int capacity;
+
+    float *positionX, *positionY, *positionZ;
+    float *velocityX, *velocityY, *velocityZ;
+    float *age, *lifetime;
+
+    vec3 gravity;
+    vec4 plane;        // normal and offset, as in ParticleSystem
+    float restitution;
+    Uint32 seed;
+
+    int *deadIndices; // per chunk, at the chunk's first index
+    int *deadCounts;
+    float deltaTime;  // of the update in progress
+    int emitted;      // since the last update
+
+    // drawing, after CpuParticles_initDrawing
+    RingBuffer ring;
+    GLuint vao;
+    GLuint program;
+    GLint locations[5];
+    vec4 color;
+    float size; // world units across
+
+    CpuParticleStats stats;
+} CpuParticles;
+
+void CpuParticles_init(CpuParticles *particles, int capacity);
+void CpuParticles_free(CpuParticles *particles);
+
+// GL side; the simulation alone needs no context
+void CpuParticles_initDrawing(CpuParticles *particles);
+
+CpuParticlePath CpuParticles_getPath();
+void CpuParticles_setPath(CpuParticlePath path);
+const char *CpuParticles_pathName(CpuParticlePath path);
+
+// Adds up to count particles at position, launched with velocity plus up to
+// spread more in a random direction, living lifetime seconds give or take
+// 25%. Returns how many fit.
+int CpuParticles_emit(CpuParticles *particles, int count, vec3 position, vec3 velocity, float spread, float lifetime);
+
+void CpuParticles_update(CpuParticles *particles, float deltaTime);
+
+// position and fade as 4 floats per particle, alive ones only
+void CpuParticles_pack(CpuParticles *particles, float *destination);
+
+// additive point sprites, depth tested but not written; viewportHeight in pixels
+void CpuParticles_draw(CpuParticles *particles, mat4 *view, mat4 *projection, float viewportHeight);
+
+CpuParticleStats CpuParticles_stats(const CpuParticles *particles);
+
+#endif
@@ -0,0 +1,276 @@
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "cull.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CULL_X86
+#endif
+
+typedef int (*CullFn)(const CullBounds *bounds, const Frustum *frustum, int *visible);
+
+static CullFn cullFn = NULL;
+static CullPath cullPath = CULL_SCALAR;
+
+void CullBounds_init(CullBounds *bounds, int capacity)
+{
+    // round up so the vector loops never need a partial tail on a full array
+    capacity = (capacity + 7) & ~7;
+
+    bounds->count = 0;
+    bounds->capacity = capacity;
+
+    float **arrays[] = {
+        &bounds->centerX, &bounds->centerY, &bounds->centerZ,
+        &bounds->extentX, &bounds->extentY, &bounds->extentZ};
+
+    for (int i = 0; i < 6; i++)
+    {
+        *arrays[i] = SDL_SIMDAlloc(capacity * sizeof(float));
+        SDL_memset(*arrays[i], 0, capacity * sizeof(float));
+    }
+}
+
+void CullBounds_free(CullBounds *bounds)
+{
+    SDL_SIMDFree(bounds->centerX);
+    SDL_SIMDFree(bounds->centerY);
+    SDL_SIMDFree(bounds->centerZ);
+    SDL_SIMDFree(bounds->extentX);
+    SDL_SIMDFree(bounds->extentY);
+    SDL_SIMDFree(bounds->extentZ);
+
+    bounds->count = 0;
+    bounds->capacity = 0;
+}
+
+int CullBounds_add(CullBounds *bounds, vec3 center, vec3 extent)
+{
+    if (bounds->count >= bounds->capacity)
+    {
+        SDL_Log("CullBounds full (capacity %d)", bounds->capacity);
+        return -1;
+    }
+
+    int i = bounds->count++;
+    bounds->centerX[i] = center[0];
+    bounds->centerY[i] = center[1];
+    bounds->centerZ[i] = center[2];
+    bounds->extentX[i] = extent[0];
+    bounds->extentY[i] = extent[1];
+    bounds->extentZ[i] = extent[2];
+
+    return i;
+}
+
+// A box is outside a plane when its centre is further behind it than the
+// box's projected radius |n.x| ex + |n.y| ey + |n.z| ez.
+static inline bool boxVisible(const CullBounds *bounds, const Frustum *frustum, int i)
+{
+    for (int p = 0; p < 6; p++)
+    {
+        const float *plane = frustum->planes[p];
+        float distance = plane[0] * bounds->centerX[i] + plane[1] * bounds->centerY[i] + plane[2] * bounds->centerZ[i] + plane[3];
+        float radius = fabsf(plane[0]) * bounds->extentX[i] + fabsf(plane[1]) * bounds->extentY[i] + fabsf(plane[2]) * bounds->extentZ[i];
+        if (distance + radius < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+static int cullScalar(const CullBounds *bounds, const Frustum *frustum, int *visible)
+{
+    int written = 0;
+
+    for (int i = 0; i < bounds->count; i++)
+    {
+        if (boxVisible(bounds, frustum, i))
+            visible[written++] = i;
+    }
+
+    return written;
+}
+
+#ifdef CULL_X86
+__attribute__((target("sse2"))) static int cullSSE(const CullBounds *bounds, const Frustum *frustum, int *visible)
+{
+    // plane, then its absolute normal for the projected radius
+    __m128 planes[6][7];
+    for (int p = 0; p < 6; p++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            planes[p][c] = _mm_set1_ps(frustum->planes[p][c]);
+        }
+
+        for (int c = 0; c < 3; c++)
+        {
+            planes[p][4 + c] = _mm_set1_ps(fabsf(frustum->planes[p][c]));
+        }
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+
+    int written = 0;
+    int i = 0;
+    for (; i + 4 <= bounds->count; i += 4)
+    {
+        __m128 cx = _mm_load_ps(bounds->centerX + i);
+        __m128 cy = _mm_load_ps(bounds->centerY + i);
+        __m128 cz = _mm_load_ps(bounds->centerZ + i);
+        __m128 ex = _mm_load_ps(bounds->extentX + i);
+        __m128 ey = _mm_load_ps(bounds->extentY + i);
+        __m128 ez = _mm_load_ps(bounds->extentZ + i);
+
+        int mask = 0xf;
+        for (int p = 0; p < 6 && mask; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], cx), _mm_mul_ps(planes[p][1], cy)), _mm_mul_ps(planes[p][2], cz)), planes[p][3]);
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][4], ex), _mm_mul_ps(planes[p][5], ey)), _mm_mul_ps(planes[p][6], ez));
+            mask &= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        while (mask)
+        {
+            int lane = __builtin_ctz(mask);
+            visible[written++] = i + lane;
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i < bounds->count; i++)
+    {
+        if (boxVisible(bounds, frustum, i))
+            visible[written++] = i;
+    }
+
+    return written;
+}
+
+// lane indices of the set bits of every 8-bit mask, packed to the front
+static int compactTable[256][8];
+
+__attribute__((target("avx2"))) static int cullAVX2(const CullBounds *bounds, const Frustum *frustum, int *visible)
+{
+    __m256 planes[6][7];
+    for (int p = 0; p < 6; p++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            planes[p][c] = _mm256_set1_ps(frustum->planes[p][c]);
+        }
+
+        for (int c = 0; c < 3; c++)
+        {
+            planes[p][4 + c] = _mm256_set1_ps(fabsf(frustum->planes[p][c]));
+        }
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    int written = 0;
+    int i = 0;
+    for (; i + 8 <= bounds->count; i += 8)
+    {
+        __m256 cx = _mm256_load_ps(bounds->centerX + i);
+        __m256 cy = _mm256_load_ps(bounds->centerY + i);
+        __m256 cz = _mm256_load_ps(bounds->centerZ + i);
+        __m256 ex = _mm256_load_ps(bounds->extentX + i);
+        __m256 ey = _mm256_load_ps(bounds->extentY + i);
+        __m256 ez = _mm256_load_ps(bounds->extentZ + i);
+
+        int mask = 0xff;
+        for (int p = 0; p < 6 && mask; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], cx), _mm256_mul_ps(planes[p][1], cy)), _mm256_mul_ps(planes[p][2], cz)), planes[p][3]);
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][4], ex), _mm256_mul_ps(planes[p][5], ey)), _mm256_mul_ps(planes[p][6], ez));
+            mask &= _mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+        }
+
+        // write all 8 slots, only the first popcount(mask) are kept
+        __m256i shuffle = _mm256_loadu_si256((const __m256i *)compactTable[mask]);
+        __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(i), _mm256_permutevar8x32_epi32(lanes, shuffle));
+        _mm256_storeu_si256((__m256i *)(visible + written), indices);
+        written += __builtin_popcount(mask);
+    }
+
+    for (; i < bounds->count; i++)
+    {
+        if (boxVisible(bounds, frustum, i))
+            visible[written++] = i;
+    }
+
+    return written;
+}
+#endif
+
+CullPath Cull_getPath()
+{
+    if (!cullFn)
+    {
+#ifdef CULL_X86
+        if (SDL_HasAVX2())
+            Cull_setPath(CULL_AVX2);
+        else if (SDL_HasSSE2())
+            Cull_setPath(CULL_SSE);
+        else
+#endif
+            Cull_setPath(CULL_SCALAR);
+    }
+
+    return cullPath;
+}
+
+void Cull_setPath(CullPath path)
+{
+#ifdef CULL_X86
+    if (path == CULL_AVX2 && SDL_HasAVX2())
+    {
+        for (int mask = 0; mask < 256; mask++)
+        {
+            int count = 0;
+            for (int lane = 0; lane < 8; lane++)
+            {
+                if (mask & (1 << lane))
+                    compactTable[mask][count++] = lane;
+            }
+        }
+
+        cullFn = cullAVX2;
+        cullPath = CULL_AVX2;
+        return;
+    }
+
+    if (path != CULL_SCALAR && SDL_HasSSE2())
+    {
+        cullFn = cullSSE;
+        cullPath = CULL_SSE;
+        return;
+    }
+#endif
+
+    cullFn = cullScalar;
+    cullPath = CULL_SCALAR;
+}
+
+const char *Cull_pathName(CullPath path)
+{
+    switch (path)
+    {
+    case CULL_AVX2:
+        return "avx2";
+    case CULL_SSE:
+        return "sse";
+    default:
+        return "scalar";
+    }
+}
+
+int Cull_frustum(const CullBounds *bounds, const Frustum *frustum, int *visible)
+{
+    Cull_getPath();
+    return cullFn(bounds, frustum, visible);
+}
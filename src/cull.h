@@ -0,0 +1,37 @@
+#ifndef CULL_INCLUDED
+#define CULL_INCLUDED
+
+#include "frustum.h"
+
+// Object bounds as structure-of-arrays AABBs (centre and half extent), so
+// the culling kernel can test 4 (SSE) or 8 (AVX2) objects per plane.
+typedef struct CullBounds
+{
+    int count;
+    int capacity;
+
+    float *centerX, *centerY, *centerZ;
+    float *extentX, *extentY, *extentZ;
+} CullBounds;
+
+typedef enum CullPath
+{
+    CULL_SCALAR,
+    CULL_SSE,
+    CULL_AVX2
+} CullPath;
+
+void CullBounds_init(CullBounds *bounds, int capacity);
+void CullBounds_free(CullBounds *bounds);
+int CullBounds_add(CullBounds *bounds, vec3 center, vec3 extent);
+
+CullPath Cull_getPath();
+void Cull_setPath(CullPath path);
+const char *Cull_pathName(CullPath path);
+
+// Writes the indices of the objects touching the frustum to visible, in
+// increasing order, and returns how many there are. visible must hold
+// bounds->capacity entries; the vector paths store whole vectors.
+int Cull_frustum(const CullBounds *bounds, const Frustum *frustum, int *visible);
+
+#endif
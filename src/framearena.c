@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#include "framearena.h"
+
+// buffer starts are cache line aligned, so any alignment up to that holds
+#define FRAME_ARENA_ALIGNMENT 64
+
+void FrameArena_init(FrameArena *arena, size_t capacity)
+{
+    SDL_memset(arena, 0, sizeof(FrameArena));
+    arena->capacity = (capacity + FRAME_ARENA_ALIGNMENT - 1) & ~(size_t)(FRAME_ARENA_ALIGNMENT - 1);
+    arena->stats.capacity = arena->capacity;
+
+    for (int f = 0; f < FRAME_ARENA_FRAMES; f++)
+        arena->memory[f] = SDL_SIMDAlloc(arena->capacity);
+}
+
+void FrameArena_free(FrameArena *arena)
+{
+    for (int f = 0; f < FRAME_ARENA_FRAMES; f++)
+    {
+        SDL_SIMDFree(arena->memory[f]);
+        arena->memory[f] = NULL;
+    }
+}
+
+void *FrameArena_alloc(FrameArena *arena, size_t size, size_t alignment)
+{
+    SDL_assert(alignment > 0 && alignment <= FRAME_ARENA_ALIGNMENT && (alignment & (alignment - 1)) == 0);
+
+    size_t start = (arena->head + alignment - 1) & ~(alignment - 1);
+    if (start + size > arena->capacity)
+    {
+        arena->stats.overflows++;
+        return NULL;
+    }
+
+    arena->head = start + size;
+    arena->stats.used = arena->head;
+    if (arena->head > arena->stats.highWater)
+        arena->stats.highWater = arena->head;
+
+    return arena->memory[arena->frame] + start;
+}
+
+void FrameArena_reset(FrameArena *arena)
+{
+    arena->frame = (arena->frame + 1) % FRAME_ARENA_FRAMES;
+    arena->head = 0;
+    arena->stats.used = 0;
+}
+
+FrameArenaStats FrameArena_stats(const FrameArena *arena)
+{
+    return arena->stats;
+}
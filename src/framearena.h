@@ -0,0 +1,44 @@
+#ifndef FRAMEARENA_INCLUDED
+#define FRAMEARENA_INCLUDED
+
+#include <stddef.h>
+
+// Bump allocator for data that only lives for a frame. There is one buffer
+// per frame in flight: FrameArena_reset, called right after
+// SDL_GL_SwapWindow, switches to the other buffer and empties it, so memory
+// from the previous frame stays valid for one more frame. Nothing is ever
+// freed individually and nothing is allocated after init.
+//
+// Not thread safe; allocate from the thread that resets it.
+#define FRAME_ARENA_FRAMES 2
+
+typedef struct FrameArenaStats
+{
+    size_t used;      // bytes allocated this frame, padding included
+    size_t highWater; // most bytes any frame has used
+    size_t capacity;
+    int overflows;    // allocations that did not fit since init
+} FrameArenaStats;
+
+typedef struct FrameArena
+{
+    unsigned char *memory[FRAME_ARENA_FRAMES];
+    size_t capacity; // per frame
+    int frame;
+    size_t head;
+
+    FrameArenaStats stats;
+} FrameArena;
+
+void FrameArena_init(FrameArena *arena, size_t capacity);
+void FrameArena_free(FrameArena *arena);
+
+// alignment must be a power of two, at most 64. Returns NULL when the
+// frame's buffer is full.
+void *FrameArena_alloc(FrameArena *arena, size_t size, size_t alignment);
+
+void FrameArena_reset(FrameArena *arena);
+
+FrameArenaStats FrameArena_stats(const FrameArena *arena);
+
+#endif
@@ -0,0 +1,67 @@
+#include <math.h>
+
+#include "frustum.h"
+
+void Frustum_extract(Frustum *frustum, mat4 viewProjection)
+{
+    // Gribb/Hartmann: each plane is the last row of the matrix plus or minus
+    // another row. cglm is column-major, so row r is m[0][r] .. m[3][r].
+    for (int p = 0; p < 6; p++)
+    {
+        int row = p / 2;
+        float sign = (p & 1) ? -1.0f : 1.0f;
+
+        for (int c = 0; c < 4; c++)
+        {
+            frustum->planes[p][c] = viewProjection[c][3] + sign * viewProjection[c][row];
+        }
+
+        float length = sqrtf(frustum->planes[p][0] * frustum->planes[p][0] +
+                             frustum->planes[p][1] * frustum->planes[p][1] +
+                             frustum->planes[p][2] * frustum->planes[p][2]);
+        glm_vec4_scale(frustum->planes[p], 1.0f / length, frustum->planes[p]);
+    }
+}
+
+FrustumResult Frustum_testAABB(const Frustum *frustum, vec3 min, vec3 max, int *planeMask)
+{
+    FrustumResult result = FRUSTUM_INSIDE;
+
+    for (int p = 0; p < 6; p++)
+    {
+        if (!(*planeMask & (1 << p)))
+            continue;
+
+        const float *plane = frustum->planes[p];
+
+        // corners furthest along and against the plane normal
+        vec3 positive, negative;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            positive[axis] = plane[axis] >= 0.0f ? max[axis] : min[axis];
+            negative[axis] = plane[axis] >= 0.0f ? min[axis] : max[axis];
+        }
+
+        if (glm_vec3_dot((float *)plane, positive) + plane[3] < 0.0f)
+            return FRUSTUM_OUTSIDE;
+
+        if (glm_vec3_dot((float *)plane, negative) + plane[3] < 0.0f)
+            result = FRUSTUM_INTERSECTS;
+        else
+            *planeMask &= ~(1 << p);
+    }
+
+    return result;
+}
+
+bool Frustum_testSphere(const Frustum *frustum, vec3 center, float radius)
+{
+    for (int p = 0; p < 6; p++)
+    {
+        const float *plane = frustum->planes[p];
+        if (glm_vec3_dot((float *)plane, center) + plane[3] < -radius)
+            return false;
+    }
+
+    return true;
+}
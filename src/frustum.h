@@ -0,0 +1,38 @@
+#ifndef FRUSTUM_INCLUDED
+#define FRUSTUM_INCLUDED
+
+#include <stdbool.h>
+#include "cglm/cglm.h"
+
+// Six planes (left, right, bottom, top, near, far) as ax + by + cz + d with
+// normals pointing into the frustum.
+typedef struct Frustum
+{
+    vec4 planes[6];
+} Frustum;
+
+typedef enum FrustumResult
+{
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECTS,
+    FRUSTUM_INSIDE
+} FrustumResult;
+
+#define FRUSTUM_ALL_PLANES 0x3f
+
+typedef struct CullStats
+{
+    int tested;
+    int visible;
+} CullStats;
+
+// viewProjection is projection * view, as built by glm_perspective/glm_lookat.
+void Frustum_extract(Frustum *frustum, mat4 viewProjection);
+
+// Only the planes set in *planeMask are tested. On return the planes the box
+// is fully inside of are cleared, so children of a node can pass the mask on
+// and skip them.
+FrustumResult Frustum_testAABB(const Frustum *frustum, vec3 min, vec3 max, int *planeMask);
+bool Frustum_testSphere(const Frustum *frustum, vec3 center, float radius);
+
+#endif
@@ -0,0 +1,97 @@
+#include <SDL2/SDL.h>
+
+#include "gbuffer.h"
+#include "glstate.h"
+
+static GLuint createTarget(int width, int height, GLenum internalFormat, GLenum format, GLenum type)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    GLState_bindTexture(0, GL_TEXTURE_2D, texture);
+
+    // the lighting pass reads texel for pixel
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+
+    return texture;
+}
+
+bool GBuffer_init(GBuffer *gbuffer, int width, int height)
+{
+    gbuffer->width = width;
+    gbuffer->height = height;
+    gbuffer->blitFailed = false;
+
+    gbuffer->albedoSpecular = createTarget(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    gbuffer->normal = createTarget(width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    // depth can only be blitted between matching formats, so the window has
+    // to ask for 24 bit depth and 8 bit stencil before its context exists
+    gbuffer->depth = createTarget(width, height, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+    GLState_bindTexture(0, GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &gbuffer->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gbuffer->albedoSpecular, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gbuffer->normal, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, gbuffer->depth, 0);
+
+    GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        SDL_Log("GBuffer: framebuffer incomplete (0x%x)", status);
+        return false;
+    }
+
+    return true;
+}
+
+void GBuffer_free(GBuffer *gbuffer)
+{
+    glDeleteFramebuffers(1, &gbuffer->framebuffer);
+
+    GLuint textures[3] = {gbuffer->albedoSpecular, gbuffer->normal, gbuffer->depth};
+    glDeleteTextures(3, textures);
+    GLState_invalidate();
+}
+
+void GBuffer_begin(GBuffer *gbuffer)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer->framebuffer);
+
+    // the clear honours the depth mask
+    GLState_depthMask(GL_TRUE);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void GBuffer_end(GBuffer *gbuffer)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer->framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    while (glGetError() != GL_NO_ERROR)
+        ;
+    glBlitFramebuffer(0, 0, gbuffer->width, gbuffer->height, 0, 0, gbuffer->width, gbuffer->height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR && !gbuffer->blitFailed)
+    {
+        SDL_Log("GBuffer: depth blit failed (0x%x), the default framebuffer needs 24 bit depth and 8 bit stencil", error);
+        gbuffer->blitFailed = true;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer_bindTextures(GBuffer *gbuffer, int firstUnit)
+{
+    GLState_bindTexture(firstUnit, GL_TEXTURE_2D, gbuffer->albedoSpecular);
+    GLState_bindTexture(firstUnit + 1, GL_TEXTURE_2D, gbuffer->normal);
+    GLState_bindTexture(firstUnit + 2, GL_TEXTURE_2D, gbuffer->depth);
+}
@@ -0,0 +1,41 @@
+#ifndef GBUFFER_INCLUDED
+#define GBUFFER_INCLUDED
+
+#include <stdbool.h>
+#include <GL/glew.h>
+
+// Render targets for deferred shading. The geometry pass writes surface
+// attributes instead of colours; a later lighting pass reads them back per
+// pixel, so lighting costs pixels times lights instead of drawn fragments.
+//
+//   albedoSpecular  RGBA8: diffuse colour, specular intensity in alpha
+//   normal          RGBA16F: world space normal
+//   depth           DEPTH24_STENCIL8, positions are rebuilt from it
+typedef struct GBuffer
+{
+    GLuint framebuffer;
+    GLuint albedoSpecular;
+    GLuint normal;
+    GLuint depth;
+
+    int width, height;
+    bool blitFailed; // logged once
+} GBuffer;
+
+// false when the driver rejects the attachment combination
+bool GBuffer_init(GBuffer *gbuffer, int width, int height);
+void GBuffer_free(GBuffer *gbuffer);
+
+// binds and clears the targets for the geometry pass
+void GBuffer_begin(GBuffer *gbuffer);
+
+// Copies the depth into the default framebuffer, so forward draws after the
+// lighting pass still depth test against the scene, and leaves it bound. The
+// default framebuffer must be DEPTH24_STENCIL8 too: set SDL_GL_DEPTH_SIZE 24
+// and SDL_GL_STENCIL_SIZE 8 before creating the window.
+void GBuffer_end(GBuffer *gbuffer);
+
+// albedoSpecular, normal and depth to units firstUnit..firstUnit + 2
+void GBuffer_bindTextures(GBuffer *gbuffer, int firstUnit);
+
+#endif
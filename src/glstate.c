@@ -0,0 +1,292 @@
+#include <SDL2/SDL.h>
+
+#include "glstate.h"
+
+// never a valid name or enum, so the next call always goes through
+#define UNKNOWN 0xffffffffU
+
+enum
+{
+    TEXTURE_2D,
+    TEXTURE_CUBE_MAP,
+    TEXTURE_2D_ARRAY,
+    TEXTURE_3D,
+    TEXTURE_BUFFER,
+    TEXTURE_TARGETS
+};
+
+enum
+{
+    CAP_DEPTH_TEST,
+    CAP_BLEND,
+    CAP_CULL_FACE,
+    CAP_SCISSOR_TEST,
+    CAP_PROGRAM_POINT_SIZE,
+    CAP_POLYGON_OFFSET_FILL,
+    CAP_RASTERIZER_DISCARD,
+    CAPS
+};
+
+typedef struct GLStateCache
+{
+    GLuint program;
+    GLuint vao;
+    GLuint arrayBuffer;
+    GLuint elementBuffer; // of the bound VAO
+    GLuint uniformBuffer;
+    GLuint drawIndirectBuffer;
+
+    GLuint activeUnit;
+    GLuint textures[GLSTATE_TEXTURE_UNITS][TEXTURE_TARGETS];
+
+    GLuint caps[CAPS]; // GL_TRUE, GL_FALSE or UNKNOWN
+    GLenum depthFunc;
+    GLuint depthMask;
+    GLenum blendSource;
+    GLenum blendDestination;
+    GLenum polygonMode;
+    float pointSize;
+
+    GLStateStats stats;
+} GLStateCache;
+
+// a fresh context: everything unbound, every capability off
+static GLStateCache state = {
+    .activeUnit = GL_TEXTURE0,
+    .depthFunc = GL_LESS,
+    .depthMask = GL_TRUE,
+    .blendSource = GL_ONE,
+    .blendDestination = GL_ZERO,
+    .polygonMode = GL_FILL,
+    .pointSize = 1.0f};
+
+static inline bool changed(GLuint *cached, GLuint value)
+{
+    if (*cached == value)
+    {
+        state.stats.skipped++;
+        return false;
+    }
+
+    *cached = value;
+    state.stats.issued++;
+    return true;
+}
+
+static int textureTarget(GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:
+        return TEXTURE_2D;
+    case GL_TEXTURE_CUBE_MAP:
+        return TEXTURE_CUBE_MAP;
+    case GL_TEXTURE_2D_ARRAY:
+        return TEXTURE_2D_ARRAY;
+    case GL_TEXTURE_3D:
+        return TEXTURE_3D;
+    case GL_TEXTURE_BUFFER:
+        return TEXTURE_BUFFER;
+    default:
+        return -1;
+    }
+}
+
+static int capability(GLenum cap)
+{
+    switch (cap)
+    {
+    case GL_DEPTH_TEST:
+        return CAP_DEPTH_TEST;
+    case GL_BLEND:
+        return CAP_BLEND;
+    case GL_CULL_FACE:
+        return CAP_CULL_FACE;
+    case GL_SCISSOR_TEST:
+        return CAP_SCISSOR_TEST;
+    case GL_PROGRAM_POINT_SIZE:
+        return CAP_PROGRAM_POINT_SIZE;
+    case GL_POLYGON_OFFSET_FILL:
+        return CAP_POLYGON_OFFSET_FILL;
+    case GL_RASTERIZER_DISCARD:
+        return CAP_RASTERIZER_DISCARD;
+    default:
+        return -1;
+    }
+}
+
+static GLuint *bufferBinding(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        return &state.arrayBuffer;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return &state.elementBuffer;
+    case GL_UNIFORM_BUFFER:
+        return &state.uniformBuffer;
+    case GL_DRAW_INDIRECT_BUFFER:
+        return &state.drawIndirectBuffer;
+    default:
+        return NULL;
+    }
+}
+
+void GLState_useProgram(GLuint program)
+{
+    if (changed(&state.program, program))
+        glUseProgram(program);
+}
+
+void GLState_bindVertexArray(GLuint vao)
+{
+    if (changed(&state.vao, vao))
+    {
+        glBindVertexArray(vao);
+
+        // the element buffer binding belongs to the VAO we just switched to
+        state.elementBuffer = UNKNOWN;
+    }
+}
+
+void GLState_bindBuffer(GLenum target, GLuint buffer)
+{
+    GLuint *cached = bufferBinding(target);
+    if (!cached)
+    {
+        state.stats.issued++;
+        glBindBuffer(target, buffer);
+        return;
+    }
+
+    if (changed(cached, buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GLState_bindTexture(int unit, GLenum target, GLuint texture)
+{
+    int index = textureTarget(target);
+    if (index < 0 || unit >= GLSTATE_TEXTURE_UNITS)
+    {
+        state.stats.issued += 2;
+        state.activeUnit = GL_TEXTURE0 + unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        return;
+    }
+
+    // the unit is made active even when the texture is already bound, so
+    // uploads and parameter calls right after land on it
+    if (changed(&state.activeUnit, GL_TEXTURE0 + unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+
+    if (!changed(&state.textures[unit][index], texture))
+        return;
+
+    glBindTexture(target, texture);
+}
+
+static void setCapability(GLenum cap, GLuint enabled)
+{
+    int index = capability(cap);
+    if (index >= 0 && !changed(&state.caps[index], enabled))
+        return;
+
+    if (index < 0)
+        state.stats.issued++;
+
+    if (enabled)
+        glEnable(cap);
+    else
+        glDisable(cap);
+}
+
+void GLState_enable(GLenum capability)
+{
+    setCapability(capability, GL_TRUE);
+}
+
+void GLState_disable(GLenum capability)
+{
+    setCapability(capability, GL_FALSE);
+}
+
+void GLState_depthFunc(GLenum func)
+{
+    if (changed(&state.depthFunc, func))
+        glDepthFunc(func);
+}
+
+void GLState_depthMask(GLboolean mask)
+{
+    if (changed(&state.depthMask, mask))
+        glDepthMask(mask);
+}
+
+void GLState_blendFunc(GLenum source, GLenum destination)
+{
+    if (state.blendSource == source && state.blendDestination == destination)
+    {
+        state.stats.skipped++;
+        return;
+    }
+
+    state.blendSource = source;
+    state.blendDestination = destination;
+    state.stats.issued++;
+    glBlendFunc(source, destination);
+}
+
+void GLState_polygonMode(GLenum mode)
+{
+    if (changed(&state.polygonMode, mode))
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GLState_pointSize(float size)
+{
+    if (state.pointSize == size)
+    {
+        state.stats.skipped++;
+        return;
+    }
+
+    state.pointSize = size;
+    state.stats.issued++;
+    glPointSize(size);
+}
+
+GLuint GLState_program()
+{
+    return state.program;
+}
+
+GLuint GLState_vertexArray()
+{
+    return state.vao;
+}
+
+GLuint GLState_texture(int unit, GLenum target)
+{
+    int index = textureTarget(target);
+    if (index < 0 || unit >= GLSTATE_TEXTURE_UNITS)
+        return UNKNOWN;
+
+    return state.textures[unit][index];
+}
+
+void GLState_invalidate()
+{
+    GLStateStats stats = state.stats;
+    SDL_memset(&state, 0xff, sizeof(state));
+    state.pointSize = -1.0f;
+    state.stats = stats;
+}
+
+GLStateStats GLState_endFrame()
+{
+    GLStateStats stats = state.stats;
+    state.stats.issued = 0;
+    state.stats.skipped = 0;
+    return stats;
+}
@@ -0,0 +1,45 @@
+#ifndef GLSTATE_INCLUDED
+#define GLSTATE_INCLUDED
+
+#include <stdbool.h>
+#include <GL/glew.h>
+
+// Shadow copy of the GL state the renderers touch. Each call compares against
+// what is already bound and only reaches the driver when something changes.
+//
+// The cache starts out holding the defaults of a fresh context. Code that
+// changes the same state behind its back (or deletes a bound object) has to
+// call GLState_invalidate afterwards.
+#define GLSTATE_TEXTURE_UNITS 16
+
+typedef struct GLStateStats
+{
+    int issued;
+    int skipped;
+} GLStateStats;
+
+void GLState_useProgram(GLuint program);
+void GLState_bindVertexArray(GLuint vao);
+// GL_ELEMENT_ARRAY_BUFFER is tracked per bound VAO
+void GLState_bindBuffer(GLenum target, GLuint buffer);
+// leaves unit active, so glTexImage / glTexParameter calls after it act on texture
+void GLState_bindTexture(int unit, GLenum target, GLuint texture);
+
+void GLState_enable(GLenum capability);
+void GLState_disable(GLenum capability);
+void GLState_depthFunc(GLenum func);
+void GLState_depthMask(GLboolean mask);
+void GLState_blendFunc(GLenum source, GLenum destination);
+void GLState_polygonMode(GLenum mode); // GL_FRONT_AND_BACK, the only face core profile allows
+void GLState_pointSize(float size);
+
+GLuint GLState_program();
+GLuint GLState_vertexArray();
+GLuint GLState_texture(int unit, GLenum target);
+
+void GLState_invalidate();
+
+// returns this frame's counts and starts counting the next
+GLStateStats GLState_endFrame();
+
+#endif
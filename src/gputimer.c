@@ -0,0 +1,62 @@
+#include <SDL2/SDL.h>
+
+#include "gputimer.h"
+
+void GpuTimer_init(GpuTimer *timer)
+{
+    SDL_memset(timer, 0, sizeof(GpuTimer));
+    glGenQueries(GPU_TIMER_FRAMES * GPU_TIMER_MARKS, &timer->queries[0][0]);
+}
+
+void GpuTimer_free(GpuTimer *timer)
+{
+    glDeleteQueries(GPU_TIMER_FRAMES * GPU_TIMER_MARKS, &timer->queries[0][0]);
+}
+
+void GpuTimer_beginFrame(GpuTimer *timer)
+{
+    timer->frame = (timer->frame + 1) % GPU_TIMER_FRAMES;
+
+    // the slot about to be reused was written GPU_TIMER_FRAMES frames ago
+    unsigned int written = timer->written[timer->frame];
+    timer->written[timer->frame] = 0;
+    if (!written)
+        return;
+
+    // a frame that is still not done is dropped rather than waited on
+    for (int mark = 0; mark < GPU_TIMER_MARKS; mark++)
+    {
+        if (!(written & (1u << mark)))
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(timer->queries[timer->frame][mark], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+    }
+
+    // marks that were not written keep their older results
+    timer->serial++;
+    for (int mark = 0; mark < GPU_TIMER_MARKS; mark++)
+    {
+        if (!(written & (1u << mark)))
+            continue;
+
+        glGetQueryObjectui64v(timer->queries[timer->frame][mark], GL_QUERY_RESULT, &timer->times[mark]);
+        timer->serials[mark] = timer->serial;
+    }
+}
+
+void GpuTimer_mark(GpuTimer *timer, int mark)
+{
+    glQueryCounter(timer->queries[timer->frame][mark], GL_TIMESTAMP);
+    timer->written[timer->frame] |= 1u << mark;
+}
+
+double GpuTimer_ms(const GpuTimer *timer, int from, int to)
+{
+    if (!timer->serials[from] || timer->serials[from] != timer->serials[to])
+        return -1.0;
+
+    return (double)(timer->times[to] - timer->times[from]) / 1000000.0;
+}
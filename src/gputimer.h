@@ -0,0 +1,37 @@
+#ifndef GPUTIMER_INCLUDED
+#define GPUTIMER_INCLUDED
+
+#include <stdbool.h>
+#include <GL/glew.h>
+
+// GPU timestamps at marks placed between draw calls (glQueryCounter), read
+// back GPU_TIMER_FRAMES frames later so the CPU never waits for them.
+// Timestamps, unlike GL_TIME_ELAPSED queries, can be placed anywhere,
+// including inside render queue setup callbacks.
+#define GPU_TIMER_FRAMES 4
+#define GPU_TIMER_MARKS 8
+
+typedef struct GpuTimer
+{
+    GLuint queries[GPU_TIMER_FRAMES][GPU_TIMER_MARKS];
+    unsigned int written[GPU_TIMER_FRAMES]; // bit per mark issued in that frame
+    int frame;
+
+    // each mark's latest result, tagged with the frame it came from
+    GLuint64 times[GPU_TIMER_MARKS];
+    unsigned int serials[GPU_TIMER_MARKS]; // 0 until the mark has a result
+    unsigned int serial;
+} GpuTimer;
+
+void GpuTimer_init(GpuTimer *timer);
+void GpuTimer_free(GpuTimer *timer);
+
+// collects the results of the oldest frame and starts a new one
+void GpuTimer_beginFrame(GpuTimer *timer);
+void GpuTimer_mark(GpuTimer *timer, int mark);
+
+// Milliseconds between two marks of the latest finished frame that wrote
+// both, or -1 when there is none yet.
+double GpuTimer_ms(const GpuTimer *timer, int from, int to);
+
+#endif
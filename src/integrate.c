@@ -0,0 +1,210 @@
+#include <SDL2/SDL.h>
+
+#include "integrate.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INTEGRATE_X86
+#endif
+
+typedef void (*IntegrateFn)(Bodies *bodies, int start, int end, float deltaTime, const Playfield *playfield);
+
+static IntegrateFn integrateFn = NULL;
+static IntegratePath integratePath = INTEGRATE_SCALAR;
+
+void Bodies_init(Bodies *bodies, int capacity)
+{
+    // round up so the vector loops never need a partial tail on a full array
+    capacity = (capacity + 7) & ~7;
+
+    bodies->count = 0;
+    bodies->capacity = capacity;
+
+    float **arrays[] = {
+        &bodies->positionX, &bodies->positionY, &bodies->positionZ,
+        &bodies->speedX, &bodies->speedY, &bodies->speedZ,
+        &bodies->accelX, &bodies->accelY, &bodies->accelZ};
+
+    for (int i = 0; i < 9; i++)
+    {
+        *arrays[i] = SDL_SIMDAlloc(capacity * sizeof(float));
+        SDL_memset(*arrays[i], 0, capacity * sizeof(float));
+    }
+}
+
+void Bodies_free(Bodies *bodies)
+{
+    SDL_SIMDFree(bodies->positionX);
+    SDL_SIMDFree(bodies->positionY);
+    SDL_SIMDFree(bodies->positionZ);
+    SDL_SIMDFree(bodies->speedX);
+    SDL_SIMDFree(bodies->speedY);
+    SDL_SIMDFree(bodies->speedZ);
+    SDL_SIMDFree(bodies->accelX);
+    SDL_SIMDFree(bodies->accelY);
+    SDL_SIMDFree(bodies->accelZ);
+
+    bodies->count = 0;
+    bodies->capacity = 0;
+}
+
+int Bodies_add(Bodies *bodies, float x, float y, float z)
+{
+    if (bodies->count >= bodies->capacity)
+    {
+        SDL_Log("Bodies full (capacity %d)", bodies->capacity);
+        return -1;
+    }
+
+    int i = bodies->count++;
+    bodies->positionX[i] = x;
+    bodies->positionY[i] = y;
+    bodies->positionZ[i] = z;
+    bodies->speedX[i] = bodies->speedY[i] = bodies->speedZ[i] = 0.0f;
+    bodies->accelX[i] = bodies->accelY[i] = bodies->accelZ[i] = 0.0f;
+
+    return i;
+}
+
+// Semi-implicit Euler: speed first, then position with the new speed.
+// A body pushed against the playfield edge loses its speed on that axis.
+static inline void integrateAxis(float *position, float *speed, const float *accel, int i, float deltaTime, float min, float max)
+{
+    float v = speed[i] + accel[i] * deltaTime;
+    float p = position[i] + v * deltaTime;
+    float clamped = p < min ? min : (p > max ? max : p);
+
+    position[i] = clamped;
+    speed[i] = clamped == p ? v : 0.0f;
+}
+
+static void integrateScalar(Bodies *bodies, int start, int end, float deltaTime, const Playfield *playfield)
+{
+    for (int i = start; i < end; i++)
+    {
+        integrateAxis(bodies->positionX, bodies->speedX, bodies->accelX, i, deltaTime, playfield->min[0], playfield->max[0]);
+        integrateAxis(bodies->positionY, bodies->speedY, bodies->accelY, i, deltaTime, playfield->min[1], playfield->max[1]);
+        integrateAxis(bodies->positionZ, bodies->speedZ, bodies->accelZ, i, deltaTime, playfield->min[2], playfield->max[2]);
+    }
+}
+
+#ifdef INTEGRATE_X86
+__attribute__((target("sse2"))) static void integrateAxisSSE(float *position, float *speed, const float *accel, int start, int end, float deltaTime, float min, float max)
+{
+    __m128 dt = _mm_set1_ps(deltaTime);
+    __m128 lo = _mm_set1_ps(min);
+    __m128 hi = _mm_set1_ps(max);
+
+    for (int i = start; i < end; i += 4)
+    {
+        __m128 v = _mm_add_ps(_mm_loadu_ps(speed + i), _mm_mul_ps(_mm_loadu_ps(accel + i), dt));
+        __m128 p = _mm_add_ps(_mm_loadu_ps(position + i), _mm_mul_ps(v, dt));
+        __m128 clamped = _mm_min_ps(_mm_max_ps(p, lo), hi);
+
+        _mm_storeu_ps(position + i, clamped);
+        _mm_storeu_ps(speed + i, _mm_and_ps(v, _mm_cmpeq_ps(clamped, p)));
+    }
+}
+
+__attribute__((target("sse2"))) static void integrateSSE(Bodies *bodies, int start, int end, float deltaTime, const Playfield *playfield)
+{
+    int vectorEnd = start + ((end - start) & ~3);
+
+    integrateAxisSSE(bodies->positionX, bodies->speedX, bodies->accelX, start, vectorEnd, deltaTime, playfield->min[0], playfield->max[0]);
+    integrateAxisSSE(bodies->positionY, bodies->speedY, bodies->accelY, start, vectorEnd, deltaTime, playfield->min[1], playfield->max[1]);
+    integrateAxisSSE(bodies->positionZ, bodies->speedZ, bodies->accelZ, start, vectorEnd, deltaTime, playfield->min[2], playfield->max[2]);
+
+    integrateScalar(bodies, vectorEnd, end, deltaTime, playfield);
+}
+
+__attribute__((target("avx"))) static void integrateAxisAVX(float *position, float *speed, const float *accel, int start, int end, float deltaTime, float min, float max)
+{
+    __m256 dt = _mm256_set1_ps(deltaTime);
+    __m256 lo = _mm256_set1_ps(min);
+    __m256 hi = _mm256_set1_ps(max);
+
+    for (int i = start; i < end; i += 8)
+    {
+        __m256 v = _mm256_add_ps(_mm256_loadu_ps(speed + i), _mm256_mul_ps(_mm256_loadu_ps(accel + i), dt));
+        __m256 p = _mm256_add_ps(_mm256_loadu_ps(position + i), _mm256_mul_ps(v, dt));
+        __m256 clamped = _mm256_min_ps(_mm256_max_ps(p, lo), hi);
+
+        _mm256_storeu_ps(position + i, clamped);
+        _mm256_storeu_ps(speed + i, _mm256_and_ps(v, _mm256_cmp_ps(clamped, p, _CMP_EQ_OQ)));
+    }
+}
+
+__attribute__((target("avx"))) static void integrateAVX(Bodies *bodies, int start, int end, float deltaTime, const Playfield *playfield)
+{
+    int vectorEnd = start + ((end - start) & ~7);
+
+    integrateAxisAVX(bodies->positionX, bodies->speedX, bodies->accelX, start, vectorEnd, deltaTime, playfield->min[0], playfield->max[0]);
+    integrateAxisAVX(bodies->positionY, bodies->speedY, bodies->accelY, start, vectorEnd, deltaTime, playfield->min[1], playfield->max[1]);
+    integrateAxisAVX(bodies->positionZ, bodies->speedZ, bodies->accelZ, start, vectorEnd, deltaTime, playfield->min[2], playfield->max[2]);
+
+    integrateScalar(bodies, vectorEnd, end, deltaTime, playfield);
+}
+#endif
+
+IntegratePath Integrate_getPath()
+{
+    if (!integrateFn)
+    {
+#ifdef INTEGRATE_X86
+        if (SDL_HasAVX())
+            Integrate_setPath(INTEGRATE_AVX);
+        else if (SDL_HasSSE2())
+            Integrate_setPath(INTEGRATE_SSE);
+        else
+#endif
+            Integrate_setPath(INTEGRATE_SCALAR);
+    }
+
+    return integratePath;
+}
+
+void Integrate_setPath(IntegratePath path)
+{
+#ifdef INTEGRATE_X86
+    if (path == INTEGRATE_AVX && SDL_HasAVX())
+    {
+        integrateFn = integrateAVX;
+        integratePath = INTEGRATE_AVX;
+        return;
+    }
+
+    if (path != INTEGRATE_SCALAR && SDL_HasSSE2())
+    {
+        integrateFn = integrateSSE;
+        integratePath = INTEGRATE_SSE;
+        return;
+    }
+#endif
+
+    integrateFn = integrateScalar;
+    integratePath = INTEGRATE_SCALAR;
+}
+
+const char *Integrate_pathName(IntegratePath path)
+{
+    switch (path)
+    {
+    case INTEGRATE_AVX:
+        return "avx";
+    case INTEGRATE_SSE:
+        return "sse";
+    default:
+        return "scalar";
+    }
+}
+
+void Integrate_range(Bodies *bodies, int start, int end, float deltaTime, const Playfield *playfield)
+{
+    Integrate_getPath();
+    integrateFn(bodies, start, end, deltaTime, playfield);
+}
+
+void Integrate_bodies(Bodies *bodies, float deltaTime, const Playfield *playfield)
+{
+    Integrate_range(bodies, 0, bodies->count, deltaTime, playfield);
+}
@@ -0,0 +1,40 @@
+#ifndef INTEGRATE_INCLUDED
+#define INTEGRATE_INCLUDED
+
+// Entity kinematics stored as structure-of-arrays so the integrator can
+// advance 4 (SSE) or 8 (AVX) entities per instruction.
+typedef struct Bodies
+{
+    int count;
+    int capacity;
+
+    float *positionX, *positionY, *positionZ;
+    float *speedX, *speedY, *speedZ;
+    float *accelX, *accelY, *accelZ;
+} Bodies;
+
+typedef struct Playfield
+{
+    float min[3];
+    float max[3];
+} Playfield;
+
+typedef enum IntegratePath
+{
+    INTEGRATE_SCALAR,
+    INTEGRATE_SSE,
+    INTEGRATE_AVX
+} IntegratePath;
+
+void Bodies_init(Bodies *bodies, int capacity);
+void Bodies_free(Bodies *bodies);
+int Bodies_add(Bodies *bodies, float x, float y, float z);
+
+IntegratePath Integrate_getPath();
+void Integrate_setPath(IntegratePath path);
+const char *Integrate_pathName(IntegratePath path);
+
+void Integrate_bodies(Bodies *bodies, float deltaTime, const Playfield *playfield);
+void Integrate_range(Bodies *bodies, int start, int end, float deltaTime, const Playfield *playfield);
+
+#endif
@@ -2,6 +2,12 @@
 #include "cglm/cglm.h"
 #include "SDL2/SDL.h"
 
+#include "glstate.h"
+#include "integrate.h"
+
+#define JET_ALTITUDE 22.0f
+#define JET_SPEED 20.0f
+
 static float vertices[] = {
     0.0f, 0.0f, 0.0f
 };
@@ -11,13 +17,13 @@ typedef struct Ball
     GLuint shaderProgram;
     unsigned int VAO, VBO, EBO;
 
-    vec3 position;
-    vec3 speed;
+    Bodies *bodies;
+    int body;
 } Ball;
 
 static Ball ball;
 
-void Ball_init()
+void Ball_init(Bodies *bodies)
 {
     // Shader program
     void *vertexShaderSource = SDL_LoadFile("./shaders/ball.vert", NULL);
@@ -73,9 +79,9 @@ void Ball_init()
     glGenBuffers(1, &(ball.VBO));
 
     // Bind and buffer data
-    glBindVertexArray(ball.VAO);
+    GLState_bindVertexArray(ball.VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, ball.VBO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, ball.VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     // Set vertex attributes
@@ -83,23 +89,22 @@ void Ball_init()
     glEnableVertexAttribArray(0);
 
     // Unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    glm_vec3_zero(&ball.position);
-    ball.position[1] = 10.0f;
+    GLState_bindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState_bindVertexArray(0);
 
-    glm_vec3_zero(&ball.speed);
+    ball.bodies = bodies;
+    ball.body = Bodies_add(bodies, 0.0f, JET_ALTITUDE, 0.0f);
+    bodies->speedZ[ball.body] = -JET_SPEED;
 }
 
-void Ball_update(float deltaTime)
+int Ball_getBody()
 {
-    ball.position[0] += ball.speed[0] * deltaTime;
+    return ball.body;
 }
 
-void Ball_draw(mat4 *view, mat4 *projection)
+void Ball_draw(mat4 *view, mat4 *projection, mat4 *models)
 {
-    glUseProgram(ball.shaderProgram);
+    GLState_useProgram(ball.shaderProgram);
 
     unsigned int viewLoc = glGetUniformLocation(ball.shaderProgram, "view");
     unsigned int projectionLoc = glGetUniformLocation(ball.shaderProgram, "projection");
@@ -108,13 +113,10 @@ void Ball_draw(mat4 *view, mat4 *projection)
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)*projection);
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)*view);
 
-    mat4 model;
-    glm_mat4_identity(model);
-    glm_translate(model, ball.position);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)models[ball.body]);
 
-glPointSize(10.0f);
-    glBindVertexArray(ball.VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+    GLState_pointSize(10.0f);
+    GLState_bindVertexArray(ball.VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
     glDrawArrays(GL_POINTS, 0, 1); // set the count to 6 since we're drawing 6 vertices now (2 triangles); not 3!
 }
 
@@ -123,11 +125,11 @@ void Ball_setDir(int dir)
 {
     if(dir < 0)
     {
-        ball.speed[0] = -BALL_SPEED;
+        ball.bodies->speedX[ball.body] = -BALL_SPEED;
     } else if(dir > 0)
     {
-        ball.speed[0] = BALL_SPEED;
+        ball.bodies->speedX[ball.body] = BALL_SPEED;
     } else {
-        ball.speed[0] = 0;
+        ball.bodies->speedX[ball.body] = 0;
     }
 }
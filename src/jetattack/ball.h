@@ -1,9 +1,11 @@
 #ifndef BALL_INCLUDED
 #define BALL_INCLUDED
 
-void Ball_init();
-void Ball_update(float deltaTime);
-void Ball_draw(mat4 *view, mat4 *projection);
+#include "integrate.h"
+
+void Ball_init(Bodies *bodies);
+void Ball_draw(mat4 *view, mat4 *projection, mat4 *models);
 void Ball_setDir(int dir);
+int Ball_getBody();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,602 @@
+#include <float.h>
+#include <SDL2/SDL.h>
+
+#include "heightfield.h"
+
+#define STACK_SIZE (4 * HEIGHTFIELD_MAX_LEVELS)
+#define MAX_TILE_STEPS 1024 // a ray longer than this many tiles is cut short
+
+typedef struct NodeRange
+{
+    int level, i, j;
+    float tNear, tFar;
+} NodeRange;
+
+void Heightfield_init(Heightfield *field, int cells, float cellSize)
+{
+    SDL_memset(field, 0, sizeof(Heightfield));
+    field->cells = cells;
+    field->cellSize = cellSize;
+    field->heights = SDL_malloc((cells + 1) * (cells + 1) * sizeof(float));
+
+    int nodes = 0;
+    for (int side = cells; side >= 1 && field->levels < HEIGHTFIELD_MAX_LEVELS; side /= 2)
+    {
+        field->levelOffsets[field->levels++] = nodes;
+        nodes += side * side;
+    }
+    field->bounds = SDL_malloc(nodes * 2 * sizeof(float));
+}
+
+void Heightfield_free(Heightfield *field)
+{
+    SDL_free(field->heights);
+    SDL_free(field->bounds);
+    SDL_memset(field, 0, sizeof(Heightfield));
+}
+
+static float *nodeBounds(const Heightfield *field, int level, int i, int j)
+{
+    return &field->bounds[(field->levelOffsets[level] + j * (field->cells >> level) + i) * 2];
+}
+
+void Heightfield_build(Heightfield *field, float originX, float originZ)
+{
+    field->originX = originX;
+    field->originZ = originZ;
+
+    // a bilinear cell never leaves the range of its corners
+    int stride = field->cells + 1;
+    for (int j = 0; j < field->cells; j++)
+    {
+        for (int i = 0; i < field->cells; i++)
+        {
+            const float *row0 = &field->heights[j * stride + i];
+            const float *row1 = row0 + stride;
+            float *bounds = nodeBounds(field, 0, i, j);
+            bounds[0] = glm_min(glm_min(row0[0], row0[1]), glm_min(row1[0], row1[1]));
+            bounds[1] = glm_max(glm_max(row0[0], row0[1]), glm_max(row1[0], row1[1]));
+        }
+    }
+
+    for (int level = 1; level < field->levels; level++)
+    {
+        int side = field->cells >> level;
+        for (int j = 0; j < side; j++)
+        {
+            for (int i = 0; i < side; i++)
+            {
+                float *bounds = nodeBounds(field, level, i, j);
+                bounds[0] = FLT_MAX;
+                bounds[1] = -FLT_MAX;
+                for (int q = 0; q < 4; q++)
+                {
+                    const float *child = nodeBounds(field, level - 1, i * 2 + (q & 1), j * 2 + (q >> 1));
+                    bounds[0] = glm_min(bounds[0], child[0]);
+                    bounds[1] = glm_max(bounds[1], child[1]);
+                }
+            }
+        }
+    }
+}
+
+// cell under (x, z) and the position inside it, clamped to the field
+static const float *cellAt(const Heightfield *field, float x, float z, float *u, float *v)
+{
+    float cellX = glm_clamp((x - field->originX) / field->cellSize, 0.0f, (float)field->cells);
+    float cellZ = glm_clamp((z - field->originZ) / field->cellSize, 0.0f, (float)field->cells);
+    int i = SDL_min((int)cellX, field->cells - 1);
+    int j = SDL_min((int)cellZ, field->cells - 1);
+
+    *u = cellX - i;
+    *v = cellZ - j;
+    return &field->heights[j * (field->cells + 1) + i];
+}
+
+float Heightfield_heightAt(const Heightfield *field, float x, float z)
+{
+    float u, v;
+    const float *row0 = cellAt(field, x, z, &u, &v);
+    const float *row1 = row0 + field->cells + 1;
+    return glm_lerp(glm_lerp(row0[0], row0[1], u), glm_lerp(row1[0], row1[1], u), v);
+}
+
+static void normalAt(const Heightfield *field, float x, float z, vec3 normal)
+{
+    float u, v;
+    const float *row0 = cellAt(field, x, z, &u, &v);
+    const float *row1 = row0 + field->cells + 1;
+
+    float slopeX = glm_lerp(row0[1] - row0[0], row1[1] - row1[0], v) / field->cellSize;
+    float slopeZ = glm_lerp(row1[0] - row0[0], row1[1] - row0[1], u) / field->cellSize;
+    glm_vec3_copy((vec3){-slopeX, 1.0f, -slopeZ}, normal);
+    glm_vec3_normalize(normal);
+}
+
+static void rayInverse(vec3 direction, vec3 inverse)
+{
+    for (int axis = 0; axis < 3; axis++)
+        inverse[axis] = 1.0f / (fabsf(direction[axis]) > 1e-20f ? direction[axis] : copysignf(1e-20f, direction[axis]));
+}
+
+// the part of [tStart, tEnd] the ray spends above the node's square
+static bool nodeRange(const Heightfield *field, NodeRange *node, vec3 origin, vec3 inverse, float tStart, float tEnd)
+{
+    float size = field->cellSize * (float)(1 << node->level);
+    float x0 = field->originX + node->i * size, z0 = field->originZ + node->j * size;
+
+    float tx0 = (x0 - origin[0]) * inverse[0], tx1 = (x0 + size - origin[0]) * inverse[0];
+    float tz0 = (z0 - origin[2]) * inverse[2], tz1 = (z0 + size - origin[2]) * inverse[2];
+    node->tNear = glm_max(tStart, glm_max(glm_min(tx0, tx1), glm_min(tz0, tz1)));
+    node->tFar = glm_min(tEnd, glm_min(glm_max(tx0, tx1), glm_max(tz0, tz1)));
+    return node->tNear <= node->tFar;
+}
+
+// Height above the bilinear surface along the ray is a quadratic in t; the
+// first t in the cell where it reaches zero is the hit.
+static bool cellHit(const Heightfield *field, const NodeRange *cell, vec3 origin, vec3 direction, float *t)
+{
+    const float *row0 = &field->heights[cell->j * (field->cells + 1) + cell->i];
+    const float *row1 = row0 + field->cells + 1;
+    float b = row0[1] - row0[0];
+    float c = row1[0] - row0[0];
+    float d = row0[0] - row0[1] - row1[0] + row1[1];
+
+    // measured from where the ray enters the cell, to keep long rays precise
+    float inverseSize = 1.0f / field->cellSize;
+    float u0 = (origin[0] + cell->tNear * direction[0] - field->originX) * inverseSize - cell->i;
+    float v0 = (origin[2] + cell->tNear * direction[2] - field->originZ) * inverseSize - cell->j;
+    float du = direction[0] * inverseSize, dv = direction[2] * inverseSize;
+
+    float qa = -d * du * dv;
+    float qb = direction[1] - (b * du + c * dv + d * (u0 * dv + v0 * du));
+    float qc = origin[1] + cell->tNear * direction[1] - (row0[0] + b * u0 + c * v0 + d * u0 * v0);
+    if (qc <= 0.0f)
+    {
+        *t = cell->tNear;
+        return true;
+    }
+
+    float s;
+    if (fabsf(qa) < 1e-12f)
+    {
+        if (qb >= 0.0f)
+            return false;
+        s = -qc / qb;
+    }
+    else
+    {
+        float discriminant = qb * qb - 4.0f * qa * qc;
+        if (discriminant < 0.0f)
+            return false;
+
+        float q = -0.5f * (qb + copysignf(sqrtf(discriminant), qb));
+        float r0 = q / qa, r1 = q != 0.0f ? qc / q : r0;
+        if (r0 > r1)
+        {
+            float swap = r0;
+            r0 = r1;
+            r1 = swap;
+        }
+        s = r0 >= 0.0f ? r0 : r1;
+    }
+
+    if (s < 0.0f || s > cell->tFar - cell->tNear)
+        return false;
+
+    *t = cell->tNear + s;
+    return true;
+}
+
+// Nodes are visited nearest first, so the first cell hit is the hit.
+static bool raycastRange(const Heightfield *field, vec3 origin, vec3 direction, vec3 inverse, float tStart, float tEnd, HeightfieldHit *hit)
+{
+    NodeRange stack[STACK_SIZE];
+    stack[0] = (NodeRange){field->levels - 1, 0, 0};
+    if (!nodeRange(field, &stack[0], origin, inverse, tStart, tEnd))
+        return false;
+
+    int top = 1;
+
+    while (top > 0)
+    {
+        NodeRange node = stack[--top];
+
+        const float *bounds = nodeBounds(field, node.level, node.i, node.j);
+        float lowest = origin[1] + direction[1] * (direction[1] < 0.0f ? node.tFar : node.tNear);
+        if (lowest > bounds[1])
+            continue;
+
+        if (node.level == 0)
+        {
+            float t;
+            if (!cellHit(field, &node, origin, direction, &t))
+                continue;
+
+            hit->t = t;
+            glm_vec3_copy(origin, hit->position);
+            glm_vec3_muladds(direction, t, hit->position);
+            normalAt(field, hit->position[0], hit->position[2], hit->normal);
+            return true;
+        }
+
+        NodeRange children[4];
+        int count = 0;
+        for (int q = 0; q < 4; q++)
+        {
+            NodeRange child = {node.level - 1, node.i * 2 + (q & 1), node.j * 2 + (q >> 1)};
+            if (!nodeRange(field, &child, origin, inverse, node.tNear, node.tFar))
+                continue;
+
+            // insertion sort, farthest first
+            int slot = count++;
+            while (slot > 0 && children[slot - 1].tNear < child.tNear)
+            {
+                children[slot] = children[slot - 1];
+                slot--;
+            }
+            children[slot] = child;
+        }
+
+        for (int c = 0; c < count && top < STACK_SIZE; c++)
+            stack[top++] = children[c];
+    }
+
+    return false;
+}
+
+bool Heightfield_raycast(const Heightfield *field, vec3 origin, vec3 direction, float maxT, HeightfieldHit *hit)
+{
+    vec3 inverse;
+    rayInverse(direction, inverse);
+    return raycastRange(field, origin, direction, inverse, 0.0f, maxT, hit);
+}
+
+typedef struct CellSphere
+{
+    const float *row0, *row1; // the cell's corner heights
+    float x0, z0, size;
+    const float *center;
+    float radius2;
+
+    float depth; // deepest so far, at x, z
+    float x, z;
+    bool deeper;
+} CellSphere;
+
+// how far the surface at x, z rises above the sphere's underside there
+static void cellCandidate(CellSphere *cell, float x, float z)
+{
+    float dx = x - cell->center[0], dz = z - cell->center[2];
+    float reach2 = cell->radius2 - dx * dx - dz * dz;
+    if (reach2 <= 0.0f)
+        return;
+
+    float u = (x - cell->x0) / cell->size, v = (z - cell->z0) / cell->size;
+    float height = glm_lerp(glm_lerp(cell->row0[0], cell->row0[1], u), glm_lerp(cell->row1[0], cell->row1[1], u), v);
+    float depth = height - (cell->center[1] - sqrtf(reach2));
+    if (depth <= cell->depth)
+        return;
+
+    cell->depth = depth;
+    cell->x = x;
+    cell->z = z;
+    cell->deeper = true;
+}
+
+// The surface is linear along an edge and the sphere's underside is concave,
+// so the deepest point of the edge is the line's peak clamped to the part of
+// the edge under the sphere.
+static void edgeCandidate(CellSphere *cell, bool alongX, float fixed)
+{
+    int axis = alongX ? 0 : 2;
+    float offset = fixed - cell->center[alongX ? 2 : 0];
+    float reach2 = cell->radius2 - offset * offset;
+    if (reach2 <= 0.0f)
+        return;
+
+    float reach = sqrtf(reach2);
+    float start = alongX ? cell->x0 : cell->z0;
+    float low = glm_max(start, cell->center[axis] - reach);
+    float high = glm_min(start + cell->size, cell->center[axis] + reach);
+    if (low > high)
+        return;
+
+    float t = alongX ? (fixed - cell->z0) / cell->size : (fixed - cell->x0) / cell->size;
+    float slope = alongX ? glm_lerp(cell->row0[1] - cell->row0[0], cell->row1[1] - cell->row1[0], t) / cell->size
+                         : glm_lerp(cell->row1[0] - cell->row0[0], cell->row1[1] - cell->row0[1], t) / cell->size;
+    float peak = glm_clamp(cell->center[axis] + slope * reach / sqrtf(1.0f + slope * slope), low, high);
+
+    if (alongX)
+        cellCandidate(cell, peak, fixed);
+    else
+        cellCandidate(cell, fixed, peak);
+}
+
+// Inside the cell the surface is h = h00 + a x + b z + d x z. With s =
+// sqrt(r^2 - dx^2 - dz^2), how far the sphere's underside hangs below its
+// center at dx, dz from it, a stationary point of the depth has
+//   dx = s (B + s d C) / q, dz = s (C + s d B) / q, q = 1 - s^2 d^2
+// for B, C the surface slopes along the sphere's center lines, and
+// s^2 + dx^2 + dz^2 = r^2 becomes a polynomial of degree 6 in s. Every root
+// in [0, r] gives a candidate point.
+#define SPHERE_POLY_DEGREE 6
+#define SPHERE_BISECTIONS 40
+
+static double polyValue(const double *c, int degree, double s)
+{
+    double value = c[degree];
+    for (int k = degree - 1; k >= 0; k--)
+        value = value * s + c[k];
+    return value;
+}
+
+// Real roots in [low, high], ascending. The derivative's roots split the
+// range into pieces where the polynomial is monotonic, so each sign change
+// between them is exactly one root, however close the roots are.
+static int polyRoots(const double *c, int degree, double low, double high, double *roots)
+{
+    while (degree > 0 && c[degree] == 0.0)
+        degree--;
+
+    if (degree == 0)
+        return 0;
+
+    if (degree == 1)
+    {
+        double root = -c[0] / c[1];
+        if (root < low || root > high)
+            return 0;
+
+        roots[0] = root;
+        return 1;
+    }
+
+    double derivative[SPHERE_POLY_DEGREE];
+    for (int k = 1; k <= degree; k++)
+        derivative[k - 1] = k * c[k];
+
+    double breaks[SPHERE_POLY_DEGREE + 1];
+    int breakCount = polyRoots(derivative, degree - 1, low, high, breaks + 1) + 2;
+    breaks[0] = low;
+    breaks[breakCount - 1] = high;
+
+    int count = 0;
+    for (int b = 0; b + 1 < breakCount; b++)
+    {
+        double start = breaks[b], end = breaks[b + 1];
+        bool startNegative = polyValue(c, degree, start) < 0.0;
+        if (startNegative == (polyValue(c, degree, end) < 0.0))
+            continue;
+
+        for (int i = 0; i < SPHERE_BISECTIONS; i++)
+        {
+            double middle = 0.5 * (start + end);
+            if ((polyValue(c, degree, middle) < 0.0) == startNegative)
+                start = middle;
+            else
+                end = middle;
+        }
+        roots[count++] = 0.5 * (start + end);
+    }
+
+    return count;
+}
+
+static void stationaryCandidates(CellSphere *cell, float radius)
+{
+    double size = cell->size;
+    double twist = (cell->row0[0] - cell->row0[1] - cell->row1[0] + cell->row1[1]) / (size * size);
+    double slopeX = (cell->row0[1] - cell->row0[0]) / size + twist * (cell->center[2] - cell->z0);
+    double slopeZ = (cell->row1[0] - cell->row0[0]) / size + twist * (cell->center[0] - cell->x0);
+
+    double twist2 = twist * twist, slope2 = slopeX * slopeX + slopeZ * slopeZ, radius2 = cell->radius2;
+    double c[SPHERE_POLY_DEGREE + 1] = {
+        -radius2,
+        0.0,
+        1.0 + slope2 + 2.0 * radius2 * twist2,
+        4.0 * twist * slopeX * slopeZ,
+        twist2 * (slope2 - 2.0) - radius2 * twist2 * twist2,
+        0.0,
+        twist2 * twist2};
+
+    double roots[SPHERE_POLY_DEGREE];
+    int count = polyRoots(c, SPHERE_POLY_DEGREE, 0.0, radius, roots);
+    for (int r = 0; r < count; r++)
+    {
+        double s = roots[r];
+        double q = 1.0 - s * s * twist2;
+        if (fabs(q) < 1e-9)
+            continue;
+
+        float x = (float)(cell->center[0] + s * (slopeX + s * twist * slopeZ) / q);
+        float z = (float)(cell->center[2] + s * (slopeZ + s * twist * slopeX) / q);
+        if (x >= cell->x0 && x <= cell->x0 + cell->size && z >= cell->z0 && z <= cell->z0 + cell->size)
+            cellCandidate(cell, x, z);
+    }
+}
+
+// The deepest point is on an edge or at a stationary point inside, so taking
+// the deepest of all of those is exact. Returns true when it found a deeper
+// contact; the normal is left to the caller.
+static bool sphereCell(const Heightfield *field, int i, int j, vec3 center, float radius, HeightfieldContact *contact)
+{
+    CellSphere cell = {0};
+    cell.row0 = &field->heights[j * (field->cells + 1) + i];
+    cell.row1 = cell.row0 + field->cells + 1;
+    cell.size = field->cellSize;
+    cell.x0 = field->originX + i * cell.size;
+    cell.z0 = field->originZ + j * cell.size;
+    cell.center = center;
+    cell.radius2 = radius * radius;
+    cell.depth = contact->depth;
+
+    // bilinear heights peak at a corner and the underside is lowest at the
+    // cell's point nearest the center, which bounds anything this cell can add
+    float nearX = glm_clamp(center[0], cell.x0, cell.x0 + cell.size) - center[0];
+    float nearZ = glm_clamp(center[2], cell.z0, cell.z0 + cell.size) - center[2];
+    float reach2 = cell.radius2 - nearX * nearX - nearZ * nearZ;
+    float highest = glm_max(glm_max(cell.row0[0], cell.row0[1]), glm_max(cell.row1[0], cell.row1[1]));
+    if (reach2 <= 0.0f || highest - (center[1] - sqrtf(reach2)) <= cell.depth)
+        return false;
+
+    edgeCandidate(&cell, true, cell.z0);
+    edgeCandidate(&cell, true, cell.z0 + cell.size);
+    edgeCandidate(&cell, false, cell.x0);
+    edgeCandidate(&cell, false, cell.x0 + cell.size);
+
+    stationaryCandidates(&cell, radius);
+
+    if (!cell.deeper)
+        return false;
+
+    contact->depth = cell.depth;
+    float u = (cell.x - cell.x0) / cell.size, v = (cell.z - cell.z0) / cell.size;
+    float height = glm_lerp(glm_lerp(cell.row0[0], cell.row0[1], u), glm_lerp(cell.row1[0], cell.row1[1], u), v);
+    glm_vec3_copy((vec3){cell.x, height, cell.z}, contact->position);
+    return true;
+}
+
+// deepest contact so far in contact, depth 0 for none; true when this field made it deeper
+static bool sphereField(const Heightfield *field, vec3 center, float radius, HeightfieldContact *contact)
+{
+    // cells under the sphere's square
+    int i0 = (int)floorf((center[0] - radius - field->originX) / field->cellSize);
+    int i1 = (int)floorf((center[0] + radius - field->originX) / field->cellSize);
+    int j0 = (int)floorf((center[2] - radius - field->originZ) / field->cellSize);
+    int j1 = (int)floorf((center[2] + radius - field->originZ) / field->cellSize);
+    if (i1 < 0 || j1 < 0 || i0 >= field->cells || j0 >= field->cells)
+        return false;
+
+    float bottom = center[1] - radius;
+    bool deeper = false;
+    NodeRange stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = (NodeRange){field->levels - 1, 0, 0};
+
+    while (top > 0)
+    {
+        NodeRange node = stack[--top];
+        int first = 1 << node.level;
+        if ((node.i + 1) * first <= i0 || node.i * first > i1 || (node.j + 1) * first <= j0 || node.j * first > j1)
+            continue;
+
+        if (nodeBounds(field, node.level, node.i, node.j)[1] <= bottom + contact->depth)
+            continue;
+
+        if (node.level == 0)
+        {
+            deeper |= sphereCell(field, node.i, node.j, center, radius, contact);
+            continue;
+        }
+
+        for (int q = 0; q < 4 && top < STACK_SIZE; q++)
+            stack[top++] = (NodeRange){node.level - 1, node.i * 2 + (q & 1), node.j * 2 + (q >> 1)};
+    }
+
+    return deeper;
+}
+
+bool Heightfield_sphere(const Heightfield *field, vec3 center, float radius, HeightfieldContact *contact)
+{
+    contact->depth = 0.0f;
+    if (!sphereField(field, center, radius, contact))
+        return false;
+
+    normalAt(field, contact->position[0], contact->position[2], contact->normal);
+    return true;
+}
+
+bool Heightfield_raycastTiles(const HeightfieldTiles *tiles, vec3 origin, vec3 direction, float maxT, HeightfieldHit *hit)
+{
+    // only the stretch between the highest and lowest heights can hit; under
+    // the lowest a ray is already underground, so the walk ends there
+    float tStart = 0.0f, tEnd = maxT;
+    if (direction[1] < 0.0f)
+    {
+        tStart = glm_max(tStart, (tiles->maxHeight - origin[1]) / direction[1]);
+        tEnd = glm_min(tEnd, glm_max((tiles->minHeight - origin[1]) / direction[1], tStart));
+    }
+    else if (direction[1] > 0.0f)
+    {
+        tEnd = glm_min(tEnd, (tiles->maxHeight - origin[1]) / direction[1]);
+    }
+    else if (origin[1] > tiles->maxHeight)
+    {
+        return false;
+    }
+
+    if (tStart > tEnd)
+        return false;
+
+    vec3 inverse;
+    rayInverse(direction, inverse);
+
+    float size = tiles->tileSize;
+    int tileX = (int)floorf((origin[0] + tStart * direction[0]) / size);
+    int tileZ = (int)floorf((origin[2] + tStart * direction[2]) / size);
+    int stepX = direction[0] > 0.0f ? 1 : -1;
+    int stepZ = direction[2] > 0.0f ? 1 : -1;
+
+    // t at the next tile edge on each axis, and between edges
+    float nextX = direction[0] != 0.0f ? ((tileX + (stepX > 0)) * size - origin[0]) / direction[0] : FLT_MAX;
+    float nextZ = direction[2] != 0.0f ? ((tileZ + (stepZ > 0)) * size - origin[2]) / direction[2] : FLT_MAX;
+    float deltaX = direction[0] != 0.0f ? size / fabsf(direction[0]) : FLT_MAX;
+    float deltaZ = direction[2] != 0.0f ? size / fabsf(direction[2]) : FLT_MAX;
+
+    float t = tStart;
+    for (int step = 0; step < MAX_TILE_STEPS; step++)
+    {
+        float exit = glm_min(tEnd, glm_min(nextX, nextZ));
+        const Heightfield *field = tiles->lookup(tiles->data, tileX, tileZ);
+        if (field && raycastRange(field, origin, direction, inverse, t, exit, hit))
+            return true;
+
+        if (exit >= tEnd)
+            break;
+
+        if (nextX < nextZ)
+        {
+            tileX += stepX;
+            t = nextX;
+            nextX += deltaX;
+        }
+        else
+        {
+            tileZ += stepZ;
+            t = nextZ;
+            nextZ += deltaZ;
+        }
+    }
+
+    return false;
+}
+
+bool Heightfield_sphereTiles(const HeightfieldTiles *tiles, vec3 center, float radius, HeightfieldContact *contact)
+{
+    contact->depth = 0.0f;
+    if (center[1] - radius >= tiles->maxHeight)
+        return false;
+
+    int x0 = (int)floorf((center[0] - radius) / tiles->tileSize);
+    int x1 = (int)floorf((center[0] + radius) / tiles->tileSize);
+    int z0 = (int)floorf((center[2] - radius) / tiles->tileSize);
+    int z1 = (int)floorf((center[2] + radius) / tiles->tileSize);
+
+    const Heightfield *deepest = NULL;
+    for (int tileZ = z0; tileZ <= z1; tileZ++)
+    {
+        for (int tileX = x0; tileX <= x1; tileX++)
+        {
+            const Heightfield *field = tiles->lookup(tiles->data, tileX, tileZ);
+            if (field && sphereField(field, center, radius, contact))
+                deepest = field;
+        }
+    }
+
+    if (!deepest)
+        return false;
+
+    normalAt(deepest, contact->position[0], contact->position[2], contact->normal);
+    return true;
+}
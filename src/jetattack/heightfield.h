@@ -0,0 +1,70 @@
+#ifndef HEIGHTFIELD_INCLUDED
+#define HEIGHTFIELD_INCLUDED
+
+#include <stdbool.h>
+#include "cglm/cglm.h"
+
+// Collision queries straight from a height grid, no triangles. The surface
+// is bilinear between samples, the way the heightmap texture filters it.
+// Every field keeps a min-max mip: level 0 bounds each cell, each level up
+// bounds 2x2 nodes of the one below, so rays and spheres skip everything
+// they pass above at the coarsest level that shows it.
+#define HEIGHTFIELD_MAX_LEVELS 12
+
+typedef struct Heightfield
+{
+    int cells; // per side, a power of two
+    float cellSize;
+    float originX, originZ;
+
+    float *heights; // (cells + 1)^2, rows along z, filled by the caller
+    float *bounds;  // min and max per node, level 0 first
+    int levels;
+    int levelOffsets[HEIGHTFIELD_MAX_LEVELS];
+} Heightfield;
+
+typedef struct HeightfieldHit
+{
+    float t; // in units of the query's direction
+    vec3 position;
+    vec3 normal;
+} HeightfieldHit;
+
+typedef struct HeightfieldContact
+{
+    float depth; // how far the sphere must rise to clear the surface
+    vec3 position;
+    vec3 normal;
+} HeightfieldContact;
+
+// A field per square tile of tileSize, fields covering exactly their tile.
+// lookup returns NULL for a tile that has no field, which is never hit.
+typedef const Heightfield *(*HeightfieldLookup)(void *data, int tileX, int tileZ);
+
+typedef struct HeightfieldTiles
+{
+    HeightfieldLookup lookup;
+    void *data;
+    float tileSize;
+    float minHeight, maxHeight; // bound every field
+} HeightfieldTiles;
+
+void Heightfield_init(Heightfield *field, int cells, float cellSize);
+void Heightfield_free(Heightfield *field);
+
+// Places the field and rebuilds its min-max mip from the heights.
+void Heightfield_build(Heightfield *field, float originX, float originZ);
+
+float Heightfield_heightAt(const Heightfield *field, float x, float z);
+
+// First point along origin + t * direction, 0 <= t <= maxT, at or below the
+// surface; a ray starting underground hits at once.
+bool Heightfield_raycast(const Heightfield *field, vec3 origin, vec3 direction, float maxT, HeightfieldHit *hit);
+bool Heightfield_sphere(const Heightfield *field, vec3 center, float radius, HeightfieldContact *contact);
+
+// The same across tiles: rays walk the tiles they cross with a 2D DDA,
+// spheres check the few tiles under them.
+bool Heightfield_raycastTiles(const HeightfieldTiles *tiles, vec3 origin, vec3 direction, float maxT, HeightfieldHit *hit);
+bool Heightfield_sphereTiles(const HeightfieldTiles *tiles, vec3 center, float radius, HeightfieldContact *contact);
+
+#endif
@@ -1,9 +1,19 @@
 #include <stdbool.h>
+#include <float.h>
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include "cglm/cglm.h"
 
-#include "paddle.h"
+#include "framearena.h"
+#include "glstate.h"
+#include "integrate.h"
+#include "job.h"
+#include "cpuparticles.h"
+#include "occlusion.h"
+#include "particles.h"
+#include "triplebuffer.h"
+#include "terrain.h"
+#include "ball.h"
 
 #define TARGET_FPS 6000
 #define MS_PER_FRAME 1000 / TARGET_FPS
@@ -11,11 +21,47 @@
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
 
+#define MAX_BODIES 64
+#define SIM_HZ 120
+#define TERRAIN_SEED 1337
+#define FRAME_ARENA_SIZE (1 << 20)
+#define JET_RADIUS 1.0f
+#define EXHAUST_PARTICLES (1 << 20)
+#define EXHAUST_RATE 300000.0f
+#define EXHAUST_SPREAD 3.0f
+#define EXHAUST_LIFETIME 3.0f
+#define EXHAUST_SIZE 0.15f
+
 bool isRunning = false;
 static SDL_Window *window;
 static SDL_Renderer *renderer;
 static SDL_GLContext *context;
 
+static Bodies bodies;
+static FrameArena frameArena;
+static ParticleSystem particles;
+static CpuParticles cpuParticles; // instead of particles under software GL
+// the jet flies toward -Z forever; only its sideways drift is bounded
+static Playfield playfield = {
+    {-80.0f, 0.0f, -FLT_MAX},
+    {80.0f, 40.0f, FLT_MAX}};
+
+// Everything the renderer needs from one simulation step. With --threaded
+// the simulation owns `bodies` and only hands these over through a triple
+// buffer, so the GL thread never touches simulation state.
+typedef struct Snapshot
+{
+    Uint64 tick;
+    int bodyCount;
+    mat4 models[MAX_BODIES];
+    vec3 jetPosition;
+    float groundClearance; // below the jet, negative over ungenerated ground
+} Snapshot;
+
+static TripleBuffer snapshots;
+static SDL_atomic_t jetDir;
+static SDL_atomic_t simRunning;
+
 int init()
 {
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS | SDL_INIT_GAMECONTROLLER) != 0)
@@ -47,12 +93,110 @@ int init()
     }
 
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    GLState_enable(GL_DEPTH_TEST);
 
     isRunning = true;
 }
 
-int main()
+// Body updates and model matrices are independent per body, so both run as
+// parallel-for ranges; grains are multiples of 8 to keep the AVX path whole.
+static void updateBodies(void *data, int start, int end)
+{
+    float deltaTime = *(float *)data;
+    Integrate_range(&bodies, start, end, deltaTime, &playfield);
+}
+
+static void buildModels(void *data, int start, int end)
+{
+    mat4 *models = data;
+    for (int i = start; i < end; i++)
+    {
+        glm_translate_make(models[i], (vec3){bodies.positionX[i], bodies.positionY[i], bodies.positionZ[i]});
+    }
+}
+
+static void simulate(float deltaTime, Snapshot *snapshot)
+{
+    Ball_setDir(SDL_AtomicGet(&jetDir));
+
+    Job_parallelFor(bodies.count, 256, updateBodies, &deltaTime);
+
+    // the ground pushes the jet back up and stops it sinking further
+    int jet = Ball_getBody();
+    HeightfieldContact contact;
+    if (Terrain_sphere((vec3){bodies.positionX[jet], bodies.positionY[jet], bodies.positionZ[jet]}, JET_RADIUS, &contact))
+    {
+        bodies.positionY[jet] += contact.depth;
+        bodies.speedY[jet] = glm_max(bodies.speedY[jet], 0.0f);
+    }
+
+    Job_parallelFor(bodies.count, 64, buildModels, snapshot->models);
+
+    snapshot->bodyCount = bodies.count;
+
+    snapshot->jetPosition[0] = bodies.positionX[jet];
+    snapshot->jetPosition[1] = bodies.positionY[jet];
+    snapshot->jetPosition[2] = bodies.positionZ[jet];
+
+    HeightfieldHit ground;
+    snapshot->groundClearance = Terrain_raycast(snapshot->jetPosition, (vec3){0.0f, -1.0f, 0.0f}, 100.0f, &ground) ? ground.t : -1.0f;
+}
+
+// Fixed-rate simulation loop used by --threaded. It submits jobs alongside the
+// main thread, which keeps submitting occlusion, CPU particle and terrain jobs;
+// each submitting thread pushes to its own deque.
+static int simulationMain(void *data)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 ticksPerStep = frequency / SIM_HZ;
+    Uint64 prev = SDL_GetPerformanceCounter();
+    Uint64 tick = 0;
+
+    while (SDL_AtomicGet(&simRunning))
+    {
+        Uint64 now = SDL_GetPerformanceCounter();
+        float deltaTime = (float)(now - prev) / (float)frequency;
+        prev = now;
+
+        Snapshot *snapshot = TripleBuffer_writeSlot(&snapshots);
+        simulate(deltaTime, snapshot);
+        snapshot->tick = ++tick;
+        TripleBuffer_publish(&snapshots);
+
+        Uint64 elapsed = SDL_GetPerformanceCounter() - now;
+        if (elapsed < ticksPerStep)
+            SDL_Delay((Uint32)((ticksPerStep - elapsed) * 1000 / frequency));
+    }
+
+    return 0;
+}
+
+static int readJetDir()
 {
+    int arrayLen;
+    const Uint8 *keyStates = SDL_GetKeyboardState(&arrayLen);
+    if(keyStates[SDL_SCANCODE_LEFT] && keyStates[SDL_SCANCODE_RIGHT]) {
+        return 0;
+    } else if(keyStates[SDL_SCANCODE_LEFT]) {
+        return -1;
+    } else if(keyStates[SDL_SCANCODE_RIGHT]) {
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    bool threaded = false;
+    bool cpuExhaust = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (SDL_strcmp(argv[i], "--threaded") == 0)
+            threaded = true;
+        else if (SDL_strcmp(argv[i], "--cpu-particles") == 0)
+            cpuExhaust = true;
+    }
+
     if (init() != 0)
     {
         return 1;
@@ -63,11 +207,73 @@ int main()
     glm_mat4_identity(view);
     glm_mat4_identity(projection);
 
-    glm_perspective(glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f, projection);
-    glm_translate(view, (vec3){0.0f, 0.0f, -50.0f});
+    glm_perspective(glm_rad(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 300.0f, projection);
+
+    Job_init(0);
+    FrameArena_init(&frameArena, FRAME_ARENA_SIZE);
+    Occlusion_init();
+    Bodies_init(&bodies, MAX_BODIES);
 
-    Paddle_init();
-    Ball_init();
+    Terrain_init(TERRAIN_SEED);
+    Ball_init(&bodies);
+
+    // software GL runs transform feedback on the CPU as well, far slower
+    // than simulating the particles there directly
+    const char *glRenderer = (const char *)glGetString(GL_RENDERER);
+    if (glRenderer && SDL_strstr(glRenderer, "llvmpipe"))
+        cpuExhaust = true;
+
+    // exhaust streams back from the jet and bounces off the ground plane; at
+    // this rate and lifetime nearly every slot is alive at once
+    vec3 exhaustVelocity = {0.0f, 1.0f, 12.0f};
+    vec4 exhaustColor = {1.0f, 0.55f, 0.2f, 0.6f};
+    vec4 groundPlane = {0.0f, 1.0f, 0.0f, 0.0f};
+    int exhaust = -1;
+    float exhaustOwed = 0.0f;
+    if (cpuExhaust)
+    {
+        // half the GPU's particles, so the CPU keeps up
+        CpuParticles_init(&cpuParticles, EXHAUST_PARTICLES / 2);
+        CpuParticles_initDrawing(&cpuParticles);
+        glm_vec4_copy(exhaustColor, cpuParticles.color);
+        glm_vec4_copy(groundPlane, cpuParticles.plane);
+        cpuParticles.size = EXHAUST_SIZE;
+        SDL_Log("particles: simulating the exhaust on the CPU (%s)", CpuParticles_pathName(CpuParticles_getPath()));
+    }
+    else
+    {
+        Particles_init(&particles, EXHAUST_PARTICLES);
+        exhaust = Particles_addEmitter(&particles, EXHAUST_PARTICLES);
+        if (exhaust >= 0)
+        {
+            ParticleEmitter *emitter = &particles.emitters[exhaust];
+            glm_vec3_copy(exhaustVelocity, emitter->velocity);
+            emitter->spread = EXHAUST_SPREAD;
+            emitter->lifetime = EXHAUST_LIFETIME;
+            emitter->rate = EXHAUST_RATE;
+            emitter->size = EXHAUST_SIZE;
+            glm_vec4_copy(exhaustColor, emitter->color);
+        }
+        glm_vec4_copy(groundPlane, particles.plane);
+    }
+
+    TripleBuffer_init(&snapshots, sizeof(Snapshot));
+
+    SDL_Thread *simulationThread = NULL;
+    if (threaded)
+    {
+        SDL_AtomicSet(&simRunning, 1);
+        simulationThread = SDL_CreateThread(simulationMain, "simulation", NULL);
+        if (!simulationThread)
+        {
+            SDL_Log("Error creating simulation thread: %s", SDL_GetError());
+            threaded = false;
+        }
+    }
+
+    // single-threaded mode simulates straight into this snapshot
+    Snapshot *localSnapshot = SDL_calloc(1, sizeof(Snapshot));
+    const Snapshot *snapshot = NULL;
 
     Uint64 msPrevFrame = 0;
     int frameCount = 0;
@@ -111,29 +317,119 @@ int main()
 
         SDL_PumpEvents();
 
-        int arrayLen;
-        Uint8* keyStates = SDL_GetKeyboardState(&arrayLen);
-        if(keyStates[SDL_SCANCODE_LEFT] && keyStates[SDL_SCANCODE_RIGHT]) {
-            Paddle_setDir(0);
-        } else if(keyStates[SDL_SCANCODE_LEFT]) {
-            Paddle_setDir(-1);
-        } else if(keyStates[SDL_SCANCODE_RIGHT]) {
-            Paddle_setDir(1);
-        } else {
-            Paddle_setDir(0);
-        }
+        SDL_AtomicSet(&jetDir, readJetDir());
 
-        Paddle_update(deltaTime);
-        Ball_update(deltaTime);
+        if (threaded)
+        {
+            // keep drawing the previous snapshot until a newer one is published
+            if (TripleBuffer_acquire(&snapshots))
+                snapshot = TripleBuffer_readSlot(&snapshots);
+        }
+        else
+        {
+            simulate(deltaTime, localSnapshot);
+            localSnapshot->tick++;
+            snapshot = localSnapshot;
+        }
 
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        Paddle_draw(&view, &projection);
-        Ball_draw(&view, &projection);
+        if (snapshot)
+        {
+            // chase camera behind and above the jet
+            vec3 eye, center;
+            glm_vec3_add((float *)snapshot->jetPosition, (vec3){0.0f, 8.0f, 20.0f}, eye);
+            glm_vec3_add((float *)snapshot->jetPosition, (vec3){0.0f, 0.0f, -30.0f}, center);
+            glm_lookat(eye, center, (vec3){0.0f, 1.0f, 0.0f}, view);
+
+            Terrain_update((float *)snapshot->jetPosition);
+
+            // terrain hides terrain: rasterize the resident chunks before selecting nodes
+            mat4 viewProjection;
+            glm_mat4_mul(projection, view, viewProjection);
+            Occlusion_begin(viewProjection, &frameArena);
+            Terrain_addOccluders();
+            Occlusion_rasterize();
+
+            Terrain_draw(&view, &projection, eye);
+            Ball_draw(&view, &projection, (mat4 *)snapshot->models);
+
+            if (cpuExhaust)
+            {
+                exhaustOwed += EXHAUST_RATE / 2 * deltaTime;
+                int due = (int)exhaustOwed;
+                exhaustOwed -= due;
+
+                CpuParticles_emit(&cpuParticles, due, (float *)snapshot->jetPosition, exhaustVelocity, EXHAUST_SPREAD, EXHAUST_LIFETIME);
+                CpuParticles_update(&cpuParticles, deltaTime);
+                CpuParticles_draw(&cpuParticles, &view, &projection, WINDOW_HEIGHT);
+            }
+            else
+            {
+                if (exhaust >= 0)
+                    glm_vec3_copy((float *)snapshot->jetPosition, particles.emitters[exhaust].position);
+                Particles_update(&particles, deltaTime);
+                Particles_draw(&particles, &view, &projection, WINDOW_HEIGHT);
+            }
+        }
+
+        GLStateStats glStats = GLState_endFrame();
+        if (++frameCount % 120 == 0)
+        {
+            TerrainStats stats = Terrain_stats();
+            SDL_Log("%.0f fps, terrain: %d/%d nodes visible, %d occluded, %d triangles, select %.3f ms, %d chunks resident",
+                    fps, stats.nodes, stats.tested, stats.occluded, stats.triangles, stats.selectMs, stats.resident);
+
+            OcclusionStats occlusionStats = Occlusion_stats();
+            SDL_Log("occlusion: %d occluder triangles (%d binned), %d/%d boxes culled, setup %.3f ms, raster %.3f ms",
+                    occlusionStats.triangles, occlusionStats.binned, occlusionStats.culled, occlusionStats.tested,
+                    occlusionStats.setupMs, occlusionStats.rasterMs);
+
+            SDL_Log("gl state: %d calls issued, %d skipped", glStats.issued, glStats.skipped);
+
+            if (cpuExhaust)
+            {
+                CpuParticleStats particleStats = CpuParticles_stats(&cpuParticles);
+                SDL_Log("particles: %d alive, %d spawned, %d died, update %.3f ms, pack %.3f ms, %d overflows",
+                        particleStats.count, particleStats.spawned, particleStats.died, particleStats.updateMs, particleStats.packMs, particleStats.overflows);
+            }
+            else
+            {
+                ParticleStats particleStats = Particles_stats(&particles);
+                SDL_Log("particles: %d slots, %d spawned, update %.3f ms, draw %.3f ms",
+                        particleStats.slots, particleStats.spawned, particleStats.updateMs, particleStats.drawMs);
+            }
+
+            if (snapshot)
+                SDL_Log("jet: %.1f above the ground", snapshot->groundClearance);
+
+            FrameArenaStats arenaStats = FrameArena_stats(&frameArena);
+            SDL_Log("frame arena: %zu bytes used, high water %zu/%zu, %d overflows",
+                    arenaStats.used, arenaStats.highWater, arenaStats.capacity, arenaStats.overflows);
+        }
 
         SDL_GL_SwapWindow(window);
+        FrameArena_reset(&frameArena);
     }
 
+    if (simulationThread)
+    {
+        SDL_AtomicSet(&simRunning, 0);
+        SDL_WaitThread(simulationThread, NULL);
+    }
+
+    if (cpuExhaust)
+        CpuParticles_free(&cpuParticles);
+    else
+        Particles_free(&particles);
+    Terrain_free();
+    Occlusion_free();
+    FrameArena_free(&frameArena);
+    SDL_free(localSnapshot);
+    TripleBuffer_free(&snapshots);
+    Bodies_free(&bodies);
+    Job_shutdown();
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,324 @@
+#include <stdint.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "noise.h"
+
+// The paths only stay bit-identical if nothing fuses a multiply and an add.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NOISE_X86
+#endif
+
+// bring the gradient noises to roughly [-1, 1]
+#define NOISE_PERLIN_SCALE 1.0f
+#define NOISE_SIMPLEX_SCALE 70.0f
+
+typedef void (*NoiseBatchFn)(const NoiseParams *params, const float *x, const float *z, float *out, int count);
+
+static NoiseBatchFn noiseBatchFn = NULL;
+static NoisePath noisePath = NOISE_SCALAR;
+
+static float totalAmplitude(const NoiseParams *params)
+{
+    float total = 0.0f;
+    float amplitude = 1.0f;
+    for (int octave = 0; octave < params->octaves; octave++)
+    {
+        total += amplitude;
+        amplitude *= params->gain;
+    }
+    return total > 0.0f ? total : 1.0f;
+}
+
+// --- scalar -----------------------------------------------------------------
+
+static inline float flipSign(float x, uint32_t bits)
+{
+    union { float f; uint32_t u; } v = {x};
+    v.u ^= bits;
+    return v.f;
+}
+
+static inline float absolute(float x)
+{
+    union { float f; uint32_t u; } v = {x};
+    v.u &= 0x7fffffffU;
+    return v.f;
+}
+
+// same truncate-and-correct floor as the vector paths (valid for |x| < 2^31)
+static inline float floorScalar(float x)
+{
+    float t = (float)(int32_t)x;
+    return t > x ? t - 1.0f : t;
+}
+
+#define NK(name) name##Scalar
+#define NK_TARGET
+#define NK_WIDTH 1
+#define VF float
+#define VI uint32_t
+#define VF_SET1(a) (a)
+#define VF_LOAD(p) (*(p))
+#define VF_STORE(p, a) (*(p) = (a))
+#define VF_ADD(a, b) ((a) + (b))
+#define VF_SUB(a, b) ((a) - (b))
+#define VF_MUL(a, b) ((a) * (b))
+#define VF_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define VF_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define VF_ABS(a) absolute(a)
+#define VF_FLOOR(a) floorScalar(a)
+#define VF_FLIPSIGN(a, bits) flipSign(a, bits)
+#define VF_GT(a, b) ((a) > (b) ? 0xffffffffU : 0U)
+#define VF_TO_VI(a) ((uint32_t)(int32_t)(a))
+#define VI_TO_VF(a) ((float)(int32_t)(a))
+#define VI_SET1(a) ((uint32_t)(a))
+#define VI_ADD(a, b) ((a) + (b))
+#define VI_SUB(a, b) ((a) - (b))
+#define VI_MUL(a, b) ((a) * (b))
+#define VI_AND(a, b) ((a) & (b))
+#define VI_XOR(a, b) ((a) ^ (b))
+#define VI_SRL(a, n) ((a) >> (n))
+#define VI_SLL(a, n) ((a) << (n))
+#include "noise_kernel.h"
+#undef NK
+#undef NK_TARGET
+#undef NK_WIDTH
+#undef VF
+#undef VI
+#undef VF_SET1
+#undef VF_LOAD
+#undef VF_STORE
+#undef VF_ADD
+#undef VF_SUB
+#undef VF_MUL
+#undef VF_MIN
+#undef VF_MAX
+#undef VF_ABS
+#undef VF_FLOOR
+#undef VF_FLIPSIGN
+#undef VF_GT
+#undef VF_TO_VI
+#undef VI_TO_VF
+#undef VI_SET1
+#undef VI_ADD
+#undef VI_SUB
+#undef VI_MUL
+#undef VI_AND
+#undef VI_XOR
+#undef VI_SRL
+#undef VI_SLL
+
+#ifdef NOISE_X86
+// --- SSE2, 4 lanes ----------------------------------------------------------
+
+// SSE2 has no 32-bit low multiply, build it from the two 32x32->64 products
+__attribute__((target("sse2"))) static inline __m128i mulloSSE2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__attribute__((target("sse2"))) static inline __m128 floorSSE2(__m128 x)
+{
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+#define NK(name) name##SSE2
+#define NK_TARGET __attribute__((target("sse2")))
+#define NK_WIDTH 4
+#define VF __m128
+#define VI __m128i
+#define VF_SET1(a) _mm_set1_ps(a)
+#define VF_LOAD(p) _mm_loadu_ps(p)
+#define VF_STORE(p, a) _mm_storeu_ps(p, a)
+#define VF_ADD(a, b) _mm_add_ps(a, b)
+#define VF_SUB(a, b) _mm_sub_ps(a, b)
+#define VF_MUL(a, b) _mm_mul_ps(a, b)
+#define VF_MIN(a, b) _mm_min_ps(a, b)
+#define VF_MAX(a, b) _mm_max_ps(a, b)
+#define VF_ABS(a) _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)))
+#define VF_FLOOR(a) floorSSE2(a)
+#define VF_FLIPSIGN(a, bits) _mm_xor_ps(a, _mm_castsi128_ps(bits))
+#define VF_GT(a, b) _mm_castps_si128(_mm_cmpgt_ps(a, b))
+#define VF_TO_VI(a) _mm_cvttps_epi32(a)
+#define VI_TO_VF(a) _mm_cvtepi32_ps(a)
+#define VI_SET1(a) _mm_set1_epi32((int)(a))
+#define VI_ADD(a, b) _mm_add_epi32(a, b)
+#define VI_SUB(a, b) _mm_sub_epi32(a, b)
+#define VI_MUL(a, b) mulloSSE2(a, b)
+#define VI_AND(a, b) _mm_and_si128(a, b)
+#define VI_XOR(a, b) _mm_xor_si128(a, b)
+#define VI_SRL(a, n) _mm_srli_epi32(a, n)
+#define VI_SLL(a, n) _mm_slli_epi32(a, n)
+#include "noise_kernel.h"
+#undef NK
+#undef NK_TARGET
+#undef NK_WIDTH
+#undef VF
+#undef VI
+#undef VF_SET1
+#undef VF_LOAD
+#undef VF_STORE
+#undef VF_ADD
+#undef VF_SUB
+#undef VF_MUL
+#undef VF_MIN
+#undef VF_MAX
+#undef VF_ABS
+#undef VF_FLOOR
+#undef VF_FLIPSIGN
+#undef VF_GT
+#undef VF_TO_VI
+#undef VI_TO_VF
+#undef VI_SET1
+#undef VI_ADD
+#undef VI_SUB
+#undef VI_MUL
+#undef VI_AND
+#undef VI_XOR
+#undef VI_SRL
+#undef VI_SLL
+
+// --- AVX2, 8 lanes ----------------------------------------------------------
+
+// _mm256_floor_ps would differ from the other paths on -0.0, so floor the same way
+__attribute__((target("avx2"))) static inline __m256 floorAVX2(__m256 x)
+{
+    __m256 t = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(x));
+    return _mm256_sub_ps(t, _mm256_and_ps(_mm256_cmp_ps(t, x, _CMP_GT_OQ), _mm256_set1_ps(1.0f)));
+}
+
+#define NK(name) name##AVX2
+#define NK_TARGET __attribute__((target("avx2")))
+#define NK_WIDTH 8
+#define VF __m256
+#define VI __m256i
+#define VF_SET1(a) _mm256_set1_ps(a)
+#define VF_LOAD(p) _mm256_loadu_ps(p)
+#define VF_STORE(p, a) _mm256_storeu_ps(p, a)
+#define VF_ADD(a, b) _mm256_add_ps(a, b)
+#define VF_SUB(a, b) _mm256_sub_ps(a, b)
+#define VF_MUL(a, b) _mm256_mul_ps(a, b)
+#define VF_MIN(a, b) _mm256_min_ps(a, b)
+#define VF_MAX(a, b) _mm256_max_ps(a, b)
+#define VF_ABS(a) _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)))
+#define VF_FLOOR(a) floorAVX2(a)
+#define VF_FLIPSIGN(a, bits) _mm256_xor_ps(a, _mm256_castsi256_ps(bits))
+#define VF_GT(a, b) _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ))
+#define VF_TO_VI(a) _mm256_cvttps_epi32(a)
+#define VI_TO_VF(a) _mm256_cvtepi32_ps(a)
+#define VI_SET1(a) _mm256_set1_epi32((int)(a))
+#define VI_ADD(a, b) _mm256_add_epi32(a, b)
+#define VI_SUB(a, b) _mm256_sub_epi32(a, b)
+#define VI_MUL(a, b) _mm256_mullo_epi32(a, b)
+#define VI_AND(a, b) _mm256_and_si256(a, b)
+#define VI_XOR(a, b) _mm256_xor_si256(a, b)
+#define VI_SRL(a, n) _mm256_srli_epi32(a, n)
+#define VI_SLL(a, n) _mm256_slli_epi32(a, n)
+#include "noise_kernel.h"
+#undef NK
+#undef NK_TARGET
+#undef NK_WIDTH
+#undef VF
+#undef VI
+#undef VF_SET1
+#undef VF_LOAD
+#undef VF_STORE
+#undef VF_ADD
+#undef VF_SUB
+#undef VF_MUL
+#undef VF_MIN
+#undef VF_MAX
+#undef VF_ABS
+#undef VF_FLOOR
+#undef VF_FLIPSIGN
+#undef VF_GT
+#undef VF_TO_VI
+#undef VI_TO_VF
+#undef VI_SET1
+#undef VI_ADD
+#undef VI_SUB
+#undef VI_MUL
+#undef VI_AND
+#undef VI_XOR
+#undef VI_SRL
+#undef VI_SLL
+#endif
+
+NoisePath Noise_getPath()
+{
+    if (!noiseBatchFn)
+    {
+#ifdef NOISE_X86
+        if (SDL_HasAVX2())
+            Noise_setPath(NOISE_AVX2);
+        else if (SDL_HasSSE2())
+            Noise_setPath(NOISE_SSE2);
+        else
+#endif
+            Noise_setPath(NOISE_SCALAR);
+    }
+
+    return noisePath;
+}
+
+void Noise_setPath(NoisePath path)
+{
+#ifdef NOISE_X86
+    if (path == NOISE_AVX2 && SDL_HasAVX2())
+    {
+        noiseBatchFn = batchAVX2;
+        noisePath = NOISE_AVX2;
+        return;
+    }
+
+    if (path != NOISE_SCALAR && SDL_HasSSE2())
+    {
+        noiseBatchFn = batchSSE2;
+        noisePath = NOISE_SSE2;
+        return;
+    }
+#endif
+
+    noiseBatchFn = batchScalar;
+    noisePath = NOISE_SCALAR;
+}
+
+const char *Noise_pathName(NoisePath path)
+{
+    switch (path)
+    {
+    case NOISE_AVX2:
+        return "avx2";
+    case NOISE_SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+float Noise_sample(const NoiseParams *params, float x, float z)
+{
+    return fractalScalar(params, x, z);
+}
+
+void Noise_sampleBatch(const NoiseParams *params, const float *x, const float *z, float *out, int count)
+{
+    Noise_getPath();
+
+    int width = noisePath == NOISE_AVX2 ? 8 : (noisePath == NOISE_SSE2 ? 4 : 1);
+    int vectorCount = count - count % width;
+
+    noiseBatchFn(params, x, z, out, vectorCount);
+    batchScalar(params, x + vectorCount, z + vectorCount, out + vectorCount, count - vectorCount);
+}
@@ -0,0 +1,44 @@
+#ifndef NOISE_INCLUDED
+#define NOISE_INCLUDED
+
+typedef enum NoiseType
+{
+    NOISE_VALUE,
+    NOISE_PERLIN,
+    NOISE_SIMPLEX
+} NoiseType;
+
+typedef enum NoiseFractal
+{
+    NOISE_FBM,
+    NOISE_RIDGED
+} NoiseFractal;
+
+typedef enum NoisePath
+{
+    NOISE_SCALAR,
+    NOISE_SSE2,
+    NOISE_AVX2
+} NoisePath;
+
+typedef struct NoiseParams
+{
+    NoiseType type;
+    NoiseFractal fractal;
+    unsigned int seed;
+    int octaves;
+    float frequency;
+    float lacunarity;
+    float gain;
+} NoiseParams;
+
+NoisePath Noise_getPath();
+void Noise_setPath(NoisePath path);
+const char *Noise_pathName(NoisePath path);
+
+// Both return values in [0, 1]. Results are bit-identical on every path, so
+// a height sampled one at a time matches the same point from a batch.
+float Noise_sample(const NoiseParams *params, float x, float z);
+void Noise_sampleBatch(const NoiseParams *params, const float *x, const float *z, float *out, int count);
+
+#endif
@@ -0,0 +1,184 @@
+// Noise kernels written once against a tiny vector vocabulary. noise.c
+// includes this file once per instruction set after defining:
+//
+//   NK(name)     function name with the path suffix
+//   NK_TARGET    target attribute for the path
+//   NK_WIDTH     lanes per vector
+//   VF / VI      float / 32-bit int vector types
+//   and the VF_* / VI_* operations used below.
+//
+// Every path performs the same IEEE operations in the same order (no FMA,
+// no approximations), which is what keeps scalar and SIMD results identical.
+
+static NK_TARGET VI NK(hash)(VI seed, VI x, VI z)
+{
+    VI h = VI_XOR(seed, VI_MUL(x, VI_SET1(0x27d4eb2d)));
+    h = VI_XOR(h, VI_MUL(z, VI_SET1(0x165667b1)));
+    h = VI_MUL(VI_XOR(h, VI_SRL(h, 15)), VI_SET1((int)0x85ebca6bU));
+    h = VI_MUL(VI_XOR(h, VI_SRL(h, 13)), VI_SET1((int)0xc2b2ae35U));
+    return VI_XOR(h, VI_SRL(h, 16));
+}
+
+// quintic fade 6t^5 - 15t^4 + 10t^3
+static NK_TARGET VF NK(fade)(VF t)
+{
+    VF inner = VF_ADD(VF_MUL(t, VF_SUB(VF_MUL(t, VF_SET1(6.0f)), VF_SET1(15.0f))), VF_SET1(10.0f));
+    return VF_MUL(VF_MUL(VF_MUL(t, t), t), inner);
+}
+
+static NK_TARGET VF NK(lerp)(VF a, VF b, VF t)
+{
+    return VF_ADD(a, VF_MUL(VF_SUB(b, a), t));
+}
+
+// diagonal gradient (+-1, +-1) picked by the low hash bits, applied as sign flips
+static NK_TARGET VF NK(grad)(VI h, VF x, VF z)
+{
+    VF gx = VF_FLIPSIGN(x, VI_SLL(VI_AND(h, VI_SET1(1)), 31));
+    VF gz = VF_FLIPSIGN(z, VI_SLL(VI_AND(h, VI_SET1(2)), 30));
+    return VF_ADD(gx, gz);
+}
+
+// hash -> [-1, 1] using the top 24 bits so the int->float conversion is exact
+static NK_TARGET VF NK(hashToFloat)(VI h)
+{
+    VF unit = VF_MUL(VI_TO_VF(VI_SRL(h, 8)), VF_SET1(1.0f / 16777215.0f));
+    return VF_SUB(VF_MUL(unit, VF_SET1(2.0f)), VF_SET1(1.0f));
+}
+
+static NK_TARGET VF NK(value)(VI seed, VF x, VF z)
+{
+    VF fx = VF_FLOOR(x);
+    VF fz = VF_FLOOR(z);
+    VI ix = VF_TO_VI(fx);
+    VI iz = VF_TO_VI(fz);
+    VI one = VI_SET1(1);
+
+    VF u = NK(fade)(VF_SUB(x, fx));
+    VF v = NK(fade)(VF_SUB(z, fz));
+
+    VF a = NK(hashToFloat)(NK(hash)(seed, ix, iz));
+    VF b = NK(hashToFloat)(NK(hash)(seed, VI_ADD(ix, one), iz));
+    VF c = NK(hashToFloat)(NK(hash)(seed, ix, VI_ADD(iz, one)));
+    VF d = NK(hashToFloat)(NK(hash)(seed, VI_ADD(ix, one), VI_ADD(iz, one)));
+
+    return NK(lerp)(NK(lerp)(a, b, u), NK(lerp)(c, d, u), v);
+}
+
+static NK_TARGET VF NK(perlin)(VI seed, VF x, VF z)
+{
+    VF fx = VF_FLOOR(x);
+    VF fz = VF_FLOOR(z);
+    VI ix = VF_TO_VI(fx);
+    VI iz = VF_TO_VI(fz);
+    VI one = VI_SET1(1);
+    VF fone = VF_SET1(1.0f);
+
+    VF x0 = VF_SUB(x, fx);
+    VF z0 = VF_SUB(z, fz);
+    VF x1 = VF_SUB(x0, fone);
+    VF z1 = VF_SUB(z0, fone);
+
+    VF a = NK(grad)(NK(hash)(seed, ix, iz), x0, z0);
+    VF b = NK(grad)(NK(hash)(seed, VI_ADD(ix, one), iz), x1, z0);
+    VF c = NK(grad)(NK(hash)(seed, ix, VI_ADD(iz, one)), x0, z1);
+    VF d = NK(grad)(NK(hash)(seed, VI_ADD(ix, one), VI_ADD(iz, one)), x1, z1);
+
+    VF n = NK(lerp)(NK(lerp)(a, b, NK(fade)(x0)), NK(lerp)(c, d, NK(fade)(x0)), NK(fade)(z0));
+    return VF_MUL(n, VF_SET1(NOISE_PERLIN_SCALE));
+}
+
+static NK_TARGET VF NK(simplexCorner)(VI h, VF x, VF z)
+{
+    VF t = VF_SUB(VF_SUB(VF_SET1(0.5f), VF_MUL(x, x)), VF_MUL(z, z));
+    t = VF_MAX(t, VF_SET1(0.0f));
+    t = VF_MUL(t, t);
+    return VF_MUL(VF_MUL(t, t), NK(grad)(h, x, z));
+}
+
+static NK_TARGET VF NK(simplex)(VI seed, VF x, VF z)
+{
+    const float F2 = 0.36602540378f; // (sqrt(3) - 1) / 2
+    const float G2 = 0.21132486540f; // (3 - sqrt(3)) / 6
+
+    VF s = VF_MUL(VF_ADD(x, z), VF_SET1(F2));
+    VF fi = VF_FLOOR(VF_ADD(x, s));
+    VF fj = VF_FLOOR(VF_ADD(z, s));
+    VI i = VF_TO_VI(fi);
+    VI j = VF_TO_VI(fj);
+
+    VF t = VF_MUL(VF_ADD(fi, fj), VF_SET1(G2));
+    VF x0 = VF_SUB(x, VF_SUB(fi, t));
+    VF z0 = VF_SUB(z, VF_SUB(fj, t));
+
+    // lower or upper triangle of the skewed cell
+    VI upper = VF_GT(x0, z0);
+    VI i1 = VI_AND(upper, VI_SET1(1));
+    VI j1 = VI_SUB(VI_SET1(1), i1);
+
+    VF x1 = VF_ADD(VF_SUB(x0, VI_TO_VF(i1)), VF_SET1(G2));
+    VF z1 = VF_ADD(VF_SUB(z0, VI_TO_VF(j1)), VF_SET1(G2));
+    VF x2 = VF_ADD(VF_SUB(x0, VF_SET1(1.0f)), VF_SET1(2.0f * G2));
+    VF z2 = VF_ADD(VF_SUB(z0, VF_SET1(1.0f)), VF_SET1(2.0f * G2));
+
+    VI one = VI_SET1(1);
+    VF n0 = NK(simplexCorner)(NK(hash)(seed, i, j), x0, z0);
+    VF n1 = NK(simplexCorner)(NK(hash)(seed, VI_ADD(i, i1), VI_ADD(j, j1)), x1, z1);
+    VF n2 = NK(simplexCorner)(NK(hash)(seed, VI_ADD(i, one), VI_ADD(j, one)), x2, z2);
+
+    return VF_MUL(VF_ADD(VF_ADD(n0, n1), n2), VF_SET1(NOISE_SIMPLEX_SCALE));
+}
+
+static NK_TARGET VF NK(fractal)(const NoiseParams *params, VF x, VF z)
+{
+    VF sum = VF_SET1(0.0f);
+    float frequency = params->frequency;
+    float amplitude = 1.0f;
+
+    for (int octave = 0; octave < params->octaves; octave++)
+    {
+        VI seed = VI_SET1((int)(params->seed + (unsigned int)octave * 0x9e3779b9U));
+        VF sx = VF_MUL(x, VF_SET1(frequency));
+        VF sz = VF_MUL(z, VF_SET1(frequency));
+
+        VF n;
+        switch (params->type)
+        {
+        case NOISE_PERLIN:
+            n = NK(perlin)(seed, sx, sz);
+            break;
+        case NOISE_SIMPLEX:
+            n = NK(simplex)(seed, sx, sz);
+            break;
+        default:
+            n = NK(value)(seed, sx, sz);
+            break;
+        }
+
+        if (params->fractal == NOISE_RIDGED)
+        {
+            n = VF_SUB(VF_SET1(1.0f), VF_ABS(n));
+            n = VF_MUL(n, n);
+        }
+
+        sum = VF_ADD(sum, VF_MUL(n, VF_SET1(amplitude)));
+        frequency *= params->lacunarity;
+        amplitude *= params->gain;
+    }
+
+    float norm = totalAmplitude(params);
+    if (params->fractal == NOISE_RIDGED)
+        sum = VF_MUL(sum, VF_SET1(1.0f / norm));
+    else
+        sum = VF_ADD(VF_MUL(sum, VF_SET1(0.5f / norm)), VF_SET1(0.5f));
+
+    return VF_MIN(VF_MAX(sum, VF_SET1(0.0f)), VF_SET1(1.0f));
+}
+
+static NK_TARGET void NK(batch)(const NoiseParams *params, const float *x, const float *z, float *out, int count)
+{
+    for (int i = 0; i + NK_WIDTH <= count; i += NK_WIDTH)
+    {
+        VF_STORE(out + i, NK(fractal)(params, VF_LOAD(x + i), VF_LOAD(z + i)));
+    }
+}
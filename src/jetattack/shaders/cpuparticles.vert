@@ -0,0 +1,20 @@
+#version 330 core
+
+layout (location = 0) in vec4 positionFade;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float pointScale;
+uniform vec4 color;
+uniform float size;
+
+out vec4 Color;
+
+void main()
+{
+    vec4 viewPos = view * vec4(positionFade.xyz, 1.0);
+    gl_Position = projection * viewPos;
+    gl_PointSize = size * pointScale / max(-viewPos.z, 0.01);
+
+    Color = vec4(color.rgb, color.a * positionFade.w);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec4 Color;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec2 offset = gl_PointCoord * 2.0 - 1.0;
+    float distance = dot(offset, offset);
+    if (distance > 1.0)
+        discard;
+
+    FragColor = vec4(Color.rgb, Color.a * (1.0 - distance));
+}
@@ -0,0 +1,20 @@
+#version 330 core
+
+uniform float maxHeight;
+
+in vec3 Normal;
+in float Height;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec3 lightDir = normalize(vec3(-0.4f, 1.0f, 0.3f));
+    float diff = max(dot(normalize(Normal), lightDir), 0.0f);
+
+    vec3 low = vec3(0.2f, 0.45f, 0.2f);
+    vec3 high = vec3(0.55f, 0.5f, 0.45f);
+    vec3 color = mix(low, high, clamp(Height / maxHeight, 0.0f, 1.0f));
+
+    FragColor = vec4(color * (0.25f + 0.75f * diff), 1.0f);
+}
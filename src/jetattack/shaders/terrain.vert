@@ -0,0 +1,42 @@
+#version 330 core
+
+layout (location = 0) in vec2 aGrid;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform vec3 cameraPos;
+uniform vec2 nodeOffset;
+uniform float nodeScale;
+uniform vec2 morphRange; // distance where morphing starts, and where it ends
+uniform sampler2D heightmap;
+uniform float gridSize;      // quads along a node side, LOD_GRID
+uniform float heightmapSize; // texels along the heightmap, HEIGHTMAP_SIZE
+
+out vec3 Normal;
+out float Height;
+
+float heightAt(vec2 world)
+{
+    return texture(heightmap, (world + 0.5f) / heightmapSize).r;
+}
+
+void main()
+{
+    vec2 world = nodeOffset + aGrid * nodeScale;
+    float dist = distance(cameraPos, vec3(world.x, heightAt(world), world.y));
+
+    // slide odd vertices onto their even neighbours so the grid matches the
+    // parent level's by the time the parent takes over
+    float morph = clamp((dist - morphRange.x) / (morphRange.y - morphRange.x), 0.0f, 1.0f);
+    vec2 odd = fract(aGrid * gridSize * 0.5f) * 2.0f / gridSize;
+    world = nodeOffset + (aGrid - odd * morph) * nodeScale;
+
+    float height = heightAt(world);
+    Normal = normalize(vec3(heightAt(world - vec2(1.0f, 0.0f)) - heightAt(world + vec2(1.0f, 0.0f)),
+                            2.0f,
+                            heightAt(world - vec2(0.0f, 1.0f)) - heightAt(world + vec2(0.0f, 1.0f))));
+    Height = height;
+
+    gl_Position = projection * view * vec4(world.x, height, world.y, 1.0f);
+}
@@ -1,146 +1,716 @@
+#include <math.h>
 #include "GL/glew.h"
 #include "cglm/cglm.h"
 #include "SDL2/SDL.h"
 
-static float vertices[] = {
-    10.0f, 0.5f, 0.0f,   // top right
-    10.0f, -0.5f, 0.0f,  // bottom right
-    -10.0f, -0.5f, 0.0f, // bottom left
-    -10.0f, 0.5f, 0.0f   // top left
-};
+#include "frustum.h"
+#include "glstate.h"
+#include "heightfield.h"
+#include "job.h"
+#include "noise.h"
+#include "occlusion.h"
+#include "shader.h"
+#include "terrain.h"
+
+// Chunks kept around the focus: CHUNKS_SIDE to each side, CHUNKS_AHEAD in
+// the flight direction (-Z) and CHUNKS_BEHIND behind it. Everything else is
+// evicted, so memory is fixed at MAX_CHUNKS slots however far the jet flies.
+#define CHUNKS_SIDE 3
+#define CHUNKS_AHEAD 6
+#define CHUNKS_BEHIND 1
+#define MAX_CHUNKS ((2 * CHUNKS_SIDE + 1) * (CHUNKS_AHEAD + CHUNKS_BEHIND + 1))
+
+// Heights live in one toroidal texture of HEIGHTMAP_TILES^2 chunk tiles. A
+// chunk always lands in tile (x mod tiles, z mod tiles), so texel (u, v)
+// holds world (u, v) mod HEIGHTMAP_SIZE and the window scrolls for free.
+#define HEIGHTMAP_TILES 8
+#define HEIGHTMAP_SIZE (HEIGHTMAP_TILES * TERRAIN_CHUNK_RES)
+#define CHUNK_SAMPLES (TERRAIN_CHUNK_RES * TERRAIN_CHUNK_RES)
+#define FIELD_SAMPLES ((TERRAIN_CHUNK_RES + 1) * (TERRAIN_CHUNK_RES + 1))
 
-static unsigned int indices[] = {
-    // note that we start from 0!
-    0, 1, 3, // first triangle
-    1, 2, 3  // second triangle
+// CDLOD: every selected quadtree node draws the same LOD_GRID^2 mesh scaled
+// to its size. Leaves get one quad per texel; each level up doubles both the
+// node size and its distance range.
+#define LOD_GRID 16
+#define LOD_LEVELS 5
+#define LOD_LEAF_SIZE 16.0f
+#define LOD_NEAR_RANGE 32.0f
+#define LOD_MORPH_START 0.7f // fraction of a level's range where morphing begins
+#define LOD_QUADRANT_INDICES ((LOD_GRID / 2) * (LOD_GRID / 2) * 6)
+#define LOD_MAX_NODES 512
+
+// Occluders are a coarse grid per chunk. Each vertex takes the lowest height
+// within OCCLUDER_REACH texels so the grid stays under the rendered surface,
+// including coarser LOD triangles that span several cells.
+#define OCCLUDER_CELLS 8
+#define OCCLUDER_VERTS (OCCLUDER_CELLS + 1)
+#define OCCLUDER_REACH 8
+#define OCCLUDER_INDEX_COUNT (OCCLUDER_CELLS * OCCLUDER_CELLS * 6)
+
+enum
+{
+    CHUNK_FREE,
+    CHUNK_BUILDING,
+    CHUNK_READY
 };
 
-typedef struct Paddle
+typedef struct Chunk
+{
+    int x, z;
+    int state;
+
+    Job job;
+    JobCounter counter;
+
+    SDL_atomic_t readers; // collision queries using the field; the slot is not rebuilt while any are
+    float *heights;       // filled by a worker, uploaded on the GL thread
+    float minHeight, maxHeight;
+    Heightfield field; // one sample wider than heights, to meet the next chunk
+    float occluder[OCCLUDER_VERTS * OCCLUDER_VERTS * 3];
+} Chunk;
+
+typedef struct LodNode
+{
+    float x, z, size;
+    int level;
+    int quadrants; // child quadrants drawn at this node's LOD, one bit each
+} LodNode;
+
+typedef struct Terrain
 {
     GLuint shaderProgram;
     unsigned int VAO, VBO, EBO;
+    unsigned int heightmap;
+
+    int viewLoc, projectionLoc, heightLoc, cameraLoc;
+    int nodeOffsetLoc, nodeScaleLoc, morphLoc, heightmapLoc;
+    int gridSizeLoc, heightmapSizeLoc;
+
+    NoiseParams noise;
+    Chunk chunks[MAX_CHUNKS];
+    unsigned short occluderIndices[OCCLUDER_INDEX_COUNT];
+
+    // rebuilt every frame by Terrain_update / Terrain_draw
+    int rootX, rootZ; // chunk at the corner of the LOD root
+    bool ready[HEIGHTMAP_TILES][HEIGHTMAP_TILES];
+    float tileMin[HEIGHTMAP_TILES][HEIGHTMAP_TILES];
+    float tileMax[HEIGHTMAP_TILES][HEIGHTMAP_TILES];
+    Frustum frustum;
+    float ranges[LOD_LEVELS];
+    LodNode nodes[LOD_MAX_NODES];
+    int nodeCount;
+
+    // ready chunks by heightmap tile, for collision from other threads;
+    // only the GL thread swaps them, always atomically
+    Chunk *collision[HEIGHTMAP_TILES][HEIGHTMAP_TILES];
+
+    TerrainStats stats;
+} Terrain;
+
+static Terrain terrain;
+
+float Terrain_heightAt(float x, float z)
+{
+    return Noise_sample(&terrain.noise, x, z) * TERRAIN_HEIGHT;
+}
+
+// The chunks one collision query has pinned. A query counts itself as a
+// reader of every chunk it looks at, so queries never wait on each other and
+// the GL thread only has to leave a pinned slot alone until they let go.
+typedef struct CollisionPins
+{
+    Chunk *chunks[MAX_CHUNKS];
+    int count;
+} CollisionPins;
+
+static int wrapTile(int c)
+{
+    return ((c % HEIGHTMAP_TILES) + HEIGHTMAP_TILES) % HEIGHTMAP_TILES;
+}
+
+static const Heightfield *collisionTile(void *data, int tileX, int tileZ)
+{
+    CollisionPins *pins = data;
+    Chunk **tile = &terrain.collision[wrapTile(tileZ)][wrapTile(tileX)];
+    Chunk *chunk = SDL_AtomicGetPtr((void **)tile);
+    if (!chunk)
+        return NULL;
+
+    // once pinned, a chunk still in the table cannot be evicted and rebuilt
+    // under us; one that left it before the pin took may already be
+    SDL_AtomicAdd(&chunk->readers, 1);
+    if (SDL_AtomicGetPtr((void **)tile) != chunk || chunk->x != tileX || chunk->z != tileZ)
+    {
+        SDL_AtomicAdd(&chunk->readers, -1);
+        return NULL;
+    }
+
+    pins->chunks[pins->count++] = chunk;
+    return &chunk->field;
+}
+
+static HeightfieldTiles collisionTiles(CollisionPins *pins)
+{
+    pins->count = 0;
+    return (HeightfieldTiles){collisionTile, pins, TERRAIN_CHUNK_SIZE, 0.0f, TERRAIN_HEIGHT};
+}
+
+static void releasePins(CollisionPins *pins)
+{
+    for (int i = 0; i < pins->count; i++)
+        SDL_AtomicAdd(&pins->chunks[i]->readers, -1);
+}
+
+bool Terrain_raycast(vec3 origin, vec3 direction, float maxDistance, HeightfieldHit *hit)
+{
+    vec3 unit;
+    glm_vec3_normalize_to(direction, unit);
 
-    vec3 position;
-    vec3 speed;
-} Paddle;
+    CollisionPins pins;
+    HeightfieldTiles tiles = collisionTiles(&pins);
+    bool found = Heightfield_raycastTiles(&tiles, origin, unit, maxDistance, hit);
+    releasePins(&pins);
+    return found;
+}
+
+bool Terrain_segment(vec3 from, vec3 to, HeightfieldHit *hit)
+{
+    vec3 direction;
+    glm_vec3_sub(to, from, direction);
 
-static Paddle paddle;
+    CollisionPins pins;
+    HeightfieldTiles tiles = collisionTiles(&pins);
+    bool found = Heightfield_raycastTiles(&tiles, from, direction, 1.0f, hit);
+    releasePins(&pins);
+    return found;
+}
 
-void Paddle_init()
+bool Terrain_sphere(vec3 center, float radius, HeightfieldContact *contact)
 {
-    // Shader program
-    void *vertexShaderSource = SDL_LoadFile("./shaders/paddle.vert", NULL);
-    void *fragmentShaderSource = SDL_LoadFile("./shaders/paddle.frag", NULL);
+    CollisionPins pins;
+    HeightfieldTiles tiles = collisionTiles(&pins);
+    bool found = Heightfield_sphereTiles(&tiles, center, radius, contact);
+    releasePins(&pins);
+    return found;
+}
 
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, (const char **)&vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
+// Runs on a job worker: one height per heightmap texel of the chunk's tile.
+static void buildChunk(void *data, int start, int end)
+{
+    Chunk *chunk = data;
 
-    // check for shader compile errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    const float step = TERRAIN_CHUNK_SIZE / TERRAIN_CHUNK_RES;
+    const float originX = chunk->x * TERRAIN_CHUNK_SIZE;
+    const float originZ = chunk->z * TERRAIN_CHUNK_SIZE;
+
+    // the collision field also takes the first row and column of the next
+    // chunks, so the cells across the seam are covered
+    float sampleX[FIELD_SAMPLES];
+    float sampleZ[FIELD_SAMPLES];
+    for (int j = 0; j <= TERRAIN_CHUNK_RES; j++)
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        SDL_Log("Vertex shader compile error: %s\n", infoLog);
+        for (int i = 0; i <= TERRAIN_CHUNK_RES; i++)
+        {
+            sampleX[j * (TERRAIN_CHUNK_RES + 1) + i] = originX + i * step;
+            sampleZ[j * (TERRAIN_CHUNK_RES + 1) + i] = originZ + j * step;
+        }
     }
 
-    // fragment shader
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, (const char **)&fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    // batched noise is bit-identical to Terrain_heightAt at the same points
+    float *fieldHeights = chunk->field.heights;
+    Noise_sampleBatch(&terrain.noise, sampleX, sampleZ, fieldHeights, FIELD_SAMPLES);
+    for (int i = 0; i < FIELD_SAMPLES; i++)
+    {
+        fieldHeights[i] *= TERRAIN_HEIGHT;
+    }
+    Heightfield_build(&chunk->field, originX, originZ);
 
-    // check for shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    chunk->minHeight = TERRAIN_HEIGHT;
+    chunk->maxHeight = 0.0f;
+    for (int j = 0; j < TERRAIN_CHUNK_RES; j++)
     {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        SDL_Log("Frag shader compile error: %s\n", infoLog);
+        for (int i = 0; i < TERRAIN_CHUNK_RES; i++)
+        {
+            float height = fieldHeights[j * (TERRAIN_CHUNK_RES + 1) + i];
+            chunk->heights[j * TERRAIN_CHUNK_RES + i] = height;
+            chunk->minHeight = glm_min(chunk->minHeight, height);
+            chunk->maxHeight = glm_max(chunk->maxHeight, height);
+        }
     }
 
-    // link shaders
-    paddle.shaderProgram = glCreateProgram();
-    glAttachShader(paddle.shaderProgram, vertexShader);
-    glAttachShader(paddle.shaderProgram, fragmentShader);
-    glLinkProgram(paddle.shaderProgram);
+    // the last row sits on the last texel; past it heights belong to the neighbour
+    float *v = chunk->occluder;
+    for (int j = 0; j < OCCLUDER_VERTS; j++)
+    {
+        int texelZ = SDL_min(j * TERRAIN_CHUNK_RES / OCCLUDER_CELLS, TERRAIN_CHUNK_RES - 1);
+        for (int i = 0; i < OCCLUDER_VERTS; i++)
+        {
+            int texelX = SDL_min(i * TERRAIN_CHUNK_RES / OCCLUDER_CELLS, TERRAIN_CHUNK_RES - 1);
+
+            float lowest = TERRAIN_HEIGHT;
+            for (int tz = SDL_max(texelZ - OCCLUDER_REACH, 0); tz <= SDL_min(texelZ + OCCLUDER_REACH, TERRAIN_CHUNK_RES - 1); tz++)
+            {
+                for (int tx = SDL_max(texelX - OCCLUDER_REACH, 0); tx <= SDL_min(texelX + OCCLUDER_REACH, TERRAIN_CHUNK_RES - 1); tx++)
+                {
+                    lowest = glm_min(lowest, chunk->heights[tz * TERRAIN_CHUNK_RES + tx]);
+                }
+            }
 
-    // check for linking errors
-    glGetProgramiv(paddle.shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
+            *v++ = originX + texelX * step;
+            *v++ = lowest;
+            *v++ = originZ + texelZ * step;
+        }
+    }
+}
+
+static void buildGrid()
+{
+    float vertices[(LOD_GRID + 1) * (LOD_GRID + 1) * 2];
+    float *v = vertices;
+    for (int j = 0; j <= LOD_GRID; j++)
     {
-        glGetProgramInfoLog(paddle.shaderProgram, 512, NULL, infoLog);
-        SDL_Log("Shader program linking failed: %s\n", infoLog);
+        for (int i = 0; i <= LOD_GRID; i++)
+        {
+            *v++ = (float)i / LOD_GRID;
+            *v++ = (float)j / LOD_GRID;
+        }
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
 
-    SDL_free(vertexShaderSource);
-    SDL_free(fragmentShaderSource);
+    // indices grouped by quadrant so a node can draw any subset of its children
+    unsigned short indices[4 * LOD_QUADRANT_INDICES];
+    unsigned short *index = indices;
+    for (int q = 0; q < 4; q++)
+    {
+        int startI = (q & 1) * (LOD_GRID / 2);
+        int startJ = (q >> 1) * (LOD_GRID / 2);
+
+        for (int j = startJ; j < startJ + LOD_GRID / 2; j++)
+        {
+            for (int i = startI; i < startI + LOD_GRID / 2; i++)
+            {
+                unsigned short topLeft = j * (LOD_GRID + 1) + i;
+                unsigned short bottomLeft = topLeft + LOD_GRID + 1;
+
+                *index++ = topLeft;
+                *index++ = bottomLeft;
+                *index++ = topLeft + 1;
+                *index++ = topLeft + 1;
+                *index++ = bottomLeft;
+                *index++ = bottomLeft + 1;
+            }
+        }
+    }
 
-    glGenVertexArrays(1, &(paddle.VAO));
-    glGenBuffers(1, &(paddle.VBO));
-    glGenBuffers(1, &(paddle.EBO));
+    glGenVertexArrays(1, &terrain.VAO);
+    glGenBuffers(1, &terrain.VBO);
+    glGenBuffers(1, &terrain.EBO);
 
-    // Bind and buffer data
-    glBindVertexArray(paddle.VAO);
+    GLState_bindVertexArray(terrain.VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, paddle.VBO);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, terrain.VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, paddle.EBO);
+    GLState_bindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrain.EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-    // Set vertex attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
 
-    // Unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState_bindVertexArray(0);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    glm_vec3_zero(&paddle.position);
-    paddle.position[1] = -20.0f;
+void Terrain_init(unsigned int seed)
+{
+    terrain.noise.type = NOISE_SIMPLEX;
+    terrain.noise.fractal = NOISE_FBM;
+    terrain.noise.seed = seed;
+    terrain.noise.octaves = 5;
+    terrain.noise.frequency = 0.015f;
+    terrain.noise.lacunarity = 2.0f;
+    terrain.noise.gain = 0.5f;
 
-    glm_vec3_zero(&paddle.speed);
+    terrain.shaderProgram = CreateProgram("./shaders/terrain.vert", "./shaders/terrain.frag");
+    terrain.viewLoc = glGetUniformLocation(terrain.shaderProgram, "view");
+    terrain.projectionLoc = glGetUniformLocation(terrain.shaderProgram, "projection");
+    terrain.heightLoc = glGetUniformLocation(terrain.shaderProgram, "maxHeight");
+    terrain.cameraLoc = glGetUniformLocation(terrain.shaderProgram, "cameraPos");
+    terrain.nodeOffsetLoc = glGetUniformLocation(terrain.shaderProgram, "nodeOffset");
+    terrain.nodeScaleLoc = glGetUniformLocation(terrain.shaderProgram, "nodeScale");
+    terrain.morphLoc = glGetUniformLocation(terrain.shaderProgram, "morphRange");
+    terrain.heightmapLoc = glGetUniformLocation(terrain.shaderProgram, "heightmap");
+    terrain.gridSizeLoc = glGetUniformLocation(terrain.shaderProgram, "gridSize");
+    terrain.heightmapSizeLoc = glGetUniformLocation(terrain.shaderProgram, "heightmapSize");
+
+    buildGrid();
+
+    unsigned short *index = terrain.occluderIndices;
+    for (int j = 0; j < OCCLUDER_CELLS; j++)
+    {
+        for (int i = 0; i < OCCLUDER_CELLS; i++)
+        {
+            unsigned short topLeft = j * OCCLUDER_VERTS + i;
+            unsigned short bottomLeft = topLeft + OCCLUDER_VERTS;
+
+            *index++ = topLeft;
+            *index++ = bottomLeft;
+            *index++ = topLeft + 1;
+            *index++ = topLeft + 1;
+            *index++ = bottomLeft;
+            *index++ = bottomLeft + 1;
+        }
+    }
+
+    glGenTextures(1, &terrain.heightmap);
+    GLState_bindTexture(0, GL_TEXTURE_2D, terrain.heightmap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, HEIGHTMAP_SIZE, HEIGHTMAP_SIZE, 0, GL_RED, GL_FLOAT, NULL);
+    GLState_bindTexture(0, GL_TEXTURE_2D, 0);
+
+    for (int c = 0; c < MAX_CHUNKS; c++)
+    {
+        terrain.chunks[c].state = CHUNK_FREE;
+        terrain.chunks[c].heights = SDL_malloc(CHUNK_SAMPLES * sizeof(float));
+        Heightfield_init(&terrain.chunks[c].field, TERRAIN_CHUNK_RES, TERRAIN_CHUNK_SIZE / TERRAIN_CHUNK_RES);
+    }
+
+    for (int level = 0; level < LOD_LEVELS; level++)
+    {
+        terrain.ranges[level] = LOD_NEAR_RANGE * (float)(1 << level);
+    }
 }
 
-void Paddle_update(float deltaTime)
+static bool inWindow(int x, int z, int focusX, int focusZ)
 {
-    paddle.position[0] += paddle.speed[0] * deltaTime;
+    return x >= focusX - CHUNKS_SIDE && x <= focusX + CHUNKS_SIDE &&
+           z >= focusZ - CHUNKS_AHEAD && z <= focusZ + CHUNKS_BEHIND;
 }
 
-void Paddle_draw(mat4 *view, mat4 *projection)
+static Chunk *findChunk(int x, int z)
 {
-    glUseProgram(paddle.shaderProgram);
+    for (int c = 0; c < MAX_CHUNKS; c++)
+    {
+        Chunk *chunk = &terrain.chunks[c];
+        if (chunk->state != CHUNK_FREE && chunk->x == x && chunk->z == z)
+            return chunk;
+    }
 
-    unsigned int viewLoc = glGetUniformLocation(paddle.shaderProgram, "view");
-    unsigned int projectionLoc = glGetUniformLocation(paddle.shaderProgram, "projection");
-    unsigned int modelLoc = glGetUniformLocation(paddle.shaderProgram, "model");
+    return NULL;
+}
 
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (float *)*projection);
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (float *)*view);
+static Chunk *freeChunk()
+{
+    for (int c = 0; c < MAX_CHUNKS; c++)
+    {
+        // an evicted chunk may still be read by a query that pinned it in time
+        if (terrain.chunks[c].state == CHUNK_FREE && SDL_AtomicGet(&terrain.chunks[c].readers) == 0)
+            return &terrain.chunks[c];
+    }
 
-    mat4 model;
-    glm_mat4_identity(model);
-    glm_translate(model, paddle.position);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float *)model);
+    return NULL;
+}
 
-    glBindVertexArray(paddle.VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+void Terrain_update(vec3 focus)
+{
+    int focusX = (int)floorf(focus[0] / TERRAIN_CHUNK_SIZE);
+    int focusZ = (int)floorf(focus[2] / TERRAIN_CHUNK_SIZE);
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0); // set the count to 6 since we're drawing 6 vertices now (2 triangles); not 3!
+    // the LOD root is the HEIGHTMAP_TILES^2 block of chunks holding the window
+    terrain.rootX = focusX - HEIGHTMAP_TILES / 2;
+    terrain.rootZ = focusZ - CHUNKS_AHEAD;
+    SDL_memset(terrain.ready, 0, sizeof(terrain.ready));
+
+    terrain.stats.resident = 0;
+    terrain.stats.building = 0;
+
+    GLState_bindTexture(0, GL_TEXTURE_2D, terrain.heightmap);
+    for (int c = 0; c < MAX_CHUNKS; c++)
+    {
+        Chunk *chunk = &terrain.chunks[c];
+        if (chunk->state == CHUNK_FREE)
+            continue;
+
+        bool finished = SDL_AtomicGet(&chunk->counter.pending) == 0;
+
+        // a chunk still being built keeps its slot until the worker is done
+        if (finished && !inWindow(chunk->x, chunk->z, focusX, focusZ))
+        {
+            // out of the collision table before the slot can be rebuilt,
+            // unless a newer chunk has already taken the tile
+            SDL_AtomicCASPtr((void **)&terrain.collision[wrapTile(chunk->z)][wrapTile(chunk->x)], chunk, NULL);
+
+            chunk->state = CHUNK_FREE;
+            terrain.stats.evicted++;
+            continue;
+        }
+
+        if (chunk->state == CHUNK_BUILDING && finished)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, 0,
+                            wrapTile(chunk->x) * TERRAIN_CHUNK_RES, wrapTile(chunk->z) * TERRAIN_CHUNK_RES,
+                            TERRAIN_CHUNK_RES, TERRAIN_CHUNK_RES, GL_RED, GL_FLOAT, chunk->heights);
+            chunk->state = CHUNK_READY;
+
+            SDL_AtomicSetPtr((void **)&terrain.collision[wrapTile(chunk->z)][wrapTile(chunk->x)], chunk);
+        }
+
+        if (chunk->state == CHUNK_READY)
+        {
+            terrain.stats.resident++;
+            terrain.ready[chunk->z - terrain.rootZ][chunk->x - terrain.rootX] = true;
+            terrain.tileMin[chunk->z - terrain.rootZ][chunk->x - terrain.rootX] = chunk->minHeight;
+            terrain.tileMax[chunk->z - terrain.rootZ][chunk->x - terrain.rootX] = chunk->maxHeight;
+        }
+        else
+        {
+            terrain.stats.building++;
+        }
+    }
+
+    // queue missing chunks nearest row first so the terrain under the jet appears first
+    for (int ring = 0; ring <= CHUNKS_AHEAD; ring++)
+    {
+        for (int dz = -ring; dz <= ring; dz += (ring ? 2 * ring : 1))
+        {
+            if (dz < -CHUNKS_AHEAD || dz > CHUNKS_BEHIND)
+                continue;
+
+            for (int dx = -CHUNKS_SIDE; dx <= CHUNKS_SIDE; dx++)
+            {
+                int x = focusX + dx;
+                int z = focusZ + dz;
+                if (findChunk(x, z))
+                    continue;
+
+                Chunk *chunk = freeChunk();
+                if (!chunk)
+                    return;
+
+                chunk->x = x;
+                chunk->z = z;
+                chunk->state = CHUNK_BUILDING;
+                chunk->job.fn = buildChunk;
+                chunk->job.data = chunk;
+                chunk->job.start = 0;
+                chunk->job.end = 1;
+                Job_submit(&chunk->job, &chunk->counter);
+
+                terrain.stats.building++;
+                terrain.stats.generated++;
+            }
+        }
+    }
 }
 
-const int PADDLE_SPEED = 10;
-void Paddle_setDir(int dir)
+// True when every chunk under the square has its heights in the texture.
+// minY/maxY bound the heights of the ready chunks, when given.
+static bool areaReady(float x, float z, float size, float *minY, float *maxY)
 {
-    if(dir < 0)
+    int x0 = (int)floorf(x / TERRAIN_CHUNK_SIZE) - terrain.rootX;
+    int z0 = (int)floorf(z / TERRAIN_CHUNK_SIZE) - terrain.rootZ;
+    int x1 = (int)ceilf((x + size) / TERRAIN_CHUNK_SIZE) - terrain.rootX;
+    int z1 = (int)ceilf((z + size) / TERRAIN_CHUNK_SIZE) - terrain.rootZ;
+
+    bool ready = true;
+    float low = TERRAIN_HEIGHT;
+    float high = 0.0f;
+    for (int j = z0; j < z1; j++)
     {
-        paddle.speed[0] = -PADDLE_SPEED;
-    } else if(dir > 0)
+        for (int i = x0; i < x1; i++)
+        {
+            if (i < 0 || j < 0 || i >= HEIGHTMAP_TILES || j >= HEIGHTMAP_TILES || !terrain.ready[j][i])
+            {
+                ready = false;
+                continue;
+            }
+
+            low = glm_min(low, terrain.tileMin[j][i]);
+            high = glm_max(high, terrain.tileMax[j][i]);
+        }
+    }
+
+    if (minY)
+        *minY = glm_min(low, high);
+    if (maxY)
+        *maxY = high;
+
+    return ready;
+}
+
+// heights are bounded by [0, TERRAIN_HEIGHT], which is tight enough for LOD
+static bool nodeInRange(vec3 camera, float range, float x, float z, float size)
+{
+    float dx = camera[0] - glm_clamp(camera[0], x, x + size);
+    float dy = camera[1] - glm_clamp(camera[1], 0.0f, TERRAIN_HEIGHT);
+    float dz = camera[2] - glm_clamp(camera[2], z, z + size);
+    return dx * dx + dy * dy + dz * dz <= range * range;
+}
+
+static void addNode(float x, float z, float size, int level, int quadrants)
+{
+    // leave out quadrants whose chunks are still being generated
+    float half = size * 0.5f;
+    int readyQuadrants = 0;
+    for (int q = 0; q < 4; q++)
+    {
+        if ((quadrants & (1 << q)) && areaReady(x + (q & 1) * half, z + (q >> 1) * half, half, NULL, NULL))
+            readyQuadrants |= 1 << q;
+    }
+
+    if (!readyQuadrants || terrain.nodeCount >= LOD_MAX_NODES)
+        return;
+
+    LodNode *node = &terrain.nodes[terrain.nodeCount++];
+    node->x = x;
+    node->z = z;
+    node->size = size;
+    node->level = level;
+    node->quadrants = readyQuadrants;
+}
+
+// Returns false when the node lies outside its level's range, in which case
+// the parent draws that quadrant itself at the coarser LOD. Nodes outside the
+// frustum or hidden behind the occluders count as handled; planeMask drops
+// planes a parent was fully inside.
+static bool selectNode(vec3 camera, float x, float z, float size, int level, int planeMask)
+{
+    if (!nodeInRange(camera, terrain.ranges[level], x, z, size))
+        return false;
+
+    vec3 min = {x, 0.0f, z};
+    vec3 max = {x + size, TERRAIN_HEIGHT, z + size};
+    areaReady(x, z, size, &min[1], &max[1]);
+
+    if (planeMask)
     {
-        paddle.speed[0] = PADDLE_SPEED;
-    } else {
-        paddle.speed[0] = 0;
+        terrain.stats.tested++;
+        if (Frustum_testAABB(&terrain.frustum, min, max, &planeMask) == FRUSTUM_OUTSIDE)
+            return true;
     }
+
+    if (!Occlusion_testAABB(min, max))
+    {
+        terrain.stats.occluded++;
+        return true;
+    }
+
+    if (level == 0 || !nodeInRange(camera, terrain.ranges[level - 1], x, z, size))
+    {
+        addNode(x, z, size, level, 0xf);
+        return true;
+    }
+
+    float half = size * 0.5f;
+    int parentQuadrants = 0;
+    for (int q = 0; q < 4; q++)
+    {
+        if (!selectNode(camera, x + (q & 1) * half, z + (q >> 1) * half, half, level - 1, planeMask))
+            parentQuadrants |= 1 << q;
+    }
+
+    if (parentQuadrants)
+        addNode(x, z, size, level, parentQuadrants);
+
+    return true;
+}
+
+void Terrain_draw(mat4 *view, mat4 *projection, vec3 camera)
+{
+    Uint64 selectStart = SDL_GetPerformanceCounter();
+
+    mat4 viewProjection;
+    glm_mat4_mul(*projection, *view, viewProjection);
+    Frustum_extract(&terrain.frustum, viewProjection);
+
+    terrain.nodeCount = 0;
+    terrain.stats.tested = 0;
+    terrain.stats.occluded = 0;
+    float rootSize = LOD_LEAF_SIZE * (float)(1 << (LOD_LEVELS - 1));
+    selectNode(camera, terrain.rootX * TERRAIN_CHUNK_SIZE, terrain.rootZ * TERRAIN_CHUNK_SIZE, rootSize, LOD_LEVELS - 1, FRUSTUM_ALL_PLANES);
+
+    terrain.stats.selectMs = (double)(SDL_GetPerformanceCounter() - selectStart) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    terrain.stats.nodes = terrain.nodeCount;
+    terrain.stats.triangles = 0;
+
+    GLState_useProgram(terrain.shaderProgram);
+
+    glUniformMatrix4fv(terrain.projectionLoc, 1, GL_FALSE, (float *)*projection);
+    glUniformMatrix4fv(terrain.viewLoc, 1, GL_FALSE, (float *)*view);
+    glUniform1f(terrain.heightLoc, TERRAIN_HEIGHT);
+    glUniform3fv(terrain.cameraLoc, 1, camera);
+    glUniform1i(terrain.heightmapLoc, 0);
+    glUniform1f(terrain.gridSizeLoc, LOD_GRID);
+    glUniform1f(terrain.heightmapSizeLoc, HEIGHTMAP_SIZE);
+
+    GLState_bindTexture(0, GL_TEXTURE_2D, terrain.heightmap);
+    GLState_bindVertexArray(terrain.VAO);
+
+    for (int n = 0; n < terrain.nodeCount; n++)
+    {
+        LodNode *node = &terrain.nodes[n];
+
+        // morph toward the next coarser grid over the far end of this level's range
+        float rangeEnd = terrain.ranges[node->level];
+        float rangeStart = node->level > 0 ? terrain.ranges[node->level - 1] : 0.0f;
+        float morphStart = rangeStart + (rangeEnd - rangeStart) * LOD_MORPH_START;
+
+        glUniform2f(terrain.nodeOffsetLoc, node->x, node->z);
+        glUniform1f(terrain.nodeScaleLoc, node->size);
+        glUniform2f(terrain.morphLoc, morphStart, rangeEnd);
+
+        if (node->quadrants == 0xf)
+        {
+            glDrawElements(GL_TRIANGLES, 4 * LOD_QUADRANT_INDICES, GL_UNSIGNED_SHORT, 0);
+            terrain.stats.triangles += 4 * LOD_QUADRANT_INDICES / 3;
+            continue;
+        }
+
+        for (int q = 0; q < 4; q++)
+        {
+            if (!(node->quadrants & (1 << q)))
+                continue;
+
+            glDrawElements(GL_TRIANGLES, LOD_QUADRANT_INDICES, GL_UNSIGNED_SHORT, (void *)(q * LOD_QUADRANT_INDICES * sizeof(unsigned short)));
+            terrain.stats.triangles += LOD_QUADRANT_INDICES / 3;
+        }
+    }
+}
+
+void Terrain_free()
+{
+    for (int c = 0; c < MAX_CHUNKS; c++)
+    {
+        Chunk *chunk = &terrain.chunks[c];
+
+        // workers may still be writing into the staging buffer
+        if (chunk->state == CHUNK_BUILDING)
+            Job_wait(&chunk->counter);
+
+        SDL_free(chunk->heights);
+        Heightfield_free(&chunk->field);
+    }
+
+    glDeleteTextures(1, &terrain.heightmap);
+    glDeleteVertexArrays(1, &terrain.VAO);
+    glDeleteBuffers(1, &terrain.VBO);
+    glDeleteBuffers(1, &terrain.EBO);
+    glDeleteProgram(terrain.shaderProgram);
+}
+
+void Terrain_addOccluders()
+{
+    for (int c = 0; c < MAX_CHUNKS; c++)
+    {
+        Chunk *chunk = &terrain.chunks[c];
+        if (chunk->state == CHUNK_READY)
+            Occlusion_addOccluder(chunk->occluder, OCCLUDER_VERTS * OCCLUDER_VERTS, terrain.occluderIndices, OCCLUDER_INDEX_COUNT);
+    }
+}
+
+TerrainStats Terrain_stats()
+{
+    return terrain.stats;
 }
@@ -1,9 +1,45 @@
-#ifndef PADDLE_INCLUDED
-#define PADDLE_INCLUDED
+#ifndef TERRAIN_INCLUDED
+#define TERRAIN_INCLUDED
 
-void Paddle_init();
-void Paddle_update(float deltaTime);
-void Paddle_draw(mat4 *view, mat4 *projection);
-void Paddle_setDir(int dir);
+#include "heightfield.h"
 
-#endif
\ No newline at end of file
+#define TERRAIN_CHUNK_SIZE 32.0f // world units per chunk side
+#define TERRAIN_CHUNK_RES 32     // height samples per chunk side
+#define TERRAIN_HEIGHT 14.0f
+
+typedef struct TerrainStats
+{
+    int resident;
+    int building;
+    int generated;
+    int evicted;
+
+    // CDLOD selection of the last Terrain_draw
+    int tested;   // quadtree nodes tested against the frustum
+    int occluded; // nodes hidden behind the occluders
+    int nodes;  // nodes drawn
+    int triangles;
+    double selectMs;
+} TerrainStats;
+
+void Terrain_init(unsigned int seed);
+void Terrain_update(vec3 focus);
+void Terrain_draw(mat4 *view, mat4 *projection, vec3 camera);
+void Terrain_free();
+
+// Submits every resident chunk as an occluder; call between Occlusion_begin
+// and Occlusion_rasterize.
+void Terrain_addOccluders();
+
+float Terrain_heightAt(float x, float z);
+
+// Collision against the resident chunks, callable from any thread; queries
+// never block each other or the chunk streaming. Where a chunk is still being
+// generated there is no ground yet. Segment hits report t from 0 at from to 1
+// at to.
+bool Terrain_raycast(vec3 origin, vec3 direction, float maxDistance, HeightfieldHit *hit);
+bool Terrain_segment(vec3 from, vec3 to, HeightfieldHit *hit);
+bool Terrain_sphere(vec3 center, float radius, HeightfieldContact *contact);
+TerrainStats Terrain_stats();
+
+#endif
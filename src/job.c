@@ -0,0 +1,352 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "job.h"
+
+#define JOB_MAX_WORKERS 64
+#define JOB_DEQUE_SIZE 1024 // power of two
+#define JOB_MAX_SPLITS 256
+#define JOB_WAIT_SPINS 64 // empty polls in Job_wait before it starts yielding
+
+// Chase-Lev work-stealing deque: the owner pushes and pops at the bottom,
+// thieves take from the top. Fixed size; a full deque runs jobs inline.
+typedef struct JobDeque
+{
+    atomic_long top;
+    char pad0[64 - sizeof(atomic_long)];
+    atomic_long bottom;
+    char pad1[64 - sizeof(atomic_long)];
+    _Atomic(Job *) jobs[JOB_DEQUE_SIZE];
+} JobDeque;
+
+static JobDeque deques[JOB_MAX_WORKERS];
+static SDL_Thread *threads[JOB_MAX_WORKERS];
+static int threadCount = 1; // worker threads plus the main thread
+static SDL_atomic_t dequeCount; // every thread that has pushed or runs jobs owns one
+static SDL_atomic_t generation;  // bumped by Job_init, so slots from an earlier pool are claimed again
+static SDL_sem *wakeup;
+static atomic_bool running;
+
+static SDL_atomic_t statExecuted;
+static SDL_atomic_t statStolen;
+
+static _Thread_local int workerIndex = -1;
+static _Thread_local int workerGeneration;
+
+// Chase-Lev only allows one owner per deque. The thread that calls Job_init
+// owns slot 0 and workers take theirs from the spawn index; any other thread
+// that submits (the simulation) claims the next free slot the first time.
+// Past JOB_MAX_WORKERS a thread gets none and runs what it submits inline.
+static int ownDeque()
+{
+    int current = SDL_AtomicGet(&generation);
+    if (workerGeneration != current)
+    {
+        workerGeneration = current;
+        workerIndex = SDL_AtomicAdd(&dequeCount, 1);
+        if (workerIndex >= JOB_MAX_WORKERS)
+        {
+            SDL_Log("Too many job threads (max %d), running their jobs inline", JOB_MAX_WORKERS);
+            workerIndex = -1;
+        }
+    }
+
+    return workerIndex;
+}
+
+static bool dequePush(JobDeque *deque, Job *job)
+{
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+    if (b - t >= JOB_DEQUE_SIZE)
+        return false;
+
+    atomic_store_explicit(&deque->jobs[b & (JOB_DEQUE_SIZE - 1)], job, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+
+    return true;
+}
+
+static Job *dequePop(JobDeque *deque)
+{
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b)
+    {
+        // empty
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Job *job = atomic_load_explicit(&deque->jobs[b & (JOB_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (t == b)
+    {
+        // last job, race against thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            job = NULL;
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+
+    return job;
+}
+
+static Job *dequeSteal(JobDeque *deque)
+{
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (t >= b)
+        return NULL;
+
+    Job *job = atomic_load_explicit(&deque->jobs[t & (JOB_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+
+    return job;
+}
+
+static void execute(Job *job)
+{
+    job->fn(job->data, job->start, job->end);
+    SDL_AtomicAdd(&statExecuted, 1);
+
+    if (job->counter)
+        SDL_AtomicAdd(&job->counter->pending, -1);
+}
+
+static Job *findJob()
+{
+    int self = ownDeque();
+    Job *job = self >= 0 ? dequePop(&deques[self]) : NULL;
+    if (job)
+        return job;
+
+    // start at a different victim per thread so thieves do not all pile on one deque
+    int count = SDL_min(SDL_AtomicGet(&dequeCount), JOB_MAX_WORKERS);
+    for (int i = 0; i < count; i++)
+    {
+        int victim = (SDL_max(self, 0) + i) % count;
+        if (victim == self)
+            continue;
+
+        job = dequeSteal(&deques[victim]);
+        if (job)
+        {
+            SDL_AtomicAdd(&statStolen, 1);
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+static bool anyQueued()
+{
+    int count = SDL_min(SDL_AtomicGet(&dequeCount), JOB_MAX_WORKERS);
+    for (int i = 0; i < count; i++)
+    {
+        if (atomic_load(&deques[i].bottom) > atomic_load(&deques[i].top))
+            return true;
+    }
+
+    return false;
+}
+
+// runs everything still queued on the calling thread
+static void drain()
+{
+    while (anyQueued())
+    {
+        Job *job = findJob();
+        if (job)
+            execute(job);
+    }
+}
+
+static int workerMain(void *data)
+{
+    workerIndex = (int)(intptr_t)data;
+    workerGeneration = SDL_AtomicGet(&generation);
+
+    while (atomic_load(&running))
+    {
+        Job *job = findJob();
+        if (job)
+        {
+            execute(job);
+        }
+        else
+        {
+            SDL_SemWaitTimeout(wakeup, 1);
+        }
+    }
+
+    return 0;
+}
+
+int Job_init(int workerCount)
+{
+    // keep one worker even on a single core, async jobs like terrain chunks
+    // are never waited on and would otherwise not run at all
+    if (workerCount <= 0)
+        workerCount = SDL_max(SDL_GetCPUCount() - 1, 1);
+    if (workerCount > JOB_MAX_WORKERS - 1)
+        workerCount = JOB_MAX_WORKERS - 1;
+
+    wakeup = SDL_CreateSemaphore(0);
+    atomic_store(&running, true);
+
+    // slots past the workers are left for other threads that submit
+    SDL_AtomicAdd(&generation, 1);
+    SDL_AtomicSet(&dequeCount, workerCount + 1);
+    workerIndex = 0;
+    workerGeneration = SDL_AtomicGet(&generation);
+
+    threadCount = 1;
+    for (int i = 1; i <= workerCount; i++)
+    {
+        threads[i] = SDL_CreateThread(workerMain, "job worker", (void *)(intptr_t)i);
+        if (!threads[i])
+        {
+            SDL_Log("Error creating job worker: %s", SDL_GetError());
+            break;
+        }
+        threadCount++;
+    }
+
+    return threadCount - 1;
+}
+
+void Job_shutdown()
+{
+    // async jobs such as terrain tiles may still be queued; run them with the
+    // workers' help so no counter is left pending
+    drain();
+    atomic_store(&running, false);
+
+    for (int i = 1; i < threadCount; i++)
+    {
+        SDL_SemPost(wakeup);
+    }
+    for (int i = 1; i < threadCount; i++)
+    {
+        SDL_WaitThread(threads[i], NULL);
+    }
+
+    // whatever the last running jobs submitted before their workers stopped
+    drain();
+
+    SDL_DestroySemaphore(wakeup);
+    wakeup = NULL;
+    threadCount = 1;
+
+    // every worker is joined and nothing is queued, so the slots start over
+    for (int i = 0; i < JOB_MAX_WORKERS; i++)
+    {
+        atomic_store(&deques[i].top, 0);
+        atomic_store(&deques[i].bottom, 0);
+    }
+    SDL_AtomicSet(&dequeCount, 0);
+}
+
+int Job_workerCount()
+{
+    return threadCount;
+}
+
+void Job_submit(Job *job, JobCounter *counter)
+{
+    job->counter = counter;
+    if (counter)
+        SDL_AtomicAdd(&counter->pending, 1);
+
+    int self = ownDeque();
+    if (self < 0 || !dequePush(&deques[self], job))
+    {
+        execute(job);
+        return;
+    }
+
+    if (wakeup && SDL_SemValue(wakeup) < (Uint32)threadCount)
+        SDL_SemPost(wakeup);
+}
+
+void Job_wait(JobCounter *counter)
+{
+    // help with queued work instead of blocking while children are pending;
+    // once there is nothing to take, yield so the workers running the rest
+    // get the core on an oversubscribed machine
+    int misses = 0;
+    while (SDL_AtomicGet(&counter->pending) > 0)
+    {
+        Job *job = findJob();
+        if (job)
+        {
+            execute(job);
+            misses = 0;
+        }
+        else if (++misses < JOB_WAIT_SPINS)
+            SDL_CompilerBarrier();
+        else
+            SDL_Delay(0);
+    }
+}
+
+void Job_parallelFor(int count, int grain, JobFn fn, void *data)
+{
+    if (count <= 0)
+        return;
+    if (grain < 1)
+        grain = 1;
+
+    if (count <= grain || threadCount == 1)
+    {
+        fn(data, 0, count);
+        return;
+    }
+
+    int splits = (count + grain - 1) / grain;
+    if (splits > JOB_MAX_SPLITS)
+    {
+        // keep the per-call job array on the stack
+        grain = (count + JOB_MAX_SPLITS - 1) / JOB_MAX_SPLITS;
+        splits = (count + grain - 1) / grain;
+    }
+
+    Job jobs[JOB_MAX_SPLITS];
+    JobCounter counter = {0};
+
+    // the caller runs the first range itself
+    for (int i = 1; i < splits; i++)
+    {
+        jobs[i].fn = fn;
+        jobs[i].data = data;
+        jobs[i].start = i * grain;
+        jobs[i].end = SDL_min(count, (i + 1) * grain);
+        Job_submit(&jobs[i], &counter);
+    }
+
+    fn(data, 0, grain);
+    SDL_AtomicAdd(&statExecuted, 1);
+
+    Job_wait(&counter);
+}
+
+JobStats Job_stats()
+{
+    JobStats stats = {SDL_AtomicGet(&statExecuted), SDL_AtomicGet(&statStolen)};
+    return stats;
+}
+
+void Job_resetStats()
+{
+    SDL_AtomicSet(&statExecuted, 0);
+    SDL_AtomicSet(&statStolen, 0);
+}
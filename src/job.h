@@ -0,0 +1,41 @@
+#ifndef JOB_INCLUDED
+#define JOB_INCLUDED
+
+#include <SDL2/SDL.h>
+
+typedef void (*JobFn)(void *data, int start, int end);
+
+// Counts outstanding jobs; a parent waits on it for all of its children.
+typedef struct JobCounter
+{
+    SDL_atomic_t pending;
+} JobCounter;
+
+// Caller owns the memory of a submitted job until its counter reaches zero.
+typedef struct Job
+{
+    JobFn fn;
+    void *data;
+    int start, end;
+
+    JobCounter *counter;
+} Job;
+
+typedef struct JobStats
+{
+    int executed;
+    int stolen;
+} JobStats;
+
+int Job_init(int workerCount);
+void Job_shutdown();
+int Job_workerCount();
+
+void Job_submit(Job *job, JobCounter *counter);
+void Job_wait(JobCounter *counter);
+void Job_parallelFor(int count, int grain, JobFn fn, void *data);
+
+JobStats Job_stats();
+void Job_resetStats();
+
+#endif
@@ -0,0 +1,226 @@
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#include "mesharena.h"
+#include "glstate.h"
+
+static void freeList_init(MeshFreeList *list, int size)
+{
+    list->size = size;
+    list->used = 0;
+    list->count = 1;
+    list->capacity = 16;
+    list->ranges = SDL_malloc(list->capacity * sizeof(MeshRange));
+    list->ranges[0] = (MeshRange){0, size};
+}
+
+static void freeList_free(MeshFreeList *list)
+{
+    SDL_free(list->ranges);
+    list->ranges = NULL;
+    list->count = 0;
+}
+
+// best fit keeps the big holes around for big meshes
+static int freeList_alloc(MeshFreeList *list, int size)
+{
+    int best = -1;
+    for (int i = 0; i < list->count; i++)
+    {
+        if (list->ranges[i].size >= size && (best < 0 || list->ranges[i].size < list->ranges[best].size))
+            best = i;
+    }
+
+    if (best < 0)
+        return -1;
+
+    MeshRange *range = &list->ranges[best];
+    int offset = range->offset;
+    range->offset += size;
+    range->size -= size;
+
+    if (range->size == 0)
+    {
+        SDL_memmove(range, range + 1, (list->count - best - 1) * sizeof(MeshRange));
+        list->count--;
+    }
+
+    list->used += size;
+    return offset;
+}
+
+static void freeList_release(MeshFreeList *list, int offset, int size)
+{
+    int i = 0;
+    while (i < list->count && list->ranges[i].offset < offset)
+        i++;
+
+    list->used -= size;
+
+    bool joinsPrevious = i > 0 && list->ranges[i - 1].offset + list->ranges[i - 1].size == offset;
+    bool joinsNext = i < list->count && offset + size == list->ranges[i].offset;
+
+    if (joinsPrevious && joinsNext)
+    {
+        list->ranges[i - 1].size += size + list->ranges[i].size;
+        SDL_memmove(&list->ranges[i], &list->ranges[i + 1], (list->count - i - 1) * sizeof(MeshRange));
+        list->count--;
+        return;
+    }
+
+    if (joinsPrevious)
+    {
+        list->ranges[i - 1].size += size;
+        return;
+    }
+
+    if (joinsNext)
+    {
+        list->ranges[i].offset = offset;
+        list->ranges[i].size += size;
+        return;
+    }
+
+    if (list->count == list->capacity)
+    {
+        list->capacity *= 2;
+        list->ranges = SDL_realloc(list->ranges, list->capacity * sizeof(MeshRange));
+    }
+
+    SDL_memmove(&list->ranges[i + 1], &list->ranges[i], (list->count - i) * sizeof(MeshRange));
+    list->ranges[i] = (MeshRange){offset, size};
+    list->count++;
+}
+
+static void freeList_stats(const MeshFreeList *list, int *holes, int *largest, float *fragmentation)
+{
+    *holes = list->count;
+    *largest = 0;
+    for (int i = 0; i < list->count; i++)
+        *largest = SDL_max(*largest, list->ranges[i].size);
+
+    int free = list->size - list->used;
+    *fragmentation = free > 0 ? 1.0f - (float)*largest / (float)free : 0.0f;
+}
+
+void MeshArena_init(MeshArena *arena, const MeshFormat *format, int maxVertices, int maxIndices)
+{
+    arena->format = *format;
+    arena->meshes = 0;
+    freeList_init(&arena->vertices, maxVertices);
+    freeList_init(&arena->indices, maxIndices);
+
+    glGenVertexArrays(1, &arena->VAO);
+    glGenBuffers(1, &arena->VBO);
+    glGenBuffers(1, &arena->EBO);
+
+    GLState_bindVertexArray(arena->VAO);
+
+    GLState_bindBuffer(GL_ARRAY_BUFFER, arena->VBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)maxVertices * format->stride, NULL, GL_STATIC_DRAW);
+
+    GLState_bindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena->EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)maxIndices * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+    for (int a = 0; a < format->attributeCount; a++)
+    {
+        const MeshAttribute *attribute = &format->attributes[a];
+        glVertexAttribPointer(a, attribute->components, GL_FLOAT, GL_FALSE, format->stride, (void *)(uintptr_t)attribute->offset);
+        glEnableVertexAttribArray(a);
+    }
+
+    GLState_bindVertexArray(0);
+}
+
+void MeshArena_free(MeshArena *arena)
+{
+    GLState_bindVertexArray(0);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDeleteVertexArrays(1, &arena->VAO);
+    glDeleteBuffers(1, &arena->VBO);
+    glDeleteBuffers(1, &arena->EBO);
+    GLState_invalidate();
+
+    freeList_free(&arena->vertices);
+    freeList_free(&arena->indices);
+}
+
+bool MeshArena_add(MeshArena *arena, const void *vertices, int vertexCount, const unsigned int *indices, int indexCount, Mesh *mesh)
+{
+    if (!indices)
+        indexCount = vertexCount;
+
+    int baseVertex = freeList_alloc(&arena->vertices, vertexCount);
+    if (baseVertex < 0)
+    {
+        SDL_Log("MeshArena: no room for %d vertices", vertexCount);
+        return false;
+    }
+
+    int firstIndex = freeList_alloc(&arena->indices, indexCount);
+    if (firstIndex < 0)
+    {
+        SDL_Log("MeshArena: no room for %d indices", indexCount);
+        freeList_release(&arena->vertices, baseVertex, vertexCount);
+        return false;
+    }
+
+    // upload through the copy target so no VAO's element binding is touched
+    GLState_bindBuffer(GL_COPY_WRITE_BUFFER, arena->VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)baseVertex * arena->format.stride, (GLsizeiptr)vertexCount * arena->format.stride, vertices);
+
+    unsigned int *sequential = NULL;
+    if (!indices)
+    {
+        sequential = SDL_malloc(indexCount * sizeof(unsigned int));
+        for (int i = 0; i < indexCount; i++)
+            sequential[i] = i;
+        indices = sequential;
+    }
+
+    GLState_bindBuffer(GL_COPY_WRITE_BUFFER, arena->EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)firstIndex * sizeof(unsigned int), (GLsizeiptr)indexCount * sizeof(unsigned int), indices);
+    SDL_free(sequential);
+
+    mesh->baseVertex = baseVertex;
+    mesh->vertexCount = vertexCount;
+    mesh->firstIndex = firstIndex;
+    mesh->indexCount = indexCount;
+    arena->meshes++;
+
+    return true;
+}
+
+void MeshArena_remove(MeshArena *arena, Mesh *mesh)
+{
+    if (mesh->vertexCount == 0)
+        return;
+
+    freeList_release(&arena->vertices, mesh->baseVertex, mesh->vertexCount);
+    freeList_release(&arena->indices, mesh->firstIndex, mesh->indexCount);
+    arena->meshes--;
+
+    SDL_zerop(mesh);
+}
+
+void MeshArena_draw(MeshArena *arena, const Mesh *mesh, GLenum mode)
+{
+    GLState_bindVertexArray(arena->VAO);
+    glDrawElementsBaseVertex(mode, mesh->indexCount, GL_UNSIGNED_INT, (void *)((uintptr_t)mesh->firstIndex * sizeof(unsigned int)), mesh->baseVertex);
+}
+
+MeshArenaStats MeshArena_stats(const MeshArena *arena)
+{
+    MeshArenaStats stats;
+    stats.meshes = arena->meshes;
+    stats.vertexUsed = arena->vertices.used;
+    stats.vertexCapacity = arena->vertices.size;
+    stats.indexUsed = arena->indices.used;
+    stats.indexCapacity = arena->indices.size;
+
+    freeList_stats(&arena->vertices, &stats.vertexHoles, &stats.largestVertexHole, &stats.vertexFragmentation);
+    freeList_stats(&arena->indices, &stats.indexHoles, &stats.largestIndexHole, &stats.indexFragmentation);
+
+    return stats;
+}
@@ -0,0 +1,83 @@
+#ifndef MESHARENA_INCLUDED
+#define MESHARENA_INCLUDED
+
+#include <stdbool.h>
+#include <GL/glew.h>
+
+// Static meshes sharing one vertex format live in a single vertex buffer and
+// a single index buffer behind one VAO. Each mesh gets a vertex range and an
+// index range from a best-fit free list, and is drawn with
+// glDrawElementsBaseVertex so its indices stay relative to its own vertices.
+#define MESH_MAX_ATTRIBUTES 8
+
+typedef struct MeshAttribute
+{
+    int components; // floats, bound to the location matching its index
+    int offset;     // bytes into the vertex
+} MeshAttribute;
+
+typedef struct MeshFormat
+{
+    int stride;
+    int attributeCount;
+    MeshAttribute attributes[MESH_MAX_ATTRIBUTES];
+} MeshFormat;
+
+typedef struct Mesh
+{
+    int baseVertex;
+    int vertexCount;
+    int firstIndex;
+    int indexCount;
+} Mesh;
+
+typedef struct MeshRange
+{
+    int offset;
+    int size;
+} MeshRange;
+
+// free ranges sorted by offset, neighbours always merged
+typedef struct MeshFreeList
+{
+    int size;
+    int used;
+    int count;
+    int capacity;
+    MeshRange *ranges;
+} MeshFreeList;
+
+typedef struct MeshArenaStats
+{
+    int meshes;
+    int vertexUsed, vertexCapacity;
+    int indexUsed, indexCapacity;
+    int vertexHoles, indexHoles;           // free ranges
+    int largestVertexHole, largestIndexHole;
+    float vertexFragmentation;             // 1 - largest hole / free space
+    float indexFragmentation;
+} MeshArenaStats;
+
+typedef struct MeshArena
+{
+    MeshFormat format;
+    GLuint VAO, VBO, EBO;
+
+    MeshFreeList vertices;
+    MeshFreeList indices;
+    int meshes;
+} MeshArena;
+
+void MeshArena_init(MeshArena *arena, const MeshFormat *format, int maxVertices, int maxIndices);
+void MeshArena_free(MeshArena *arena);
+
+// indices are relative to the mesh's first vertex; NULL draws the vertices
+// in order. Returns false when either buffer has no hole big enough.
+bool MeshArena_add(MeshArena *arena, const void *vertices, int vertexCount, const unsigned int *indices, int indexCount, Mesh *mesh);
+void MeshArena_remove(MeshArena *arena, Mesh *mesh);
+
+void MeshArena_draw(MeshArena *arena, const Mesh *mesh, GLenum mode);
+
+MeshArenaStats MeshArena_stats(const MeshArena *arena);
+
+#endif
@@ -0,0 +1,183 @@
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#include "multidraw.h"
+#include "glstate.h"
+
+static bool pathChosen = false;
+static MultiDrawPath multiDrawPath = MULTIDRAW_LOOP;
+
+static bool hasIndirect()
+{
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+MultiDrawPath MultiDraw_getPath()
+{
+    if (!pathChosen)
+        MultiDraw_setPath(MULTIDRAW_INDIRECT);
+
+    return multiDrawPath;
+}
+
+void MultiDraw_setPath(MultiDrawPath path)
+{
+    pathChosen = true;
+
+    if (path == MULTIDRAW_INDIRECT && !hasIndirect())
+        path = MULTIDRAW_BASEVERTEX;
+
+    multiDrawPath = path;
+}
+
+const char *MultiDraw_pathName(MultiDrawPath path)
+{
+    switch (path)
+    {
+    case MULTIDRAW_INDIRECT:
+        return "indirect";
+    case MULTIDRAW_BASEVERTEX:
+        return "basevertex";
+    default:
+        return "loop";
+    }
+}
+
+void MultiDraw_init(MultiDraw *draws, int capacity)
+{
+    SDL_zerop(draws);
+    draws->capacity = capacity;
+    draws->commands = SDL_malloc(capacity * sizeof(DrawElementsIndirectCommand));
+    draws->counts = SDL_malloc(capacity * sizeof(GLsizei));
+    draws->offsets = SDL_malloc(capacity * sizeof(void *));
+    draws->baseVertices = SDL_malloc(capacity * sizeof(GLint));
+
+    // the indirect binding point does not exist before GL 4.0
+    if (hasIndirect())
+        RingBuffer_init(&draws->indirect, GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand));
+}
+
+void MultiDraw_free(MultiDraw *draws)
+{
+    if (draws->indirect.buffer)
+        RingBuffer_free(&draws->indirect);
+
+    SDL_free(draws->commands);
+    SDL_free(draws->counts);
+    SDL_free(draws->offsets);
+    SDL_free(draws->baseVertices);
+    SDL_zerop(draws);
+}
+
+void MultiDraw_beginFrame(MultiDraw *draws)
+{
+    draws->count = 0;
+    draws->instances = 0;
+
+    if (draws->indirect.buffer)
+        RingBuffer_beginFrame(&draws->indirect);
+}
+
+void MultiDraw_endFrame(MultiDraw *draws)
+{
+    if (draws->indirect.buffer)
+        RingBuffer_endFrame(&draws->indirect);
+}
+
+int MultiDraw_add(MultiDraw *draws, const Mesh *mesh, int instances)
+{
+    if (draws->count >= draws->capacity)
+    {
+        SDL_Log("MultiDraw full (capacity %d)", draws->capacity);
+        return -1;
+    }
+
+    int baseInstance = draws->instances;
+    draws->commands[draws->count++] = (DrawElementsIndirectCommand){
+        mesh->indexCount, instances, mesh->firstIndex, mesh->baseVertex, baseInstance};
+    draws->instances += instances;
+
+    return baseInstance;
+}
+
+static void pointData(const MultiDrawData *data, int element)
+{
+    GLState_bindBuffer(GL_ARRAY_BUFFER, data->buffer);
+    for (int column = 0; column < data->columns; column++)
+    {
+        void *offset = (void *)(uintptr_t)(data->offset + (size_t)element * data->stride + column * 4 * sizeof(float));
+        glVertexAttribPointer(data->location + column, 4, GL_FLOAT, GL_FALSE, data->stride, offset);
+    }
+}
+
+static void submitIndirect(MultiDraw *draws, GLenum mode)
+{
+    size_t offset;
+    size_t size = draws->count * sizeof(DrawElementsIndirectCommand);
+    void *memory = RingBuffer_alloc(&draws->indirect, size, sizeof(GLuint), &offset);
+    if (!memory)
+    {
+        SDL_Log("MultiDraw: indirect buffer full");
+        return;
+    }
+
+    SDL_memcpy(memory, draws->commands, size);
+    RingBuffer_flush(&draws->indirect);
+
+    glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (void *)(uintptr_t)offset, draws->count, 0);
+}
+
+static void submitBaseVertex(MultiDraw *draws, GLenum mode)
+{
+    for (int i = 0; i < draws->count; i++)
+    {
+        DrawElementsIndirectCommand *command = &draws->commands[i];
+        draws->counts[i] = command->count;
+        draws->offsets[i] = (void *)((uintptr_t)command->firstIndex * sizeof(GLuint));
+        draws->baseVertices[i] = command->baseVertex;
+    }
+
+    glMultiDrawElementsBaseVertex(mode, draws->counts, GL_UNSIGNED_INT, (const void *const *)draws->offsets, draws->count, draws->baseVertices);
+}
+
+static void submitLoop(MultiDraw *draws, GLenum mode, const MultiDrawData *data)
+{
+    for (int i = 0; i < draws->count; i++)
+    {
+        DrawElementsIndirectCommand *command = &draws->commands[i];
+        if (data)
+            pointData(data, command->baseInstance);
+
+        void *offset = (void *)((uintptr_t)command->firstIndex * sizeof(GLuint));
+        glDrawElementsInstancedBaseVertex(mode, command->count, GL_UNSIGNED_INT, offset, command->instanceCount, command->baseVertex);
+    }
+}
+
+void MultiDraw_submit(MultiDraw *draws, MeshArena *arena, GLenum mode, const MultiDrawData *data)
+{
+    if (draws->count == 0)
+        return;
+
+    GLState_bindVertexArray(arena->VAO);
+
+    if (data)
+    {
+        pointData(data, 0);
+        for (int column = 0; column < data->columns; column++)
+        {
+            glEnableVertexAttribArray(data->location + column);
+            glVertexAttribDivisor(data->location + column, 1);
+        }
+    }
+
+    MultiDrawPath path = MultiDraw_getPath();
+    if (path == MULTIDRAW_INDIRECT && draws->indirect.buffer)
+        submitIndirect(draws, mode);
+    else if (path == MULTIDRAW_BASEVERTEX && !data && draws->instances == draws->count)
+        submitBaseVertex(draws, mode);
+    else
+        submitLoop(draws, mode, data);
+
+    draws->count = 0;
+    draws->instances = 0;
+}
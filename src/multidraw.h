@@ -0,0 +1,81 @@
+#ifndef MULTIDRAW_INCLUDED
+#define MULTIDRAW_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <GL/glew.h>
+
+#include "mesharena.h"
+#include "ringbuffer.h"
+
+// Batches draws of meshes from one arena into a single submission. Each draw
+// gets baseInstance = its index, so per draw data lives in an instanced
+// vertex attribute and draw i reads element i.
+//
+//   indirect    commands go to a GL_DRAW_INDIRECT_BUFFER and one
+//               glMultiDrawElementsIndirect issues them (GL 4.3)
+//   basevertex  one glMultiDrawElementsBaseVertex (GL 3.2); it has no base
+//               instance, so only batches without per draw data can use it
+//   loop        one glDrawElementsInstancedBaseVertex per draw, repointing
+//               the per draw attribute each time
+typedef enum MultiDrawPath
+{
+    MULTIDRAW_LOOP,
+    MULTIDRAW_BASEVERTEX,
+    MULTIDRAW_INDIRECT
+} MultiDrawPath;
+
+// matches the layout glMultiDrawElementsIndirect reads
+typedef struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+} DrawElementsIndirectCommand;
+
+// per draw data as vec4 columns of an instanced attribute, e.g. a mat4 model
+// matrix at locations 3-6
+typedef struct MultiDrawData
+{
+    GLuint buffer;
+    size_t offset; // of element 0 in buffer
+    int location;
+    int columns;
+    int stride;
+} MultiDrawData;
+
+typedef struct MultiDraw
+{
+    int count;
+    int capacity;
+    int instances; // running baseInstance
+    DrawElementsIndirectCommand *commands;
+
+    // glMultiDrawElementsBaseVertex takes arrays instead of commands
+    GLsizei *counts;
+    const void **offsets;
+    GLint *baseVertices;
+
+    RingBuffer indirect;
+} MultiDraw;
+
+MultiDrawPath MultiDraw_getPath();
+void MultiDraw_setPath(MultiDrawPath path);
+const char *MultiDraw_pathName(MultiDrawPath path);
+
+void MultiDraw_init(MultiDraw *draws, int capacity);
+void MultiDraw_free(MultiDraw *draws);
+
+void MultiDraw_beginFrame(MultiDraw *draws);
+void MultiDraw_endFrame(MultiDraw *draws);
+
+// returns the draw's first element in the per draw data, its baseInstance
+int MultiDraw_add(MultiDraw *draws, const Mesh *mesh, int instances);
+
+// Issues every draw added since the last submit. data may be NULL; when it
+// is streamed, flush it before submitting.
+void MultiDraw_submit(MultiDraw *draws, MeshArena *arena, GLenum mode, const MultiDrawData *data);
+
+#endif
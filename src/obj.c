@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "obj.h"
+
+// grows *array to hold at least count elements of size bytes
+static bool reserve(void **array, int *capacity, int count, size_t size)
+{
+    if (count <= *capacity)
+        return true;
+
+    int grown = SDL_max(*capacity * 2, SDL_max(count, 1024));
+    void *resized = SDL_realloc(*array, grown * size);
+    if (!resized)
+        return false;
+
+    *array = resized;
+    *capacity = grown;
+    return true;
+}
+
+int Obj_loadTriangles(const char *path, vec3 **vertices)
+{
+    size_t size;
+    char *text = SDL_LoadFile(path, &size);
+    if (!text)
+    {
+        SDL_Log("Error loading %s: %s", path, SDL_GetError());
+        return -1;
+    }
+
+    vec3 *positions = NULL;
+    int positionCount = 0, positionCapacity = 0;
+
+    vec3 *triangles = NULL;
+    int triangleCount = 0, triangleCapacity = 0;
+
+    char *line = text;
+    while (line < text + size)
+    {
+        char *end = line;
+        while (end < text + size && *end != '\n')
+            end++;
+        *end = '\0';
+
+        if (line[0] == 'v' && line[1] == ' ')
+        {
+            if (!reserve((void **)&positions, &positionCapacity, positionCount + 1, sizeof(vec3)))
+                break;
+
+            char *cursor = line + 2;
+            for (int axis = 0; axis < 3; axis++)
+                positions[positionCount][axis] = strtof(cursor, &cursor);
+            positionCount++;
+        }
+        else if (line[0] == 'f' && line[1] == ' ')
+        {
+            // v, v/t, v//n or v/t/n per corner, negative indices count back from the last position
+            int corners[3], cornerCount = 0;
+            char *cursor = line + 2;
+            while (true)
+            {
+                char *next;
+                long index = strtol(cursor, &next, 10);
+                if (next == cursor)
+                    break;
+
+                while (*next && *next != ' ' && *next != '\t')
+                    next++;
+                cursor = next;
+
+                index = index < 0 ? positionCount + index : index - 1;
+                if (index < 0 || index >= positionCount)
+                    continue;
+
+                // fan: corner 0, the previous corner, this one
+                if (cornerCount < 2)
+                {
+                    corners[cornerCount++] = (int)index;
+                    continue;
+                }
+
+                corners[2] = (int)index;
+                if (!reserve((void **)&triangles, &triangleCapacity, (triangleCount + 1) * 3, sizeof(vec3)))
+                    break;
+
+                for (int c = 0; c < 3; c++)
+                    glm_vec3_copy(positions[corners[c]], triangles[triangleCount * 3 + c]);
+                triangleCount++;
+                corners[1] = corners[2];
+            }
+        }
+
+        line = end + 1;
+    }
+
+    SDL_free(positions);
+    SDL_free(text);
+
+    *vertices = triangles;
+    return triangleCount;
+}
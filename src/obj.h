@@ -0,0 +1,12 @@
+#ifndef OBJ_INCLUDED
+#define OBJ_INCLUDED
+
+#include "cglm/cglm.h"
+
+// Positions of a Wavefront OBJ file as a triangle soup, three vertices per
+// triangle, polygons fanned from their first corner. Texture coordinates,
+// normals, groups and materials are skipped. Returns the triangle count and
+// an SDL_malloc'ed array in *vertices, or -1 when the file cannot be read.
+int Obj_loadTriangles(const char *path, vec3 **vertices);
+
+#endif
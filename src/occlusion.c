@@ -0,0 +1,411 @@
+#include <float.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "job.h"
+#include "occlusion.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define OCCLUSION_SSE
+#endif
+
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 32
+#define TILES_X (OCCLUSION_WIDTH / TILE_WIDTH)
+#define TILES_Y (OCCLUSION_HEIGHT / TILE_HEIGHT)
+#define TILE_COUNT (TILES_X * TILES_Y)
+
+#define HIZ_LEVELS 8 // down to 2x1
+#define NEAR_W 1e-3f
+
+// screen-space triangle, counter-clockwise, depth in [0, 1]
+typedef struct OccluderTriangle
+{
+    float x[3], y[3], z[3];
+} OccluderTriangle;
+
+typedef struct TileBin
+{
+    int *triangles;
+    int count;
+    int capacity;
+} TileBin;
+
+typedef struct Occlusion
+{
+    mat4 viewProjection;
+    FrameArena *scratch;
+
+    OccluderTriangle *triangles;
+    int triangleCount;
+    int triangleCapacity;
+
+    TileBin bins[TILE_COUNT];
+
+    // level 0 is the depth buffer itself, each level keeps the max of 2x2 below
+    float *levels[HIZ_LEVELS];
+
+    OcclusionStats stats;
+} Occlusion;
+
+static Occlusion occlusion;
+
+static double elapsedMs(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+void Occlusion_init()
+{
+    SDL_memset(&occlusion, 0, sizeof(Occlusion));
+
+    for (int level = 0; level < HIZ_LEVELS; level++)
+    {
+        int width = OCCLUSION_WIDTH >> level;
+        int height = OCCLUSION_HEIGHT >> level;
+        occlusion.levels[level] = SDL_SIMDAlloc(width * height * sizeof(float));
+
+        // nothing occludes until the first rasterize
+        for (int i = 0; i < width * height; i++)
+        {
+            occlusion.levels[level][i] = 1.0f;
+        }
+    }
+}
+
+void Occlusion_free()
+{
+    for (int level = 0; level < HIZ_LEVELS; level++)
+    {
+        SDL_SIMDFree(occlusion.levels[level]);
+    }
+
+    for (int t = 0; t < TILE_COUNT; t++)
+    {
+        SDL_free(occlusion.bins[t].triangles);
+    }
+
+    SDL_free(occlusion.triangles);
+    SDL_memset(&occlusion, 0, sizeof(Occlusion));
+}
+
+void Occlusion_begin(mat4 viewProjection, FrameArena *scratch)
+{
+    glm_mat4_copy(viewProjection, occlusion.viewProjection);
+    occlusion.scratch = scratch;
+
+    occlusion.triangleCount = 0;
+    for (int t = 0; t < TILE_COUNT; t++)
+    {
+        occlusion.bins[t].count = 0;
+    }
+
+    occlusion.stats.triangles = 0;
+    occlusion.stats.binned = 0;
+    occlusion.stats.tested = 0;
+    occlusion.stats.culled = 0;
+    occlusion.stats.setupMs = 0.0;
+    occlusion.stats.rasterMs = 0.0;
+}
+
+static void binTriangle(int triangle, float minX, float minY, float maxX, float maxY)
+{
+    int tileX0 = SDL_max((int)minX / TILE_WIDTH, 0);
+    int tileY0 = SDL_max((int)minY / TILE_HEIGHT, 0);
+    int tileX1 = SDL_min((int)maxX / TILE_WIDTH, TILES_X - 1);
+    int tileY1 = SDL_min((int)maxY / TILE_HEIGHT, TILES_Y - 1);
+
+    for (int ty = tileY0; ty <= tileY1; ty++)
+    {
+        for (int tx = tileX0; tx <= tileX1; tx++)
+        {
+            TileBin *bin = &occlusion.bins[ty * TILES_X + tx];
+            if (bin->count == bin->capacity)
+            {
+                bin->capacity = SDL_max(bin->capacity * 2, 256);
+                bin->triangles = SDL_realloc(bin->triangles, bin->capacity * sizeof(int));
+            }
+
+            bin->triangles[bin->count++] = triangle;
+            occlusion.stats.binned++;
+        }
+    }
+}
+
+void Occlusion_addOccluder(const float *positions, int vertexCount, const unsigned short *indices, int indexCount)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // clip space positions, screen x/y and depth for every vertex
+    vec4 *clip = FrameArena_alloc(occlusion.scratch, vertexCount * sizeof(vec4), sizeof(vec4));
+    if (!clip)
+    {
+        // an occluder that is left out only loses occlusion
+        occlusion.stats.setupMs += elapsedMs(start);
+        return;
+    }
+
+    for (int v = 0; v < vertexCount; v++)
+    {
+        vec4 position = {positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2], 1.0f};
+        glm_mat4_mulv(occlusion.viewProjection, position, clip[v]);
+
+        if (clip[v][3] > NEAR_W)
+        {
+            float invW = 1.0f / clip[v][3];
+            clip[v][0] = (clip[v][0] * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+            clip[v][1] = (clip[v][1] * invW * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+            clip[v][2] = clip[v][2] * invW * 0.5f + 0.5f;
+        }
+    }
+
+    for (int i = 0; i + 2 < indexCount; i += 3)
+    {
+        occlusion.stats.triangles++;
+
+        const float *a = clip[indices[i]];
+        const float *b = clip[indices[i + 1]];
+        const float *c = clip[indices[i + 2]];
+
+        // dropping a triangle that crosses the near plane only loses occlusion
+        if (a[3] <= NEAR_W || b[3] <= NEAR_W || c[3] <= NEAR_W)
+            continue;
+
+        float minX = glm_min(a[0], glm_min(b[0], c[0]));
+        float minY = glm_min(a[1], glm_min(b[1], c[1]));
+        float maxX = glm_max(a[0], glm_max(b[0], c[0]));
+        float maxY = glm_max(a[1], glm_max(b[1], c[1]));
+        if (maxX < 0.0f || maxY < 0.0f || minX >= OCCLUSION_WIDTH || minY >= OCCLUSION_HEIGHT)
+            continue;
+
+        float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+        if (fabsf(area) < 1e-6f)
+            continue;
+
+        if (occlusion.triangleCount == occlusion.triangleCapacity)
+        {
+            occlusion.triangleCapacity = SDL_max(occlusion.triangleCapacity * 2, 1024);
+            occlusion.triangles = SDL_realloc(occlusion.triangles, occlusion.triangleCapacity * sizeof(OccluderTriangle));
+        }
+
+        // occluders are rasterized from both sides, so fix the winding here
+        const float *corners[3] = {a, area > 0.0f ? b : c, area > 0.0f ? c : b};
+        OccluderTriangle *triangle = &occlusion.triangles[occlusion.triangleCount];
+        for (int k = 0; k < 3; k++)
+        {
+            triangle->x[k] = corners[k][0];
+            triangle->y[k] = corners[k][1];
+            triangle->z[k] = corners[k][2];
+        }
+
+        binTriangle(occlusion.triangleCount++, minX, minY, maxX, maxY);
+    }
+
+    occlusion.stats.setupMs += elapsedMs(start);
+}
+
+static void rasterTriangle(const OccluderTriangle *triangle, int tileX, int tileY)
+{
+    const float *x = triangle->x;
+    const float *y = triangle->y;
+    const float *z = triangle->z;
+
+    // edge k is the one opposite vertex k; all three are >= 0 inside
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (int k = 0; k < 3; k++)
+    {
+        int from = (k + 1) % 3;
+        int to = (k + 2) % 3;
+        edgeA[k] = y[from] - y[to];
+        edgeB[k] = x[to] - x[from];
+        edgeC[k] = x[from] * y[to] - y[from] * x[to];
+    }
+
+    float area = edgeC[0] + edgeC[1] + edgeC[2];
+    if (area <= 0.0f)
+        return;
+
+    // depth is linear in screen space: z = depthA * x + depthB * y + depthC
+    float invArea = 1.0f / area;
+    float depthA = (edgeA[0] * z[0] + edgeA[1] * z[1] + edgeA[2] * z[2]) * invArea;
+    float depthB = (edgeB[0] * z[0] + edgeB[1] * z[1] + edgeB[2] * z[2]) * invArea;
+    float depthC = (edgeC[0] * z[0] + edgeC[1] * z[1] + edgeC[2] * z[2]) * invArea;
+
+    int tileMinX = tileX * TILE_WIDTH;
+    int tileMinY = tileY * TILE_HEIGHT;
+    int minX = SDL_max((int)floorf(glm_min(x[0], glm_min(x[1], x[2]))), tileMinX) & ~3;
+    int minY = SDL_max((int)floorf(glm_min(y[0], glm_min(y[1], y[2]))), tileMinY);
+    int maxX = SDL_min((int)ceilf(glm_max(x[0], glm_max(x[1], x[2]))), tileMinX + TILE_WIDTH);
+    int maxY = SDL_min((int)ceilf(glm_max(y[0], glm_max(y[1], y[2]))), tileMinY + TILE_HEIGHT);
+
+    float *depth = occlusion.levels[0];
+
+#ifdef OCCLUSION_SSE
+    __m128 stepX = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+    __m128 depthX = _mm_set1_ps(depthA);
+    __m128 zero = _mm_setzero_ps();
+
+    for (int py = minY; py < maxY; py++)
+    {
+        float centerY = py + 0.5f;
+        __m128 row0 = _mm_set1_ps(edgeB[0] * centerY + edgeC[0]);
+        __m128 row1 = _mm_set1_ps(edgeB[1] * centerY + edgeC[1]);
+        __m128 row2 = _mm_set1_ps(edgeB[2] * centerY + edgeC[2]);
+        __m128 rowDepth = _mm_set1_ps(depthB * centerY + depthC);
+
+        float *line = depth + py * OCCLUSION_WIDTH;
+        for (int px = minX; px < maxX; px += 4)
+        {
+            __m128 centerX = _mm_add_ps(_mm_set1_ps((float)px), stepX);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, centerX), row0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, centerX), row1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, centerX), row2);
+
+            __m128 inside = _mm_cmpge_ps(_mm_min_ps(_mm_min_ps(e0, e1), e2), zero);
+            if (!_mm_movemask_ps(inside))
+                continue;
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(depthX, centerX), rowDepth);
+            __m128 current = _mm_load_ps(line + px);
+            __m128 nearest = _mm_min_ps(current, z);
+            _mm_store_ps(line + px, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+        }
+    }
+#else
+    for (int py = minY; py < maxY; py++)
+    {
+        float centerY = py + 0.5f;
+        float *line = depth + py * OCCLUSION_WIDTH;
+        for (int px = minX; px < maxX; px++)
+        {
+            float centerX = px + 0.5f;
+            float e0 = edgeA[0] * centerX + edgeB[0] * centerY + edgeC[0];
+            float e1 = edgeA[1] * centerX + edgeB[1] * centerY + edgeC[1];
+            float e2 = edgeA[2] * centerX + edgeB[2] * centerY + edgeC[2];
+            if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f)
+                continue;
+
+            float z = depthA * centerX + depthB * centerY + depthC;
+            line[px] = glm_min(line[px], z);
+        }
+    }
+#endif
+}
+
+static void rasterTiles(void *data, int start, int end)
+{
+    for (int t = start; t < end; t++)
+    {
+        int tileX = t % TILES_X;
+        int tileY = t / TILES_X;
+
+        for (int py = tileY * TILE_HEIGHT; py < (tileY + 1) * TILE_HEIGHT; py++)
+        {
+            float *line = occlusion.levels[0] + py * OCCLUSION_WIDTH + tileX * TILE_WIDTH;
+            for (int px = 0; px < TILE_WIDTH; px++)
+            {
+                line[px] = 1.0f;
+            }
+        }
+
+        const TileBin *bin = &occlusion.bins[t];
+        for (int i = 0; i < bin->count; i++)
+        {
+            rasterTriangle(&occlusion.triangles[bin->triangles[i]], tileX, tileY);
+        }
+    }
+}
+
+void Occlusion_rasterize()
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    Job_parallelFor(TILE_COUNT, 1, rasterTiles, NULL);
+
+    for (int level = 1; level < HIZ_LEVELS; level++)
+    {
+        int width = OCCLUSION_WIDTH >> level;
+        int height = OCCLUSION_HEIGHT >> level;
+        const float *below = occlusion.levels[level - 1];
+        float *current = occlusion.levels[level];
+
+        for (int y = 0; y < height; y++)
+        {
+            const float *row0 = below + (2 * y) * (width * 2);
+            const float *row1 = row0 + width * 2;
+            for (int x = 0; x < width; x++)
+            {
+                current[y * width + x] = glm_max(glm_max(row0[2 * x], row0[2 * x + 1]), glm_max(row1[2 * x], row1[2 * x + 1]));
+            }
+        }
+    }
+
+    occlusion.stats.rasterMs = elapsedMs(start);
+}
+
+bool Occlusion_testAABB(vec3 min, vec3 max)
+{
+    occlusion.stats.tested++;
+
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    float nearest = FLT_MAX;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        vec4 position = {
+            (corner & 1) ? max[0] : min[0],
+            (corner & 2) ? max[1] : min[1],
+            (corner & 4) ? max[2] : min[2],
+            1.0f};
+
+        vec4 clip;
+        glm_mat4_mulv(occlusion.viewProjection, position, clip);
+
+        // boxes reaching behind the camera are never occluded
+        if (clip[3] <= NEAR_W)
+            return true;
+
+        float invW = 1.0f / clip[3];
+        float x = (clip[0] * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        float y = (clip[1] * invW * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+        minX = glm_min(minX, x);
+        minY = glm_min(minY, y);
+        maxX = glm_max(maxX, x);
+        maxY = glm_max(maxY, y);
+        nearest = glm_min(nearest, clip[2] * invW * 0.5f + 0.5f);
+    }
+
+    int x0 = SDL_max((int)floorf(minX), 0);
+    int y0 = SDL_max((int)floorf(minY), 0);
+    int x1 = SDL_min((int)floorf(maxX), OCCLUSION_WIDTH - 1);
+    int y1 = SDL_min((int)floorf(maxY), OCCLUSION_HEIGHT - 1);
+    if (x0 > x1 || y0 > y1)
+        return true;
+
+    // coarsest level where the box still spans at most 4x4 texels
+    int level = 0;
+    while (level < HIZ_LEVELS - 1 && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3))
+    {
+        level++;
+    }
+
+    int width = OCCLUSION_WIDTH >> level;
+    const float *depth = occlusion.levels[level];
+    for (int y = y0 >> level; y <= y1 >> level; y++)
+    {
+        for (int x = x0 >> level; x <= x1 >> level; x++)
+        {
+            if (depth[y * width + x] >= nearest)
+                return true;
+        }
+    }
+
+    occlusion.stats.culled++;
+    return false;
+}
+
+OcclusionStats Occlusion_stats()
+{
+    return occlusion.stats;
+}
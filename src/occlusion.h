@@ -0,0 +1,42 @@
+#ifndef OCCLUSION_INCLUDED
+#define OCCLUSION_INCLUDED
+
+#include <stdbool.h>
+#include "cglm/cglm.h"
+
+#include "framearena.h"
+
+// Low resolution CPU depth buffer for occlusion culling. Occluders are
+// transformed and binned into screen tiles on the calling thread, then the
+// tiles are rasterized in parallel on the job system and reduced into a
+// max-depth pyramid (hierarchical Z) that bounding boxes are tested against.
+//
+// Occluder geometry must lie inside the real surfaces it stands for, or
+// visible objects get culled.
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+
+typedef struct OcclusionStats
+{
+    int triangles; // occluder triangles submitted this frame
+    int binned;    // triangle/tile pairs rasterized
+    int tested;
+    int culled;
+    double setupMs;  // transform and binning
+    double rasterMs; // tiles and pyramid
+} OcclusionStats;
+
+void Occlusion_init();
+void Occlusion_free();
+
+// scratch holds the frame's transformed occluder vertices
+void Occlusion_begin(mat4 viewProjection, FrameArena *scratch);
+void Occlusion_addOccluder(const float *positions, int vertexCount, const unsigned short *indices, int indexCount);
+void Occlusion_rasterize();
+
+// false only when every pixel the box covers has an occluder in front of it
+bool Occlusion_testAABB(vec3 min, vec3 max);
+
+OcclusionStats Occlusion_stats();
+
+#endif
@@ -0,0 +1,226 @@
+#include "particles.h"
+#include "glstate.h"
+#include "shader.h"
+
+// position and age, then velocity and lifetime
+#define PARTICLE_STRIDE (8 * sizeof(float))
+
+enum
+{
+    UPDATE_DELTA_TIME,
+    UPDATE_GRAVITY,
+    UPDATE_PLANE,
+    UPDATE_RESTITUTION,
+    UPDATE_SEED,
+    UPDATE_EMITTER_COUNT,
+    UPDATE_SLOTS,
+    UPDATE_LAUNCHES,
+    UPDATE_VELOCITIES
+};
+
+enum
+{
+    DRAW_VIEW,
+    DRAW_PROJECTION,
+    DRAW_POINT_SCALE,
+    DRAW_EMITTER_COUNT,
+    DRAW_SLOTS,
+    DRAW_COLORS,
+    DRAW_SIZES
+};
+
+void Particles_init(ParticleSystem *system, int capacity)
+{
+    SDL_memset(system, 0, sizeof(ParticleSystem));
+    system->capacity = capacity;
+    glm_vec3_copy((vec3){0.0f, -9.81f, 0.0f}, system->gravity);
+    glm_vec4_copy((vec4){0.0f, 1.0f, 0.0f, 1e6f}, system->plane);
+    system->restitution = 0.4f;
+
+    const char *varyings[] = {"positionAge", "velocityLife"};
+    system->updateProgram = CreateFeedbackProgram("./shaders/particles_update.vert", varyings, 2);
+    system->drawProgram = CreateProgram("./shaders/particles.vert", "./shaders/particles.frag");
+
+    const char *updateNames[] = {"deltaTime", "gravity", "plane", "restitution", "seed", "emitterCount", "emitterSlots", "emitterLaunches", "emitterVelocities"};
+    for (int i = 0; i < 9; i++)
+        system->updateLocations[i] = glGetUniformLocation(system->updateProgram, updateNames[i]);
+
+    const char *drawNames[] = {"view", "projection", "pointScale", "emitterCount", "emitterSlots", "emitterColors", "emitterSizes"};
+    for (int i = 0; i < 7; i++)
+        system->drawLocations[i] = glGetUniformLocation(system->drawProgram, drawNames[i]);
+
+    // every particle starts dead: age 0 is not below lifetime 0
+    void *zeros = SDL_calloc(capacity, PARTICLE_STRIDE);
+    glGenBuffers(2, system->buffers);
+    glGenVertexArrays(2, system->vaos);
+    for (int b = 0; b < 2; b++)
+    {
+        GLState_bindVertexArray(system->vaos[b]);
+        GLState_bindBuffer(GL_ARRAY_BUFFER, system->buffers[b]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * PARTICLE_STRIDE, zeros, GL_DYNAMIC_COPY);
+
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, PARTICLE_STRIDE, (void *)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, PARTICLE_STRIDE, (void *)(4 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+    GLState_bindVertexArray(0);
+    GLState_bindBuffer(GL_ARRAY_BUFFER, 0);
+    SDL_free(zeros);
+
+    GpuTimer_init(&system->timer);
+}
+
+void Particles_free(ParticleSystem *system)
+{
+    GpuTimer_free(&system->timer);
+    glDeleteVertexArrays(2, system->vaos);
+    glDeleteBuffers(2, system->buffers);
+    glDeleteProgram(system->updateProgram);
+    glDeleteProgram(system->drawProgram);
+    GLState_invalidate();
+
+    SDL_memset(system, 0, sizeof(ParticleSystem));
+}
+
+int Particles_addEmitter(ParticleSystem *system, int count)
+{
+    if (system->emitterCount >= PARTICLE_MAX_EMITTERS || count <= 0 || system->used + count > system->capacity)
+    {
+        SDL_Log("Particles: no room for an emitter of %d (%d/%d slots, %d emitters)", count, system->used, system->capacity, system->emitterCount);
+        return -1;
+    }
+
+    ParticleEmitter *emitter = &system->emitters[system->emitterCount];
+    SDL_memset(emitter, 0, sizeof(ParticleEmitter));
+    emitter->first = system->used;
+    emitter->count = count;
+    emitter->lifetime = 1.0f;
+    emitter->size = 0.1f;
+    glm_vec4_one(emitter->color);
+
+    system->used += count;
+    return system->emitterCount++;
+}
+
+void Particles_burst(ParticleSystem *system, int emitter, int count)
+{
+    if (emitter >= 0 && emitter < system->emitterCount)
+        system->emitters[emitter].spawnCount += count;
+}
+
+void Particles_update(ParticleSystem *system, float deltaTime)
+{
+    GpuTimer_beginFrame(&system->timer);
+    system->frame++;
+    system->stats.spawned = 0;
+
+    GLint slots[PARTICLE_MAX_EMITTERS][4];
+    vec4 launches[PARTICLE_MAX_EMITTERS];
+    vec4 velocities[PARTICLE_MAX_EMITTERS];
+    for (int e = 0; e < system->emitterCount; e++)
+    {
+        ParticleEmitter *emitter = &system->emitters[e];
+        emitter->owed += emitter->rate * deltaTime;
+        int due = (int)emitter->owed;
+        emitter->owed -= due;
+
+        // a window wider than the range would overwrite itself
+        int spawn = SDL_min(emitter->spawnCount + due, emitter->count);
+        slots[e][0] = emitter->first;
+        slots[e][1] = emitter->count;
+        slots[e][2] = emitter->cursor;
+        slots[e][3] = spawn;
+        emitter->cursor = (emitter->cursor + spawn) % emitter->count;
+        emitter->spawnCount = 0;
+        system->stats.spawned += spawn;
+
+        glm_vec4(emitter->position, emitter->spread, launches[e]);
+        glm_vec4(emitter->velocity, emitter->lifetime, velocities[e]);
+    }
+
+    if (system->used == 0)
+        return;
+
+    GpuTimer_mark(&system->timer, PARTICLE_MARK_UPDATE);
+
+    GLState_useProgram(system->updateProgram);
+    glUniform1f(system->updateLocations[UPDATE_DELTA_TIME], deltaTime);
+    glUniform3fv(system->updateLocations[UPDATE_GRAVITY], 1, system->gravity);
+    glUniform4fv(system->updateLocations[UPDATE_PLANE], 1, system->plane);
+    glUniform1f(system->updateLocations[UPDATE_RESTITUTION], system->restitution);
+    glUniform1ui(system->updateLocations[UPDATE_SEED], system->frame * 0x9E3779B9u);
+    glUniform1i(system->updateLocations[UPDATE_EMITTER_COUNT], system->emitterCount);
+    glUniform4iv(system->updateLocations[UPDATE_SLOTS], system->emitterCount, &slots[0][0]);
+    glUniform4fv(system->updateLocations[UPDATE_LAUNCHES], system->emitterCount, &launches[0][0]);
+    glUniform4fv(system->updateLocations[UPDATE_VELOCITIES], system->emitterCount, &velocities[0][0]);
+
+    // read one buffer, capture into the other; nothing reaches the rasterizer
+    GLState_enable(GL_RASTERIZER_DISCARD);
+    GLState_bindVertexArray(system->vaos[system->current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, system->buffers[1 - system->current]);
+
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, system->used);
+    glEndTransformFeedback();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    GLState_disable(GL_RASTERIZER_DISCARD);
+    system->current = 1 - system->current;
+
+    GpuTimer_mark(&system->timer, PARTICLE_MARK_UPDATED);
+}
+
+void Particles_draw(ParticleSystem *system, mat4 *view, mat4 *projection, float viewportHeight)
+{
+    if (system->used == 0)
+        return;
+
+    GLint slots[PARTICLE_MAX_EMITTERS][4];
+    vec4 colors[PARTICLE_MAX_EMITTERS];
+    float sizes[PARTICLE_MAX_EMITTERS];
+    for (int e = 0; e < system->emitterCount; e++)
+    {
+        slots[e][0] = system->emitters[e].first;
+        slots[e][1] = system->emitters[e].count;
+        slots[e][2] = slots[e][3] = 0;
+        glm_vec4_copy(system->emitters[e].color, colors[e]);
+        sizes[e] = system->emitters[e].size;
+    }
+
+    GpuTimer_mark(&system->timer, PARTICLE_MARK_DRAW);
+
+    GLState_useProgram(system->drawProgram);
+    glUniformMatrix4fv(system->drawLocations[DRAW_VIEW], 1, GL_FALSE, (float *)*view);
+    glUniformMatrix4fv(system->drawLocations[DRAW_PROJECTION], 1, GL_FALSE, (float *)*projection);
+    // pixels across for one world unit at distance 1
+    glUniform1f(system->drawLocations[DRAW_POINT_SCALE], viewportHeight * (*projection)[1][1] * 0.5f);
+    glUniform1i(system->drawLocations[DRAW_EMITTER_COUNT], system->emitterCount);
+    glUniform4iv(system->drawLocations[DRAW_SLOTS], system->emitterCount, &slots[0][0]);
+    glUniform4fv(system->drawLocations[DRAW_COLORS], system->emitterCount, &colors[0][0]);
+    glUniform1fv(system->drawLocations[DRAW_SIZES], system->emitterCount, sizes);
+
+    GLState_enable(GL_PROGRAM_POINT_SIZE);
+    GLState_enable(GL_BLEND);
+    GLState_blendFunc(GL_SRC_ALPHA, GL_ONE);
+    GLState_depthMask(GL_FALSE);
+
+    GLState_bindVertexArray(system->vaos[system->current]);
+    glDrawArrays(GL_POINTS, 0, system->used);
+
+    // the games' own points size themselves with GLState_pointSize
+    GLState_depthMask(GL_TRUE);
+    GLState_disable(GL_BLEND);
+    GLState_disable(GL_PROGRAM_POINT_SIZE);
+
+    GpuTimer_mark(&system->timer, PARTICLE_MARK_DRAWN);
+}
+
+ParticleStats Particles_stats(const ParticleSystem *system)
+{
+    ParticleStats stats = system->stats;
+    stats.slots = system->used;
+    stats.updateMs = GpuTimer_ms(&system->timer, PARTICLE_MARK_UPDATE, PARTICLE_MARK_UPDATED);
+    stats.drawMs = GpuTimer_ms(&system->timer, PARTICLE_MARK_DRAW, PARTICLE_MARK_DRAWN);
+    return stats;
+}
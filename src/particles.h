@@ -0,0 +1,102 @@
+#ifndef PARTICLES_INCLUDED
+#define PARTICLES_INCLUDED
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "cglm/cglm.h"
+
+#include "gputimer.h"
+
+// Particles that live entirely on the GPU. Two buffers take turns: a vertex
+// shader reads every particle from one, emits, ages, moves and bounces it off
+// a plane, and transform feedback writes the result into the other, with
+// rasterization off. Drawing reads the newest buffer as point sprites. The
+// CPU only sets a few uniforms per emitter each frame, however many
+// particles there are.
+//
+// Each emitter owns a fixed range of slots and spawns into them round-robin,
+// so a slot is reused once its particle has lived at most count / rate
+// seconds. Spawning writes a window of slots starting at the emitter's
+// cursor; bursts and the steady rate share that window.
+//
+// Shaders are loaded from ./shaders/particles_update.vert, particles.vert
+// and particles.frag.
+#define PARTICLE_MAX_EMITTERS 8
+
+// GpuTimer marks around the update and the draw
+enum
+{
+    PARTICLE_MARK_UPDATE,
+    PARTICLE_MARK_UPDATED,
+    PARTICLE_MARK_DRAW,
+    PARTICLE_MARK_DRAWN
+};
+
+typedef struct ParticleEmitter
+{
+    int first, count; // slots
+
+    // set freely between updates; spawned particles take the values of the update they spawn in
+    vec3 position;
+    vec3 velocity;  // mean launch velocity
+    float spread;   // up to this much speed more, in a random direction
+    float lifetime; // seconds, randomly within 25% either way
+    float rate;     // particles per second, 0 for bursts only
+    float size;     // world units across
+    vec4 color;     // alpha fades out over the lifetime
+
+    int cursor; // next slot to spawn into, relative to first
+    float owed; // fraction of a particle the rate has not spawned yet
+    int spawnCount; // this frame's window, starting at cursor
+} ParticleEmitter;
+
+typedef struct ParticleStats
+{
+    int slots;   // assigned to emitters
+    int spawned; // in the last update
+    double updateMs, drawMs; // GPU, a few frames old; -1 until known
+} ParticleStats;
+
+typedef struct ParticleSystem
+{
+    int capacity;
+    int used; // slots given to emitters
+    GLuint buffers[2];
+    GLuint vaos[2]; // each reads one buffer
+    int current;    // the buffer holding the latest particles
+
+    ParticleEmitter emitters[PARTICLE_MAX_EMITTERS];
+    int emitterCount;
+
+    vec3 gravity;
+    vec4 plane;        // normal and offset; dot(normal, p) + offset < 0 is inside
+    float restitution; // of the velocity into the plane, kept on a bounce
+
+    GLuint updateProgram, drawProgram;
+    GLint updateLocations[9];
+    GLint drawLocations[7];
+    Uint32 frame;
+
+    GpuTimer timer;
+    ParticleStats stats;
+} ParticleSystem;
+
+void Particles_init(ParticleSystem *system, int capacity);
+void Particles_free(ParticleSystem *system);
+
+// Gives the next count slots to a new emitter, which starts idle at the
+// origin. Returns its index, or -1 when the slots or emitters run out.
+int Particles_addEmitter(ParticleSystem *system, int count);
+
+// spawns count more at the next update, on top of the rate
+void Particles_burst(ParticleSystem *system, int emitter, int count);
+
+// steps every particle by deltaTime on the GPU
+void Particles_update(ParticleSystem *system, float deltaTime);
+
+// additive point sprites, depth tested but not written; viewportHeight in pixels
+void Particles_draw(ParticleSystem *system, mat4 *view, mat4 *projection, float viewportHeight);
+
+ParticleStats Particles_stats(const ParticleSystem *system);
+
+#endif
@@ -0,0 +1,312 @@
+#include <SDL2/SDL.h>
+
+#include "pointshadow.h"
+#include "glstate.h"
+
+#define ALL_FACES ((1u << POINT_SHADOW_FACES) - 1)
+
+// GL cube map face order, with the up vectors that make a face's clip space
+// line up with cube map texture coordinates
+static const vec3 faceDirections[POINT_SHADOW_FACES] = {
+    {1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}};
+static const vec3 faceUps[POINT_SHADOW_FACES] = {
+    {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}};
+
+// distance from zero to the nearest point of [min, max]
+static float nearestAbs(float min, float max)
+{
+    if (min > 0.0f)
+        return min;
+    if (max < 0.0f)
+        return -max;
+    return 0.0f;
+}
+
+// The faces a box overlaps, relative to the light. A face owns the points
+// where its axis is the major one, so the box reaches it when its furthest
+// extent along the axis beats the nearest it gets to the other two.
+static unsigned int boxFaces(vec3 min, vec3 max)
+{
+    unsigned int faces = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        float side = glm_max(nearestAbs(min[u], max[u]), nearestAbs(min[v], max[v]));
+
+        if (max[axis] > 0.0f && max[axis] >= side)
+            faces |= 1u << (axis * 2);
+        if (min[axis] < 0.0f && -min[axis] >= side)
+            faces |= 1u << (axis * 2 + 1);
+    }
+
+    return faces;
+}
+
+void PointShadow_init(PointShadows *shadows, int lightCapacity, int size, int faceBudget)
+{
+    SDL_memset(shadows, 0, sizeof(PointShadows));
+    shadows->size = size;
+    shadows->lightCapacity = lightCapacity;
+    shadows->faceBudget = faceBudget;
+    shadows->lights = SDL_malloc(lightCapacity * sizeof(PointShadowLight));
+    shadows->requests = SDL_malloc(lightCapacity * sizeof(int));
+
+    for (int s = 0; s < POINT_SHADOW_SLOTS; s++)
+        shadows->slotLights[s] = -1;
+
+    glGenTextures(1, &shadows->texture);
+    GLState_bindTexture(0, GL_TEXTURE_2D_ARRAY, shadows->texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, POINT_SHADOW_SLOTS * POINT_SHADOW_FACES, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+    // hardware depth comparison with bilinear filtering; faces meet at the edges, so clamp
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    GLState_bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &shadows->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows->framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows->texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        SDL_Log("PointShadows: framebuffer incomplete (0x%x)", status);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PointShadow_free(PointShadows *shadows)
+{
+    glDeleteFramebuffers(1, &shadows->framebuffer);
+    glDeleteTextures(1, &shadows->texture);
+    GLState_invalidate();
+
+    SDL_free(shadows->lights);
+    SDL_free(shadows->requests);
+    SDL_memset(shadows, 0, sizeof(PointShadows));
+}
+
+int PointShadow_addLight(PointShadows *shadows, vec3 position, float radius)
+{
+    if (shadows->lightCount >= shadows->lightCapacity)
+        return -1;
+
+    PointShadowLight *light = &shadows->lights[shadows->lightCount];
+    glm_vec3_copy(position, light->position);
+    light->radius = radius;
+    light->slot = -1;
+    light->complete = false;
+    light->dirty = ALL_FACES;
+    light->lastUsed = 0;
+
+    return shadows->lightCount++;
+}
+
+void PointShadow_moveLight(PointShadows *shadows, int light, vec3 position, float radius)
+{
+    PointShadowLight *shadowLight = &shadows->lights[light];
+    if (glm_vec3_eqv(shadowLight->position, position) && shadowLight->radius == radius)
+        return;
+
+    // faces rendered from the old position no longer line up with the new
+    // one, so the light is not sampled until all six are rendered again
+    glm_vec3_copy(position, shadowLight->position);
+    shadowLight->radius = radius;
+    shadowLight->dirty = ALL_FACES;
+    shadowLight->complete = false;
+}
+
+void PointShadow_moveCaster(PointShadows *shadows, vec3 min, vec3 max)
+{
+    // lights without a slot get every face rendered once they have one anyway
+    for (int s = 0; s < POINT_SHADOW_SLOTS; s++)
+    {
+        if (shadows->slotLights[s] < 0)
+            continue;
+
+        PointShadowLight *light = &shadows->lights[shadows->slotLights[s]];
+        if (light->dirty == ALL_FACES)
+            continue;
+
+        vec3 relativeMin, relativeMax, nearest;
+        glm_vec3_sub(min, light->position, relativeMin);
+        glm_vec3_sub(max, light->position, relativeMax);
+
+        glm_vec3_maxv(relativeMin, (vec3){0.0f, 0.0f, 0.0f}, nearest);
+        glm_vec3_minv(nearest, relativeMax, nearest);
+        if (glm_vec3_norm2(nearest) > light->radius * light->radius)
+            continue;
+
+        light->dirty |= boxFaces(relativeMin, relativeMax);
+    }
+}
+
+void PointShadow_beginFrame(PointShadows *shadows)
+{
+    shadows->frame++;
+    shadows->requestCount = 0;
+    shadows->cursor = 0;
+    SDL_memset(&shadows->stats, 0, sizeof(PointShadowStats));
+}
+
+int PointShadow_request(PointShadows *shadows, int light)
+{
+    PointShadowLight *shadowLight = &shadows->lights[light];
+    if (shadowLight->lastUsed == shadows->frame)
+        return shadowLight->slot;
+
+    if (shadowLight->slot < 0)
+    {
+        // a free slot, otherwise the one requested longest ago, never one already asked for this frame
+        int slot = -1;
+        unsigned int oldest = shadows->frame;
+        for (int s = 0; s < POINT_SHADOW_SLOTS; s++)
+        {
+            int owner = shadows->slotLights[s];
+            if (owner < 0)
+            {
+                slot = s;
+                break;
+            }
+
+            if (shadows->lights[owner].lastUsed < oldest)
+            {
+                oldest = shadows->lights[owner].lastUsed;
+                slot = s;
+            }
+        }
+
+        if (slot < 0)
+            return -1;
+
+        int owner = shadows->slotLights[slot];
+        if (owner >= 0)
+        {
+            shadows->lights[owner].slot = -1;
+            shadows->lights[owner].complete = false;
+            shadows->stats.evictions++;
+        }
+
+        shadows->slotLights[slot] = light;
+        shadowLight->slot = slot;
+        shadowLight->complete = false;
+        shadowLight->dirty = ALL_FACES;
+    }
+
+    shadowLight->lastUsed = shadows->frame;
+    shadows->requests[shadows->requestCount++] = light;
+    shadows->stats.requested++;
+
+    return shadowLight->slot;
+}
+
+int PointShadow_sampleSlot(const PointShadows *shadows, int light)
+{
+    const PointShadowLight *shadowLight = &shadows->lights[light];
+    return shadowLight->slot >= 0 && shadowLight->complete ? shadowLight->slot + 1 : 0;
+}
+
+bool PointShadow_next(PointShadows *shadows, int *light, int *face)
+{
+    for (; shadows->cursor < shadows->requestCount; shadows->cursor++)
+    {
+        int l = shadows->requests[shadows->cursor];
+        unsigned int dirty = shadows->lights[l].dirty;
+        if (!dirty)
+            continue;
+
+        // over budget, what is left waits for the next frames; a light that
+        // is not sampled yet finishes once it has started, so it is not left
+        // unshadowed for longer than it has to be
+        bool started = !shadows->lights[l].complete && dirty != ALL_FACES;
+        if (shadows->stats.faces >= shadows->faceBudget && !started)
+        {
+            for (int r = shadows->cursor; r < shadows->requestCount; r++)
+            {
+                for (unsigned int bits = shadows->lights[shadows->requests[r]].dirty; bits; bits &= bits - 1)
+                    shadows->stats.postponed++;
+            }
+
+            shadows->cursor = shadows->requestCount;
+            return false;
+        }
+
+        int f = 0;
+        while (!(dirty & (1u << f)))
+            f++;
+
+        *light = l;
+        *face = f;
+        return true;
+    }
+
+    return false;
+}
+
+void PointShadow_faceViewProjection(const PointShadows *shadows, int light, int face, mat4 viewProjection)
+{
+    const PointShadowLight *shadowLight = &shadows->lights[light];
+
+    mat4 projection, view;
+    glm_perspective(glm_rad(90.0f), 1.0f, POINT_SHADOW_NEAR, shadowLight->radius, projection);
+
+    vec3 target;
+    glm_vec3_add((float *)shadowLight->position, (float *)faceDirections[face], target);
+    glm_lookat((float *)shadowLight->position, target, (float *)faceUps[face], view);
+    glm_mat4_mul(projection, view, viewProjection);
+}
+
+void PointShadow_begin(PointShadows *shadows, int light, int face)
+{
+    PointShadowLight *shadowLight = &shadows->lights[light];
+
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows->framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows->texture, 0, shadowLight->slot * POINT_SHADOW_FACES + face);
+    glViewport(0, 0, shadows->size, shadows->size);
+
+    GLState_depthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    GLState_enable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+}
+
+void PointShadow_end(PointShadows *shadows, int light, int face)
+{
+    PointShadowLight *shadowLight = &shadows->lights[light];
+    shadowLight->dirty &= ~(1u << face);
+    if (!shadowLight->dirty)
+        shadowLight->complete = true;
+
+    shadows->stats.faces++;
+}
+
+void PointShadow_finish(PointShadows *shadows, int width, int height)
+{
+    for (int r = 0; r < shadows->requestCount; r++)
+    {
+        if (shadows->lights[shadows->requests[r]].complete)
+            shadows->stats.resident++;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    GLState_disable(GL_POLYGON_OFFSET_FILL);
+}
+
+void PointShadow_bind(PointShadows *shadows, GLuint program, int unit)
+{
+    if (shadows->program != program)
+    {
+        shadows->program = program;
+        shadows->location = glGetUniformLocation(program, "pointShadows");
+    }
+
+    GLState_bindTexture(unit, GL_TEXTURE_2D_ARRAY, shadows->texture);
+    glUniform1i(shadows->location, unit);
+}
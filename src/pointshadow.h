@@ -0,0 +1,109 @@
+#ifndef POINTSHADOW_INCLUDED
+#define POINTSHADOW_INCLUDED
+
+#include <stdbool.h>
+#include <GL/glew.h>
+#include "cglm/cglm.h"
+
+// Cached omnidirectional shadows for point lights. The atlas is one depth
+// texture array with POINT_SHADOW_SLOTS groups of six layers, a cube face per
+// layer in GL cube map order (+x, -x, +y, -y, +z, -z), so it works on GL 3.3
+// without cube map arrays.
+//
+// Nothing is re-rendered unless it changed: every light keeps a dirty bit per
+// face, set when the light moves or a caster moves through that face. A light
+// gets a slot when requested, taking a free one or the least recently
+// requested one; a fresh slot has all six faces dirty and is only sampled
+// once each has been rendered. Static lights over static casters cost nothing
+// after their first frame.
+//
+// A face looks down its axis with POINT_SHADOW_NEAR and the light's radius as
+// near and far planes; see shaders that sample pointShadows for the lookup.
+#define POINT_SHADOW_SLOTS 16
+#define POINT_SHADOW_FACES 6
+#define POINT_SHADOW_NEAR 0.05f
+
+typedef struct PointShadowLight
+{
+    vec3 position;
+    float radius;
+
+    int slot;              // -1 while it has none
+    bool complete;         // every face rendered since it got the slot
+    unsigned int dirty;    // bit per face
+    unsigned int lastUsed; // frame it was last requested
+} PointShadowLight;
+
+typedef struct PointShadowStats
+{
+    int requested;
+    int resident;  // requested and complete, so sampled
+    int faces;     // rendered this frame
+    int postponed; // dirty faces left for later by the budget
+    int evictions;
+} PointShadowStats;
+
+typedef struct PointShadows
+{
+    GLuint texture; // GL_TEXTURE_2D_ARRAY, POINT_SHADOW_FACES layers per slot
+    GLuint framebuffer;
+    int size;
+
+    int lightCapacity;
+    int lightCount;
+    PointShadowLight *lights;
+    int slotLights[POINT_SHADOW_SLOTS]; // -1 when free
+
+    // this frame's requests in order, walked by PointShadow_next
+    int *requests;
+    int requestCount;
+    int cursor;
+
+    int faceBudget; // faces rendered per frame at most
+    unsigned int frame;
+    PointShadowStats stats;
+
+    GLuint program; // the uniform location below belongs to it
+    GLint location;
+} PointShadows;
+
+void PointShadow_init(PointShadows *shadows, int lightCapacity, int size, int faceBudget);
+void PointShadow_free(PointShadows *shadows);
+
+// returns the light's index, or -1 when full
+int PointShadow_addLight(PointShadows *shadows, vec3 position, float radius);
+
+// dirties every face when either changed; the light is not sampled again
+// until all of them are rendered
+void PointShadow_moveLight(PointShadows *shadows, int light, vec3 position, float radius);
+
+// Dirties the faces the box overlaps of every light holding a slot. Call it
+// with the bounds a caster left and with the bounds it moved into.
+void PointShadow_moveCaster(PointShadows *shadows, vec3 min, vec3 max);
+
+void PointShadow_beginFrame(PointShadows *shadows);
+
+// Asks for the light's shadows this frame, most important first. Returns the
+// slot, or -1 when every slot is taken by lights already requested.
+int PointShadow_request(PointShadows *shadows, int light);
+
+// slot + 1 when the light's map can be sampled, 0 otherwise
+int PointShadow_sampleSlot(const PointShadows *shadows, int light);
+
+// The next dirty face of the requested lights within the budget, which a light
+// not sampled yet may overrun to finish its faces once started. Render it
+// between begin and end, through a program that transforms by the face's
+// viewProjection. begin clears the face, so have everything the draw needs
+// ready first; a face begun but never ended is left empty.
+bool PointShadow_next(PointShadows *shadows, int *light, int *face);
+void PointShadow_faceViewProjection(const PointShadows *shadows, int light, int face, mat4 viewProjection);
+void PointShadow_begin(PointShadows *shadows, int light, int face);
+void PointShadow_end(PointShadows *shadows, int light, int face);
+
+// back to the default framebuffer and the given viewport
+void PointShadow_finish(PointShadows *shadows, int width, int height);
+
+// binds the atlas to unit and sets pointShadows (sampler2DArrayShadow) on the bound program
+void PointShadow_bind(PointShadows *shadows, GLuint program, int unit);
+
+#endif
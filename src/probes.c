@@ -0,0 +1,251 @@
+#include <float.h>
+
+#include "probes.h"
+#include "glstate.h"
+#include "job.h"
+
+#define SURFACE_OFFSET 1e-3f
+
+typedef struct BakeJob
+{
+    ProbeGrid *grid;
+    const Bvh *scene;
+    const ProbeBakeSettings *settings;
+    long long *rays; // per probe, summed once every job is done
+} BakeJob;
+
+static float randomUnit(Uint32 *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) / 16777216.0f;
+}
+
+// real L2 spherical harmonics at a unit direction
+static void shBasis(vec3 d, float *basis)
+{
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * d[1];
+    basis[2] = 0.488603f * d[2];
+    basis[3] = 0.488603f * d[0];
+    basis[4] = 1.092548f * d[0] * d[1];
+    basis[5] = 1.092548f * d[1] * d[2];
+    basis[6] = 0.315392f * (3.0f * d[2] * d[2] - 1.0f);
+    basis[7] = 1.092548f * d[0] * d[2];
+    basis[8] = 0.546274f * (d[0] * d[0] - d[1] * d[1]);
+}
+
+static void sampleSphere(Uint32 *seed, vec3 direction)
+{
+    float z = 1.0f - 2.0f * randomUnit(seed);
+    float r = sqrtf(glm_max(0.0f, 1.0f - z * z));
+    float phi = 2.0f * GLM_PIf * randomUnit(seed);
+    glm_vec3_copy((vec3){r * cosf(phi), r * sinf(phi), z}, direction);
+}
+
+static void sampleCosine(Uint32 *seed, vec3 normal, vec3 direction)
+{
+    vec3 tangent, bitangent;
+    glm_vec3_cross(fabsf(normal[0]) > 0.5f ? (vec3){0.0f, 1.0f, 0.0f} : (vec3){1.0f, 0.0f, 0.0f}, normal, tangent);
+    glm_vec3_normalize(tangent);
+    glm_vec3_cross(normal, tangent, bitangent);
+
+    float u = randomUnit(seed);
+    float r = sqrtf(u);
+    float phi = 2.0f * GLM_PIf * randomUnit(seed);
+    float x = r * cosf(phi), y = r * sinf(phi), z = sqrtf(glm_max(0.0f, 1.0f - u));
+
+    for (int axis = 0; axis < 3; axis++)
+        direction[axis] = tangent[axis] * x + bitangent[axis] * y + normal[axis] * z;
+}
+
+// Radiance arriving at origin from direction. Surfaces are two sided and
+// diffuse; the sun is sampled directly at every bounce, cosine sampling
+// cancels everything but the albedo from the throughput.
+static void tracePath(const Bvh *scene, const ProbeBakeSettings *settings, Uint32 *seed, vec3 origin, vec3 direction, vec3 radiance, long long *rays)
+{
+    vec3 toSun;
+    glm_vec3_negate_to((float *)settings->sunDirection, toSun);
+    glm_vec3_normalize(toSun);
+
+    vec3 position, ray, throughput = {1.0f, 1.0f, 1.0f};
+    glm_vec3_copy(origin, position);
+    glm_vec3_copy(direction, ray);
+    glm_vec3_zero(radiance);
+
+    for (int bounce = 0; bounce <= settings->bounces; bounce++)
+    {
+        BvhHit hit;
+        (*rays)++;
+        if (!Bvh_intersect(scene, position, ray, FLT_MAX, &hit))
+        {
+            glm_vec3_muladd(throughput, (float *)settings->skyColor, radiance);
+            break;
+        }
+
+        if (glm_vec3_dot(hit.normal, ray) > 0.0f)
+            glm_vec3_negate(hit.normal);
+
+        glm_vec3_muladds(ray, hit.t, position);
+        glm_vec3_muladds(hit.normal, SURFACE_OFFSET, position);
+
+        float sunCosine = glm_vec3_dot(hit.normal, toSun);
+        if (sunCosine > 0.0f)
+        {
+            (*rays)++;
+            if (!Bvh_occluded(scene, position, toSun, FLT_MAX))
+            {
+                vec3 direct;
+                glm_vec3_scale((float *)settings->sunColor, settings->albedo / GLM_PIf * sunCosine, direct);
+                glm_vec3_muladd(throughput, direct, radiance);
+            }
+        }
+
+        if (bounce == settings->bounces)
+            break;
+
+        glm_vec3_scale(throughput, settings->albedo, throughput);
+        sampleCosine(seed, hit.normal, ray);
+    }
+}
+
+static void bakeProbes(void *data, int start, int end)
+{
+    BakeJob *job = data;
+    ProbeGrid *grid = job->grid;
+    const ProbeBakeSettings *settings = job->settings;
+
+    // cosine lobe convolution per band, over pi
+    static const float bands[PROBE_COEFFICIENTS] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+
+    for (int probe = start; probe < end; probe++)
+    {
+        int x = probe % grid->counts[0];
+        int y = probe / grid->counts[0] % grid->counts[1];
+        int z = probe / (grid->counts[0] * grid->counts[1]);
+
+        vec3 origin;
+        Probe_position(grid, x, y, z, origin);
+
+        // seeded by the probe alone, so the schedule cannot change the result
+        Uint32 seed = settings->seed ^ ((Uint32)probe * 0x9E3779B9u);
+        randomUnit(&seed);
+
+        float sh[PROBE_COEFFICIENTS][3] = {{0.0f}};
+        for (int s = 0; s < settings->samples; s++)
+        {
+            vec3 direction, radiance;
+            sampleSphere(&seed, direction);
+            tracePath(job->scene, settings, &seed, origin, direction, radiance, &job->rays[probe]);
+
+            float basis[PROBE_COEFFICIENTS];
+            shBasis(direction, basis);
+            for (int k = 0; k < PROBE_COEFFICIENTS; k++)
+            {
+                for (int c = 0; c < 3; c++)
+                    sh[k][c] += radiance[c] * basis[k];
+            }
+        }
+
+        // uniform sphere sampling, pdf 1 / 4pi
+        float weight = 4.0f * GLM_PIf / glm_max((float)settings->samples, 1.0f);
+        float *coefficients = &grid->coefficients[probe * PROBE_TEXELS * 4];
+        for (int k = 0; k < PROBE_COEFFICIENTS; k++)
+        {
+            for (int c = 0; c < 3; c++)
+                coefficients[k * 3 + c] = sh[k][c] * weight * bands[k];
+        }
+        coefficients[PROBE_TEXELS * 4 - 1] = 0.0f;
+    }
+}
+
+void Probe_init(ProbeGrid *grid, vec3 min, vec3 max, int countX, int countY, int countZ)
+{
+    SDL_memset(grid, 0, sizeof(ProbeGrid));
+    grid->counts[0] = SDL_max(countX, 2);
+    grid->counts[1] = SDL_max(countY, 2);
+    grid->counts[2] = SDL_max(countZ, 2);
+    glm_vec3_copy(min, grid->min);
+    glm_vec3_copy(max, grid->max);
+
+    int probes = grid->counts[0] * grid->counts[1] * grid->counts[2];
+    grid->coefficients = SDL_calloc(probes * PROBE_TEXELS * 4, sizeof(float));
+    grid->stats.probes = probes;
+
+    glGenTextures(1, &grid->texture);
+    GLState_bindTexture(0, GL_TEXTURE_3D, grid->texture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, grid->counts[0], grid->counts[1], grid->counts[2] * PROBE_TEXELS, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    GLState_bindTexture(0, GL_TEXTURE_3D, 0);
+}
+
+void Probe_free(ProbeGrid *grid)
+{
+    glDeleteTextures(1, &grid->texture);
+    GLState_invalidate();
+
+    SDL_free(grid->coefficients);
+    SDL_memset(grid, 0, sizeof(ProbeGrid));
+}
+
+void Probe_position(const ProbeGrid *grid, int x, int y, int z, vec3 position)
+{
+    int cell[3] = {x, y, z};
+    for (int axis = 0; axis < 3; axis++)
+        position[axis] = grid->min[axis] + (grid->max[axis] - grid->min[axis]) * cell[axis] / (grid->counts[axis] - 1);
+}
+
+void Probe_bake(ProbeGrid *grid, const Bvh *scene, const ProbeBakeSettings *settings)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    int probes = grid->stats.probes;
+    BakeJob job = {grid, scene, settings, SDL_calloc(probes, sizeof(long long))};
+    Job_parallelFor(probes, 1, bakeProbes, &job);
+
+    grid->stats.rays = 0;
+    for (int probe = 0; probe < probes; probe++)
+        grid->stats.rays += job.rays[probe];
+    SDL_free(job.rays);
+
+    // slab i of the texture holds texel i of every probe
+    int countX = grid->counts[0], countY = grid->counts[1], countZ = grid->counts[2];
+    float *texels = SDL_malloc(probes * PROBE_TEXELS * 4 * sizeof(float));
+    for (int slab = 0; slab < PROBE_TEXELS; slab++)
+    {
+        for (int probe = 0; probe < probes; probe++)
+        {
+            int layer = slab * countZ + probe / (countX * countY);
+            float *texel = &texels[((size_t)layer * countX * countY + probe % (countX * countY)) * 4];
+            SDL_memcpy(texel, &grid->coefficients[(probe * PROBE_TEXELS + slab) * 4], 4 * sizeof(float));
+        }
+    }
+
+    GLState_bindTexture(0, GL_TEXTURE_3D, grid->texture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, countX, countY, countZ * PROBE_TEXELS, GL_RGBA, GL_FLOAT, texels);
+    GLState_bindTexture(0, GL_TEXTURE_3D, 0);
+    SDL_free(texels);
+
+    grid->stats.bakeMs = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+void Probe_bind(ProbeGrid *grid, GLuint program, int unit)
+{
+    if (grid->program != program)
+    {
+        grid->program = program;
+        grid->locations[0] = glGetUniformLocation(program, "probeGrid");
+        grid->locations[1] = glGetUniformLocation(program, "probeMin");
+        grid->locations[2] = glGetUniformLocation(program, "probeMax");
+        grid->locations[3] = glGetUniformLocation(program, "probeCounts");
+    }
+
+    GLState_bindTexture(unit, GL_TEXTURE_3D, grid->texture);
+    glUniform1i(grid->locations[0], unit);
+    glUniform3fv(grid->locations[1], 1, grid->min);
+    glUniform3fv(grid->locations[2], 1, grid->max);
+    glUniform3iv(grid->locations[3], 1, grid->counts);
+}
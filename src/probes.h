@@ -0,0 +1,69 @@
+#ifndef PROBES_INCLUDED
+#define PROBES_INCLUDED
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "cglm/cglm.h"
+
+#include "bvh.h"
+
+// A grid of irradiance probes baked on the CPU. Every probe path traces the
+// static scene in all directions and projects the radiance it sees onto L2
+// spherical harmonics, already convolved with the cosine lobe and divided by
+// pi, so a shader gets diffuse ambient as albedo times the nine coefficients
+// evaluated along the normal.
+//
+// The 27 floats of a probe go into PROBE_TEXELS RGBA texels, coefficient k
+// channel c at float 3k + c. They are stored in one 3D texture as that many
+// slabs of the grid stacked along z, slab i holding texel i of every probe;
+// clamping the lookup to the texel centres of a slab keeps trilinear
+// filtering from bleeding into the next one.
+#define PROBE_COEFFICIENTS 9
+#define PROBE_TEXELS 7
+
+typedef struct ProbeBakeSettings
+{
+    vec3 skyColor;     // radiance of rays that escape
+    vec3 sunDirection; // the way the light travels
+    vec3 sunColor;
+    float albedo;      // of every surface
+
+    int samples; // paths per probe
+    int bounces;
+    Uint32 seed; // same seed, same bake, on any number of workers
+} ProbeBakeSettings;
+
+typedef struct ProbeStats
+{
+    int probes;
+    long long rays; // every intersection and shadow query
+    double bakeMs;
+} ProbeStats;
+
+typedef struct ProbeGrid
+{
+    int counts[3];
+    vec3 min, max; // first and last probe positions
+
+    float *coefficients; // PROBE_TEXELS * 4 per probe, x fastest
+    GLuint texture;
+
+    GLuint program; // the uniform locations below belong to it
+    GLint locations[4];
+
+    ProbeStats stats;
+} ProbeGrid;
+
+void Probe_init(ProbeGrid *grid, vec3 min, vec3 max, int countX, int countY, int countZ);
+void Probe_free(ProbeGrid *grid);
+
+void Probe_position(const ProbeGrid *grid, int x, int y, int z, vec3 position);
+
+// traces every probe over the job system, then uploads the texture
+void Probe_bake(ProbeGrid *grid, const Bvh *scene, const ProbeBakeSettings *settings);
+
+// Binds the texture to unit and sets probeGrid (sampler3D), probeMin,
+// probeMax and probeCounts on the bound program.
+void Probe_bind(ProbeGrid *grid, GLuint program, int unit);
+
+#endif
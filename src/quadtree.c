@@ -0,0 +1,161 @@
+#include <float.h>
+#include <SDL2/SDL.h>
+
+#include "quadtree.h"
+
+#define QUADTREE_MAX_DEPTH 10
+
+static int allocNodes(Quadtree *tree, int count)
+{
+    if (tree->nodeCount + count > tree->nodeCapacity)
+    {
+        tree->nodeCapacity = SDL_max(tree->nodeCapacity * 2, tree->nodeCount + count);
+        tree->nodes = SDL_realloc(tree->nodes, tree->nodeCapacity * sizeof(QuadtreeNode));
+    }
+
+    int first = tree->nodeCount;
+    tree->nodeCount += count;
+    return first;
+}
+
+static void buildNode(Quadtree *tree, int index, int first, int count, int leafSize, int depth, int *scratch)
+{
+    QuadtreeNode *node = &tree->nodes[index];
+    node->first = first;
+    node->count = count;
+    node->firstChild = -1;
+
+    glm_vec3_fill(node->min, FLT_MAX);
+    glm_vec3_fill(node->max, -FLT_MAX);
+    for (int i = first; i < first + count; i++)
+    {
+        glm_vec3_minv(node->min, tree->mins[tree->items[i]], node->min);
+        glm_vec3_maxv(node->max, tree->maxs[tree->items[i]], node->max);
+    }
+
+    if (count <= leafSize || depth >= QUADTREE_MAX_DEPTH)
+        return;
+
+    // split the node's box at its centre on X and Z, bucketing objects by centre
+    float midX = (node->min[0] + node->max[0]) * 0.5f;
+    float midZ = (node->min[2] + node->max[2]) * 0.5f;
+
+    int bucketCount[4] = {0};
+    for (int i = first; i < first + count; i++)
+    {
+        int item = tree->items[i];
+        int q = ((tree->mins[item][0] + tree->maxs[item][0]) * 0.5f >= midX) |
+                (((tree->mins[item][2] + tree->maxs[item][2]) * 0.5f >= midZ) << 1);
+        scratch[i] = q;
+        bucketCount[q]++;
+    }
+
+    // every centre in one bucket would recurse forever
+    for (int q = 0; q < 4; q++)
+    {
+        if (bucketCount[q] == count)
+            return;
+    }
+
+    int bucketStart[4];
+    int offset = first;
+    for (int q = 0; q < 4; q++)
+    {
+        bucketStart[q] = offset;
+        offset += bucketCount[q];
+    }
+
+    int *sorted = SDL_malloc(count * sizeof(int));
+    int cursor[4] = {bucketStart[0], bucketStart[1], bucketStart[2], bucketStart[3]};
+    for (int i = first; i < first + count; i++)
+    {
+        sorted[cursor[scratch[i]]++ - first] = tree->items[i];
+    }
+    SDL_memcpy(tree->items + first, sorted, count * sizeof(int));
+    SDL_free(sorted);
+
+    int firstChild = allocNodes(tree, 4);
+    tree->nodes[index].firstChild = firstChild;
+
+    for (int q = 0; q < 4; q++)
+    {
+        buildNode(tree, firstChild + q, bucketStart[q], bucketCount[q], leafSize, depth + 1, scratch);
+    }
+}
+
+void Quadtree_build(Quadtree *tree, vec3 *mins, vec3 *maxs, int count, int leafSize)
+{
+    SDL_memset(tree, 0, sizeof(Quadtree));
+
+    tree->count = count;
+    tree->items = SDL_malloc(SDL_max(count, 1) * sizeof(int));
+    tree->mins = SDL_malloc(SDL_max(count, 1) * sizeof(vec3));
+    tree->maxs = SDL_malloc(SDL_max(count, 1) * sizeof(vec3));
+    for (int i = 0; i < count; i++)
+    {
+        tree->items[i] = i;
+        glm_vec3_copy(mins[i], tree->mins[i]);
+        glm_vec3_copy(maxs[i], tree->maxs[i]);
+    }
+
+    int *scratch = SDL_malloc(SDL_max(count, 1) * sizeof(int));
+    buildNode(tree, allocNodes(tree, 1), 0, count, SDL_max(leafSize, 1), 0, scratch);
+    SDL_free(scratch);
+}
+
+void Quadtree_free(Quadtree *tree)
+{
+    SDL_free(tree->nodes);
+    SDL_free(tree->items);
+    SDL_free(tree->mins);
+    SDL_free(tree->maxs);
+    SDL_memset(tree, 0, sizeof(Quadtree));
+}
+
+static int cullNode(const Quadtree *tree, int index, const Frustum *frustum, int planeMask, int *visible, CullStats *stats)
+{
+    const QuadtreeNode *node = &tree->nodes[index];
+    if (node->count == 0)
+        return 0;
+
+    stats->tested++;
+    FrustumResult result = Frustum_testAABB(frustum, (float *)node->min, (float *)node->max, &planeMask);
+    if (result == FRUSTUM_OUTSIDE)
+        return 0;
+
+    // nothing below can be outside, take the whole range
+    if (result == FRUSTUM_INSIDE)
+    {
+        SDL_memcpy(visible, tree->items + node->first, node->count * sizeof(int));
+        return node->count;
+    }
+
+    int written = 0;
+    if (node->firstChild >= 0)
+    {
+        for (int q = 0; q < 4; q++)
+        {
+            written += cullNode(tree, node->firstChild + q, frustum, planeMask, visible + written, stats);
+        }
+        return written;
+    }
+
+    for (int i = node->first; i < node->first + node->count; i++)
+    {
+        int item = tree->items[i];
+        int itemMask = planeMask;
+
+        stats->tested++;
+        if (Frustum_testAABB(frustum, tree->mins[item], tree->maxs[item], &itemMask) != FRUSTUM_OUTSIDE)
+            visible[written++] = item;
+    }
+
+    return written;
+}
+
+int Quadtree_cull(const Quadtree *tree, const Frustum *frustum, int *visible, CullStats *stats)
+{
+    stats->tested = 0;
+    stats->visible = cullNode(tree, 0, frustum, FRUSTUM_ALL_PLANES, visible, stats);
+    return stats->visible;
+}
@@ -0,0 +1,34 @@
+#ifndef QUADTREE_INCLUDED
+#define QUADTREE_INCLUDED
+
+#include "cglm/cglm.h"
+#include "frustum.h"
+
+// Static bounding-volume quadtree over object AABBs, split on X/Z. Every
+// node's objects are contiguous in items, so a subtree that is fully inside
+// the frustum is emitted without testing anything below it.
+typedef struct QuadtreeNode
+{
+    vec3 min, max;  // union of the boxes of everything below
+    int firstChild; // four consecutive nodes, -1 for a leaf
+    int first, count;
+} QuadtreeNode;
+
+typedef struct Quadtree
+{
+    QuadtreeNode *nodes;
+    int nodeCount;
+    int nodeCapacity;
+
+    int *items; // object indices
+    vec3 *mins, *maxs;
+    int count;
+} Quadtree;
+
+void Quadtree_build(Quadtree *tree, vec3 *mins, vec3 *maxs, int count, int leafSize);
+void Quadtree_free(Quadtree *tree);
+
+// Writes the indices of visible objects to visible and returns how many.
+int Quadtree_cull(const Quadtree *tree, const Frustum *frustum, int *visible, CullStats *stats);
+
+#endif
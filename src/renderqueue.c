@@ -0,0 +1,200 @@
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "renderqueue.h"
+#include "glstate.h"
+
+#define LAYER_BITS 4
+#define PROGRAM_BITS 12
+#define MATERIAL_BITS 16
+#define VAO_BITS 12
+#define DEPTH_BITS 20
+
+#define DEPTH_SHIFT 0
+#define VAO_SHIFT (DEPTH_SHIFT + DEPTH_BITS)
+#define MATERIAL_SHIFT (VAO_SHIFT + VAO_BITS)
+#define PROGRAM_SHIFT (MATERIAL_SHIFT + MATERIAL_BITS)
+#define LAYER_SHIFT (PROGRAM_SHIFT + PROGRAM_BITS)
+
+static inline uint64_t field(uint64_t value, int bits, int shift)
+{
+    return (value & ((1ULL << bits) - 1)) << shift;
+}
+
+// GL names wider than their field only share a slot, they still get bound
+uint64_t RenderQueue_key(int layer, GLuint program, int material, GLuint vao, float depth)
+{
+    depth = SDL_clamp(depth, 0.0f, 1.0f);
+    uint64_t quantized = (uint64_t)(depth * (float)((1 << DEPTH_BITS) - 1));
+
+    return field(layer, LAYER_BITS, LAYER_SHIFT) |
+           field(program, PROGRAM_BITS, PROGRAM_SHIFT) |
+           field(material, MATERIAL_BITS, MATERIAL_SHIFT) |
+           field(vao, VAO_BITS, VAO_SHIFT) |
+           field(quantized, DEPTH_BITS, DEPTH_SHIFT);
+}
+
+void RenderQueue_init(RenderQueue *queue, int capacity)
+{
+    queue->count = 0;
+    queue->capacity = capacity;
+    queue->commands = SDL_malloc(capacity * sizeof(RenderCommand));
+    queue->items = SDL_malloc(capacity * sizeof(RenderSortItem));
+    queue->scratch = SDL_malloc(capacity * sizeof(RenderSortItem));
+
+    SDL_zero(queue->stats);
+}
+
+void RenderQueue_free(RenderQueue *queue)
+{
+    SDL_free(queue->commands);
+    SDL_free(queue->items);
+    SDL_free(queue->scratch);
+
+    queue->count = 0;
+    queue->capacity = 0;
+}
+
+void RenderQueue_submit(RenderQueue *queue, const RenderCommand *command)
+{
+    if (queue->count >= queue->capacity)
+    {
+        SDL_Log("RenderQueue full (capacity %d)", queue->capacity);
+        return;
+    }
+
+    queue->commands[queue->count] = *command;
+    queue->items[queue->count].key = command->key;
+    queue->items[queue->count].index = queue->count;
+    queue->count++;
+}
+
+// LSD radix sort, a byte per pass. It is stable, so equal keys keep their
+// submission order, and passes where every key has the same byte are skipped.
+static void sortItems(RenderQueue *queue)
+{
+    RenderSortItem *source = queue->items;
+    RenderSortItem *target = queue->scratch;
+    int count = queue->count;
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        int offsets[256] = {0};
+        for (int i = 0; i < count; i++)
+            offsets[(source[i].key >> shift) & 0xff]++;
+
+        if (offsets[(source[0].key >> shift) & 0xff] == count)
+            continue;
+
+        int sum = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            int bucket = offsets[digit];
+            offsets[digit] = sum;
+            sum += bucket;
+        }
+
+        for (int i = 0; i < count; i++)
+            target[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+
+        RenderSortItem *swap = source;
+        source = target;
+        target = swap;
+    }
+
+    // an odd number of passes leaves the result in the scratch buffer
+    if (source != queue->items)
+    {
+        queue->scratch = queue->items;
+        queue->items = source;
+    }
+}
+
+typedef struct BoundState
+{
+    GLuint program;
+    GLuint vao;
+    GLuint textures[RENDER_MAX_TEXTURES];
+} BoundState;
+
+static void currentState(BoundState *state)
+{
+    state->program = GLState_program();
+    state->vao = GLState_vertexArray();
+    for (int unit = 0; unit < RENDER_MAX_TEXTURES; unit++)
+        state->textures[unit] = GLState_texture(unit, GL_TEXTURE_2D);
+}
+
+// applies a command to the simulated state, counting what would need binding
+static void track(BoundState *state, const RenderCommand *command, RenderSwitches *switches)
+{
+    switches->programs += state->program != command->program;
+    switches->vaos += state->vao != command->vao;
+    state->program = command->program;
+    state->vao = command->vao;
+
+    if (command->material)
+    {
+        for (int unit = 0; unit < command->material->textureCount; unit++)
+        {
+            switches->textures += state->textures[unit] != command->material->textures[unit];
+            state->textures[unit] = command->material->textures[unit];
+        }
+    }
+}
+
+void RenderQueue_execute(RenderQueue *queue)
+{
+    RenderQueueStats *stats = &queue->stats;
+    SDL_zero(*stats);
+    stats->draws = queue->count;
+
+    if (queue->count == 0)
+        return;
+
+    BoundState state;
+    currentState(&state);
+    for (int i = 0; i < queue->count; i++)
+        track(&state, &queue->commands[i], &stats->unsorted);
+
+    Uint64 sortStart = SDL_GetPerformanceCounter();
+    sortItems(queue);
+    stats->sortMs = (double)(SDL_GetPerformanceCounter() - sortStart) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+    currentState(&state);
+    for (int i = 0; i < queue->count; i++)
+        track(&state, &queue->commands[queue->items[i].index], &stats->sorted);
+
+    for (int i = 0; i < queue->count; i++)
+    {
+        const RenderCommand *command = &queue->commands[queue->items[i].index];
+
+        GLState_useProgram(command->program);
+        GLState_bindVertexArray(command->vao);
+
+        if (command->material)
+        {
+            for (int unit = 0; unit < command->material->textureCount; unit++)
+                GLState_bindTexture(unit, GL_TEXTURE_2D, command->material->textures[unit]);
+        }
+
+        if (command->setup)
+            command->setup(command);
+
+        if (command->indexType)
+        {
+            int indexSize = command->indexType == GL_UNSIGNED_INT ? 4 : (command->indexType == GL_UNSIGNED_SHORT ? 2 : 1);
+            void *offset = (void *)(uintptr_t)(command->first * indexSize);
+            if (command->instances > 0)
+                glDrawElementsInstancedBaseVertex(command->mode, command->count, command->indexType, offset, command->instances, command->baseVertex);
+            else
+                glDrawElementsBaseVertex(command->mode, command->count, command->indexType, offset, command->baseVertex);
+        }
+        else if (command->instances > 0)
+            glDrawArraysInstanced(command->mode, command->first, command->count, command->instances);
+        else
+            glDrawArrays(command->mode, command->first, command->count);
+    }
+
+    queue->count = 0;
+}
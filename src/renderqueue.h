@@ -0,0 +1,94 @@
+#ifndef RENDERQUEUE_INCLUDED
+#define RENDERQUEUE_INCLUDED
+
+#include <stdint.h>
+#include <GL/glew.h>
+
+// Draws are recorded with a 64-bit sort key and executed in key order, so
+// draws sharing a program, material or VAO end up next to each other. State
+// goes through the GL state cache, so it is only touched when it changes.
+//
+// Key layout, most significant bits first:
+//   layer 4 | program 12 | material 16 | vao 12 | depth 20
+#define RENDER_MAX_LAYERS 16
+#define RENDER_MAX_TEXTURES 4
+
+typedef struct RenderMaterial
+{
+    int id; // sort id, unique per material
+    int textureCount;
+    GLuint textures[RENDER_MAX_TEXTURES]; // bound to units 0..textureCount-1 as GL_TEXTURE_2D
+} RenderMaterial;
+
+typedef struct RenderCommand RenderCommand;
+
+// Called after the command's state is bound, for per draw uniforms and
+// uploads. It must not change the program, VAO or material textures itself.
+typedef void (*RenderSetupFn)(const RenderCommand *command);
+
+struct RenderCommand
+{
+    uint64_t key;
+
+    GLuint program;
+    GLuint vao;
+    const RenderMaterial *material; // NULL leaves the texture units alone
+
+    GLenum mode;
+    GLenum indexType; // 0 for glDrawArrays, else elements from the VAO's index buffer
+    int first;        // first vertex, or first index
+    int count;
+    int baseVertex;   // added to every index, for meshes sharing a buffer
+    int instances; // 0 draws without instancing
+
+    RenderSetupFn setup;
+    void *data;
+};
+
+typedef struct RenderSwitches
+{
+    int programs;
+    int textures; // per texture unit
+    int vaos;
+} RenderSwitches;
+
+typedef struct RenderQueueStats
+{
+    int draws;
+    RenderSwitches unsorted; // what submission order would have cost
+    RenderSwitches sorted;   // what was actually issued
+    double sortMs;
+} RenderQueueStats;
+
+typedef struct RenderSortItem
+{
+    uint64_t key;
+    int index;
+} RenderSortItem;
+
+typedef struct RenderQueue
+{
+    int count;
+    int capacity;
+    RenderCommand *commands;
+
+    // sorted instead of the commands, with the radix sort's second buffer
+    RenderSortItem *items;
+    RenderSortItem *scratch;
+
+    RenderQueueStats stats;
+} RenderQueue;
+
+// depth is the normalized view distance in [0, 1]; pass 1 - depth in
+// translucent layers to draw them back to front
+uint64_t RenderQueue_key(int layer, GLuint program, int material, GLuint vao, float depth);
+
+void RenderQueue_init(RenderQueue *queue, int capacity);
+void RenderQueue_free(RenderQueue *queue);
+
+void RenderQueue_submit(RenderQueue *queue, const RenderCommand *command);
+
+// sorts, draws and empties the queue
+void RenderQueue_execute(RenderQueue *queue);
+
+#endif
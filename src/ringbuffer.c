@@ -0,0 +1,150 @@
+#include <SDL2/SDL.h>
+
+#include "ringbuffer.h"
+#include "glstate.h"
+
+// how long a single glClientWaitSync blocks before checking again
+#define FENCE_TIMEOUT_NS 1000000
+
+void RingBuffer_init(RingBuffer *ring, GLenum target, size_t regionSize)
+{
+    SDL_zerop(ring);
+    ring->target = target;
+
+    // keep every region start aligned for any vertex or uniform data
+    ring->regionSize = (regionSize + 255) & ~(size_t)255;
+    size_t size = ring->regionSize * RING_FRAMES;
+
+    glGenBuffers(1, &ring->buffer);
+    GLState_bindBuffer(target, ring->buffer);
+
+    ring->persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if (ring->persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, size, NULL, flags);
+        ring->memory = glMapBufferRange(target, 0, size, flags);
+        if (!ring->memory)
+        {
+            SDL_Log("RingBuffer: persistent mapping failed, falling back to orphaning");
+
+            // immutable storage cannot be respecified, start over with a new name
+            GLState_bindBuffer(target, 0);
+            glDeleteBuffers(1, &ring->buffer);
+            glGenBuffers(1, &ring->buffer);
+            GLState_bindBuffer(target, ring->buffer);
+            ring->persistent = false;
+        }
+    }
+
+    if (!ring->persistent)
+    {
+        glBufferData(target, ring->regionSize, NULL, GL_STREAM_DRAW);
+        ring->memory = SDL_malloc(ring->regionSize);
+    }
+
+    // start on the last region so the first beginFrame moves to region 0
+    ring->frame = RING_FRAMES - 1;
+}
+
+void RingBuffer_free(RingBuffer *ring)
+{
+    for (int i = 0; i < RING_FRAMES; i++)
+    {
+        if (ring->fences[i])
+            glDeleteSync(ring->fences[i]);
+    }
+
+    if (ring->persistent)
+    {
+        GLState_bindBuffer(ring->target, ring->buffer);
+        glUnmapBuffer(ring->target);
+    }
+    else
+    {
+        SDL_free(ring->memory);
+    }
+
+    GLState_bindBuffer(ring->target, 0);
+    glDeleteBuffers(1, &ring->buffer);
+    SDL_zerop(ring);
+}
+
+void RingBuffer_beginFrame(RingBuffer *ring)
+{
+    ring->frame = (ring->frame + 1) % RING_FRAMES;
+    ring->head = 0;
+    ring->flushed = 0;
+    ring->stats.used = 0;
+    ring->stats.overflows = 0;
+    ring->stats.waitMs = 0.0;
+
+    GLsync fence = ring->fences[ring->frame];
+    if (fence)
+    {
+        Uint64 waitStart = SDL_GetPerformanceCounter();
+
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        GLenum status;
+        while ((status = glClientWaitSync(fence, flags, FENCE_TIMEOUT_NS)) == GL_TIMEOUT_EXPIRED)
+            flags = 0;
+
+        if (status == GL_WAIT_FAILED)
+            SDL_Log("RingBuffer: fence wait failed");
+
+        glDeleteSync(fence);
+        ring->fences[ring->frame] = NULL;
+        ring->stats.waitMs = (double)(SDL_GetPerformanceCounter() - waitStart) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    }
+
+    if (!ring->persistent)
+    {
+        // orphan: the driver hands back fresh storage instead of stalling on the old one
+        GLState_bindBuffer(ring->target, ring->buffer);
+        glBufferData(ring->target, ring->regionSize, NULL, GL_STREAM_DRAW);
+    }
+}
+
+void RingBuffer_endFrame(RingBuffer *ring)
+{
+    // only the persistent mapping is ever written while the GPU may read it
+    if (ring->persistent)
+        ring->fences[ring->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void *RingBuffer_alloc(RingBuffer *ring, size_t size, size_t alignment, size_t *offset)
+{
+    if (alignment == 0)
+        alignment = 1;
+
+    size_t start = (ring->head + alignment - 1) / alignment * alignment;
+    if (start + size > ring->regionSize)
+    {
+        ring->stats.overflows++;
+        return NULL;
+    }
+
+    ring->head = start + size;
+    ring->stats.used = ring->head;
+
+    if (ring->persistent)
+    {
+        size_t regionStart = (size_t)ring->frame * ring->regionSize;
+        *offset = regionStart + start;
+        return ring->memory + regionStart + start;
+    }
+
+    *offset = start;
+    return ring->memory + start;
+}
+
+void RingBuffer_flush(RingBuffer *ring)
+{
+    GLState_bindBuffer(ring->target, ring->buffer);
+
+    if (ring->persistent || ring->flushed == ring->head)
+        return;
+
+    glBufferSubData(ring->target, ring->flushed, ring->head - ring->flushed, ring->memory + ring->flushed);
+    ring->flushed = ring->head;
+}
@@ -0,0 +1,62 @@
+#ifndef RINGBUFFER_INCLUDED
+#define RINGBUFFER_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <GL/glew.h>
+
+// Streaming buffer for geometry the CPU rewrites every frame. The buffer is
+// split into one region per frame in flight; a frame bump-allocates from its
+// region and fences it when done, and the region is only written again once
+// that fence has signalled.
+//
+// With glBufferStorage the whole buffer stays persistently and coherently
+// mapped, so filling an allocation is the only copy. On plain GL 3.3 the
+// allocations are staged in memory, the buffer is orphaned at the start of
+// each frame and RingBuffer_flush uploads what was written since the last
+// flush.
+#define RING_FRAMES 3
+
+typedef struct RingBufferStats
+{
+    size_t used;     // bytes allocated this frame
+    int overflows;   // allocations that did not fit
+    double waitMs;   // time blocked on the region's fence
+} RingBufferStats;
+
+typedef struct RingBuffer
+{
+    GLuint buffer;
+    GLenum target;
+    bool persistent;
+
+    size_t regionSize;
+    int frame;      // region being filled
+    size_t head;    // next free byte in the region
+    size_t flushed; // staged bytes already uploaded
+
+    unsigned char *memory; // mapped buffer, or the staging copy of one region
+    GLsync fences[RING_FRAMES];
+
+    RingBufferStats stats;
+} RingBuffer;
+
+// regionSize is the most a single frame can allocate. target is where the
+// buffer gets bound for uploads; not GL_ELEMENT_ARRAY_BUFFER, which would
+// rebind the current VAO's indices.
+void RingBuffer_init(RingBuffer *ring, GLenum target, size_t regionSize);
+void RingBuffer_free(RingBuffer *ring);
+
+// waits until the next region is no longer read by the GPU
+void RingBuffer_beginFrame(RingBuffer *ring);
+void RingBuffer_endFrame(RingBuffer *ring);
+
+// Returns memory to write size bytes into, or NULL when the frame's region
+// is full. *offset is where the data will be in the buffer, a multiple of
+// alignment; 0 means no alignment.
+void *RingBuffer_alloc(RingBuffer *ring, size_t size, size_t alignment, size_t *offset);
+
+// makes everything allocated so far visible to draws; binds the buffer
+void RingBuffer_flush(RingBuffer *ring);
+
+#endif
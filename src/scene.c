@@ -0,0 +1,161 @@
+#include <SDL2/SDL.h>
+
+#include "scene.h"
+
+void Scene_init(Scene *scene, int capacity)
+{
+    SDL_zerop(scene);
+    scene->capacity = capacity;
+
+    scene->parents = SDL_malloc(capacity * sizeof(int));
+    scene->subtreeSizes = SDL_malloc(capacity * sizeof(int));
+    scene->translations = SDL_malloc(capacity * sizeof(vec3));
+    scene->scales = SDL_malloc(capacity * sizeof(vec3));
+
+    // cglm loads these with aligned SIMD
+    scene->rotations = SDL_SIMDAlloc(capacity * sizeof(versor));
+    scene->worlds = SDL_SIMDAlloc(capacity * sizeof(mat4));
+
+    scene->dirty = SDL_calloc(capacity, sizeof(bool));
+    scene->dirtyNodes = SDL_malloc(capacity * sizeof(int));
+}
+
+void Scene_free(Scene *scene)
+{
+    SDL_free(scene->parents);
+    SDL_free(scene->subtreeSizes);
+    SDL_free(scene->translations);
+    SDL_free(scene->scales);
+    SDL_SIMDFree(scene->rotations);
+    SDL_SIMDFree(scene->worlds);
+    SDL_free(scene->dirty);
+    SDL_free(scene->dirtyNodes);
+
+    SDL_zerop(scene);
+}
+
+static void markDirty(Scene *scene, int node)
+{
+    if (scene->dirty[node])
+        return;
+
+    scene->dirty[node] = true;
+    scene->dirtyNodes[scene->dirtyCount++] = node;
+}
+
+int Scene_add(Scene *scene, int parent, vec3 translation, versor rotation, vec3 scale)
+{
+    if (scene->count >= scene->capacity)
+    {
+        SDL_Log("Scene full (capacity %d)", scene->capacity);
+        return -1;
+    }
+
+    if (parent >= scene->count || (parent >= 0 && parent + scene->subtreeSizes[parent] != scene->count))
+    {
+        SDL_Log("Scene: node %d cannot take children after its subtree has ended", parent);
+        return -1;
+    }
+
+    int node = scene->count++;
+    scene->parents[node] = parent;
+    scene->subtreeSizes[node] = 1;
+    glm_vec3_copy(translation, scene->translations[node]);
+    glm_quat_copy(rotation, scene->rotations[node]);
+    glm_vec3_copy(scale, scene->scales[node]);
+
+    for (int ancestor = parent; ancestor >= 0; ancestor = scene->parents[ancestor])
+        scene->subtreeSizes[ancestor]++;
+
+    scene->dirty[node] = false;
+    markDirty(scene, node);
+    return node;
+}
+
+void Scene_setTranslation(Scene *scene, int node, vec3 translation)
+{
+    glm_vec3_copy(translation, scene->translations[node]);
+    markDirty(scene, node);
+}
+
+void Scene_setRotation(Scene *scene, int node, versor rotation)
+{
+    glm_quat_copy(rotation, scene->rotations[node]);
+    markDirty(scene, node);
+}
+
+void Scene_setScale(Scene *scene, int node, vec3 scale)
+{
+    glm_vec3_copy(scale, scene->scales[node]);
+    markDirty(scene, node);
+}
+
+static void composeLocal(const Scene *scene, int node, mat4 local)
+{
+    glm_quat_mat4(scene->rotations[node], local);
+    glm_vec4_scale(local[0], scene->scales[node][0], local[0]);
+    glm_vec4_scale(local[1], scene->scales[node][1], local[1]);
+    glm_vec4_scale(local[2], scene->scales[node][2], local[2]);
+    glm_vec3_copy(scene->translations[node], local[3]);
+}
+
+// a range starts at a node whose parent is already up to date, and every
+// later node's parent comes before it in the range or is that parent
+static void rebuildRange(Scene *scene, int start, int end)
+{
+    for (int node = start; node < end; node++)
+    {
+        int parent = scene->parents[node];
+        if (parent < 0)
+        {
+            composeLocal(scene, node, scene->worlds[node]);
+            continue;
+        }
+
+        mat4 local;
+        composeLocal(scene, node, local);
+        glm_mul(scene->worlds[parent], local, scene->worlds[node]);
+    }
+}
+
+static int compareNodes(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+void Scene_update(Scene *scene)
+{
+    scene->stats.dirty = scene->dirtyCount;
+    scene->stats.subtrees = 0;
+    scene->stats.rebuilt = 0;
+    if (scene->dirtyCount == 0)
+        return;
+
+    // in ascending order a subtree's own dirty nodes come right after it and
+    // are covered by its rebuild; the next one that is not starts a new range
+    SDL_qsort(scene->dirtyNodes, scene->dirtyCount, sizeof(int), compareNodes);
+
+    int covered = 0;
+    for (int i = 0; i < scene->dirtyCount; i++)
+    {
+        int node = scene->dirtyNodes[i];
+        scene->dirty[node] = false;
+        if (node < covered)
+            continue;
+
+        covered = node + scene->subtreeSizes[node];
+        rebuildRange(scene, node, covered);
+
+        scene->stats.subtrees++;
+        scene->stats.rebuilt += scene->subtreeSizes[node];
+    }
+
+    scene->dirtyCount = 0;
+}
+
+SceneStats Scene_stats(const Scene *scene)
+{
+    SceneStats stats = scene->stats;
+    stats.nodes = scene->count;
+    return stats;
+}
@@ -0,0 +1,60 @@
+#ifndef SCENE_INCLUDED
+#define SCENE_INCLUDED
+
+#include <stdbool.h>
+#include "cglm/cglm.h"
+
+// Transform hierarchy as flat arrays in depth-first order: every node comes
+// after its parent and its whole subtree follows it contiguously, so a
+// subtree is just the range [node, node + subtreeSize). Setting a local
+// transform only flags the node; Scene_update rebuilds the world matrices of
+// the flagged subtrees in one pass over each range, parents first. Nodes
+// nobody touched cost nothing.
+typedef struct SceneStats
+{
+    int nodes;
+    int dirty;    // nodes changed since the previous update
+    int subtrees; // ranges rebuilt, after merging nested ones
+    int rebuilt;  // world matrices computed
+} SceneStats;
+
+typedef struct Scene
+{
+    int count;
+    int capacity;
+
+    int *parents;      // -1 for roots
+    int *subtreeSizes; // the node itself included
+
+    // local transform: translate * rotate * scale
+    vec3 *translations;
+    versor *rotations;
+    vec3 *scales;
+
+    mat4 *worlds; // valid for every node after Scene_update
+
+    bool *dirty;
+    int *dirtyNodes;
+    int dirtyCount;
+
+    SceneStats stats;
+} Scene;
+
+void Scene_init(Scene *scene, int capacity);
+void Scene_free(Scene *scene);
+
+// Adds a node under parent, or a root with -1. To keep subtrees contiguous
+// the parent's subtree must end at the newest node, which is the case when a
+// hierarchy is built depth first. Returns the node, or -1 when the scene is
+// full or parent cannot take children any more.
+int Scene_add(Scene *scene, int parent, vec3 translation, versor rotation, vec3 scale);
+
+void Scene_setTranslation(Scene *scene, int node, vec3 translation);
+void Scene_setRotation(Scene *scene, int node, versor rotation);
+void Scene_setScale(Scene *scene, int node, vec3 scale);
+
+void Scene_update(Scene *scene);
+
+SceneStats Scene_stats(const Scene *scene);
+
+#endif
@@ -53,5 +53,100 @@ CreateProgram(char *vertexShaderPath, char *fragmentShaderPath)
     SDL_free(vertexShaderSource);
     SDL_free(fragmentShaderSource);
 
+    return shaderProgram;
+}
+
+unsigned int
+CreateFeedbackProgram(char *vertexShaderPath, const char **varyings, int varyingCount)
+{
+    void *vertexShaderSource = SDL_LoadFile(vertexShaderPath, NULL);
+
+    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, (const char **)&vertexShaderSource, NULL);
+    glCompileShader(vertexShader);
+
+    // check for shader compile errors
+    int success;
+    char infoLog[512];
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        SDL_Log("Vertex shader compile error: %s\n", infoLog);
+    }
+
+    // varyings have to be named before linking; no fragment shader, nothing is rasterized
+    GLuint shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glTransformFeedbackVaryings(shaderProgram, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(shaderProgram);
+
+    // check for linking errors
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+        SDL_Log("Shader program linking failed: %s\n", infoLog);
+    }
+    glDeleteShader(vertexShader);
+
+    SDL_free(vertexShaderSource);
+
+    return shaderProgram;
+}
+
+unsigned int
+CreateProgramWithShared(char *vertexShaderPath, char *sharedPath, char *fragmentShaderPath)
+{
+    void *vertexShaderSource = SDL_LoadFile(vertexShaderPath, NULL);
+    void *fragmentShaderSources[2] = {SDL_LoadFile(sharedPath, NULL), SDL_LoadFile(fragmentShaderPath, NULL)};
+
+    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, (const char **)&vertexShaderSource, NULL);
+    glCompileShader(vertexShader);
+
+    // check for shader compile errors
+    int success;
+    char infoLog[512];
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        SDL_Log("Vertex shader compile error: %s\n", infoLog);
+    }
+
+    // fragment shader, the shared code first
+    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 2, (const char **)fragmentShaderSources, NULL);
+    glCompileShader(fragmentShader);
+
+    // check for shader compile errors
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+        SDL_Log("Frag shader compile error: %s\n", infoLog);
+    }
+
+    // link shaders
+    GLuint shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    glLinkProgram(shaderProgram);
+
+    // check for linking errors
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+        SDL_Log("Shader program linking failed: %s\n", infoLog);
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    SDL_free(vertexShaderSource);
+    SDL_free(fragmentShaderSources[0]);
+    SDL_free(fragmentShaderSources[1]);
+
     return shaderProgram;
 }
\ No newline at end of file
@@ -6,4 +6,15 @@
 unsigned int
 CreateProgram(char *vertexShaderPath, char *fragmentShaderPath);
 
+// A vertex shader alone whose outputs are captured by transform feedback,
+// interleaved in the order given.
+unsigned int
+CreateFeedbackProgram(char *vertexShaderPath, const char **varyings, int varyingCount);
+
+// GLSL 3.30 has no #include, so code several fragment shaders use lives in a
+// file of its own that starts with the #version line; the fragment shader is
+// compiled from that file followed by its own.
+unsigned int
+CreateProgramWithShared(char *vertexShaderPath, char *sharedPath, char *fragmentShaderPath);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include <SDL2/SDL.h>
+
+#include "triplebuffer.h"
+
+#define TRIPLEBUFFER_FRESH 4
+#define TRIPLEBUFFER_INDEX 3
+
+void TripleBuffer_init(TripleBuffer *buffer, size_t size)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        buffer->slots[i] = SDL_calloc(1, size);
+    }
+
+    buffer->size = size;
+    buffer->back = 0;
+    SDL_AtomicSet(&buffer->middle, 1);
+    buffer->front = 2;
+}
+
+void TripleBuffer_free(TripleBuffer *buffer)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        SDL_free(buffer->slots[i]);
+        buffer->slots[i] = NULL;
+    }
+}
+
+void *TripleBuffer_writeSlot(TripleBuffer *buffer)
+{
+    return buffer->slots[buffer->back];
+}
+
+void TripleBuffer_publish(TripleBuffer *buffer)
+{
+    // SDL_AtomicSet is a full barrier, so the slot contents are visible
+    // before the reader can pick up its index
+    int previous = SDL_AtomicSet(&buffer->middle, buffer->back | TRIPLEBUFFER_FRESH);
+    buffer->back = previous & TRIPLEBUFFER_INDEX;
+}
+
+bool TripleBuffer_acquire(TripleBuffer *buffer)
+{
+    if (!(SDL_AtomicGet(&buffer->middle) & TRIPLEBUFFER_FRESH))
+        return false;
+
+    int previous = SDL_AtomicSet(&buffer->middle, buffer->front);
+    buffer->front = previous & TRIPLEBUFFER_INDEX;
+
+    return true;
+}
+
+const void *TripleBuffer_readSlot(TripleBuffer *buffer)
+{
+    return buffer->slots[buffer->front];
+}
@@ -0,0 +1,29 @@
+#ifndef TRIPLEBUFFER_INCLUDED
+#define TRIPLEBUFFER_INCLUDED
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+// Single producer / single consumer handoff of fixed-size snapshots.
+// The writer always has a slot to fill and the reader always sees the most
+// recently published one; neither side ever blocks the other.
+typedef struct TripleBuffer
+{
+    void *slots[3];
+    size_t size;
+
+    SDL_atomic_t middle; // slot index, TRIPLEBUFFER_FRESH set when unread
+    int back;
+    int front;
+} TripleBuffer;
+
+void TripleBuffer_init(TripleBuffer *buffer, size_t size);
+void TripleBuffer_free(TripleBuffer *buffer);
+
+void *TripleBuffer_writeSlot(TripleBuffer *buffer);
+void TripleBuffer_publish(TripleBuffer *buffer);
+
+bool TripleBuffer_acquire(TripleBuffer *buffer);
+const void *TripleBuffer_readSlot(TripleBuffer *buffer);
+
+#endif